@@ -0,0 +1,69 @@
+// Microbenchmark do cálculo de normais por vértice: versão escalar original contra a
+// versão SIMD + multithread. Gera uma malha em grade (com ruído) em memória.
+//
+// Uso: bench_normais [lado da grade] [repetições] [threads]
+
+#include "../src/normais.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+static void gerarGrade(int n, vector<float>& v, vector<unsigned int>& idx) {
+    v.clear(); idx.clear();
+    unsigned int semente = 12345u;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            semente = semente * 1664525u + 1013904223u;
+            const float ruido = (float)(semente >> 8) / 16777216.0f * 0.01f;
+            v.push_back((float)i / n);
+            v.push_back(0.1f * sinf(i * 0.05f) * cosf(j * 0.07f) + ruido);
+            v.push_back((float)j / n);
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            const unsigned int a = j * (n + 1) + i, b = a + 1, c = a + n + 2, d = a + n + 1;
+            idx.insert(idx.end(), { a, b, c, a, c, d });
+        }
+    }
+}
+
+template <class F>
+static double melhorTempoMs(int reps, F f) {
+    double melhor = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        const auto t0 = chrono::steady_clock::now();
+        f();
+        melhor = min(melhor, chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count());
+    }
+    return melhor;
+}
+
+int main(int argc, char** argv) {
+    const int lado = argc > 1 ? atoi(argv[1]) : 1000;
+    const int reps = argc > 2 ? atoi(argv[2]) : 5;
+    const int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+    vector<float> v; vector<unsigned int> idx;
+    gerarGrade(lado, v, idx);
+    printf("Malha: %zu vertices, %zu triangulos\n", v.size() / 3, idx.size() / 3);
+
+    vector<float> ref, rapida, umaThread;
+    const double tEscalar = melhorTempoMs(reps, [&] { calcularNormaisVerticeEscalar(v, idx, ref); });
+    const double tUma     = melhorTempoMs(reps, [&] { calcularNormaisVertice(v, idx, umaThread, 1); });
+    const double tRapida  = melhorTempoMs(reps, [&] { calcularNormaisVertice(v, idx, rapida, threads); });
+
+    float difMax = 0.0f;
+    for (size_t i = 0; i < ref.size(); ++i) difMax = max(difMax, fabsf(ref[i] - rapida[i]));
+
+    printf("escalar:            %8.2f ms\n", tEscalar);
+    printf("simd (1 thread):    %8.2f ms  (%.2fx)\n", tUma, tEscalar / tUma);
+    printf("simd (threads=%d):   %8.2f ms  (%.2fx)\n", threads, tRapida, tEscalar / tRapida);
+    printf("diferenca maxima:   %g\n", difMax);
+    return difMax <= 1e-5f ? 0 : 1;
+}
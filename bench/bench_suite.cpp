@@ -0,0 +1,278 @@
+// Suíte de benchmarks da carga e do envio à GPU sobre OBJs sintéticos (gerador_obj.h).
+// Para cada escala e variante mede o parse nos três modos (e confere que os três produzem os
+// mesmos buffers), as normais por vértice, a deduplicação da malha indexada e a criação da
+// display list e do VBO. O resultado é um JSON
+// com métricas planas ("variante.escala.metrica": valor), fácil de comparar entre commits.
+//
+// Uso: bench [--escalas=10k,100k,1m] [--variantes=v,vtn,quads,negativos,crlf,extremos] [--dir=bench_dados]
+//            [--repeticoes=3] [--threads=N] [--sem-gl] [--saida=resultado.json] [--comparar=antes.json]
+
+#include "gerador_obj.h"
+#include "../src/arena.h"
+#include "../src/contexto_offscreen.h"
+#include "../src/malha_lista.h"
+#include "../src/malha_vbo.h"
+#include "../src/obj_loader.h"
+#include "../src/perf.h"
+
+#include <sys/stat.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+#ifndef DIR_FONTE
+#define DIR_FONTE "."
+#endif
+
+static vector<string> dividirVirgulas(const string& s) {
+    vector<string> partes;
+    stringstream ss(s);
+    string p;
+    while (getline(ss, p, ',')) if (!p.empty()) partes.push_back(p);
+    return partes;
+}
+
+// Total acumulado de uma fase dos medidores de perf.h
+static double totalFaseMs(const char* nome) {
+    for (const TotalFasePerf& f : totaisFasesPerf())
+        if (f.nome == nome) return f.ms;
+    return 0.0;
+}
+
+// Commit do código medido (git describe; "desconhecido" fora de um checkout)
+static string commitAtual() {
+    string saida;
+    if (FILE* p = popen("git -C \"" DIR_FONTE "\" describe --always --dirty 2>/dev/null", "r")) {
+        char buf[128];
+        while (fgets(buf, sizeof(buf), p)) saida += buf;
+        pclose(p);
+    }
+    while (!saida.empty() && (saida.back() == '\n' || saida.back() == '\r')) saida.pop_back();
+    return saida.empty() ? "desconhecido" : saida;
+}
+
+// O log do carregador e do envio à GPU fica fora da saída do bench
+struct SilenciarCout {
+    ostringstream descarte;
+    streambuf* antigo;
+    SilenciarCout() : antigo(cout.rdbuf(descarte.rdbuf())) {}
+    ~SilenciarCout() { cout.rdbuf(antigo); }
+};
+
+template <class F>
+static double melhorTempoMs(int reps, F f) {
+    double melhor = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        const auto t0 = chrono::steady_clock::now();
+        f();
+        melhor = min(melhor, chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count());
+    }
+    return melhor;
+}
+
+// Lê as métricas de um JSON gravado por este programa (só o objeto plano "metricas")
+static bool lerMetricas(const string& caminho, map<string, double>& out) {
+    ifstream f(caminho);
+    if (!f) return false;
+    const string texto((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+    size_t p = texto.find("\"metricas\"");
+    if (p == string::npos) return false;
+    p = texto.find('{', p);
+    const size_t fim = texto.find('}', p);
+    while (p != string::npos && p < fim) {
+        const size_t a = texto.find('"', p);
+        if (a == string::npos || a > fim) break;
+        const size_t b = texto.find('"', a + 1);
+        const size_t dois = texto.find(':', b);
+        out[texto.substr(a + 1, b - a - 1)] = atof(texto.c_str() + dois + 1);
+        p = texto.find(',', dois);
+    }
+    return true;
+}
+
+// Buffers que saem do parse: os três modos precisam produzir exatamente os mesmos bytes
+// (as normais calculadas ficam de fora; em paralelo elas diferem no arredondamento)
+struct BuffersParse {
+    vector<float> vertices, normaisOBJ, uvs;
+    vector<unsigned int> indicesPos;
+    vector<CantoTri> triangulos;
+    vector<int32_t> materialTri;
+
+    explicit BuffersParse(const MalhaOBJ& m)
+        : vertices(m.vertices), normaisOBJ(m.normaisOBJ), uvs(m.uvs), indicesPos(m.indicesPos),
+          triangulos(m.triangulos), materialTri(m.materialTri) {}
+};
+
+template <class T>
+static bool mesmosBytes(const vector<T>& a, const vector<T>& b) {
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// Nome do primeiro buffer diferente, ou nullptr se todos são iguais
+static const char* bufferDivergente(const BuffersParse& ref, const MalhaOBJ& m) {
+    if (!mesmosBytes(ref.vertices, m.vertices)) return "vertices";
+    if (!mesmosBytes(ref.indicesPos, m.indicesPos)) return "indicesPos";
+    if (!mesmosBytes(ref.normaisOBJ, m.normaisOBJ)) return "normaisOBJ";
+    if (!mesmosBytes(ref.uvs, m.uvs)) return "uvs";
+    if (!mesmosBytes(ref.triangulos, m.triangulos)) return "triangulos";
+    if (!mesmosBytes(ref.materialTri, m.materialTri)) return "materialTri";
+    return nullptr;
+}
+
+static void compararMetricas(const map<string, double>& antes, const vector<pair<string, double>>& agora) {
+    printf("\n%-40s %12s %12s %9s\n", "metrica", "antes", "agora", "variacao");
+    for (const auto& m : agora) {
+        auto it = antes.find(m.first);
+        if (it == antes.end()) continue;
+        const double var = it->second != 0.0 ? (m.second / it->second - 1.0) * 100.0 : 0.0;
+        printf("%-40s %12.3f %12.3f %+8.1f%%\n", m.first.c_str(), it->second, m.second, var);
+    }
+}
+
+int main(int argc, char** argv) {
+    vector<string> escalas = { "10k", "100k", "1m" };
+    vector<string> variantes = { "v", "vtn", "quads", "negativos", "crlf" };
+    string dir = "bench_dados", saida, comparar;
+    int reps = 3, threads = 0;
+    bool usarGL = true;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg.rfind("--escalas=", 0) == 0) escalas = dividirVirgulas(arg.substr(10));
+        else if (arg.rfind("--variantes=", 0) == 0) variantes = dividirVirgulas(arg.substr(12));
+        else if (arg.rfind("--dir=", 0) == 0) dir = arg.substr(6);
+        else if (arg.rfind("--repeticoes=", 0) == 0) reps = max(1, atoi(arg.c_str() + 13));
+        else if (arg.rfind("--threads=", 0) == 0) threads = atoi(arg.c_str() + 10);
+        else if (arg == "--sem-gl") usarGL = false;
+        else if (arg.rfind("--saida=", 0) == 0) saida = arg.substr(8);
+        else if (arg.rfind("--comparar=", 0) == 0) comparar = arg.substr(11);
+        else { cerr << "Opcao desconhecida: " << arg << "\n"; return 1; }
+    }
+
+    ContextoOffscreen ctx;
+    if (usarGL) {
+        SilenciarCout s;
+        usarGL = criarContextoOffscreen(64, 64, ctx);
+    }
+    if (!usarGL) cerr << "Sem contexto GL: display list e VBO ficam de fora\n";
+    configurarPerf(true, false);
+
+    const ModoLeituraOBJ modos[] = { ModoLeituraOBJ::Stream, ModoLeituraOBJ::Mmap, ModoLeituraOBJ::Paralelo };
+    const char* nomesModos[] = { "stream", "mmap", "paralelo" };
+    vector<pair<string, double>> metricas;
+
+    for (const string& escala : escalas) {
+        const size_t alvo = lerEscalaTriangulos(escala);
+        if (alvo == 0) { cerr << "Escala invalida: " << escala << "\n"; return 1; }
+        for (const string& nomeVariante : variantes) {
+            VarianteOBJ variante;
+            if (!varianteOBJPorNome(nomeVariante, variante)) { cerr << "Variante invalida: " << nomeVariante << "\n"; return 1; }
+            const string caminho = obterOBJSintetico(dir, variante, alvo, escala);
+            if (caminho.empty()) return 1;
+            struct stat st;
+            const double mb = stat(caminho.c_str(), &st) == 0 ? st.st_size / (1024.0 * 1024.0) : 0.0;
+            const string prefixo = nomeVariante + "." + escala + ".";
+
+            OpcoesCarregamento opcoes;
+            opcoes.usarCache = false;
+            opcoes.gerarLODs = false;
+            opcoes.numThreads = threads;
+            MalhaOBJ malha;
+            ArenaCarga arena;
+            double normais = 1e30, indexar = 1e30;
+            double parse[3];
+            unique_ptr<BuffersParse> referencia;
+            for (int m = 0; m < 3; ++m) {
+                opcoes.modo = modos[m];
+                parse[m] = 1e30;
+                for (int r = 0; r < reps; ++r) {
+                    const double p0 = totalFaseMs("carga.parse"), n0 = totalFaseMs("carga.normais");
+                    const double i0 = totalFaseMs("carga.indexar");
+                    bool ok;
+                    {
+                        SilenciarCout s;
+                        ok = carregarMalhaOBJ(caminho, malha, opcoes, &arena);
+                    }
+                    if (!ok) { cerr << "Falha ao carregar " << caminho << "\n"; return 1; }
+                    parse[m] = min(parse[m], totalFaseMs("carga.parse") - p0);
+                    normais = min(normais, totalFaseMs("carga.normais") - n0);
+                    indexar = min(indexar, totalFaseMs("carga.indexar") - i0);
+                }
+                if (!referencia) {
+                    referencia = make_unique<BuffersParse>(malha);
+                } else if (const char* diferente = bufferDivergente(*referencia, malha)) {
+                    cerr << "Parse " << nomesModos[m] << " diverge do stream em " << diferente
+                         << " (" << caminho << ")\n";
+                    return 1;
+                }
+            }
+
+            const size_t tris = malha.triangulos.size() / 3;
+            metricas.emplace_back(prefixo + "triangulos", (double)tris);
+            metricas.emplace_back(prefixo + "arquivo_mb", mb);
+            for (int m = 0; m < 3; ++m) {
+                metricas.emplace_back(prefixo + "parse_" + nomesModos[m] + "_ms", parse[m]);
+                metricas.emplace_back(prefixo + "parse_" + nomesModos[m] + "_mb_s", parse[m] > 0 ? mb / (parse[m] / 1000.0) : 0.0);
+            }
+            metricas.emplace_back(prefixo + "normais_ms", normais);
+            metricas.emplace_back(prefixo + "indexar_ms", indexar);
+            printf("%-9s %5s: %9zu tris %8.1f MB | parse stream %8.1f mmap %8.1f paralelo %8.1f ms | normais %7.1f indexar %7.1f ms",
+                   nomeVariante.c_str(), escala.c_str(), tris, mb, parse[0], parse[1], parse[2], normais, indexar);
+
+            if (usarGL) {
+                SilenciarCout s;
+                GLuint lista = 0;
+                const double tLista = melhorTempoMs(reps, [&] {
+                    criarDisplayListOBJ(malha, lista);
+                    glFinish();
+                });
+                glDeleteLists(lista, 1);
+                const double tVBO = melhorTempoMs(reps, [&] {
+                    MalhaVBO vbo;
+                    enviarMalhaVBO(malha.indexada, vbo);
+                    glFinish();
+                    liberarMalhaVBO(vbo);
+                });
+                metricas.emplace_back(prefixo + "display_list_ms", tLista);
+                metricas.emplace_back(prefixo + "vbo_ms", tVBO);
+                printf(" | lista %8.1f vbo %7.1f ms", tLista, tVBO);
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    if (usarGL) destruirContextoOffscreen(ctx);
+
+    char data[32];
+    const time_t agora = time(nullptr);
+    strftime(data, sizeof(data), "%Y-%m-%dT%H:%M:%S", localtime(&agora));
+    ostringstream js;
+    js << "{\n  \"commit\": \"" << commitAtual() << "\",\n  \"data\": \"" << data << "\",\n"
+       << "  \"threads\": " << threads << ",\n  \"repeticoes\": " << reps << ",\n  \"metricas\": {\n";
+    for (size_t i = 0; i < metricas.size(); ++i)
+        js << "    \"" << metricas[i].first << "\": " << metricas[i].second << (i + 1 < metricas.size() ? ",\n" : "\n");
+    js << "  }\n}\n";
+    if (saida.empty()) {
+        cout << js.str();
+    } else {
+        ofstream f(saida);
+        f << js.str();
+        cout << "Resultado: " << saida << "\n";
+    }
+
+    if (!comparar.empty()) {
+        map<string, double> antes;
+        if (!lerMetricas(comparar, antes)) { cerr << "Falha ao ler " << comparar << "\n"; return 1; }
+        compararMetricas(antes, metricas);
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "gerador_obj.h"
+
+#include <sys/stat.h>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+const char* nomeVarianteOBJ(VarianteOBJ v) {
+    switch (v) {
+        case VarianteOBJ::SoPosicoes: return "v";
+        case VarianteOBJ::Completo:   return "vtn";
+        case VarianteOBJ::Poligonos:  return "quads";
+        case VarianteOBJ::Negativos:  return "negativos";
+        case VarianteOBJ::CRLF:       return "crlf";
+        case VarianteOBJ::Extremos:   return "extremos";
+    }
+    return "?";
+}
+
+bool varianteOBJPorNome(const string& nome, VarianteOBJ& out) {
+    const VarianteOBJ todas[] = { VarianteOBJ::SoPosicoes, VarianteOBJ::Completo, VarianteOBJ::Poligonos,
+                                  VarianteOBJ::Negativos, VarianteOBJ::CRLF, VarianteOBJ::Extremos };
+    for (VarianteOBJ v : todas)
+        if (nome == nomeVarianteOBJ(v)) { out = v; return true; }
+    return false;
+}
+
+size_t lerEscalaTriangulos(const string& texto) {
+    char* fim = nullptr;
+    const double x = strtod(texto.c_str(), &fim);
+    if (fim == texto.c_str() || x <= 0.0) return 0;
+    double mult = 1.0;
+    if (*fim == 'k' || *fim == 'K') { mult = 1e3; ++fim; }
+    else if (*fim == 'm' || *fim == 'M') { mult = 1e6; ++fim; }
+    if (*fim != '\0') return 0;
+    return (size_t)(x * mult + 0.5);
+}
+
+int ladoGradeOBJ(size_t triangulos) {
+    return max(1, (int)lround(sqrt(triangulos / 2.0)));
+}
+
+// Saída com buffer grande (os arquivos maiores passam de 1 GB)
+struct EscritorOBJ {
+    FILE* f = nullptr;
+    string buf;
+    const char* fimLinha = "\n";
+
+    void linha(const char* fmt, ...) {
+        char tmp[256];
+        va_list args;
+        va_start(args, fmt);
+        const int n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+        va_end(args);
+        buf.append(tmp, (size_t)max(0, min(n, (int)sizeof(tmp) - 1)));
+        buf += fimLinha;
+        if (buf.size() >= (4u << 20)) descarregar();
+    }
+    void descarregar() {
+        fwrite(buf.data(), 1, buf.size(), f);
+        buf.clear();
+    }
+};
+
+// Relevo da grade e a normal analítica dele (o ruído fica de fora da normal)
+static float alturaGrade(int i, int j) {
+    uint32_t h = (uint32_t)i * 73856093u ^ (uint32_t)j * 19349663u;
+    h = h * 1664525u + 1013904223u;
+    const float ruido = (float)(h >> 8) / 16777216.0f * 0.01f;
+    return 0.1f * sinf(i * 0.05f) * cosf(j * 0.07f) + ruido;
+}
+
+// Números que os modos de leitura precisam tratar igual: fora da faixa do float (dos dois
+// lados, inclusive expoentes que não cabem em 64 bits), inf e nan
+static const char* const NUMEROS_EXTREMOS[] = {
+    "1e50", "-1e50", "+3.5e38", "1e-50", "-0.00000000000000000000000000000000000000000000000001",
+    "1e99999999999999999999", "-1e-99999999999999999999", "inf", "-inf", "nan", "infinity", "NaN",
+};
+static const int NUM_EXTREMOS = sizeof(NUMEROS_EXTREMOS) / sizeof(NUMEROS_EXTREMOS[0]);
+
+// extremo != nullptr: escrito no lugar da primeira coordenada de v, vt e vn
+static void escreverVertice(EscritorOBJ& e, int i, int j, int n, bool uv, bool normal, const char* extremo = nullptr) {
+    char x[64];
+    snprintf(x, sizeof(x), "%.6f", (float)i / n - 0.5f);
+    e.linha("v %s %.6f %.6f", extremo ? extremo : x, alturaGrade(i, j), (float)j / n - 0.5f);
+    if (uv) {
+        snprintf(x, sizeof(x), "%.6f", (float)i / n);
+        e.linha("vt %s %.6f", extremo ? extremo : x, (float)j / n);
+    }
+    if (normal) {
+        const float dx = 0.1f * 0.05f * n * cosf(i * 0.05f) * cosf(j * 0.07f);
+        const float dz = -0.1f * 0.07f * n * sinf(i * 0.05f) * sinf(j * 0.07f);
+        const float len = sqrtf(dx * dx + 1.0f + dz * dz);
+        snprintf(x, sizeof(x), "%.6f", -dx / len);
+        e.linha("vn %s %.6f %.6f", extremo ? extremo : x, 1.0f / len, -dz / len);
+    }
+}
+
+size_t gerarOBJSintetico(const string& caminho, VarianteOBJ variante, size_t triangulos) {
+    const int n = ladoGradeOBJ(triangulos);
+    const string temp = caminho + ".tmp";
+    EscritorOBJ e;
+    e.f = fopen(temp.c_str(), "wb");
+    if (!e.f) {
+        cerr << "Falha ao criar " << temp << "\n";
+        return 0;
+    }
+    if (variante == VarianteOBJ::CRLF) e.fimLinha = "\r\n";
+    e.linha("# OBJ sintetico: variante %s, grade %dx%d", nomeVarianteOBJ(variante), n, n);
+
+    const bool uv = variante != VarianteOBJ::SoPosicoes && variante != VarianteOBJ::Negativos;
+    const bool normal = variante == VarianteOBJ::Completo || variante == VarianteOBJ::CRLF
+                        || variante == VarianteOBJ::Negativos || variante == VarianteOBJ::Extremos;
+    const long long lado = n + 1;
+    auto id = [lado](int i, int j) { return (long long)j * lado + i + 1; };   // 1-based
+
+    if (variante == VarianteOBJ::Negativos) {
+        // Cada linha da grade é seguida das faces que ela fecha, com índices relativos ao fim
+        for (int i = 0; i <= n; ++i) escreverVertice(e, i, 0, n, false, true);
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i <= n; ++i) escreverVertice(e, i, j + 1, n, false, true);
+            const long long total = (j + 2) * lado;
+            for (int i = 0; i < n; ++i) {
+                const long long a = id(i, j) - 1 - total, b = a + 1, c = a + lado + 1, d = a + lado;
+                e.linha("f %lld//%lld %lld//%lld %lld//%lld", a, a, b, b, c, c);
+                e.linha("f %lld//%lld %lld//%lld %lld//%lld", a, a, c, c, d, d);
+            }
+        }
+    } else {
+        for (int j = 0; j <= n; ++j) {
+            for (int i = 0; i <= n; ++i) {
+                // Um vértice a cada 7, percorrendo a lista de números extremos
+                const int k = j * (n + 1) + i;
+                const char* extremo = (variante == VarianteOBJ::Extremos && k % 7 == 0) ? NUMEROS_EXTREMOS[(k / 7) % NUM_EXTREMOS] : nullptr;
+                escreverVertice(e, i, j, n, uv, normal, extremo);
+            }
+            if (variante == VarianteOBJ::CRLF) {
+                // Linhas vazias entre as linhas da grade: o "\r" sozinho não pode virar elemento
+                e.linha("%s", "");
+                e.linha("%s", " \t");
+            }
+        }
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                const long long a = id(i, j), b = id(i + 1, j), c = id(i + 1, j + 1), d = id(i, j + 1);
+                if (variante == VarianteOBJ::SoPosicoes) {
+                    e.linha("f %lld %lld %lld", a, b, c);
+                    e.linha("f %lld %lld %lld", a, c, d);
+                } else if (variante == VarianteOBJ::Poligonos) {
+                    // Linhas pares em quads; nas ímpares, hexágonos de duas células (quad na sobra)
+                    if (j % 2 == 1 && i + 1 < n) {
+                        const long long c2 = id(i + 2, j), d2 = id(i + 2, j + 1);
+                        e.linha("f %lld/%lld %lld/%lld %lld/%lld %lld/%lld %lld/%lld %lld/%lld",
+                                a, a, b, b, c2, c2, d2, d2, c, c, d, d);
+                        ++i;
+                    } else {
+                        e.linha("f %lld/%lld %lld/%lld %lld/%lld %lld/%lld", a, a, b, b, c, c, d, d);
+                    }
+                } else {
+                    e.linha("f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld", a, a, a, b, b, b, c, c, c);
+                    e.linha("f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld", a, a, a, c, c, c, d, d, d);
+                }
+            }
+        }
+    }
+    e.descarregar();
+    const bool ok = fclose(e.f) == 0;
+    if (!ok || rename(temp.c_str(), caminho.c_str()) != 0) {
+        cerr << "Falha ao gravar " << caminho << "\n";
+        remove(temp.c_str());
+        return 0;
+    }
+    return (size_t)n * (size_t)n * 2u;
+}
+
+string obterOBJSintetico(const string& dir, VarianteOBJ variante, size_t triangulos, const string& rotuloEscala) {
+    mkdir(dir.c_str(), 0755);
+    const string caminho = dir + "/" + nomeVarianteOBJ(variante) + "_" + rotuloEscala + ".obj";
+    struct stat st;
+    if (stat(caminho.c_str(), &st) == 0 && st.st_size > 0) return caminho;
+    cout << "Gerando " << caminho << "...\n" << flush;
+    return gerarOBJSintetico(caminho, variante, triangulos) ? caminho : string();
+}
@@ -0,0 +1,35 @@
+// Gerador determinístico de OBJs sintéticos para os benchmarks: uma grade n x n com relevo
+// suave (mais um ruído fixo), escrita em variantes que exercitam caminhos diferentes do parser.
+// Mesma variante e mesmo número de triângulos produzem sempre o mesmo arquivo, byte a byte.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+enum class VarianteOBJ {
+    SoPosicoes,   // "v": só v e triângulos "f a b c"
+    Completo,     // "vtn": v/vt/vn em todos os cantos
+    Poligonos,    // "quads": faces com 4 e 6 vértices (triangulação em fan), com v/vt
+    Negativos,    // "negativos": índices relativos (negativos), faces intercaladas com os vértices
+    CRLF,         // "crlf": como Completo, com fim de linha "\r\n" e linhas em branco entre as linhas da grade
+    Extremos      // "extremos": como Completo, com números fora da faixa do float, inf e nan em alguns vértices
+};
+
+const char* nomeVarianteOBJ(VarianteOBJ v);
+bool varianteOBJPorNome(const string& nome, VarianteOBJ& out);
+
+// "10k", "2m", "50000" -> número de triângulos; 0 se inválido
+size_t lerEscalaTriangulos(const string& texto);
+
+// Lado da grade para ~triangulos (2 por célula)
+int ladoGradeOBJ(size_t triangulos);
+
+// Escreve o OBJ em caminho (via arquivo temporário + rename, para um arquivo pela metade
+// nunca ser reaproveitado). Devolve o número de triângulos gerados.
+size_t gerarOBJSintetico(const string& caminho, VarianteOBJ variante, size_t triangulos);
+
+// Reaproveita o arquivo se ele já existe em dir; senão gera. Devolve o caminho.
+string obterOBJSintetico(const string& dir, VarianteOBJ variante, size_t triangulos, const string& rotuloEscala);
@@ -0,0 +1,58 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+
+ArenaCarga::ArenaCarga(size_t bytesBloco) : bytesBloco(max<size_t>(bytesBloco, 4096)) {}
+
+ArenaCarga::~ArenaCarga() {
+    for (const Bloco& b : blocos) free(b.dados);
+}
+
+void* ArenaCarga::alocar(size_t bytes, size_t alinhamento) {
+    if (!blocos.empty()) {
+        const Bloco& b = blocos.back();
+        const uintptr_t base = (uintptr_t)b.dados;
+        const size_t inicio = ((base + usadoAtual + alinhamento - 1) & ~(uintptr_t)(alinhamento - 1)) - base;
+        if (inicio + bytes <= b.tamanho) {
+            usadoAtual = inicio + bytes;
+            return b.dados + inicio;
+        }
+        usadosAnteriores += usadoAtual;
+    }
+    // Bloco novo: pelo menos o dobro do anterior, para o número de blocos crescer devagar
+    size_t tamanho = max(bytesBloco, bytes + alinhamento);
+    if (!blocos.empty()) tamanho = max(tamanho, blocos.back().tamanho * 2);
+    char* dados = static_cast<char*>(malloc(tamanho));
+    if (!dados) throw bad_alloc();
+    blocos.push_back(Bloco{ dados, tamanho });
+    ++pedidos;
+    const size_t inicio = (((uintptr_t)dados + alinhamento - 1) & ~(uintptr_t)(alinhamento - 1)) - (uintptr_t)dados;
+    usadoAtual = inicio + bytes;
+    return dados + inicio;
+}
+
+void ArenaCarga::reiniciar() {
+    // Vários blocos: troca por um só com o total usado, que a próxima carga igual preenche
+    if (blocos.size() > 1) {
+        const size_t total = bytesUsados() + 4096;   // folga para diferenças de alinhamento
+        for (const Bloco& b : blocos) free(b.dados);
+        blocos.clear();
+        char* dados = static_cast<char*>(malloc(total));
+        if (dados) {
+            blocos.push_back(Bloco{ dados, total });
+            ++pedidos;
+        }
+    }
+    usadoAtual = 0;
+    usadosAnteriores = 0;
+}
+
+size_t ArenaCarga::bytesReservados() const {
+    size_t total = 0;
+    for (const Bloco& b : blocos) total += b.tamanho;
+    return total;
+}
@@ -0,0 +1,70 @@
+// Arena para os temporários da carga: cada alocação só avança um ponteiro dentro de um bloco
+// grande e nada é liberado individualmente. reiniciar() descarta tudo de uma vez e guarda um
+// bloco do tamanho do que foi usado, então a carga seguinte do mesmo modelo não pede memória
+// nenhuma ao sistema (nem toca páginas novas). Não é thread-safe: uma arena por thread.
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+class ArenaCarga {
+public:
+    explicit ArenaCarga(size_t bytesBloco = 1u << 20);
+    ~ArenaCarga();
+    ArenaCarga(const ArenaCarga&) = delete;
+    ArenaCarga& operator=(const ArenaCarga&) = delete;
+
+    void* alocar(size_t bytes, size_t alinhamento);
+    void reiniciar();
+
+    size_t bytesUsados() const { return usadosAnteriores + usadoAtual; }
+    size_t bytesReservados() const;
+    size_t blocosPedidos() const { return pedidos; }   // acumulado, para medir reaproveitamento
+
+private:
+    struct Bloco { char* dados; size_t tamanho; };
+    vector<Bloco> blocos;
+    size_t bytesBloco;
+    size_t usadoAtual = 0;        // no último bloco
+    size_t usadosAnteriores = 0;  // nos blocos cheios
+    size_t pedidos = 0;
+};
+
+// Alocador STL sobre a arena; sem arena (nullptr) usa o heap normal
+template <class T>
+struct AlocadorArena {
+    using value_type = T;
+    ArenaCarga* arena = nullptr;
+
+    AlocadorArena() = default;
+    explicit AlocadorArena(ArenaCarga* a) : arena(a) {}
+    template <class U> AlocadorArena(const AlocadorArena<U>& o) : arena(o.arena) {}
+
+    T* allocate(size_t n) {
+        if (arena) return static_cast<T*>(arena->alocar(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t) {
+        if (!arena) ::operator delete(p);
+    }
+    template <class U> bool operator==(const AlocadorArena<U>& o) const { return arena == o.arena; }
+    template <class U> bool operator!=(const AlocadorArena<U>& o) const { return arena != o.arena; }
+};
+
+template <class T>
+using VetorArena = vector<T, AlocadorArena<T>>;
+
+// Reinicia a arena ao sair do escopo, com sucesso ou erro: uma carga que falha no meio não
+// deixa o que já alocou preso até a próxima carga. Sem arena (nullptr) não faz nada.
+struct ReinicioArena {
+    ArenaCarga* arena;
+
+    explicit ReinicioArena(ArenaCarga* a) : arena(a) {}
+    ~ReinicioArena() { if (arena) arena->reiniciar(); }
+    ReinicioArena(const ReinicioArena&) = delete;
+    ReinicioArena& operator=(const ReinicioArena&) = delete;
+};
@@ -0,0 +1,297 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "perf.h"
+
+using namespace std;
+
+static CaixaAABB caixaVazia() {
+    return CaixaAABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+}
+
+static inline void expandir(CaixaAABB& c, const CaixaAABB& o) {
+    for (int k = 0; k < 3; ++k) {
+        c.min[k] = min(c.min[k], o.min[k]);
+        c.max[k] = max(c.max[k], o.max[k]);
+    }
+}
+
+static inline const float* posicao(const Fatia<float>& vertices, const CantoTri& c) {
+    return &vertices[(size_t)c.v * 3u];
+}
+
+// Estado da construção: caixa e centróide de cada triângulo, calculados uma vez
+struct ConstrutorBVH {
+    const vector<CaixaAABB>& caixasTri;
+    const vector<float>& centroides;   // xyz por triângulo
+    BVHMalha& bvh;
+    uint32_t trisPorCluster;
+
+    uint32_t construir(uint32_t ini, uint32_t fim, bool dentroDeCluster) {
+        const uint32_t indice = (uint32_t)bvh.nos.size();
+        bvh.nos.push_back(NoBVH());
+
+        CaixaAABB caixa = caixaVazia();
+        CaixaAABB caixaCentros = caixaVazia();
+        for (uint32_t i = ini; i < fim; ++i) {
+            const uint32_t t = bvh.ordem[i];
+            expandir(caixa, caixasTri[t]);
+            const float* c = &centroides[(size_t)t * 3u];
+            const CaixaAABB p{ { c[0], c[1], c[2] }, { c[0], c[1], c[2] } };
+            expandir(caixaCentros, p);
+        }
+
+        const uint32_t contagem = fim - ini;
+        const bool raizCluster = !dentroDeCluster && contagem <= trisPorCluster;
+        const uint32_t primeiroCluster = (uint32_t)bvh.clusters.size();
+        if (raizCluster) bvh.clusters.push_back(ClusterBVH{ caixa, ini, contagem });
+
+        uint32_t filhoDireito = 0;
+        if (contagem > TRIS_POR_FOLHA_BVH) {
+            int eixo = 0;
+            float extensao = caixaCentros.max[0] - caixaCentros.min[0];
+            for (int k = 1; k < 3; ++k) {
+                const float e = caixaCentros.max[k] - caixaCentros.min[k];
+                if (e > extensao) { extensao = e; eixo = k; }
+            }
+            const uint32_t meio = ini + contagem / 2;
+            nth_element(bvh.ordem.begin() + ini, bvh.ordem.begin() + meio, bvh.ordem.begin() + fim,
+                        [&](uint32_t a, uint32_t b) {
+                            return centroides[(size_t)a * 3u + eixo] < centroides[(size_t)b * 3u + eixo];
+                        });
+            construir(ini, meio, dentroDeCluster || raizCluster);
+            filhoDireito = construir(meio, fim, dentroDeCluster || raizCluster);
+        }
+
+        NoBVH& no = bvh.nos[indice];
+        no.caixa = caixa;
+        no.primeiro = ini;
+        no.contagem = contagem;
+        no.filhoDireito = filhoDireito;
+        no.primeiroCluster = primeiroCluster;
+        no.numClusters = dentroDeCluster ? 0 : (uint32_t)bvh.clusters.size() - primeiroCluster;
+        return indice;
+    }
+};
+
+void construirBVH(
+    const Fatia<float>& vertices,
+    const Fatia<CantoTri>& triangulos,
+    BVHMalha& out,
+    uint32_t trisPorCluster
+) {
+    out = BVHMalha();
+    const size_t nTris = triangulos.size() / 3;
+    vector<CaixaAABB> caixasTri(nTris);
+    vector<float> centroides(nTris * 3);
+    out.ordem.reserve(nTris);
+    for (size_t t = 0; t < nTris; ++t) {
+        const CantoTri* c = &triangulos[t * 3];
+        if (c[0].v < 0 || c[1].v < 0 || c[2].v < 0) continue;
+        CaixaAABB caixa = caixaVazia();
+        for (int k = 0; k < 3; ++k) {
+            const float* P = posicao(vertices, c[k]);
+            const CaixaAABB p{ { P[0], P[1], P[2] }, { P[0], P[1], P[2] } };
+            expandir(caixa, p);
+        }
+        caixasTri[t] = caixa;
+        for (int k = 0; k < 3; ++k) centroides[t * 3 + k] = 0.5f * (caixa.min[k] + caixa.max[k]);
+        out.ordem.push_back((uint32_t)t);
+    }
+    if (out.ordem.empty()) return;
+
+    // Cada nível cria no máximo 2 nós por folha; reservar evita realocar durante a recursão
+    out.nos.reserve(out.ordem.size() / TRIS_POR_FOLHA_BVH * 4 + 1);
+    ConstrutorBVH construtor{ caixasTri, centroides, out, max<uint32_t>(1, trisPorCluster) };
+    construtor.construir(0, (uint32_t)out.ordem.size(), false);
+    out.ordemDesenho = out.ordem;
+}
+
+void reordenarIndicesPorBVH(const BVHMalha& bvh, const Fatia<CantoTri>& triangulos, MalhaIndexada& malha) {
+    // A malha indexada guarda só os triângulos válidos, na ordem original: posição de cada um
+    const size_t nTris = triangulos.size() / 3;
+    vector<uint32_t> posicaoNaMalha(nTris, UINT32_MAX);
+    uint32_t proximo = 0;
+    for (size_t t = 0; t < nTris; ++t) {
+        const CantoTri* c = &triangulos[t * 3];
+        if (c[0].v >= 0 && c[1].v >= 0 && c[2].v >= 0) posicaoNaMalha[t] = proximo++;
+    }
+    if ((size_t)proximo * 3 != malha.numIndices() || bvh.ordem.size() != proximo) return;
+
+    auto reordenar = [&](auto& indices) {
+        auto novos = indices;
+        size_t k = 0;
+        for (uint32_t t : bvh.ordem) {
+            const size_t origem = (size_t)posicaoNaMalha[t] * 3u;
+            novos[k++] = indices[origem];
+            novos[k++] = indices[origem + 1];
+            novos[k++] = indices[origem + 2];
+        }
+        indices.swap(novos);
+    };
+    if (malha.indices16Bits()) reordenar(malha.indices16);
+    else reordenar(malha.indices32);
+}
+
+void prepararBVH(const Fatia<float>& vertices, const Fatia<CantoTri>& triangulos,
+                 MalhaIndexada& malha, BVHMalha& bvh) {
+    PERF_ESCOPO("carga.bvh");
+    const auto t0 = chrono::steady_clock::now();
+    construirBVH(vertices, triangulos, bvh);
+    reordenarIndicesPorBVH(bvh, triangulos, malha);
+    cout << "BVH: " << bvh.nos.size() << " nos, " << bvh.clusters.size() << " clusters em "
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() << " ms\n";
+}
+
+Frustum frustumDasMatrizes(const float projecao[16], const float modelview[16]) {
+    // m = projecao * modelview, em coluna: m[coluna * 4 + linha]
+    float m[16];
+    for (int c = 0; c < 4; ++c)
+        for (int l = 0; l < 4; ++l) {
+            float s = 0.0f;
+            for (int k = 0; k < 4; ++k) s += projecao[k * 4 + l] * modelview[c * 4 + k];
+            m[c * 4 + l] = s;
+        }
+    auto linha = [&](int l, int k) { return m[k * 4 + l]; };
+
+    // Gribb/Hartmann: cada plano é a linha 3 somada/subtraída das linhas 0, 1 e 2
+    Frustum f;
+    for (int i = 0; i < 6; ++i) {
+        const int l = i / 2;
+        const float sinal = (i % 2 == 0) ? 1.0f : -1.0f;
+        float n = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            f.planos[i][k] = linha(3, k) + sinal * linha(l, k);
+            if (k < 3) n += f.planos[i][k] * f.planos[i][k];
+        }
+        n = sqrt(n);
+        if (n > 0.0f) for (int k = 0; k < 4; ++k) f.planos[i][k] /= n;
+    }
+    return f;
+}
+
+// 0 = fora, 1 = cruza algum plano, 2 = totalmente dentro
+static int classificarCaixa(const Frustum& f, const CaixaAABB& c) {
+    bool cruza = false;
+    for (const float* p : f.planos) {
+        float dentro = p[3], fora = p[3];   // vértices da caixa mais e menos à frente do plano
+        for (int k = 0; k < 3; ++k) {
+            if (p[k] >= 0.0f) { dentro += p[k] * c.max[k]; fora += p[k] * c.min[k]; }
+            else              { dentro += p[k] * c.min[k]; fora += p[k] * c.max[k]; }
+        }
+        if (dentro < 0.0f) return 0;
+        if (fora < 0.0f) cruza = true;
+    }
+    return cruza ? 1 : 2;
+}
+
+bool caixaNoFrustum(const Frustum& f, const CaixaAABB& c) {
+    return classificarCaixa(f, c) != 0;
+}
+
+static void visitarVisiveis(const BVHMalha& bvh, const Frustum& f, uint32_t indice, vector<uint32_t>& visiveis) {
+    const NoBVH& no = bvh.nos[indice];
+    const int classe = classificarCaixa(f, no.caixa);
+    if (classe == 0) return;
+    if (classe == 2 || no.numClusters == 1) {
+        for (uint32_t c = 0; c < no.numClusters; ++c) visiveis.push_back(no.primeiroCluster + c);
+        return;
+    }
+    visitarVisiveis(bvh, f, indice + 1, visiveis);
+    visitarVisiveis(bvh, f, no.filhoDireito, visiveis);
+}
+
+void clustersVisiveis(const BVHMalha& bvh, const Frustum& f, vector<uint32_t>& visiveis) {
+    visiveis.clear();
+    if (!bvh.vazia()) visitarVisiveis(bvh, f, 0, visiveis);
+}
+
+// Distância de entrada do raio na caixa (slabs); FLT_MAX se não atinge antes de tMax
+static float entradaNaCaixa(const CaixaAABB& c, const float o[3], const float inv[3], float tMax) {
+    float t0 = 0.0f, t1 = tMax;
+    for (int k = 0; k < 3; ++k) {
+        float a = (c.min[k] - o[k]) * inv[k];
+        float b = (c.max[k] - o[k]) * inv[k];
+        if (a > b) swap(a, b);
+        t0 = max(t0, a);
+        t1 = min(t1, b);
+        if (t0 > t1) return FLT_MAX;
+    }
+    return t0;
+}
+
+// Möller-Trumbore, sem descartar faces de costas (a cena desenha os dois lados)
+static bool intersectarTriangulo(const float* A, const float* B, const float* C,
+                                 const float o[3], const float d[3], float& t) {
+    const float e1[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+    const float e2[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+    const float p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+    const float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (fabs(det) < 1e-12f) return false;
+    const float inv = 1.0f / det;
+    const float s[3] = { o[0] - A[0], o[1] - A[1], o[2] - A[2] };
+    const float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+    if (u < 0.0f || u > 1.0f) return false;
+    const float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+    const float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+    return t > 0.0f;
+}
+
+bool intersectarRaio(
+    const BVHMalha& bvh,
+    const Fatia<float>& vertices,
+    const Fatia<CantoTri>& triangulos,
+    const float origem[3],
+    const float direcao[3],
+    AcertoRaio& out
+) {
+    out = AcertoRaio();
+    if (bvh.vazia()) return false;
+    float inv[3];
+    for (int k = 0; k < 3; ++k) inv[k] = (direcao[k] != 0.0f) ? 1.0f / direcao[k] : FLT_MAX;
+
+    float melhor = FLT_MAX;
+    vector<uint32_t> pilha;
+    pilha.reserve(64);
+    if (entradaNaCaixa(bvh.nos[0].caixa, origem, inv, melhor) != FLT_MAX) pilha.push_back(0);
+    while (!pilha.empty()) {
+        const NoBVH& no = bvh.nos[pilha.back()];
+        const uint32_t indice = pilha.back();
+        pilha.pop_back();
+        if (entradaNaCaixa(no.caixa, origem, inv, melhor) == FLT_MAX) continue;
+
+        if (no.filhoDireito == 0) {
+            for (uint32_t i = no.primeiro; i < no.primeiro + no.contagem; ++i) {
+                const uint32_t t = bvh.ordem[i];
+                const CantoTri* c = &triangulos[(size_t)t * 3u];
+                float dist;
+                if (intersectarTriangulo(posicao(vertices, c[0]), posicao(vertices, c[1]), posicao(vertices, c[2]),
+                                         origem, direcao, dist) && dist < melhor) {
+                    melhor = dist;
+                    out.triangulo = t;
+                    out.t = dist;
+                }
+            }
+            continue;
+        }
+        // Empilha o filho mais distante primeiro para visitar o mais próximo antes
+        const uint32_t esq = indice + 1, dir = no.filhoDireito;
+        const float tEsq = entradaNaCaixa(bvh.nos[esq].caixa, origem, inv, melhor);
+        const float tDir = entradaNaCaixa(bvh.nos[dir].caixa, origem, inv, melhor);
+        if (tEsq <= tDir) {
+            if (tDir != FLT_MAX) pilha.push_back(dir);
+            if (tEsq != FLT_MAX) pilha.push_back(esq);
+        } else {
+            if (tEsq != FLT_MAX) pilha.push_back(esq);
+            if (tDir != FLT_MAX) pilha.push_back(dir);
+        }
+    }
+    return out.triangulo != UINT32_MAX;
+}
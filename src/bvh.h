@@ -0,0 +1,93 @@
+// Hierarquia de volumes envolventes (BVH) sobre os triângulos carregados.
+// Os triângulos são reordenados em faixas espacialmente coerentes: cada nó cobre uma faixa
+// contígua de "ordem", e as subárvores com até trisPorCluster triângulos viram clusters, a
+// unidade de desenho. A cada quadro só os clusters que tocam o frustum são desenhados; a
+// mesma árvore responde ao pick por raio do mouse.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "obj_loader.h"
+
+using namespace std;
+
+struct CaixaAABB {
+    float min[3];
+    float max[3];
+};
+
+struct NoBVH {
+    CaixaAABB caixa;
+    uint32_t primeiro;         // faixa [primeiro, primeiro + contagem) em BVHMalha::ordem
+    uint32_t contagem;
+    uint32_t filhoDireito;     // 0 = folha; o filho esquerdo é sempre o nó seguinte
+    uint32_t primeiroCluster;  // clusters da subárvore (só acima do nível dos clusters;
+    uint32_t numClusters;      // 1 = este nó é a raiz de um cluster)
+};
+
+// Faixa de triângulos desenhada de uma vez
+struct ClusterBVH {
+    CaixaAABB caixa;
+    uint32_t primeiroTri;      // posição em BVHMalha::ordem
+    uint32_t numTris;
+};
+
+struct BVHMalha {
+    vector<NoBVH> nos;
+    vector<uint32_t> ordem;        // índices de triângulo (em triangulos / 3), na ordem da árvore
+    vector<uint32_t> ordemDesenho; // ordem do IBO/listas: igual a "ordem", ou reordenada dentro
+                                   // de cada cluster (otimizar_malha.h)
+    vector<ClusterBVH> clusters;   // em ordem de profundidade: clusters vizinhos têm faixas vizinhas
+    bool vazia() const { return nos.empty(); }
+};
+
+static const uint32_t TRIS_POR_FOLHA_BVH = 8;
+static const uint32_t TRIS_POR_CLUSTER_BVH = 4096;
+
+// Monta a árvore (divisão pela mediana dos centróides no eixo mais longo).
+// Triângulos com posição inválida ficam de fora, como na malha indexada.
+void construirBVH(
+    const Fatia<float>& vertices,
+    const Fatia<CantoTri>& triangulos,
+    BVHMalha& out,
+    uint32_t trisPorCluster = TRIS_POR_CLUSTER_BVH
+);
+
+// Reordena os índices da malha indexada para a ordem da BVH, de forma que cada cluster
+// vire uma faixa contígua [primeiroTri * 3, (primeiroTri + numTris) * 3) do IBO
+void reordenarIndicesPorBVH(const BVHMalha& bvh, const Fatia<CantoTri>& triangulos, MalhaIndexada& malha);
+
+// construirBVH + reordenarIndicesPorBVH, com o tempo e o tamanho da árvore no log
+void prepararBVH(const Fatia<float>& vertices, const Fatia<CantoTri>& triangulos,
+                 MalhaIndexada& malha, BVHMalha& bvh);
+
+// Planos do frustum (ax + by + cz + d >= 0 dentro) no espaço do objeto, extraídos de
+// projeção * modelview (matrizes em coluna, como devolvidas por glGetFloatv)
+struct Frustum {
+    float planos[6][4];
+};
+
+Frustum frustumDasMatrizes(const float projecao[16], const float modelview[16]);
+
+// true se a caixa toca o frustum (teste conservador pelos 6 planos)
+bool caixaNoFrustum(const Frustum& f, const CaixaAABB& c);
+
+// Preenche "visiveis" com os clusters que tocam o frustum, em ordem crescente
+void clustersVisiveis(const BVHMalha& bvh, const Frustum& f, vector<uint32_t>& visiveis);
+
+struct AcertoRaio {
+    uint32_t triangulo = UINT32_MAX;   // índice em triangulos / 3
+    float t = 0.0f;                    // distância ao longo da direção
+};
+
+// Triângulo mais próximo atingido pelo raio origem + t * direcao (t > 0); false se nenhum
+bool intersectarRaio(
+    const BVHMalha& bvh,
+    const Fatia<float>& vertices,
+    const Fatia<CantoTri>& triangulos,
+    const float origem[3],
+    const float direcao[3],
+    AcertoRaio& out
+);
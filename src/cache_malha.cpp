@@ -0,0 +1,266 @@
+#include "cache_malha.h"
+
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Layout do arquivo:
+//   CabecalhoCache
+//   seções (vertices, normaisCalculadas, normaisOBJ, uvs, triangulos, indicesPos,
+//           verticesIndexados, indices16, indices32, indicesLOD, niveisLOD, materialTri,
+//           faixasMaterial, textoMateriais, nosBVH, ordemBVH, ordemDesenhoBVH, clustersBVH),
+//   cada uma começando em deslocamento múltiplo de ALINHAMENTO
+// O checksum cobre todos os bytes depois do cabeçalho.
+static const char MAGICA_CACHE[8] = { 'O','B','J','C','A','C','H','E' };
+static const size_t ALINHAMENTO = 16;
+static const int NUM_SECOES = 18;
+
+struct CabecalhoCache {
+    char magica[8];
+    uint32_t versao;
+    uint32_t tamCabecalho;
+    uint64_t tamanhoOBJ;       // chave: tamanho do OBJ em bytes
+    int64_t mtimeOBJ;          // chave: mtime do OBJ em ns
+    uint64_t hashCaminho;      // chave: hash do caminho absoluto do OBJ
+    uint32_t preparo;          // chave: PREPARO_CACHE_* pedido na carga que gravou
+    uint32_t reservado;
+    uint64_t tamSecao[NUM_SECOES];   // em bytes
+    uint64_t tamanhoPayload;
+    uint64_t checksum;
+};
+
+size_t alinharSecao(size_t n) { return (n + ALINHAMENTO - 1) & ~(ALINHAMENTO - 1); }
+
+// FNV-1a 64 bits (usado para o caminho)
+static uint64_t fnv1a(const void* dados, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(dados);
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+// Checksum do payload: processa 8 bytes por vez para não virar gargalo da recarga.
+// O payload sempre tem tamanho múltiplo de ALINHAMENTO, então só há palavras inteiras.
+uint64_t checksumInicial(size_t n) { return 0x9e3779b97f4a7c15ull ^ n; }
+
+static uint64_t misturarPalavra(uint64_t h, uint64_t w) {
+    h = (h ^ w) * 0x100000001b3ull;
+    return h ^ (h >> 29);
+}
+
+static uint64_t checksum64(const void* dados, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(dados);
+    uint64_t h = checksumInicial(n);
+    for (size_t i = 0; i + 8 <= n; i += 8) {
+        uint64_t w; memcpy(&w, p + i, 8);
+        h = misturarPalavra(h, w);
+    }
+    return h;
+}
+
+// Mesmo checksum de checksum64, aplicado a uma seção seguida do preenchimento com zeros
+uint64_t checksumSecao(uint64_t h, const void* dados, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(dados);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w; memcpy(&w, p + i, 8);
+        h = misturarPalavra(h, w);
+    }
+    const size_t resto = n - i;
+    size_t preenchido = i;
+    if (resto) {
+        uint64_t w = 0; memcpy(&w, p + i, resto);
+        h = misturarPalavra(h, w);
+        preenchido += 8;
+    }
+    for (; preenchido < alinharSecao(n); preenchido += 8) h = misturarPalavra(h, 0);
+    return h;
+}
+
+static string caminhoAbsoluto(const string& caminho) {
+    char buf[PATH_MAX];
+    if (realpath(caminho.c_str(), buf)) return string(buf);
+    return caminho;
+}
+
+bool lerChaveCacheOBJ(const string& caminhoOBJ, ChaveCacheOBJ& out) {
+    struct stat st;
+    if (stat(caminhoOBJ.c_str(), &st) != 0) return false;
+    out.tamanho = (uint64_t)st.st_size;
+    out.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+    return true;
+}
+
+FILE* criarTemporarioAoLado(const string& destino, string& temp) {
+    temp = destino + ".XXXXXX";
+    const int fd = mkstemp(&temp[0]);
+    if (fd < 0) return nullptr;
+    fchmod(fd, 0644);   // mkstemp cria com 0600; o arquivo final fica legível como os outros
+    FILE* f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        remove(temp.c_str());
+    }
+    return f;
+}
+
+string caminhoCacheMalha(const string& caminhoOBJ, const string& dirCache) {
+    if (dirCache.empty()) return caminhoOBJ + ".cache";
+    const string abs = caminhoAbsoluto(caminhoOBJ);
+    char nome[32];
+    snprintf(nome, sizeof(nome), "%016llx.objcache", (unsigned long long)fnv1a(abs.data(), abs.size()));
+    return dirCache + "/" + nome;
+}
+
+CacheMalhaMapeado::~CacheMalhaMapeado() {
+    if (mapa) munmap(mapa, tamanhoMapa);
+}
+
+void aliviarCacheMalha(const CacheMalhaMapeado& cache) {
+    if (cache.mapa) madvise(cache.mapa, cache.tamanhoMapa, MADV_DONTNEED);
+}
+
+bool abrirCacheMalha(const string& caminhoOBJ, const string& dirCache, uint32_t preparo, CacheMalhaMapeado& out) {
+    ChaveCacheOBJ chave;
+    if (!lerChaveCacheOBJ(caminhoOBJ, chave)) return false;
+
+    const string caminho = caminhoCacheMalha(caminhoOBJ, dirCache);
+    int fd = open(caminho.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CabecalhoCache)) { close(fd); return false; }
+    const size_t tamanho = (size_t)st.st_size;
+    void* mapa = mmap(nullptr, tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapa == MAP_FAILED) return false;
+
+    const unsigned char* base = static_cast<const unsigned char*>(mapa);
+    CabecalhoCache cab; memcpy(&cab, base, sizeof(cab));
+    const string abs = caminhoAbsoluto(caminhoOBJ);
+
+    const char* motivo = nullptr;
+    if (memcmp(cab.magica, MAGICA_CACHE, sizeof(MAGICA_CACHE)) != 0) motivo = "formato invalido";
+    else if (cab.versao != VERSAO_CACHE_MALHA || cab.tamCabecalho != sizeof(CabecalhoCache)) motivo = "versao diferente";
+    else if (cab.tamanhoOBJ != chave.tamanho || cab.mtimeOBJ != chave.mtime
+             || cab.hashCaminho != fnv1a(abs.data(), abs.size())) motivo = "desatualizado";
+    else if (cab.preparo != preparo) motivo = "preparo diferente";
+    else if (cab.tamanhoPayload != tamanho - sizeof(CabecalhoCache)) motivo = "tamanho incorreto";
+    else {
+        size_t soma = 0;
+        for (int i = 0; i < NUM_SECOES; ++i) soma += alinharSecao(cab.tamSecao[i]);
+        if (soma != cab.tamanhoPayload) motivo = "tamanho incorreto";
+        else if (checksum64(base + sizeof(CabecalhoCache), cab.tamanhoPayload) != cab.checksum) motivo = "checksum invalido";
+    }
+    if (motivo) {
+        cerr << "Cache ignorado (" << motivo << "): " << caminho << "\n";
+        munmap(mapa, tamanho);
+        return false;
+    }
+
+    const unsigned char* secao[NUM_SECOES];
+    size_t desloc = sizeof(CabecalhoCache);
+    for (int i = 0; i < NUM_SECOES; ++i) { secao[i] = base + desloc; desloc += alinharSecao(cab.tamSecao[i]); }
+
+    out.mapa = mapa; out.tamanhoMapa = tamanho;
+    out.vertices          = reinterpret_cast<const float*>(secao[0]);        out.nVertices          = cab.tamSecao[0] / sizeof(float);
+    out.normaisCalculadas = reinterpret_cast<const float*>(secao[1]);        out.nNormaisCalculadas = cab.tamSecao[1] / sizeof(float);
+    out.normaisOBJ        = reinterpret_cast<const float*>(secao[2]);        out.nNormaisOBJ        = cab.tamSecao[2] / sizeof(float);
+    out.uvs               = reinterpret_cast<const float*>(secao[3]);        out.nUVs               = cab.tamSecao[3] / sizeof(float);
+    out.triangulos        = reinterpret_cast<const CantoTri*>(secao[4]);     out.nTriangulos        = cab.tamSecao[4] / sizeof(CantoTri);
+    out.indicesPos        = reinterpret_cast<const unsigned int*>(secao[5]); out.nIndicesPos        = cab.tamSecao[5] / sizeof(unsigned int);
+    out.verticesIndexados = reinterpret_cast<const float*>(secao[6]);        out.nVerticesIndexados = cab.tamSecao[6] / sizeof(float);
+    out.indices16         = reinterpret_cast<const uint16_t*>(secao[7]);     out.nIndices16         = cab.tamSecao[7] / sizeof(uint16_t);
+    out.indices32         = reinterpret_cast<const uint32_t*>(secao[8]);     out.nIndices32         = cab.tamSecao[8] / sizeof(uint32_t);
+    out.indicesLOD        = reinterpret_cast<const uint32_t*>(secao[9]);     out.nIndicesLOD        = cab.tamSecao[9] / sizeof(uint32_t);
+    out.niveisLOD         = reinterpret_cast<const NivelLOD*>(secao[10]);    out.nNiveisLOD         = cab.tamSecao[10] / sizeof(NivelLOD);
+    out.materialTri       = reinterpret_cast<const int32_t*>(secao[11]);     out.nMaterialTri       = cab.tamSecao[11] / sizeof(int32_t);
+    out.faixasMaterial    = reinterpret_cast<const FaixaMaterial*>(secao[12]); out.nFaixasMaterial  = cab.tamSecao[12] / sizeof(FaixaMaterial);
+    out.textoMateriais    = reinterpret_cast<const char*>(secao[13]);        out.nTextoMateriais    = cab.tamSecao[13];
+    out.nosBVH            = reinterpret_cast<const NoBVH*>(secao[14]);       out.nNosBVH            = cab.tamSecao[14] / sizeof(NoBVH);
+    out.ordemBVH          = reinterpret_cast<const uint32_t*>(secao[15]);    out.nOrdemBVH          = cab.tamSecao[15] / sizeof(uint32_t);
+    out.ordemDesenhoBVH   = reinterpret_cast<const uint32_t*>(secao[16]);    out.nOrdemDesenhoBVH   = cab.tamSecao[16] / sizeof(uint32_t);
+    out.clustersBVH       = reinterpret_cast<const ClusterBVH*>(secao[17]);  out.nClustersBVH       = cab.tamSecao[17] / sizeof(ClusterBVH);
+    return true;
+}
+
+bool gravarCacheMalha(const string& caminhoOBJ, const string& dirCache, const ChaveCacheOBJ& chave,
+                      const MalhaOBJ& malha, uint32_t preparo, const BVHMalha* bvh) {
+    const MalhaIndexada& malhaIndexada = malha.indexada;
+    static const BVHMalha semBVH;
+    const BVHMalha& arvore = bvh ? *bvh : semBVH;
+    const string textoMateriais = textoNomesMateriais(malha.nomesMateriais);
+    CabecalhoCache cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magica, MAGICA_CACHE, sizeof(MAGICA_CACHE));
+    cab.versao = VERSAO_CACHE_MALHA;
+    cab.tamCabecalho = sizeof(CabecalhoCache);
+    cab.tamanhoOBJ = chave.tamanho;
+    cab.mtimeOBJ = chave.mtime;
+    const string abs = caminhoAbsoluto(caminhoOBJ);
+    cab.hashCaminho = fnv1a(abs.data(), abs.size());
+    cab.preparo = preparo;
+
+    const void* dados[NUM_SECOES] = {
+        malha.vertices.data(), malha.normaisCalculadas.data(), malha.normaisOBJ.data(),
+        malha.uvs.data(), malha.triangulos.data(), malha.indicesPos.data(),
+        malhaIndexada.vertices.data(), malhaIndexada.indices16.data(), malhaIndexada.indices32.data(),
+        malhaIndexada.indicesLOD.data(), malhaIndexada.niveisLOD.data(),
+        malha.materialTri.data(), malhaIndexada.faixasMaterial.data(), textoMateriais.data(),
+        arvore.nos.data(), arvore.ordem.data(), arvore.ordemDesenho.data(), arvore.clusters.data()
+    };
+    cab.tamSecao[0] = malha.vertices.size() * sizeof(float);
+    cab.tamSecao[1] = malha.normaisCalculadas.size() * sizeof(float);
+    cab.tamSecao[2] = malha.normaisOBJ.size() * sizeof(float);
+    cab.tamSecao[3] = malha.uvs.size() * sizeof(float);
+    cab.tamSecao[4] = malha.triangulos.size() * sizeof(CantoTri);
+    cab.tamSecao[5] = malha.indicesPos.size() * sizeof(unsigned int);
+    cab.tamSecao[6] = malhaIndexada.vertices.size() * sizeof(float);
+    cab.tamSecao[7] = malhaIndexada.indices16.size() * sizeof(uint16_t);
+    cab.tamSecao[8] = malhaIndexada.indices32.size() * sizeof(uint32_t);
+    cab.tamSecao[9] = malhaIndexada.indicesLOD.size() * sizeof(uint32_t);
+    cab.tamSecao[10] = malhaIndexada.niveisLOD.size() * sizeof(NivelLOD);
+    cab.tamSecao[11] = malha.materialTri.size() * sizeof(int32_t);
+    cab.tamSecao[12] = malhaIndexada.faixasMaterial.size() * sizeof(FaixaMaterial);
+    cab.tamSecao[13] = textoMateriais.size();
+    cab.tamSecao[14] = arvore.nos.size() * sizeof(NoBVH);
+    cab.tamSecao[15] = arvore.ordem.size() * sizeof(uint32_t);
+    cab.tamSecao[16] = arvore.ordemDesenho.size() * sizeof(uint32_t);
+    cab.tamSecao[17] = arvore.clusters.size() * sizeof(ClusterBVH);
+
+    size_t total = 0;
+    for (int i = 0; i < NUM_SECOES; ++i) total += alinharSecao(cab.tamSecao[i]);
+    cab.tamanhoPayload = total;
+    cab.checksum = checksumInicial(total);
+    for (int i = 0; i < NUM_SECOES; ++i) cab.checksum = checksumSecao(cab.checksum, dados[i], cab.tamSecao[i]);
+
+    const string caminho = caminhoCacheMalha(caminhoOBJ, dirCache);
+    string temp;
+    FILE* f = criarTemporarioAoLado(caminho, temp);
+    if (!f) {
+        cerr << "Nao foi possivel gravar cache: " << caminho << "\n";
+        return false;
+    }
+    static const unsigned char zeros[ALINHAMENTO] = {};
+    bool ok = fwrite(&cab, sizeof(cab), 1, f) == 1;
+    for (int i = 0; ok && i < NUM_SECOES; ++i) {
+        if (cab.tamSecao[i]) ok = fwrite(dados[i], cab.tamSecao[i], 1, f) == 1;
+        const size_t pad = alinharSecao(cab.tamSecao[i]) - cab.tamSecao[i];
+        if (ok && pad) ok = fwrite(zeros, pad, 1, f) == 1;
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(temp.c_str(), caminho.c_str()) != 0) {
+        remove(temp.c_str());
+        cerr << "Nao foi possivel gravar cache: " << caminho << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+// Cache binário de malhas já processadas.
+// Depois do primeiro parse de um OBJ, os buffers finais (posições, normais calculadas,
+// normais/UVs do arquivo, triângulos, índices de posição, a malha indexada com os níveis
+// de detalhe e os materiais por triângulo, com os nomes) são gravados num arquivo
+// binário. Nas cargas seguintes o arquivo é mapeado em memória e fica mapeado enquanto a
+// MalhaOBJ existir (MalhaOBJ::cache): sem parse, o envio à GPU, a display list e o
+// rasterizador leem as páginas mapeadas por VisaoMalhaOBJ. Com a BVH e a otimização da ordem
+// pedidas na carga, o cache guarda os índices já reordenados e a árvore, e a carga seguinte
+// só copia a BVH para os vetores. Sem elas, só é copiado o que vai ser alterado (vértices e
+// LODs de um cache gravado sem níveis).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+#include "obj_loader.h"
+
+using namespace std;
+
+// Incrementar sempre que o layout do arquivo ou o resultado do parse mudar
+static const uint32_t VERSAO_CACHE_MALHA = 6;
+
+// Passo feito depois da indexação antes de gravar (OpcoesCarregamento::montarBVH/otimizarOrdem)
+static const uint32_t PREPARO_CACHE_BVH = 1;
+static const uint32_t PREPARO_CACHE_OTIMIZADA = 2;
+
+// Visão somente leitura de um cache mapeado (válida enquanto o objeto existir)
+struct CacheMalhaMapeado {
+    const float* vertices = nullptr;          size_t nVertices = 0;          // em floats
+    const float* normaisCalculadas = nullptr; size_t nNormaisCalculadas = 0;
+    const float* normaisOBJ = nullptr;        size_t nNormaisOBJ = 0;
+    const float* uvs = nullptr;               size_t nUVs = 0;
+    const CantoTri* triangulos = nullptr;     size_t nTriangulos = 0;        // em cantos
+    const unsigned int* indicesPos = nullptr; size_t nIndicesPos = 0;
+    const float* verticesIndexados = nullptr; size_t nVerticesIndexados = 0; // em floats
+    const uint16_t* indices16 = nullptr;      size_t nIndices16 = 0;
+    const uint32_t* indices32 = nullptr;      size_t nIndices32 = 0;
+    const uint32_t* indicesLOD = nullptr;     size_t nIndicesLOD = 0;
+    const NivelLOD* niveisLOD = nullptr;      size_t nNiveisLOD = 0;
+    const int32_t* materialTri = nullptr;     size_t nMaterialTri = 0;
+    const FaixaMaterial* faixasMaterial = nullptr; size_t nFaixasMaterial = 0;
+    const char* textoMateriais = nullptr;     size_t nTextoMateriais = 0;    // textoNomesMateriais
+    // BVHMalha (vazias sem PREPARO_CACHE_BVH)
+    const NoBVH* nosBVH = nullptr;            size_t nNosBVH = 0;
+    const uint32_t* ordemBVH = nullptr;       size_t nOrdemBVH = 0;
+    const uint32_t* ordemDesenhoBVH = nullptr; size_t nOrdemDesenhoBVH = 0;
+    const ClusterBVH* clustersBVH = nullptr;  size_t nClustersBVH = 0;
+
+    CacheMalhaMapeado() = default;
+    CacheMalhaMapeado(const CacheMalhaMapeado&) = delete;
+    CacheMalhaMapeado& operator=(const CacheMalhaMapeado&) = delete;
+    ~CacheMalhaMapeado();
+
+    void* mapa = nullptr;
+    size_t tamanhoMapa = 0;
+};
+
+// Caminho do cache para um OBJ: ao lado do arquivo ("modelo.obj.cache") ou, se
+// dirCache não for vazio, dentro dele com nome derivado do caminho absoluto.
+string caminhoCacheMalha(const string& caminhoOBJ, const string& dirCache);
+
+// Chave do cache: tamanho e mtime (ns) do OBJ
+struct ChaveCacheOBJ {
+    uint64_t tamanho = 0;
+    int64_t mtime = 0;
+};
+
+// Lê a chave do OBJ. Deve ser lida antes do parse: se o arquivo mudar durante o parse, o
+// cache gravado fica com a chave antiga e é descartado na carga seguinte.
+bool lerChaveCacheOBJ(const string& caminhoOBJ, ChaveCacheOBJ& out);
+
+// Mapeia o cache do OBJ se ele existir e ainda corresponder ao arquivo (mesmo caminho,
+// tamanho e mtime) e ao preparo pedido (PREPARO_CACHE_*), com versão e checksum válidos.
+// Retorna false caso contrário.
+bool abrirCacheMalha(const string& caminhoOBJ, const string& dirCache, uint32_t preparo, CacheMalhaMapeado& out);
+
+// Devolve ao sistema as páginas já lidas do mapeamento (que continua válido: uma leitura
+// seguinte recarrega a página do arquivo). Para depois que a GPU recebeu a malha.
+void aliviarCacheMalha(const CacheMalhaMapeado& cache);
+
+// Grava (de forma atômica: arquivo temporário + rename) o cache do OBJ, com a chave lida
+// antes do parse que produziu a malha, o preparo feito nela e a BVH (nullptr = sem BVH)
+bool gravarCacheMalha(const string& caminhoOBJ, const string& dirCache, const ChaveCacheOBJ& chave,
+                      const MalhaOBJ& malha, uint32_t preparo, const BVHMalha* bvh);
+
+// Cria um arquivo temporário de nome único ao lado de destino (mkstemp), para ser gravado e
+// depois renomeado para destino; gravações simultâneas não pisam no arquivo uma da outra.
+// Devolve nullptr se não conseguiu criar; o nome criado fica em temp.
+FILE* criarTemporarioAoLado(const string& destino, string& temp);
+
+// Checksum dos arquivos em seções (também usado por malha_pronta.h): começa em
+// checksumInicial(tamanho do payload) e passa por checksumSecao em cada seção, na ordem;
+// cada seção conta com o preenchimento com zeros até alinharSecao(n) bytes.
+size_t alinharSecao(size_t n);
+uint64_t checksumInicial(size_t n);
+uint64_t checksumSecao(uint64_t h, const void* dados, size_t n);
@@ -0,0 +1,179 @@
+#include "captura.h"
+#include "imagem.h"
+#include "paralelo.h"
+#include "perf.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <sys/stat.h>
+
+using namespace std;
+
+static string caminhoQuadro(const CapturaQuadros& c, int indice) {
+    char nome[32];
+    snprintf(nome, sizeof(nome), "/quadro_%04d", indice);
+    return c.saida + nome + (gravacaoPNGDisponivel() ? ".png" : ".ppm");
+}
+
+// Como "mkdir -p"
+static bool criarDiretorios(const string& caminho) {
+    for (size_t p = caminho.find('/', 1); ; p = caminho.find('/', p + 1)) {
+        const string parte = caminho.substr(0, p);
+        if (mkdir(parte.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (p == string::npos) return true;
+    }
+}
+
+// Vídeo cru: linhas de cima para baixo, como os leitores de rawvideo esperam
+static bool acrescentarVideo(CapturaQuadros& c, const vector<uint8_t>& rgba) {
+    const size_t linha = (size_t)c.largura * 4;
+    for (int y = c.altura - 1; y >= 0; --y)
+        if (fwrite(&rgba[(size_t)y * linha], 1, linha, c.arquivoVideo) != linha) return false;
+    return true;
+}
+
+static void codificarQuadros(CapturaQuadros* c) {
+    nomearThreadPerf("captura");
+    for (;;) {
+        QuadroCapturado q;
+        {
+            unique_lock<mutex> l(c->trava);
+            c->temQuadro.wait(l, [c] { return !c->fila.empty() || c->encerrando; });
+            if (c->fila.empty()) return;
+            q = move(c->fila.front());
+            c->fila.pop_front();
+        }
+        c->temEspaco.notify_one();
+        bool ok;
+        {
+            PERF_ESCOPO("captura.codificar");
+            ok = c->videoCru ? acrescentarVideo(*c, q.rgba) : gravarImagemRGBA(caminhoQuadro(*c, q.indice), c->largura, c->altura, q.rgba.data());
+        }
+        lock_guard<mutex> l(c->trava);
+        if (!ok) c->falhou = true;
+        ++c->gravados;
+        c->livres.push_back(move(q.rgba));
+    }
+}
+
+// Copia o quadro para um buffer livre e o põe na fila (espera se ela está cheia)
+static void entregarQuadro(CapturaQuadros& c, int indice, const uint8_t* rgba) {
+    const size_t n = (size_t)c.largura * c.altura * 4;
+    vector<uint8_t> buf;
+    {
+        unique_lock<mutex> l(c.trava);
+        const auto t0 = chrono::steady_clock::now();
+        c.temEspaco.wait(l, [&c] { return c.fila.size() < c.maxFila; });
+        c.esperaFilaMs += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        if (!c.livres.empty()) {
+            buf = move(c.livres.back());
+            c.livres.pop_back();
+        }
+    }
+    buf.resize(n);
+    memcpy(buf.data(), rgba, n);
+    {
+        lock_guard<mutex> l(c.trava);
+        c.fila.push_back(QuadroCapturado{ indice, move(buf) });
+    }
+    c.temQuadro.notify_one();
+}
+
+// Espera a cópia do PBO i terminar, mapeia e entrega o quadro dele
+static void entregarPBO(CapturaQuadros& c, size_t i) {
+    PERF_ESCOPO("captura.leitura");
+    const auto t0 = chrono::steady_clock::now();
+    while (glClientWaitSync(c.cercas[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+    c.esperaLeituraMs += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    glDeleteSync(c.cercas[i]);
+    c.cercas[i] = nullptr;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, c.pbos[i]);
+    const size_t n = (size_t)c.largura * c.altura * 4;
+    const void* p = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)n, GL_MAP_READ_BIT);
+    if (p) {
+        entregarQuadro(c, c.indicePBO[i], static_cast<const uint8_t*>(p));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        cerr << "Falha ao mapear o PBO do quadro " << c.indicePBO[i] << "\n";
+        lock_guard<mutex> l(c.trava);
+        c.falhou = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    c.indicePBO[i] = -1;
+}
+
+bool iniciarCaptura(CapturaQuadros& c, const string& saida, int largura, int altura, int numPBOs, int numThreads) {
+    c.largura = largura;
+    c.altura = altura;
+    c.saida = saida;
+    c.videoCru = saida.size() > 5 && saida.compare(saida.size() - 5, 5, ".rgba") == 0;
+    if (c.videoCru) {
+        c.arquivoVideo = fopen(saida.c_str(), "wb");
+        if (!c.arquivoVideo) {
+            cerr << "Falha ao criar " << saida << ": " << strerror(errno) << "\n";
+            return false;
+        }
+    } else if (!criarDiretorios(saida)) {
+        cerr << "Falha ao criar o diretorio " << saida << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    // O vídeo precisa dos quadros em ordem: um codificador só
+    const size_t threads = c.videoCru ? 1 : numThreadsEfetivo(numThreads);
+    c.maxFila = 2 * threads + 2;
+    c.encerrando = false;
+    for (size_t i = 0; i < threads; ++i) c.codificadores.emplace_back(codificarQuadros, &c);
+
+    if (numPBOs > 0) {
+        const size_t n = (size_t)largura * altura * 4;
+        c.pbos.resize((size_t)numPBOs);
+        c.cercas.assign((size_t)numPBOs, nullptr);
+        c.indicePBO.assign((size_t)numPBOs, -1);
+        glGenBuffers(numPBOs, c.pbos.data());
+        for (GLuint pbo : c.pbos) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)n, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    return true;
+}
+
+void capturarQuadro(CapturaQuadros& c, int indice) {
+    const size_t i = c.proximoPBO;
+    c.proximoPBO = (i + 1) % c.pbos.size();
+    if (c.indicePBO[i] >= 0) entregarPBO(c, i);   // o mais antigo do anel
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, c.pbos[i]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, c.largura, c.altura, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    c.cercas[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    c.indicePBO[i] = indice;
+}
+
+void capturarQuadroRGBA(CapturaQuadros& c, int indice, const uint8_t* rgba) {
+    entregarQuadro(c, indice, rgba);
+}
+
+bool encerrarCaptura(CapturaQuadros& c) {
+    for (size_t k = 0; k < c.pbos.size(); ++k) {
+        const size_t i = (c.proximoPBO + k) % c.pbos.size();
+        if (c.indicePBO[i] >= 0) entregarPBO(c, i);
+    }
+    {
+        lock_guard<mutex> l(c.trava);
+        c.encerrando = true;
+    }
+    c.temQuadro.notify_all();
+    for (thread& t : c.codificadores) t.join();
+    c.codificadores.clear();
+    if (!c.pbos.empty()) glDeleteBuffers((GLsizei)c.pbos.size(), c.pbos.data());
+    c.pbos.clear();
+    if (c.arquivoVideo && fclose(c.arquivoVideo) != 0) c.falhou = true;
+    c.arquivoVideo = nullptr;
+    c.livres.clear();
+    return !c.falhou;
+}
@@ -0,0 +1,68 @@
+// Captura de uma sequência de quadros (modo --turntable) sem parar o pipeline: cada quadro é
+// lido com glReadPixels para um anel de pixel buffer objects, e só o quadro de algumas
+// posições atrás é mapeado, quando a GPU já terminou de copiá-lo. Os pixels vão para uma fila
+// e threads de fundo gravam cada quadro como imagem (PNG, ou PPM sem libpng) ou acrescentam ao
+// arquivo de vídeo cru. Precisa de contexto GL corrente, exceto capturarQuadroRGBA.
+
+#pragma once
+
+#include <GL/freeglut.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct QuadroCapturado {
+    int indice = 0;
+    vector<uint8_t> rgba;   // linha 0 embaixo, como glReadPixels
+};
+
+struct CapturaQuadros {
+    int largura = 0, altura = 0;
+    string saida;               // diretório das imagens, ou o arquivo .rgba do vídeo cru
+    bool videoCru = false;
+    FILE* arquivoVideo = nullptr;
+
+    // Anel de PBOs: pbos[i % n] recebe o quadro i; indicePBO = quadro em cada um (-1 = livre)
+    vector<GLuint> pbos;
+    vector<GLsync> cercas;
+    vector<int> indicePBO;
+    size_t proximoPBO = 0;
+
+    // Fila para os codificadores, limitada: quem captura espera quando ela enche
+    mutex trava;
+    condition_variable temQuadro, temEspaco;
+    deque<QuadroCapturado> fila;
+    vector<vector<uint8_t>> livres;   // buffers já gravados, reaproveitados
+    size_t maxFila = 0;
+    bool encerrando = false;
+    vector<thread> codificadores;
+    size_t gravados = 0;
+    bool falhou = false;
+
+    double esperaLeituraMs = 0.0;   // dentro de glClientWaitSync (a cópia do quadro antigo ainda não acabou)
+    double esperaFilaMs = 0.0;      // com a fila cheia (codificação mais lenta que o desenho)
+};
+
+// saida terminando em ".rgba" grava vídeo cru (quadros RGBA de cima para baixo, em ordem,
+// com uma thread só); senão, saida é um diretório (criado se não existe) e cada quadro vira
+// quadro_NNNN.png em até numThreads threads (0 = núcleos disponíveis). numPBOs = 0 captura sem
+// contexto GL (só capturarQuadroRGBA).
+bool iniciarCaptura(CapturaQuadros& c, const string& saida, int largura, int altura, int numPBOs, int numThreads);
+
+// Começa a leitura do framebuffer atual para o quadro "indice" e entrega à fila o quadro mais
+// antigo do anel, se ele já estava ocupado
+void capturarQuadro(CapturaQuadros& c, int indice);
+
+// Entrega um quadro que já está na memória (backend CPU)
+void capturarQuadroRGBA(CapturaQuadros& c, int indice, const uint8_t* rgba);
+
+// Entrega o que ainda está no anel, espera os codificadores e libera os PBOs. Devolve false se
+// alguma gravação falhou.
+bool encerrarCaptura(CapturaQuadros& c);
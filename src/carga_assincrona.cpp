@@ -0,0 +1,77 @@
+#include "carga_assincrona.h"
+#include "perf.h"
+
+#include <cmath>
+#include <fstream>
+
+using namespace std;
+
+// Monta um lote de pré-visualização a partir dos triângulos novos do progresso.
+// Sem vn no arquivo, usa a normal da face (as normais suaves só existem no fim do parse).
+static void montarLotePrevia(const ProgressoCarga& p, vector<float>& lote) {
+    const size_t nCantos = p.nCantosNovos - p.nCantosNovos % 3;
+    lote.clear();
+    lote.reserve(nCantos * FLOATS_POR_VERTICE);
+    for (size_t i = 0; i < nCantos; i += 3) {
+        const CantoTri* t = p.trisNovos + i;
+        bool valido = true;
+        for (int k = 0; k < 3; ++k)
+            if (t[k].v < 0 || (size_t)t[k].v * 3u + 2 >= p.nVertices) valido = false;
+        if (!valido) continue;
+        const float* P[3] = { p.vertices + (size_t)t[0].v * 3u, p.vertices + (size_t)t[1].v * 3u, p.vertices + (size_t)t[2].v * 3u };
+
+        float nf[3];
+        const float ux = P[1][0] - P[0][0], uy = P[1][1] - P[0][1], uz = P[1][2] - P[0][2];
+        const float vx = P[2][0] - P[0][0], vy = P[2][1] - P[0][1], vz = P[2][2] - P[0][2];
+        nf[0] = uy * vz - uz * vy; nf[1] = uz * vx - ux * vz; nf[2] = ux * vy - uy * vx;
+        const float len = sqrt(nf[0]*nf[0] + nf[1]*nf[1] + nf[2]*nf[2]);
+        if (len > 1e-8f) { nf[0] /= len; nf[1] /= len; nf[2] /= len; }
+
+        for (int k = 0; k < 3; ++k) {
+            const CantoTri& c = t[k];
+            const float* N = (c.vn >= 0 && (size_t)c.vn * 3u + 2 < p.nNormaisOBJ) ? p.normaisOBJ + (size_t)c.vn * 3u : nf;
+            const bool temUV = c.vt >= 0 && (size_t)c.vt * 2u + 1 < p.nUVs;
+            lote.insert(lote.end(), P[k], P[k] + 3);
+            lote.insert(lote.end(), N, N + 3);
+            lote.push_back(temUV ? p.uvs[(size_t)c.vt * 2u] : 0.0f);
+            lote.push_back(temUV ? p.uvs[(size_t)c.vt * 2u + 1] : 0.0f);
+        }
+    }
+}
+
+void iniciarCargaAssincrona(CargaAssincrona& carga, const string& caminho, OpcoesCarregamento opcoes) {
+    carga.ativa = true;
+    carga.terminou = false;
+    // Stream e Paralelo só informam progresso no fim; o total já aparece desde o começo
+    ifstream arq(caminho, ios::binary | ios::ate);
+    if (arq) carga.bytesTotal = (size_t)arq.tellg();
+    opcoes.aoProgresso = [&carga](const ProgressoCarga& p) {
+        carga.bytesLidos = p.bytesLidos;
+        carga.bytesTotal = p.bytesTotal;
+        carga.triangulos = p.triangulos;
+        if (p.nCantosNovos == 0) return;
+        vector<float> lote;
+        montarLotePrevia(p, lote);
+        if (lote.empty()) return;
+        lock_guard<mutex> g(carga.trava);
+        carga.lotesProntos.push_back(move(lote));
+    };
+    carga.trabalhador = thread([&carga, caminho, opcoes]() {
+        nomearThreadPerf("carga");
+        carga.sucesso = carregarMalhaOBJ(caminho, carga.obj, opcoes, carga.arena, &carga.bvh);
+        carga.triangulos = VisaoMalhaOBJ(carga.obj).triangulos.size() / 3;
+        carga.terminou = true;
+    });
+}
+
+void retirarLotesPrevia(CargaAssincrona& carga, vector<vector<float>>& out) {
+    lock_guard<mutex> g(carga.trava);
+    for (auto& l : carga.lotesProntos) out.push_back(move(l));
+    carga.lotesProntos.clear();
+}
+
+bool finalizarCargaAssincrona(CargaAssincrona& carga) {
+    if (carga.trabalhador.joinable()) carga.trabalhador.join();
+    carga.ativa = false;
+    return carga.sucesso;
+}
@@ -0,0 +1,46 @@
+// Carregamento do OBJ numa thread de trabalho.
+// A thread faz todo o trabalho de CPU (parse, normais, malha indexada, cache) sem tocar
+// em OpenGL e, durante o parse, monta lotes de pré-visualização (triângulos já prontos
+// para desenhar). A thread de renderização retira esses lotes entre quadros e os envia
+// para a GPU, de modo que o modelo aparece aos poucos enquanto a janela segue interativa.
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bvh.h"
+#include "obj_loader.h"
+
+using namespace std;
+
+struct CargaAssincrona {
+    thread trabalhador;
+    mutex trava;
+    vector<vector<float>> lotesProntos;   // vértices intercalados (FLOATS_POR_VERTICE), 3 por triângulo
+
+    atomic<size_t> bytesLidos{ 0 };
+    atomic<size_t> bytesTotal{ 0 };
+    atomic<size_t> triangulos{ 0 };
+    atomic<bool> terminou{ false };
+    bool sucesso = false;
+    bool ativa = false;
+    ArenaCarga* arena = nullptr; // temporários da carga; só a thread a usa enquanto ela roda
+
+    // Resultado, válido depois de finalizarCargaAssincrona. Trocar (swap) em vez de copiar
+    // devolve os vetores antigos para a próxima carga reaproveitar.
+    MalhaOBJ obj;
+    BVHMalha bvh;
+};
+
+// Dispara a thread (a carga não faz chamadas GL)
+void iniciarCargaAssincrona(CargaAssincrona& carga, const string& caminho, OpcoesCarregamento opcoes);
+
+// Move para "out" os lotes de pré-visualização acumulados desde a última chamada
+void retirarLotesPrevia(CargaAssincrona& carga, vector<vector<float>>& out);
+
+// Espera a thread terminar (chamar depois de carga.terminou) e devolve se o OBJ foi carregado
+bool finalizarCargaAssincrona(CargaAssincrona& carga);
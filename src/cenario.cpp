@@ -0,0 +1,429 @@
+#include "cenario.h"
+#include "arena.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// Primeira posição de atributo da matriz por instância (ocupa 4 posições). Fica longe das que
+// alguns drivers apelidam para os arrays do pipeline fixo (posição, normal, cor, texcoord0).
+static const GLuint ATRIB_MATRIZ_INSTANCIA = 10;
+
+// --- Leitura do .cena ---
+
+static void matrizIdentidade(float m[16]) {
+    for (int i = 0; i < 16; ++i) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
+
+// r = a · b (colunas)
+static void multiplicarMatrizes(const float a[16], const float b[16], float r[16]) {
+    float t[16];
+    for (int c = 0; c < 4; ++c)
+        for (int l = 0; l < 4; ++l) {
+            float s = 0.0f;
+            for (int k = 0; k < 4; ++k) s += a[k * 4 + l] * b[c * 4 + k];
+            t[c * 4 + l] = s;
+        }
+    memcpy(r, t, sizeof(t));
+}
+
+// Rotação de "graus" em torno do eixo 0 (X), 1 (Y) ou 2 (Z), como glRotatef
+static void matrizRotacao(int eixo, float graus, float m[16]) {
+    matrizIdentidade(m);
+    const float r = graus * 3.14159265358979f / 180.0f, c = cos(r), s = sin(r);
+    const int a = (eixo + 1) % 3, b = (eixo + 2) % 3;
+    m[a * 4 + a] = c;  m[b * 4 + a] = -s;
+    m[a * 4 + b] = s;  m[b * 4 + b] = c;
+}
+
+static void montarMatrizInstancia(const float t[3], const float rot[3], float escala, float m[16]) {
+    matrizIdentidade(m);
+    m[12] = t[0]; m[13] = t[1]; m[14] = t[2];
+    float r[16];
+    for (int eixo = 0; eixo < 3; ++eixo) {
+        if (rot[eixo] == 0.0f) continue;
+        matrizRotacao(eixo, rot[eixo], r);
+        multiplicarMatrizes(m, r, m);
+    }
+    for (int c = 0; c < 3; ++c)
+        for (int l = 0; l < 3; ++l) m[c * 4 + l] *= escala;
+}
+
+static string diretorioDe(const string& caminho) {
+    const size_t barra = caminho.find_last_of('/');
+    return barra == string::npos ? string() : caminho.substr(0, barra + 1);
+}
+
+bool lerCenario(const string& caminho, DescricaoCenario& out) {
+    out = DescricaoCenario();
+    ifstream f(caminho);
+    if (!f) {
+        cerr << "Falha ao abrir cenario: " << caminho << "\n";
+        return false;
+    }
+    const string dir = diretorioDe(caminho);
+    string linha;
+    int numLinha = 0;
+    while (getline(f, linha)) {
+        ++numLinha;
+        istringstream ss(linha);
+        string tipo;
+        if (!(ss >> tipo) || tipo[0] == '#') continue;
+        if (tipo == "malha") {
+            string nome, arquivo;
+            if (!(ss >> nome >> arquivo)) {
+                cerr << caminho << ":" << numLinha << ": esperado 'malha <nome> <arquivo.obj>'\n";
+                return false;
+            }
+            if (find(out.nomesMalhas.begin(), out.nomesMalhas.end(), nome) != out.nomesMalhas.end()) {
+                cerr << caminho << ":" << numLinha << ": malha repetida: " << nome << "\n";
+                return false;
+            }
+            out.nomesMalhas.push_back(nome);
+            out.caminhosMalhas.push_back(arquivo[0] == '/' ? arquivo : dir + arquivo);
+        } else if (tipo == "instancia") {
+            string nome;
+            float t[3], rot[3] = { 0.0f, 0.0f, 0.0f }, escala = 1.0f;
+            if (!(ss >> nome >> t[0] >> t[1] >> t[2])) {
+                cerr << caminho << ":" << numLinha << ": esperado 'instancia <malha> tx ty tz [rx ry rz [escala]]'\n";
+                return false;
+            }
+            if (ss >> rot[0]) {
+                if (!(ss >> rot[1] >> rot[2])) {
+                    cerr << caminho << ":" << numLinha << ": rotacao incompleta\n";
+                    return false;
+                }
+                ss >> escala;
+            }
+            const auto it = find(out.nomesMalhas.begin(), out.nomesMalhas.end(), nome);
+            if (it == out.nomesMalhas.end()) {
+                cerr << caminho << ":" << numLinha << ": malha nao declarada: " << nome << "\n";
+                return false;
+            }
+            InstanciaCenario inst;
+            inst.malha = (uint32_t)(it - out.nomesMalhas.begin());
+            montarMatrizInstancia(t, rot, escala, inst.matriz);
+            out.instancias.push_back(inst);
+        } else {
+            cerr << caminho << ":" << numLinha << ": linha desconhecida: " << tipo << "\n";
+            return false;
+        }
+    }
+    if (out.instancias.empty()) {
+        cerr << "Cenario sem instancias: " << caminho << "\n";
+        return false;
+    }
+    return true;
+}
+
+const char* nomeModoCenario(ModoCenario modo) {
+    switch (modo) {
+        case ModoCenario::Instancias: return "instancias";
+        case ModoCenario::Lotes: return "lotes";
+        case ModoCenario::Copias: return "copias";
+    }
+    return "?";
+}
+
+// --- Shader do modo Instancias ---
+
+// Mesma iluminação que main configura no pipeline fixo: GL_LIGHT0 pontual, cor do material
+// vinda de glColor (ambiente e difusa), dois lados, sem especular (material padrão)
+static const char* VERTEX_INSTANCIAS = R"(#version 120
+attribute mat4 matrizInstancia;
+uniform vec4 dequant;   // posição no VBO compacto: xyz + w * p
+vec4 corLado(vec3 n, vec3 l) {
+    vec4 ambiente = gl_Color * (gl_LightModel.ambient + gl_LightSource[0].ambient);
+    vec4 difusa = gl_Color * gl_LightSource[0].diffuse * max(dot(n, l), 0.0);
+    return vec4((ambiente + difusa).rgb, gl_Color.a);
+}
+void main() {
+    vec4 pObjeto = matrizInstancia * vec4(dequant.xyz + dequant.w * gl_Vertex.xyz, 1.0);
+    vec4 pOlho = gl_ModelViewMatrix * pObjeto;
+    vec3 n = normalize(gl_NormalMatrix * (mat3(matrizInstancia) * gl_Normal));
+    vec4 luz = gl_LightSource[0].position;
+    vec3 l = normalize(luz.xyz - pOlho.xyz * luz.w);
+    gl_FrontColor = corLado(n, l);
+    gl_BackColor = corLado(-n, l);
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+    gl_Position = gl_ProjectionMatrix * pOlho;
+}
+)";
+
+static const char* FRAGMENT_INSTANCIAS = R"(#version 120
+uniform sampler2D textura;
+uniform bool usarTextura;
+void main() {
+    vec4 c = gl_Color;
+    if (usarTextura) c *= texture2D(textura, gl_TexCoord[0].st);
+    gl_FragColor = c;
+}
+)";
+
+static GLuint compilarShader(GLenum tipo, const char* fonte) {
+    const GLuint s = glCreateShader(tipo);
+    glShaderSource(s, 1, &fonte, nullptr);
+    glCompileShader(s);
+    GLint ok = 0;
+    glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024] = "";
+        glGetShaderInfoLog(s, sizeof(log), nullptr, log);
+        cerr << "Falha ao compilar shader do cenario: " << log << "\n";
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+static GLuint criarProgramaInstancias() {
+    const GLuint vs = compilarShader(GL_VERTEX_SHADER, VERTEX_INSTANCIAS);
+    const GLuint fs = vs ? compilarShader(GL_FRAGMENT_SHADER, FRAGMENT_INSTANCIAS) : 0;
+    if (!fs) {
+        if (vs) glDeleteShader(vs);
+        return 0;
+    }
+    const GLuint p = glCreateProgram();
+    glAttachShader(p, vs);
+    glAttachShader(p, fs);
+    glBindAttribLocation(p, ATRIB_MATRIZ_INSTANCIA, "matrizInstancia");
+    glLinkProgram(p);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = 0;
+    glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024] = "";
+        glGetProgramInfoLog(p, sizeof(log), nullptr, log);
+        cerr << "Falha ao ligar shader do cenario: " << log << "\n";
+        glDeleteProgram(p);
+        return 0;
+    }
+    return p;
+}
+
+// glVertexAttribDivisor e glDrawElementsInstanced são do núcleo a partir do GL 3.3
+static bool temInstanciamento() {
+    const char* versao = (const char*)glGetString(GL_VERSION);
+    int maior = 0, menor = 0;
+    if (!versao || sscanf(versao, "%d.%d", &maior, &menor) != 2) return false;
+    return maior > 3 || (maior == 3 && menor >= 3);
+}
+
+// --- Montagem ---
+
+static void transformarPonto(const float m[16], const float p[3], float r[3]) {
+    for (int l = 0; l < 3; ++l) r[l] = m[l] * p[0] + m[4 + l] * p[1] + m[8 + l] * p[2] + m[12 + l];
+}
+
+// Todas as cópias de uma malha num só buffer, com posições e normais já no espaço do cenário
+// (as escalas das instâncias são uniformes, então basta renormalizar a normal)
+static void juntarCopias(const VisaoMalhaIndexada& m, const vector<InstanciaCenario>& matrizes,
+                         const vector<uint32_t>& instancias, MalhaIndexada& out) {
+    const size_t nv = m.numVertices(), ni = m.numIndices();
+    const size_t total = nv * instancias.size();
+    out = MalhaIndexada();
+    out.vertices.resize(total * FLOATS_POR_VERTICE);
+    const bool bits16 = total <= 65536;
+    if (bits16) out.indices16.resize(ni * instancias.size());
+    else out.indices32.resize(ni * instancias.size());
+
+    for (size_t k = 0; k < instancias.size(); ++k) {
+        const float* mat = matrizes[instancias[k]].matriz;
+        for (size_t v = 0; v < nv; ++v) {
+            const float* f = &m.vertices[v * FLOATS_POR_VERTICE];
+            float* d = &out.vertices[(k * nv + v) * FLOATS_POR_VERTICE];
+            transformarPonto(mat, f, d);
+            float n[3], len = 0.0f;
+            for (int l = 0; l < 3; ++l) {
+                n[l] = mat[l] * f[3] + mat[4 + l] * f[4] + mat[8 + l] * f[5];
+                len += n[l] * n[l];
+            }
+            len = len > 0.0f ? 1.0f / sqrt(len) : 0.0f;
+            for (int l = 0; l < 3; ++l) d[3 + l] = n[l] * len;
+            d[6] = f[6];
+            d[7] = f[7];
+        }
+        const uint32_t base = (uint32_t)(k * nv);
+        for (size_t i = 0; i < ni; ++i) {
+            if (bits16) out.indices16[k * ni + i] = (uint16_t)(base + m.indice(i));
+            else out.indices32[k * ni + i] = base + m.indice(i);
+        }
+    }
+}
+
+// Matrizes das instâncias como atributo com divisor 1 no VAO da malha
+static bool enviarMatrizesInstancias(const vector<InstanciaCenario>& matrizes, const vector<uint32_t>& instancias,
+                                     MalhaCenario& mc) {
+    vector<float> dados(instancias.size() * 16);
+    for (size_t k = 0; k < instancias.size(); ++k)
+        memcpy(&dados[k * 16], matrizes[instancias[k]].matriz, 16 * sizeof(float));
+    glGenBuffers(1, &mc.bufferInstancias);
+    glBindVertexArray(mc.vbo.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mc.bufferInstancias);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(dados.size() * sizeof(float)), dados.data(), GL_STATIC_DRAW);
+    for (GLuint c = 0; c < 4; ++c) {
+        const GLuint atrib = ATRIB_MATRIZ_INSTANCIA + c;
+        glEnableVertexAttribArray(atrib);
+        glVertexAttribPointer(atrib, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float),
+                              reinterpret_cast<const void*>(c * 4 * sizeof(float)));
+        glVertexAttribDivisor(atrib, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mc.numInstancias = (GLsizei)instancias.size();
+    return glGetError() == GL_NO_ERROR;
+}
+
+bool carregarCenario(const DescricaoCenario& desc, const OpcoesCarregamento& opcoes, ModoCenario modo,
+                     bool compacto, CenarioGPU& out) {
+    liberarCenario(out);
+    if (modo == ModoCenario::Instancias) {
+        if (temInstanciamento()) out.programa = criarProgramaInstancias();
+        if (out.programa == 0) {
+            cerr << "Instanciamento indisponivel; desenhando o cenario em lotes\n";
+            modo = ModoCenario::Lotes;
+        } else {
+            out.locDequant = glGetUniformLocation(out.programa, "dequant");
+            out.locUsarTextura = glGetUniformLocation(out.programa, "usarTextura");
+        }
+    }
+    out.modo = modo;
+    out.matrizes = desc.instancias;
+    out.numInstancias = desc.instancias.size();
+    out.malhas.resize(desc.caminhosMalhas.size());
+    for (size_t k = 0; k < desc.instancias.size(); ++k)
+        out.malhas[desc.instancias[k].malha].instancias.push_back((uint32_t)k);
+
+    // Só a malha indexada interessa; os níveis de detalhe ficam de fora
+    OpcoesCarregamento op = opcoes;
+    op.gerarLODs = false;
+    op.aoProgresso = nullptr;
+
+    float minimo[3] = { 0, 0, 0 }, maximo[3] = { 0, 0, 0 };
+    bool primeiro = true;
+    // Reaproveitados entre as malhas: cada carga só realoca o que passar da maior anterior
+    MalhaOBJ obj;
+    ArenaCarga arena;
+    for (size_t i = 0; i < out.malhas.size(); ++i) {
+        MalhaCenario& mc = out.malhas[i];
+        if (mc.instancias.empty()) continue;   // declarada e não usada
+        const bool carregou = carregarMalhaOBJ(desc.caminhosMalhas[i], obj, op, &arena);
+        const VisaoMalhaOBJ visao(obj);   // do cache, lida direto das páginas mapeadas
+        const VisaoMalhaIndexada& malha = visao.indexada;
+        if (!carregou || malha.numIndices() == 0) {
+            cerr << "Falha ao carregar a malha '" << desc.nomesMalhas[i] << "' do cenario\n";
+            liberarCenario(out);
+            return false;
+        }
+        out.temUVs = out.temUVs || !visao.uvs.empty();
+        out.triangulos += malha.numIndices() / 3 * mc.instancias.size();
+
+        // Caixa do cenário: cantos da caixa da malha em cada instância
+        float mMin[3], mMax[3];
+        for (int l = 0; l < 3; ++l) mMin[l] = mMax[l] = malha.vertices[l];
+        for (size_t v = 0; v < malha.numVertices(); ++v)
+            for (int l = 0; l < 3; ++l) {
+                mMin[l] = min(mMin[l], malha.vertices[v * FLOATS_POR_VERTICE + l]);
+                mMax[l] = max(mMax[l], malha.vertices[v * FLOATS_POR_VERTICE + l]);
+            }
+        for (uint32_t k : mc.instancias)
+            for (int canto = 0; canto < 8; ++canto) {
+                const float p[3] = { (canto & 1) ? mMax[0] : mMin[0], (canto & 2) ? mMax[1] : mMin[1],
+                                     (canto & 4) ? mMax[2] : mMin[2] };
+                float q[3];
+                transformarPonto(out.matrizes[k].matriz, p, q);
+                for (int l = 0; l < 3; ++l) {
+                    if (primeiro || q[l] < minimo[l]) minimo[l] = q[l];
+                    if (primeiro || q[l] > maximo[l]) maximo[l] = q[l];
+                }
+                primeiro = false;
+            }
+
+        bool ok;
+        if (modo == ModoCenario::Lotes) {
+            MalhaIndexada lote;
+            juntarCopias(malha, out.matrizes, mc.instancias, lote);
+            ok = enviarMalhaVBO(lote, mc.vbo, compacto);
+        } else {
+            ok = enviarMalhaVBO(malha, mc.vbo, compacto);
+            if (ok && modo == ModoCenario::Instancias) ok = enviarMatrizesInstancias(out.matrizes, mc.instancias, mc);
+        }
+        if (!ok) {
+            cerr << "Falha ao enviar a malha '" << desc.nomesMalhas[i] << "' do cenario para a GPU\n";
+            liberarCenario(out);
+            return false;
+        }
+    }
+
+    out.raio = 0.0f;
+    for (int l = 0; l < 3; ++l) {
+        out.centro[l] = 0.5f * (minimo[l] + maximo[l]);
+        out.raio += 0.25f * (maximo[l] - minimo[l]) * (maximo[l] - minimo[l]);
+    }
+    out.raio = out.raio > 0.0f ? sqrt(out.raio) : 1.0f;
+    cout << "Cenario: " << out.numInstancias << " instancias de " << desc.caminhosMalhas.size() << " malhas, "
+         << out.triangulos << " triangulos (modo " << nomeModoCenario(modo) << ")\n";
+    return true;
+}
+
+// --- Desenho ---
+
+int desenharCenario(EstadoGL& e, const CenarioGPU& c) {
+    int chamadas = 0;
+    glPushMatrix();
+    // Enquadra o cenário como um modelo de raio 1 em torno da origem
+    const float s = 1.0f / c.raio;
+    glScalef(s, s, s);
+    glTranslatef(-c.centro[0], -c.centro[1], -c.centro[2]);
+
+    if (c.modo == ModoCenario::Instancias) {
+        glUseProgram(c.programa);
+        glUniform1i(c.locUsarTextura, ligadaGL(e, GL_TEXTURE_2D) ? 1 : 0);
+        glEnable(GL_VERTEX_PROGRAM_TWO_SIDE);
+        for (const MalhaCenario& m : c.malhas) {
+            if (m.numInstancias == 0) continue;
+            const QuantizacaoPosicao& q = m.vbo.quant;
+            if (m.vbo.compacta) glUniform4f(c.locDequant, q.deslocamento[0], q.deslocamento[1], q.deslocamento[2], q.escala);
+            else glUniform4f(c.locDequant, 0.0f, 0.0f, 0.0f, 1.0f);
+            glBindVertexArray(m.vbo.vao);
+            glDrawElementsInstanced(GL_TRIANGLES, m.vbo.numIndices, m.vbo.tipoIndice, nullptr, m.numInstancias);
+            ++chamadas;
+        }
+        glBindVertexArray(0);
+        glDisable(GL_VERTEX_PROGRAM_TWO_SIDE);
+        glUseProgram(0);
+    } else if (c.modo == ModoCenario::Lotes) {
+        for (const MalhaCenario& m : c.malhas) {
+            if (m.vbo.vao == 0) continue;
+            desenharMalhaVBO(m.vbo);
+            ++chamadas;
+        }
+    } else {
+        for (const MalhaCenario& m : c.malhas)
+            for (uint32_t k : m.instancias) {
+                glPushMatrix();
+                glMultMatrixf(c.matrizes[k].matriz);
+                desenharMalhaVBO(m.vbo);
+                glPopMatrix();
+                ++chamadas;
+            }
+    }
+    glPopMatrix();
+    return chamadas;
+}
+
+void liberarCenario(CenarioGPU& c) {
+    for (MalhaCenario& m : c.malhas) {
+        liberarMalhaVBO(m.vbo);
+        if (m.bufferInstancias) glDeleteBuffers(1, &m.bufferInstancias);
+    }
+    if (c.programa) glDeleteProgram(c.programa);
+    c = CenarioGPU();
+}
@@ -0,0 +1,76 @@
+// Cenário com várias cópias de poucos modelos (ex.: peças espalhadas num chão de fábrica).
+// O arquivo .cena lista as malhas e as instâncias, uma por linha:
+//   malha <nome> <arquivo.obj>                      (caminho relativo ao .cena)
+//   instancia <nome> tx ty tz [rx ry rz [escala]]    (graus; mesma ordem de main: T·Rx·Ry·Rz·S)
+// Linhas vazias e iniciadas por '#' são ignoradas. Cada malha é carregada e enviada à GPU uma
+// única vez; as instâncias de uma malha saem num só glDrawElementsInstanced (matriz por
+// instância num atributo com divisor 1), ou, sem shaders, num VBO com todas as cópias já
+// transformadas. Assim o número de chamadas de desenho acompanha o número de malhas, não o
+// de instâncias.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "estado_gl.h"
+#include "malha_vbo.h"
+#include "obj_loader.h"
+
+using namespace std;
+
+struct InstanciaCenario {
+    uint32_t malha;          // índice em DescricaoCenario::caminhosMalhas
+    float matriz[16];        // objeto -> cenário, em colunas (como glMultMatrixf)
+};
+
+struct DescricaoCenario {
+    vector<string> nomesMalhas;
+    vector<string> caminhosMalhas;
+    vector<InstanciaCenario> instancias;
+};
+
+// Lê o arquivo .cena; erros de sintaxe são informados com o número da linha
+bool lerCenario(const string& caminho, DescricaoCenario& out);
+
+// Como as instâncias são desenhadas
+enum class ModoCenario {
+    Instancias,   // glDrawElementsInstanced por malha (GLSL 1.20 imitando a luz do pipeline fixo)
+    Lotes,        // pipeline fixo: um VBO por malha com as cópias já transformadas
+    Copias        // pipeline fixo: um glDrawElements por instância (referência para comparação)
+};
+
+struct MalhaCenario {
+    MalhaVBO vbo;
+    GLuint bufferInstancias = 0;  // matrizes (modo Instancias)
+    GLsizei numInstancias = 0;
+    vector<uint32_t> instancias;  // índices em matrizes (modo Copias)
+};
+
+struct CenarioGPU {
+    ModoCenario modo = ModoCenario::Instancias;
+    vector<MalhaCenario> malhas;
+    vector<InstanciaCenario> matrizes;
+    GLuint programa = 0;
+    GLint locDequant = -1, locUsarTextura = -1;
+    // Esfera que envolve o cenário: o desenho o enquadra no lugar de um modelo de tamanho ~1
+    float centro[3] = { 0.0f, 0.0f, 0.0f };
+    float raio = 1.0f;
+    size_t triangulos = 0;        // soma de todas as instâncias
+    size_t numInstancias = 0;
+    bool temUVs = false;
+};
+
+// Carrega as malhas do cenário e cria os buffers. Precisa de contexto GL corrente. Se o modo
+// Instancias não estiver disponível (GL < 3.3 ou shader recusado), cai para Lotes.
+bool carregarCenario(const DescricaoCenario& desc, const OpcoesCarregamento& opcoes, ModoCenario modo,
+                     bool compacto, CenarioGPU& out);
+
+// Desenha o cenário todo com o estado de material já posto por quem chama (preenchimento, sem
+// culling, cor); a textura ligada vem do cache de e. Devolve o número de chamadas de desenho.
+int desenharCenario(EstadoGL& e, const CenarioGPU& c);
+
+void liberarCenario(CenarioGPU& c);
+
+const char* nomeModoCenario(ModoCenario modo);
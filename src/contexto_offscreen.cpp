@@ -0,0 +1,69 @@
+#include "contexto_offscreen.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <iostream>
+
+using namespace std;
+
+bool criarContextoOffscreen(int largura, int altura, ContextoOffscreen& out) {
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    auto obterDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (obterDisplay) dpy = obterDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint maior = 0, menor = 0;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &maior, &menor)) {
+        cerr << "EGL indisponivel para renderizacao offscreen\n";
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        cerr << "EGL sem suporte a OpenGL desktop\n";
+        eglTerminate(dpy);
+        return false;
+    }
+    // Sem atributos: o Mesa entrega o perfil de compatibilidade (pipeline fixo disponível)
+    EGLContext ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, nullptr);
+    if (ctx == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        cerr << "Falha ao criar contexto EGL sem superficie\n";
+        eglTerminate(dpy);
+        return false;
+    }
+
+    out.display = dpy;
+    out.contexto = ctx;
+    out.largura = largura;
+    out.altura = altura;
+
+    glGenFramebuffers(1, &out.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, out.fbo);
+    glGenRenderbuffers(1, &out.rbCor);
+    glBindRenderbuffer(GL_RENDERBUFFER, out.rbCor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, largura, altura);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, out.rbCor);
+    glGenRenderbuffers(1, &out.rbProfundidade);
+    glBindRenderbuffer(GL_RENDERBUFFER, out.rbProfundidade);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, largura, altura);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, out.rbProfundidade);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        cerr << "Framebuffer offscreen incompleto\n";
+        destruirContextoOffscreen(out);
+        return false;
+    }
+    glViewport(0, 0, largura, altura);
+
+    cout << "Contexto offscreen: " << glGetString(GL_RENDERER) << " | " << glGetString(GL_VERSION) << "\n";
+    return true;
+}
+
+void destruirContextoOffscreen(ContextoOffscreen& ctx) {
+    if (ctx.contexto) {
+        if (ctx.fbo) glDeleteFramebuffers(1, &ctx.fbo);
+        if (ctx.rbCor) glDeleteRenderbuffers(1, &ctx.rbCor);
+        if (ctx.rbProfundidade) glDeleteRenderbuffers(1, &ctx.rbProfundidade);
+        eglMakeCurrent((EGLDisplay)ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)ctx.display, (EGLContext)ctx.contexto);
+    }
+    if (ctx.display) eglTerminate((EGLDisplay)ctx.display);
+    ctx = ContextoOffscreen();
+}
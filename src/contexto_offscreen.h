@@ -0,0 +1,22 @@
+// Contexto OpenGL sem janela para o modo de benchmark.
+// Usa EGL na plataforma "surfaceless" do Mesa (funciona no llvmpipe, sem X nem GPU)
+// e desenha num framebuffer object de tamanho fixo (cor RGBA8 + profundidade 24 bits).
+
+#pragma once
+
+#include <GL/freeglut.h>
+
+struct ContextoOffscreen {
+    void* display = nullptr;   // EGLDisplay
+    void* contexto = nullptr;  // EGLContext
+    GLuint fbo = 0;
+    GLuint rbCor = 0;
+    GLuint rbProfundidade = 0;
+    int largura = 0;
+    int altura = 0;
+};
+
+// Cria o contexto, torna-o corrente e deixa o FBO ligado com o viewport ajustado
+bool criarContextoOffscreen(int largura, int altura, ContextoOffscreen& out);
+
+void destruirContextoOffscreen(ContextoOffscreen& ctx);
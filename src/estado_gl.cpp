@@ -0,0 +1,221 @@
+#include "estado_gl.h"
+
+#include <algorithm>
+
+// Grupos do glPushAttrib que guardam cada capacidade de CAPACIDADES_GL
+static const GLbitfield GRUPOS_CAPACIDADE_GL[NUM_CAPACIDADES_GL] = {
+    GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT,   // GL_DEPTH_TEST
+    GL_ENABLE_BIT | GL_LIGHTING_BIT,       // GL_LIGHTING
+    GL_ENABLE_BIT | GL_TEXTURE_BIT,        // GL_TEXTURE_2D
+    GL_ENABLE_BIT | GL_POLYGON_BIT,        // GL_CULL_FACE
+    GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT,   // GL_BLEND
+};
+
+static int indiceCapacidade(GLenum capacidade) {
+    for (int i = 0; i < NUM_CAPACIDADES_GL; ++i)
+        if (CAPACIDADES_GL[i] == capacidade) return i;
+    return -1;
+}
+
+void invalidarEstadoGL(EstadoGL& e) {
+    e.v = ValoresEstadoGL();
+}
+
+void invalidarCorGL(EstadoGL& e) {
+    e.v.corConhecida = false;
+}
+
+void zerarContagemGL(EstadoGL& e) {
+    e.trocas = 0;
+    e.evitadas = 0;
+}
+
+void habilitarGL(EstadoGL& e, GLenum capacidade, bool ligar) {
+    const int i = indiceCapacidade(capacidade);
+    if (i >= 0 && e.v.ligada[i] == (ligar ? 1 : 0)) {
+        ++e.evitadas;
+        return;
+    }
+    if (ligar) glEnable(capacidade);
+    else glDisable(capacidade);
+    if (i >= 0) e.v.ligada[i] = ligar ? 1 : 0;
+    ++e.trocas;
+}
+
+bool ligadaGL(EstadoGL& e, GLenum capacidade) {
+    const int i = indiceCapacidade(capacidade);
+    if (i >= 0 && e.v.ligada[i] >= 0) {
+        ++e.evitadas;
+        return e.v.ligada[i] == 1;
+    }
+    const bool ligada = glIsEnabled(capacidade) == GL_TRUE;
+    if (i >= 0) e.v.ligada[i] = ligada ? 1 : 0;
+    ++e.trocas;
+    return ligada;
+}
+
+void modoMatrizGL(EstadoGL& e, GLenum modo) {
+    if (e.v.modoMatriz == modo) {
+        ++e.evitadas;
+        return;
+    }
+    glMatrixMode(modo);
+    e.v.modoMatriz = modo;
+    ++e.trocas;
+}
+
+void carregarMatrizGL(EstadoGL& e, GLenum modo, const float m[16]) {
+    modoMatrizGL(e, modo);
+    glLoadMatrixf(m);
+    ++e.trocas;
+}
+
+void empilharMatrizGL(EstadoGL& e, GLenum modo, const float m[16]) {
+    modoMatrizGL(e, modo);
+    glPushMatrix();
+    glLoadMatrixf(m);
+    e.trocas += 2;
+}
+
+void desempilharMatrizGL(EstadoGL& e, GLenum modo) {
+    modoMatrizGL(e, modo);
+    glPopMatrix();
+    ++e.trocas;
+}
+
+void viewportGL(EstadoGL& e, GLint x, GLint y, GLsizei largura, GLsizei altura) {
+    GLint* vp = e.v.viewport;
+    if (vp[0] == x && vp[1] == y && vp[2] == largura && vp[3] == altura) {
+        ++e.evitadas;
+        return;
+    }
+    glViewport(x, y, largura, altura);
+    vp[0] = x; vp[1] = y; vp[2] = largura; vp[3] = altura;
+    ++e.trocas;
+}
+
+void baseListasGL(EstadoGL& e, GLuint base) {
+    if (e.v.baseListasConhecida && e.v.baseListas == base) {
+        ++e.evitadas;
+        return;
+    }
+    glListBase(base);
+    e.v.baseListas = base;
+    e.v.baseListasConhecida = true;
+    ++e.trocas;
+}
+
+void texturaGL(EstadoGL& e, GLuint textura) {
+    if (e.v.texturaConhecida && e.v.textura == textura) {
+        ++e.evitadas;
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, textura);
+    e.v.textura = textura;
+    e.v.texturaConhecida = true;
+    ++e.trocas;
+}
+
+void modoPoligonoGL(EstadoGL& e, GLenum modo) {
+    if (e.v.modoPoligono == modo) {
+        ++e.evitadas;
+        return;
+    }
+    glPolygonMode(GL_FRONT_AND_BACK, modo);
+    e.v.modoPoligono = modo;
+    ++e.trocas;
+}
+
+void corGL(EstadoGL& e, float r, float g, float b, float a) {
+    float* c = e.v.cor;
+    if (e.v.corConhecida && c[0] == r && c[1] == g && c[2] == b && c[3] == a) {
+        ++e.evitadas;
+        return;
+    }
+    glColor4f(r, g, b, a);
+    c[0] = r; c[1] = g; c[2] = b; c[3] = a;
+    e.v.corConhecida = true;
+    ++e.trocas;
+}
+
+void empilharAtributosGL(EstadoGL& e, GLbitfield mascara) {
+    glPushAttrib(mascara);
+    ++e.trocas;
+    if (e.profundidade < PROFUNDIDADE_ATRIBUTOS_GL) {
+        e.pilha[e.profundidade] = e.v;
+        e.mascaras[e.profundidade] = mascara;
+    }
+    ++e.profundidade;
+}
+
+void desempilharAtributosGL(EstadoGL& e) {
+    glPopAttrib();
+    ++e.trocas;
+    // Pop sem push correspondente, ou além da pilha guardada: não dá para saber o que voltou
+    if (e.profundidade == 0 || e.profundidade > PROFUNDIDADE_ATRIBUTOS_GL) {
+        if (e.profundidade > 0) --e.profundidade;
+        invalidarEstadoGL(e);
+        return;
+    }
+    --e.profundidade;
+    const ValoresEstadoGL& antes = e.pilha[e.profundidade];
+    const GLbitfield mascara = e.mascaras[e.profundidade];
+    for (int i = 0; i < NUM_CAPACIDADES_GL; ++i)
+        if (mascara & GRUPOS_CAPACIDADE_GL[i]) e.v.ligada[i] = antes.ligada[i];
+    if (mascara & GL_TRANSFORM_BIT) e.v.modoMatriz = antes.modoMatriz;
+    if (mascara & GL_VIEWPORT_BIT) copy(antes.viewport, antes.viewport + 4, e.v.viewport);
+    if (mascara & GL_LIST_BIT) {
+        e.v.baseListas = antes.baseListas;
+        e.v.baseListasConhecida = antes.baseListasConhecida;
+    }
+    if (mascara & GL_TEXTURE_BIT) {
+        e.v.textura = antes.textura;
+        e.v.texturaConhecida = antes.texturaConhecida;
+    }
+    if (mascara & GL_POLYGON_BIT) e.v.modoPoligono = antes.modoPoligono;
+    if (mascara & GL_CURRENT_BIT) {
+        copy(antes.cor, antes.cor + 4, e.v.cor);
+        e.v.corConhecida = antes.corConhecida;
+    }
+}
+
+// Uma lista por byte: uma linha inteira vira um glCallLists
+static void criarGlifos(EstadoGL& e) {
+    if (e.listasGlifos != 0) return;
+    e.listasGlifos = glGenLists(256);
+    for (int c = 0; c < 256; ++c) {
+        glNewList(e.listasGlifos + (GLuint)c, GL_COMPILE);
+        glutBitmapCharacter(GLUT_BITMAP_9_BY_15, c);
+        glEndList();
+    }
+}
+
+// Volta ao começo da linha e desce uma linha (glBitmap vazio só move a posição)
+static void proximaLinha(const string& s) {
+    const int largura = glutBitmapLength(GLUT_BITMAP_9_BY_15, reinterpret_cast<const unsigned char*>(s.c_str()));
+    glBitmap(0, 0, 0.0f, 0.0f, (float)-largura, (float)-ALTURA_LINHA_TEXTO, nullptr);
+}
+
+void posicaoTextoGL(EstadoGL&, int x, int y) {
+    glWindowPos2i(x, y);
+}
+
+void linhaTextoGL(EstadoGL& e, const string& s) {
+    criarGlifos(e);
+    baseListasGL(e, e.listasGlifos);
+    glCallLists((GLsizei)s.size(), GL_UNSIGNED_BYTE, s.data());
+    proximaLinha(s);
+}
+
+GLuint compilarTextoGL(EstadoGL& e, const vector<string>& linhas) {
+    criarGlifos(e);
+    const GLuint lista = glGenLists(1);
+    glNewList(lista, GL_COMPILE);
+    // Os glifos por número: a lista não depende da base corrente quando for chamada
+    for (const string& s : linhas) {
+        for (unsigned char c : s) glCallList(e.listasGlifos + c);
+        proximaLinha(s);
+    }
+    glEndList();
+    return lista;
+}
@@ -0,0 +1,92 @@
+// Estado GL de cada quadro com cache: as funções abaixo só chamam o GL quando o valor muda
+// (capacidades, modo de matriz, viewport, base das listas, textura 2D vinculada, modo de
+// polígono e cor corrente) e contam as trocas feitas e as evitadas. Cargas de matriz e
+// push/pop de atributos vão sempre ao GL e também contam como trocas. As contagens cobrem só o
+// estado que passa por aqui; o resto (glBlendFunc, glMaterial, glUseProgram...) vai direto ao
+// GL e não entra nelas. O cache vale enquanto esse estado só mudar por aqui;
+// glPushAttrib/glPopAttrib passam por empilharAtributosGL/desempilharAtributosGL, que devolvem
+// ao cache o que o pop restaura. Depois de mexer nesse estado por fora (criar ou apagar
+// texturas, chamar uma display list que troca a cor, por exemplo), chamar invalidarEstadoGL()
+// ou invalidarCorGL().
+// O texto em bitmap usa uma display list por caractere, e texto fixo pode ir inteiro para uma
+// lista só (compilarTextoGL).
+
+#pragma once
+
+#include <GL/freeglut.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Capacidades acompanhadas; as outras passam direto para glEnable/glDisable
+static const GLenum CAPACIDADES_GL[] = { GL_DEPTH_TEST, GL_LIGHTING, GL_TEXTURE_2D, GL_CULL_FACE, GL_BLEND };
+static const int NUM_CAPACIDADES_GL = sizeof(CAPACIDADES_GL) / sizeof(CAPACIDADES_GL[0]);
+
+// Texto: GLUT_BITMAP_9_BY_15, linhas a cada 18 pixels
+static const int ALTURA_LINHA_TEXTO = 18;
+
+// Profundidade mínima da pilha de atributos garantida pelo GL
+static const int PROFUNDIDADE_ATRIBUTOS_GL = 16;
+
+// Valores acompanhados pelo cache
+struct ValoresEstadoGL {
+    signed char ligada[NUM_CAPACIDADES_GL];   // -1 = desconhecido
+    GLenum modoMatriz = 0;                    // 0 = desconhecido
+    GLint viewport[4] = { 0, 0, -1, -1 };     // largura -1 = desconhecido
+    GLuint baseListas = 0;
+    bool baseListasConhecida = false;
+    GLuint textura = 0;                       // vinculada em GL_TEXTURE_2D
+    bool texturaConhecida = false;
+    GLenum modoPoligono = 0;                  // GL_FRONT_AND_BACK; 0 = desconhecido
+    float cor[4] = { 0, 0, 0, 0 };
+    bool corConhecida = false;
+
+    ValoresEstadoGL() { for (signed char& l : ligada) l = -1; }
+};
+
+struct EstadoGL {
+    ValoresEstadoGL v;
+    GLuint listasGlifos = 0;                  // 256 listas, uma por byte (criadas no primeiro texto)
+
+    // Cópia do cache em cada glPushAttrib, com a máscara empilhada
+    ValoresEstadoGL pilha[PROFUNDIDADE_ATRIBUTOS_GL];
+    GLbitfield mascaras[PROFUNDIDADE_ATRIBUTOS_GL];
+    int profundidade = 0;
+
+    size_t trocas = 0;     // chamadas de estado (deste cache) mandadas ao GL desde zerarContagemGL
+    size_t evitadas = 0;   // pedidas sem mudar nada, ou respondidas pelo cache
+};
+
+void invalidarEstadoGL(EstadoGL& e);
+// Só a cor corrente (depois de uma display list ou de um glBegin/glEnd com glColor por fora)
+void invalidarCorGL(EstadoGL& e);
+void zerarContagemGL(EstadoGL& e);
+
+void habilitarGL(EstadoGL& e, GLenum capacidade, bool ligar);
+// Se a capacidade está ligada, pelo cache; sem valor conhecido, pergunta ao GL e guarda
+bool ligadaGL(EstadoGL& e, GLenum capacidade);
+void modoMatrizGL(EstadoGL& e, GLenum modo);
+void carregarMatrizGL(EstadoGL& e, GLenum modo, const float m[16]);
+// glPushMatrix seguido de glLoadMatrixf na pilha "modo"; desempilharMatrizGL desfaz
+void empilharMatrizGL(EstadoGL& e, GLenum modo, const float m[16]);
+void desempilharMatrizGL(EstadoGL& e, GLenum modo);
+void viewportGL(EstadoGL& e, GLint x, GLint y, GLsizei largura, GLsizei altura);
+void baseListasGL(EstadoGL& e, GLuint base);
+void texturaGL(EstadoGL& e, GLuint textura);
+// glPolygonMode(GL_FRONT_AND_BACK, modo)
+void modoPoligonoGL(EstadoGL& e, GLenum modo);
+// glColor4f; pode ser chamada entre glBegin e glEnd
+void corGL(EstadoGL& e, float r, float g, float b, float a = 1.0f);
+// glPushAttrib/glPopAttrib: no pop, o cache volta aos valores empilhados nos grupos que a
+// máscara cobre. Entre os dois, esses grupos podem mudar por estas funções ou direto no GL.
+void empilharAtributosGL(EstadoGL& e, GLbitfield mascara);
+void desempilharAtributosGL(EstadoGL& e);
+
+// Texto em bitmap a partir de (x, y) em pixels da janela, com a cor corrente nesse momento.
+// Cada linhaTextoGL escreve uma linha e leva a posição para o começo da linha de baixo.
+void posicaoTextoGL(EstadoGL& e, int x, int y);
+void linhaTextoGL(EstadoGL& e, const string& s);
+// Display list com as linhas (como linhaTextoGL de cada uma), para texto que não muda
+GLuint compilarTextoGL(EstadoGL& e, const vector<string>& linhas);
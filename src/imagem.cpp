@@ -0,0 +1,238 @@
+#include "imagem.h"
+#include "paralelo.h"
+
+#include <csetjmp>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+#ifdef COM_PNG
+#include <png.h>
+#endif
+#ifdef COM_JPEG
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+using namespace std;
+
+#ifdef COM_PNG
+static bool decodificarPNG(const uint8_t* dados, size_t n, ImagemRGBA& out, string& erro) {
+    png_image img;
+    memset(&img, 0, sizeof(img));
+    img.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&img, dados, n)) {
+        erro = img.message;
+        return false;
+    }
+    img.format = PNG_FORMAT_RGBA;
+    out.largura = (int)img.width;
+    out.altura = (int)img.height;
+    out.niveis.assign(1, vector<uint8_t>(PNG_IMAGE_SIZE(img)));
+    if (!png_image_finish_read(&img, nullptr, out.niveis[0].data(), 0, nullptr)) {
+        erro = img.message;
+        png_image_free(&img);
+        return false;
+    }
+    return true;
+}
+#endif
+
+#ifdef COM_JPEG
+// A libjpeg aborta o processo no erro padrão: volta para decodificarJPEG com longjmp
+struct ErroJPEG {
+    jpeg_error_mgr padrao;
+    jmp_buf retorno;
+    char mensagem[JMSG_LENGTH_MAX];
+};
+
+static void sairErroJPEG(j_common_ptr info) {
+    ErroJPEG* e = reinterpret_cast<ErroJPEG*>(info->err);
+    (*info->err->format_message)(info, e->mensagem);
+    longjmp(e->retorno, 1);
+}
+
+static bool decodificarJPEG(const uint8_t* dados, size_t n, ImagemRGBA& out, string& erro) {
+    jpeg_decompress_struct info;
+    ErroJPEG e;
+    info.err = jpeg_std_error(&e.padrao);
+    e.padrao.error_exit = sairErroJPEG;
+    vector<uint8_t> linha;
+    if (setjmp(e.retorno)) {
+        erro = e.mensagem;
+        jpeg_destroy_decompress(&info);
+        return false;
+    }
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, const_cast<uint8_t*>(dados), (unsigned long)n);
+    jpeg_read_header(&info, TRUE);
+    info.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&info);
+    out.largura = (int)info.output_width;
+    out.altura = (int)info.output_height;
+    out.niveis.assign(1, vector<uint8_t>((size_t)out.largura * out.altura * 4u));
+    linha.resize((size_t)out.largura * 3u);
+    while (info.output_scanline < info.output_height) {
+        uint8_t* dst = out.niveis[0].data() + (size_t)info.output_scanline * out.largura * 4u;
+        JSAMPROW p = linha.data();
+        jpeg_read_scanlines(&info, &p, 1);
+        for (int x = 0; x < out.largura; ++x) {
+            dst[x * 4 + 0] = linha[x * 3 + 0];
+            dst[x * 4 + 1] = linha[x * 3 + 1];
+            dst[x * 4 + 2] = linha[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+    return true;
+}
+#endif
+
+bool decodificarImagem(const uint8_t* dados, size_t n, ImagemRGBA& out, string& erro) {
+    out = ImagemRGBA();
+    static const uint8_t assinaturaPNG[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if (n >= 8 && memcmp(dados, assinaturaPNG, 8) == 0) {
+#ifdef COM_PNG
+        return decodificarPNG(dados, n, out, erro);
+#else
+        erro = "PNG sem suporte neste build (libpng nao encontrada)";
+        return false;
+#endif
+    }
+    if (n >= 3 && dados[0] == 0xff && dados[1] == 0xd8 && dados[2] == 0xff) {
+#ifdef COM_JPEG
+        return decodificarJPEG(dados, n, out, erro);
+#else
+        erro = "JPEG sem suporte neste build (libjpeg nao encontrada)";
+        return false;
+#endif
+    }
+    erro = "formato de imagem nao suportado";
+    return false;
+}
+
+void gerarMipmaps(ImagemRGBA& img) {
+    if (img.niveis.empty()) return;
+    img.niveis.resize(1);
+    int w = img.largura, h = img.altura;
+    while (w > 1 || h > 1) {
+        const int nw = max(1, w / 2), nh = max(1, h / 2);
+        const vector<uint8_t>& src = img.niveis.back();
+        vector<uint8_t> dst((size_t)nw * nh * 4u);
+        // Em lado ímpar a última coluna/linha é absorvida pelo último texel (x1/y1 limitados)
+        for (int y = 0; y < nh; ++y) {
+            const int y0 = min(2 * y, h - 1), y1 = min(2 * y + 1, h - 1);
+            for (int x = 0; x < nw; ++x) {
+                const int x0 = min(2 * x, w - 1), x1 = min(2 * x + 1, w - 1);
+                const uint8_t* a = &src[((size_t)y0 * w + x0) * 4u];
+                const uint8_t* b = &src[((size_t)y0 * w + x1) * 4u];
+                const uint8_t* c = &src[((size_t)y1 * w + x0) * 4u];
+                const uint8_t* d = &src[((size_t)y1 * w + x1) * 4u];
+                uint8_t* o = &dst[((size_t)y * nw + x) * 4u];
+                for (int k = 0; k < 4; ++k) o[k] = (uint8_t)((a[k] + b[k] + c[k] + d[k] + 2) / 4);
+            }
+        }
+        img.niveis.push_back(move(dst));
+        w = nw;
+        h = nh;
+    }
+}
+
+uint64_t hashConteudo(const void* dados, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(dados);
+    uint64_t h = 0xcbf29ce484222325ull ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w; memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    for (; i < n; ++i) h = (h ^ p[i]) * 0x100000001b3ull;
+    return h ^ (h >> 32);
+}
+
+static bool lerArquivo(const string& caminho, vector<uint8_t>& out) {
+    ifstream f(caminho, ios::binary | ios::ate);
+    if (!f) return false;
+    out.resize((size_t)f.tellg());
+    f.seekg(0);
+    return (bool)f.read(reinterpret_cast<char*>(out.data()), (streamsize)out.size());
+}
+
+void carregarImagens(const vector<string>& caminhos, const function<bool(uint64_t)>& jaCarregada,
+                     vector<ImagemCarregada>& out, int numThreads) {
+    out.clear();
+    out.resize(caminhos.size());
+    vector<vector<uint8_t>> arquivos(caminhos.size());
+    paraCadaItem(caminhos.size(), numThreads, [&](size_t i) {
+        out[i].caminho = caminhos[i];
+        out[i].lida = lerArquivo(caminhos[i], arquivos[i]);
+        if (out[i].lida) out[i].hash = hashConteudo(arquivos[i].data(), arquivos[i].size());
+    });
+
+    // Só a primeira ocorrência de cada conteúdo ainda não carregado é decodificada
+    vector<size_t> decodificar;
+    unordered_set<uint64_t> vistos;
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (!out[i].lida) {
+            cerr << "Falha ao abrir textura: " << caminhos[i] << "\n";
+            continue;
+        }
+        if (!jaCarregada(out[i].hash) && vistos.insert(out[i].hash).second) decodificar.push_back(i);
+        else arquivos[i] = vector<uint8_t>();
+    }
+
+    vector<string> erros(caminhos.size());
+    paraCadaItem(decodificar.size(), numThreads, [&](size_t k) {
+        const size_t i = decodificar[k];
+        ImagemCarregada& c = out[i];
+        c.decodificada = decodificarImagem(arquivos[i].data(), arquivos[i].size(), c.imagem, erros[i]);
+        if (c.decodificada) gerarMipmaps(c.imagem);
+        arquivos[i] = vector<uint8_t>();
+    });
+    for (size_t i : decodificar)
+        if (!out[i].decodificada) cerr << "Falha ao decodificar " << caminhos[i] << ": " << erros[i] << "\n";
+}
+
+bool gravarImagemRGBA(const string& caminho, int largura, int altura, const uint8_t* rgba) {
+    const size_t linha = (size_t)largura * 4;
+#ifdef COM_PNG
+    if (caminho.size() >= 4 && caminho.compare(caminho.size() - 4, 4, ".png") == 0) {
+        png_image img;
+        memset(&img, 0, sizeof(img));
+        img.version = PNG_IMAGE_VERSION;
+        img.width = (png_uint_32)largura;
+        img.height = (png_uint_32)altura;
+        img.format = PNG_FORMAT_RGBA;
+        // Passo negativo: a primeira linha do arquivo é a última do buffer
+        if (!png_image_write_to_file(&img, caminho.c_str(), 0, rgba, -(png_int_32)linha, nullptr)) {
+            cerr << "Falha ao gravar " << caminho << ": " << img.message << "\n";
+            return false;
+        }
+        return true;
+    }
+#endif
+    ofstream f(caminho, ios::binary);
+    if (!f) {
+        cerr << "Falha ao gravar " << caminho << "\n";
+        return false;
+    }
+    f << "P6\n" << largura << " " << altura << "\n255\n";
+    vector<uint8_t> rgb((size_t)largura * 3);
+    for (int y = altura - 1; y >= 0; --y) {
+        const uint8_t* p = rgba + (size_t)y * linha;
+        for (int x = 0; x < largura; ++x) memcpy(&rgb[(size_t)x * 3], p + (size_t)x * 4, 3);
+        f.write(reinterpret_cast<const char*>(rgb.data()), (streamsize)rgb.size());
+    }
+    return (bool)f;
+}
+
+bool gravacaoPNGDisponivel() {
+#ifdef COM_PNG
+    return true;
+#else
+    return false;
+#endif
+}
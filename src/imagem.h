@@ -0,0 +1,55 @@
+// Decodificação de imagens (PNG e JPEG) e geração de mipmaps na CPU, sem OpenGL: o envio
+// à GPU fica em texturas.h. A leitura e a decodificação de várias imagens rodam em paralelo.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// RGBA 8 bits; niveis[0] é a imagem original e cada nível seguinte tem metade do lado
+// (arredondado para baixo, mínimo 1), até 1x1
+struct ImagemRGBA {
+    int largura = 0;
+    int altura = 0;
+    vector<vector<uint8_t>> niveis;
+
+    int larguraNivel(size_t n) const { return max(1, largura >> (int)n); }
+    int alturaNivel(size_t n) const { return max(1, altura >> (int)n); }
+};
+
+// Formato reconhecido pela assinatura do conteúdo (não pela extensão). Falha para formatos
+// não suportados ou sem a biblioteca correspondente no build (COM_PNG / COM_JPEG).
+bool decodificarImagem(const uint8_t* dados, size_t n, ImagemRGBA& out, string& erro);
+
+// Gera os níveis 1..k a partir de niveis[0] com filtro de caixa 2x2 (lados ímpares também)
+void gerarMipmaps(ImagemRGBA& img);
+
+// Hash de 64 bits do conteúdo do arquivo: identifica mapas iguais com nomes diferentes
+uint64_t hashConteudo(const void* dados, size_t n);
+
+struct ImagemCarregada {
+    string caminho;
+    bool lida = false;          // arquivo aberto e lido
+    uint64_t hash = 0;
+    bool decodificada = false;  // imagem preenchida (só na primeira ocorrência de cada hash nova)
+    ImagemRGBA imagem;
+};
+
+// Lê os arquivos e calcula os hashes em paralelo; depois decodifica (com mipmaps), também
+// em paralelo, uma vez por conteúdo distinto para o qual jaCarregada(hash) é falso.
+// out[i] corresponde a caminhos[i].
+void carregarImagens(const vector<string>& caminhos, const function<bool(uint64_t)>& jaCarregada,
+                     vector<ImagemCarregada>& out, int numThreads = 0);
+
+// Grava largura x altura pixels RGBA com a linha 0 embaixo (como glReadPixels): PNG quando o
+// caminho termina em ".png" e o build tem COM_PNG, senão PPM binário (sem alfa)
+bool gravarImagemRGBA(const string& caminho, int largura, int altura, const uint8_t* rgba);
+
+// Se o build tem libpng (gravarImagemRGBA grava PNG)
+bool gravacaoPNGDisponivel();
@@ -0,0 +1,61 @@
+// Combinação de atributos dos cantos de uma malha (P, PN, PT, PNT e as variantes em que só
+// parte dos cantos tem vn/vt), decidida uma vez por malha. Os laços que emitem ou empacotam
+// cantos são templates nessa combinação: comLayout() escolhe a instância e, dentro dela, não
+// há teste por canto para atributo ausente.
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "obj_loader.h"
+
+// De onde vem a normal de cada canto
+enum class FonteNormal { Calculada, OBJ, Mista };   // Mista: vn do arquivo quando o canto tem, senão a calculada
+// UV de cada canto
+enum class FonteUV { Nenhuma, OBJ, Mista };         // Mista: só parte dos cantos tem vt
+
+struct LayoutCantos {
+    FonteNormal normal = FonteNormal::Calculada;
+    FonteUV uv = FonteUV::Nenhuma;
+    bool posicoesValidas = true;   // nenhum canto com v < 0
+};
+
+inline LayoutCantos analisarCantos(const CantoTri* cantos, size_t n, size_t nNormaisOBJ, size_t nUVs) {
+    size_t comVN = 0, comVT = 0;
+    bool posicoesValidas = true;
+    for (size_t i = 0; i < n; ++i) {
+        comVN += cantos[i].vn >= 0;
+        comVT += cantos[i].vt >= 0;
+        posicoesValidas = posicoesValidas && cantos[i].v >= 0;
+    }
+    if (nNormaisOBJ == 0) comVN = 0;
+    if (nUVs == 0) comVT = 0;
+    LayoutCantos l;
+    l.normal = comVN == 0 ? FonteNormal::Calculada : comVN == n ? FonteNormal::OBJ : FonteNormal::Mista;
+    l.uv = comVT == 0 ? FonteUV::Nenhuma : comVT == n ? FonteUV::OBJ : FonteUV::Mista;
+    l.posicoesValidas = posicoesValidas;
+    return l;
+}
+
+template <FonteNormal N>
+using NormalFixa = std::integral_constant<FonteNormal, N>;
+template <FonteUV T>
+using UVFixa = std::integral_constant<FonteUV, T>;
+
+// Chama f(NormalFixa<N>(), UVFixa<T>()) com as constantes do layout
+template <class F>
+void comLayout(const LayoutCantos& l, F&& f) {
+    auto comUV = [&](auto normal) {
+        switch (l.uv) {
+            case FonteUV::Nenhuma: f(normal, UVFixa<FonteUV::Nenhuma>()); break;
+            case FonteUV::OBJ: f(normal, UVFixa<FonteUV::OBJ>()); break;
+            case FonteUV::Mista: f(normal, UVFixa<FonteUV::Mista>()); break;
+        }
+    };
+    switch (l.normal) {
+        case FonteNormal::Calculada: comUV(NormalFixa<FonteNormal::Calculada>()); break;
+        case FonteNormal::OBJ: comUV(NormalFixa<FonteNormal::OBJ>()); break;
+        case FonteNormal::Mista: comUV(NormalFixa<FonteNormal::Mista>()); break;
+    }
+}
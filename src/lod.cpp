@@ -0,0 +1,265 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "paralelo.h"
+#include "perf.h"
+
+using namespace std;
+
+// Quádrica simétrica 4x4 (10 termos): erro(p) = soma das distâncias² aos planos acumulados
+struct Quadrica {
+    double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+
+    void somarPlano(double nx, double ny, double nz, double d) {
+        a00 += nx * nx; a01 += nx * ny; a02 += nx * nz; a03 += nx * d;
+        a11 += ny * ny; a12 += ny * nz; a13 += ny * d;
+        a22 += nz * nz; a23 += nz * d;
+        a33 += d * d;
+    }
+    void somar(const Quadrica& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+    }
+    double erro(const float* p) const {
+        const double x = p[0], y = p[1], z = p[2];
+        return x * (a00 * x + 2.0 * (a01 * y + a02 * z + a03))
+             + y * (a11 * y + 2.0 * (a12 * z + a13))
+             + z * (a22 * z + 2.0 * a23)
+             + a33;
+    }
+};
+
+static inline const float* posicaoVertice(const MalhaIndexada& m, uint32_t v) {
+    return &m.vertices[(size_t)v * FLOATS_POR_VERTICE];
+}
+
+static inline void normalFace(const float* a, const float* b, const float* c, double n[3]) {
+    const double u[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+    const double v[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+    n[0] = u[1] * v[2] - u[2] * v[1];
+    n[1] = u[2] * v[0] - u[0] * v[2];
+    n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// Vértices que não podem se mover: bordas (arestas usadas por um só triângulo, o que inclui
+// as costuras, onde os vértices duplicados deixam a malha "aberta") e posições compartilhadas
+// por mais de um vértice
+static void marcarTravados(const MalhaIndexada& m, const vector<uint32_t>& idx, vector<uint8_t>& travado) {
+    const size_t nV = m.numVertices();
+    travado.assign(nV, 0);
+
+    vector<uint64_t> arestas(idx.size());
+    for (size_t t = 0; t + 2 < idx.size(); t += 3)
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t a = idx[t + k], b = idx[t + (k + 1) % 3];
+            arestas[t + k] = ((uint64_t)min(a, b) << 32) | max(a, b);
+        }
+    sort(arestas.begin(), arestas.end());
+    for (size_t i = 0; i < arestas.size();) {
+        size_t j = i + 1;
+        while (j < arestas.size() && arestas[j] == arestas[i]) ++j;
+        if (j - i == 1) {
+            travado[arestas[i] >> 32] = 1;
+            travado[arestas[i] & 0xffffffffu] = 1;
+        }
+        i = j;
+    }
+
+    vector<uint32_t> porPosicao(nV);
+    for (uint32_t v = 0; v < nV; ++v) porPosicao[v] = v;
+    auto chave = [&](uint32_t v, int k) { uint32_t b; memcpy(&b, posicaoVertice(m, v) + k, 4); return b; };
+    auto menor = [&](uint32_t a, uint32_t b) {
+        for (int k = 0; k < 3; ++k) if (chave(a, k) != chave(b, k)) return chave(a, k) < chave(b, k);
+        return false;
+    };
+    sort(porPosicao.begin(), porPosicao.end(), menor);
+    for (size_t i = 0; i < nV;) {
+        size_t j = i + 1;
+        while (j < nV && !menor(porPosicao[i], porPosicao[j])) ++j;
+        if (j - i > 1) for (size_t k = i; k < j; ++k) travado[porPosicao[k]] = 1;
+        i = j;
+    }
+}
+
+struct Colapso {
+    float custo;
+    uint32_t de, para;
+};
+
+// Simplificador de um nível ao outro: mantém as quádricas acumuladas entre níveis
+struct Simplificador {
+    const MalhaIndexada& malha;
+    vector<Quadrica> quadricas;
+    vector<uint8_t> travado;
+    double erroMaximo = 0.0;   // maior custo (distância²) aceito até agora
+    size_t numThreads;
+
+    // Vértice -> triângulos, em CSR, para a lista de índices atual
+    vector<uint32_t> inicioAdj, trisAdj;
+
+    void montarAdjacencia(const vector<uint32_t>& idx) {
+        const size_t nV = malha.numVertices();
+        inicioAdj.assign(nV + 1, 0);
+        for (uint32_t v : idx) ++inicioAdj[v + 1];
+        for (size_t v = 0; v < nV; ++v) inicioAdj[v + 1] += inicioAdj[v];
+        trisAdj.resize(idx.size());
+        vector<uint32_t> pos(inicioAdj.begin(), inicioAdj.end() - 1);
+        for (size_t i = 0; i < idx.size(); ++i) trisAdj[pos[idx[i]]++] = (uint32_t)(i / 3);
+    }
+
+    // Levar "de" até "para" vira algum triângulo vizinho ao contrário? Os vizinhos já colapsados
+    // nesta rodada entram pela posição de destino. Devolve em "somem" quantos degeneram.
+    bool inverte(const vector<uint32_t>& idx, const vector<uint32_t>& destino,
+                 uint32_t de, uint32_t para, size_t& somem) const {
+        somem = 0;
+        for (uint32_t a = inicioAdj[de]; a < inicioAdj[de + 1]; ++a) {
+            const uint32_t* t = &idx[(size_t)trisAdj[a] * 3u];
+            uint32_t antes[3], depois[3];
+            for (int k = 0; k < 3; ++k) {
+                antes[k] = destino[t[k]];
+                depois[k] = (antes[k] == de) ? para : antes[k];
+            }
+            if (antes[0] == antes[1] || antes[1] == antes[2] || antes[0] == antes[2]) continue;   // já sumiu
+            if (depois[0] == depois[1] || depois[1] == depois[2] || depois[0] == depois[2]) { ++somem; continue; }
+            double nAntes[3], nDepois[3];
+            normalFace(posicaoVertice(malha, antes[0]), posicaoVertice(malha, antes[1]), posicaoVertice(malha, antes[2]), nAntes);
+            normalFace(posicaoVertice(malha, depois[0]), posicaoVertice(malha, depois[1]), posicaoVertice(malha, depois[2]), nDepois);
+            if (nAntes[0] * nDepois[0] + nAntes[1] * nDepois[1] + nAntes[2] * nDepois[2] <= 0.0) return true;
+        }
+        return false;
+    }
+
+    // Uma rodada de colapsos em ordem de custo, aplicados um a um. Os dois vértices de cada
+    // colapso não participam de outro na mesma rodada (os custos deles ficaram velhos).
+    // Devolve quantos triângulos sumiram.
+    size_t rodada(vector<uint32_t>& idx, size_t trisRemover) {
+        const size_t nTris = idx.size() / 3;
+        montarAdjacencia(idx);
+
+        // Erro de cada vértice na própria posição: o custo de levar a até b é Qa(b) + Qb(b)
+        const size_t nV = malha.numVertices();
+        vector<float> erroProprio(nV);
+        paraCadaFaixa(nV, numThreads, [&](size_t, size_t ini, size_t fim) {
+            for (size_t v = ini; v < fim; ++v) erroProprio[v] = (float)quadricas[v].erro(posicaoVertice(malha, (uint32_t)v));
+        });
+
+        // Custo de cada aresta, na direção mais barata que não mexe em travados. As arestas
+        // internas aparecem em dois triângulos; fica só a ocorrência com a < b. Cada thread
+        // guarda só as arestas colapsáveis.
+        vector<vector<Colapso>> porThread(numThreads);
+        paraCadaFaixa(nTris, numThreads, [&](size_t faixa, size_t ini, size_t fim) {
+            vector<Colapso>& saida = porThread[faixa];
+            saida.reserve((fim - ini) * 3 / 2);
+            for (size_t t = ini; t < fim; ++t)
+                for (int k = 0; k < 3; ++k) {
+                    const uint32_t a = idx[t * 3 + k], b = idx[t * 3 + (k + 1) % 3];
+                    if (a > b || (travado[a] && travado[b])) continue;
+                    Colapso c{ numeric_limits<float>::infinity(), a, b };
+                    if (!travado[a]) c.custo = (float)quadricas[a].erro(posicaoVertice(malha, b)) + erroProprio[b];
+                    if (!travado[b]) {
+                        const float custo = (float)quadricas[b].erro(posicaoVertice(malha, a)) + erroProprio[a];
+                        if (custo < c.custo) c = Colapso{ custo, b, a };
+                    }
+                    saida.push_back(c);
+                }
+        });
+        vector<Colapso> candidatos;
+        if (numThreads == 1) candidatos.swap(porThread[0]);
+        else for (auto& v : porThread) candidatos.insert(candidatos.end(), v.begin(), v.end());
+        if (candidatos.empty()) return 0;
+        auto maisBarato = [](const Colapso& x, const Colapso& y) { return x.custo < y.custo; };
+        // Só os mais baratos interessam: cada colapso remove ~2 triângulos e parte é rejeitada
+        const size_t considerar = min(candidatos.size(), trisRemover * 2 + 64);
+        nth_element(candidatos.begin(), candidatos.begin() + (considerar - 1), candidatos.end(), maisBarato);
+        candidatos.resize(considerar);
+        sort(candidatos.begin(), candidatos.end(), maisBarato);
+
+        vector<uint32_t> destino(nV);
+        for (uint32_t v = 0; v < nV; ++v) destino[v] = v;
+        vector<uint8_t> tocado(nV, 0);
+        size_t removidos = 0, somem = 0;
+        for (const Colapso& c : candidatos) {
+            if (removidos >= trisRemover) break;
+            if (tocado[c.de] || tocado[c.para] || inverte(idx, destino, c.de, c.para, somem)) continue;
+            destino[c.de] = c.para;
+            quadricas[c.para].somar(quadricas[c.de]);
+            erroMaximo = max(erroMaximo, (double)max(0.0f, c.custo));
+            tocado[c.de] = tocado[c.para] = 1;
+            removidos += somem;
+        }
+
+        // Aplica os colapsos e tira os triângulos degenerados
+        size_t saida = 0;
+        for (size_t t = 0; t < nTris; ++t) {
+            const uint32_t a = destino[idx[t * 3]], b = destino[idx[t * 3 + 1]], c = destino[idx[t * 3 + 2]];
+            if (a == b || b == c || a == c) continue;
+            idx[saida++] = a; idx[saida++] = b; idx[saida++] = c;
+        }
+        idx.resize(saida);
+        return nTris - saida / 3;
+    }
+};
+
+void gerarNiveisLOD(MalhaIndexada& malha, const OpcoesLOD& opcoes) {
+    malha.indicesLOD.clear();
+    malha.niveisLOD.clear();
+    const size_t nIndices = malha.numIndices();
+    if (nIndices / 3 <= opcoes.trisMinimos) return;
+
+    PERF_ESCOPO("carga.lod");
+    const auto t0 = chrono::steady_clock::now();
+    vector<uint32_t> idx(nIndices);
+    for (size_t i = 0; i < nIndices; ++i) idx[i] = malha.indice(i);
+
+    Simplificador s{ malha, vector<Quadrica>(malha.numVertices(), Quadrica()), {}, 0.0, numThreadsEfetivo(opcoes.numThreads), {}, {} };
+    marcarTravados(malha, idx, s.travado);
+    for (size_t t = 0; t + 2 < idx.size(); t += 3) {
+        const float* p0 = posicaoVertice(malha, idx[t]);
+        double n[3];
+        normalFace(p0, posicaoVertice(malha, idx[t + 1]), posicaoVertice(malha, idx[t + 2]), n);
+        const double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len <= 0.0) continue;
+        n[0] /= len; n[1] /= len; n[2] /= len;
+        const double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        for (int k = 0; k < 3; ++k) s.quadricas[idx[t + k]].somarPlano(n[0], n[1], n[2], d);
+    }
+
+    string resumo;
+    for (uint32_t nivel = 0; nivel < opcoes.maxNiveis; ++nivel) {
+        const size_t trisAntes = idx.size() / 3;
+        const size_t alvo = max<size_t>(opcoes.trisMinimos, (size_t)(trisAntes * opcoes.reducao));
+        if (alvo >= trisAntes) break;
+        while (idx.size() / 3 > alvo) {
+            const size_t removidos = s.rodada(idx, idx.size() / 3 - alvo);
+            if (removidos < max<size_t>(1, idx.size() / 3 / 100)) break;   // sobrou pouco para colapsar
+        }
+        // Nível que quase não reduziu não compensa a memória
+        if (idx.size() / 3 > trisAntes * 9 / 10) break;
+
+        NivelLOD n;
+        n.primeiroIndice = (uint32_t)malha.indicesLOD.size();
+        n.numIndices = (uint32_t)idx.size();
+        n.erro = (float)sqrt(s.erroMaximo);
+        n.reservado = 0;
+        malha.niveisLOD.push_back(n);
+        malha.indicesLOD.insert(malha.indicesLOD.end(), idx.begin(), idx.end());
+        resumo += " " + to_string(idx.size() / 3);
+    }
+    cout << "LOD: " << malha.niveisLOD.size() << " niveis (triangulos:" << resumo << ") em "
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() << " ms\n";
+}
+
+int escolherNivelLOD(const VisaoMalhaIndexada& malha, float erroPermitido) {
+    int escolhido = 0;
+    for (size_t i = 0; i < malha.niveisLOD.size(); ++i)
+        if (malha.niveisLOD[i].erro <= erroPermitido) escolhido = (int)i + 1;
+    return escolhido;
+}
@@ -0,0 +1,26 @@
+// Níveis de detalhe (LOD) gerados por simplificação com métrica de erro quádrica (QEM).
+// A simplificação é feita por colapso de meia-aresta: o vértice removido é levado até um
+// vizinho que já existe, então cada nível é só um novo conjunto de índices sobre os
+// vértices da MalhaIndexada e todos os níveis compartilham o mesmo VBO. Vértices de borda
+// e de costura (mesma posição com normal ou UV diferentes) ficam travados, para não abrir
+// buracos nem arrastar as costuras de UV/normal.
+
+#pragma once
+
+#include <cstdint>
+
+#include "obj_loader.h"
+
+struct OpcoesLOD {
+    uint32_t maxNiveis = 8;
+    uint32_t trisMinimos = 1000;  // não gera níveis abaixo disso
+    float reducao = 0.5f;         // cada nível tenta ter essa fração dos triângulos do anterior
+    int numThreads = 0;           // 0 = núcleos disponíveis
+};
+
+// Preenche malha.indicesLOD/niveisLOD a partir dos índices completos. Cada nível sai do
+// anterior; para quando não consegue mais reduzir (tudo travado) ou chega em trisMinimos.
+void gerarNiveisLOD(MalhaIndexada& malha, const OpcoesLOD& opcoes = OpcoesLOD());
+
+// Nível mais simples com erro até erroPermitido (0 = malha completa, k = niveisLOD[k - 1])
+int escolherNivelLOD(const VisaoMalhaIndexada& malha, float erroPermitido);
@@ -1,4 +1,5 @@
 #include <GL/freeglut.h>
+#include <GL/glx.h>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -6,13 +7,40 @@
 #include <iostream>
 #include <cmath>
 #include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <malloc.h>
 #include "obj_loader.h"
+#include "cache_malha.h"
+#include "arena.h"
+#include "malha_lista.h"
+#include "malha_vbo.h"
+#include "bvh.h"
+#include "lod.h"
+#include "otimizar_malha.h"
+#include "texturas.h"
+#include "carga_assincrona.h"
+#include "cenario.h"
+#include "malha_paginada.h"
+#include "contexto_offscreen.h"
+#include "perf.h"
+#include "recarga.h"
+#include "recarga_gpu.h"
+#include "observador_arquivo.h"
+#include "rasterizador.h"
+#include "paralelo.h"
+#include "captura.h"
+#include "estado_gl.h"
 
 using namespace std;
 
 // Desenha um cubo colorido (quando não há OBJ)
 static void desenharCuboColorido();
 
+// Lê o RSS depois de cargas e descartes de blocos no modo --paginado
+static void amostrarMemoriaPaginada();
+
 // Tamanho da janela
 static int g_width = 800;
 static int g_height = 600;
@@ -27,57 +55,465 @@ static bool g_lmb_down = false; // botão esquerdo arrasta: rotacionar
 static bool g_rmb_down = false; // botão direito arrasta: transladar
 static int g_last_x = 0, g_last_y = 0;
 
-static vector<float> g_vertices;       // posições: xyz intercalado
-static vector<unsigned int> g_indices; // índices (por posição) 0-based, para cálculo de normais fallback
-static vector<float> g_vnormals;       // normais calculadas por vértice (xyz intercalado)
-
-// Dados vindos diretamente do OBJ
-static vector<float> g_onormals;       // normais do arquivo (vn) xyz intercalado
-static vector<float> g_texcoords;      // coordenadas de textura (vt) uv intercalado
-static vector<CantoTri> g_triangulos;  // triângulos (3 cantos por triângulo)
+// Buffers do OBJ: posições, normais (calculadas e do arquivo), UVs, triângulos e malha indexada
+static MalhaOBJ g_obj;
+static ArenaCarga g_arenaCarga;        // temporários do parse e da indexação
 
 // Textura simples (procedural) para demonstrar mapeamento UV
 static GLuint g_texID = 0;
 static bool g_texEnabled = true;
 
+// Materiais do OBJ (mtllib/usemtl): a malha é desenhada por faixa de material, com a textura
+// do map_Kd de cada um (0 = sem mapa) vinda do cache por conteúdo
+static CacheTexturas g_texturas;
+static vector<GLuint> g_texturasMateriais;     // uma por g_obj.materiais
+static GLuint g_listasMateriais = 0;           // primeira das g_obj.indexada.faixasMaterial.size() listas
+
 static GLuint g_objList = 0;
 static bool g_objLoaded = false;
+static bool g_temUVs = false;          // os buffers de UV são liberados depois do envio à GPU
+static size_t g_trisModelo = 0;        // idem para os índices da malha
+
+// Formato compacto dos vértices no VBO (--compacto, ver vertice_compacto.h)
+static bool g_compacto = false;
+
+// Backend de desenho do modelo, escolhido na linha de comando (--render=lista|vbo|cpu)
+enum class BackendRender { Lista, VBO, CPU };
+static BackendRender g_backend = BackendRender::Lista;
+static MalhaVBO g_vbo;
+
+// Culling por frustum (padrão; --sem-culling desenha o modelo inteiro): a malha é dividida
+// em clusters da BVH, desenhados por display lists separadas ou faixas do IBO
+static bool g_culling = true;
+static BVHMalha g_bvh;
+static GLuint g_listasClusters = 0;            // primeira das g_bvh.clusters.size() listas
+static vector<uint32_t> g_clustersVisiveis;    // do último quadro
+static size_t g_trisVisiveis = 0;
+
+// Cenário .cena (ver cenario.h): várias instâncias de poucas malhas no lugar de um só OBJ
+static CenarioGPU g_cenario;
+static bool g_cenarioCarregado = false;
+static ModoCenario g_modoCenario = ModoCenario::Instancias;
+static int g_chamadasDesenho = 0;              // do último quadro
+
+// Modo fora do núcleo (--paginado, ver malha_paginada.h): só os blocos que cabem em
+// --orcamento-mb ficam na memória; os demais são lidos do arquivo conforme a vista
+static bool g_paginado = false;
+static size_t g_orcamentoMB = 512;
+static MalhaPaginada g_paginas;
+static bool g_paginasPendentes = false;        // blocos desejados ainda por carregar
+static const size_t BYTES_CARGA_POR_QUADRO = 16u << 20;
+static const size_t MARGEM_DRIVER_PAGINADO = 16u << 20;   // buffers do driver, malloc etc.
+static size_t g_basePaginadoBytes = 0;         // RSS ao abrir o arquivo + margem (fixa)
+static double g_rssPaginadoMB = 0.0;           // última amostra (abertura, cargas e descartes)
+static bool g_avisouRSSPaginado = false;
+static size_t g_visiveisForaAvisados = 0;
+
+// Nível de detalhe (padrão; --sem-lod desliga): o nível mais simples cujo erro, projetado na
+// tela pela distância atual, fica abaixo de g_lodErroPixels (--lod-erro=PX)
+static bool g_lod = true;
+static float g_lodErroPixels = 1.0f;
+static GLuint g_listasLOD = 0;                 // primeira das g_obj.indexada.niveisLOD.size() listas
+static int g_nivelLOD = 0;                     // do último quadro (0 = malha completa)
+static float g_centroModelo[3] = { 0.0f, 0.0f, 0.0f };
+static float g_raioModelo = 0.0f;
+
+// Matrizes do objeto no último quadro (para o frustum e o pick do mouse)
+static GLdouble g_projecao[16], g_modelview[16];
+static GLint g_viewport[4];
+
+// Estado GL com cache (estado_gl.h). A projeção da cena só é recalculada depois de um reshape;
+// luz, material de cor e modo de textura não mudam entre quadros e vão para o GL uma vez.
+static EstadoGL g_estadoGL;
+static bool g_projecaoValida = false;
+static bool g_estadoFixoPronto = false;
+static size_t g_trocasGLQuadro = 0, g_evitadasGLQuadro = 0;   // trocas de estado do último quadro (estado_gl.h)
+static GLuint g_listaAjuda = 0;                // linhas fixas do overlay de ajuda
+static GLuint g_listaGizmo = 0;                // eixos e letras do gizmo
+
+// Triângulo selecionado com o botão do meio
+static AcertoRaio g_pick;
+static bool g_temPick = false;
+
+// Carregamento em segundo plano (padrão; --sincrono carrega antes de abrir o laço do GLUT).
+// Enquanto a thread lê o arquivo, os triângulos já lidos são desenhados como lotes de prévia.
+static CargaAssincrona g_carga;
+static vector<LotePrevia> g_lotesPrevia;
+static size_t g_trisPrevia = 0;
+static chrono::steady_clock::time_point g_inicioCarga;
+static const unsigned int MS_VERIFICAR_CARGA = 33;
+
+// Modo --observar: o OBJ é relido quando o arquivo muda no disco, em segundo plano, e só os
+// trechos alterados voltam a ser lidos e enviados à GPU (recarga.h). O modelo antigo continua
+// na tela até a troca.
+static bool g_observar = false;
+static string g_caminhoObservado;
+static ModeloSecoes g_modeloObservado;
+static ModeloSecoesGPU g_gpuObservado;
+static ObservadorArquivo g_observador;
+static RecargaAssincrona g_recarga;
+static bool g_recargaPendente = false;         // o arquivo mudou de novo durante a recarga
+static string g_resumoRecarga;                 // da última recarga, para o overlay
+static const unsigned int MS_OBSERVAR = 50;
+
+// Backend CPU (--render=cpu): o rasterizador desenha o quadro e glDrawPixels o põe na janela
+static QuadroRaster g_quadroCPU;
+static ImagemRGBA g_xadrezCPU;
+static vector<ImagemRGBA> g_imagensCPU;        // uma por conteúdo distinto dos mapas
+static vector<int> g_imagemMaterialCPU;        // por g_obj.materiais: índice em g_imagensCPU, -1 = sem mapa
+static int g_threadsCPU = 0;
+static TemposRaster g_temposCPU;               // do último quadro
+static TemposRaster g_somaTemposCPU;
+static int g_amostrasCPU = 0;
+
+// Tempo de desenho do modelo: GPU via GL_TIME_ELAPSED (duas consultas alternadas, para
+// ler sempre o resultado do quadro anterior sem travar) e CPU via relógio
+static GLuint g_consultaTempo[2] = { 0, 0 };
+static int g_quadroConsulta = 0;
+static double g_somaGpuMs = 0.0, g_somaCpuMs = 0.0;
+static int g_amostrasDesenho = 0;
+static double g_ultimoGpuMs = 0.0;            // do quadro anterior
+
+// Painel de desempenho (P ou --perf): FPS, gráfico do tempo de quadro, triângulos, chamadas
+// de desenho e tempo de GPU. --perf também liga os medidores de perf.h e imprime o tempo de
+// cada fase da carga; --trace=arquivo.json grava os eventos em formato Chrome trace-event.
+static bool g_painelPerf = false;
+static string g_caminhoTrace;
+static const int QUADROS_HISTORICO = 120;
+static float g_historicoQuadroMs[QUADROS_HISTORICO] = {};
+static chrono::steady_clock::time_point g_historicoInicio[QUADROS_HISTORICO];
+static int g_posHistorico = 0;                 // próxima posição a escrever
+static int g_amostrasHistorico = 0;
+
+// Redesenho sob demanda: um quadro só é pedido quando algo visível muda
+// (transformação, textura, tamanho da janela). --continuo volta ao redesenho
+// ininterrupto; --fps-max=N limita a taxa de quadros nos dois modos.
+static bool g_redesenhoContinuo = false;
+static double g_fpsMax = 0.0;                 // 0 = sem limite
+static bool g_redesenhoPendente = false;      // já há um quadro agendado
+static chrono::steady_clock::time_point g_fimUltimoQuadro;
+static unsigned long g_quadrosDesenhados = 0;
+// Eventos que não viraram quadro (redesenhar a cada evento desenharia um por evento)
+static unsigned long g_pedidosAbsorvidos = 0;   // pedidos com um quadro já agendado
+static unsigned long g_eventosSemMudanca = 0;   // eventos (teclado, mouse, janela) sem mudança visível
+
+// Tudo que influencia a imagem; comparado antes/depois de cada evento
+struct EstadoVista {
+    float tx, ty, tz, rx, ry, rz, scale;
+    bool texEnabled, painelPerf;
+    int width, height;
+    uint32_t pick;                             // triângulo selecionado (UINT32_MAX = nenhum)
+    bool operator!=(const EstadoVista& o) const {
+        return tx != o.tx || ty != o.ty || tz != o.tz || rx != o.rx || ry != o.ry || rz != o.rz
+            || scale != o.scale || texEnabled != o.texEnabled || painelPerf != o.painelPerf || width != o.width || height != o.height
+            || pick != o.pick;
+    }
+};
+
+static EstadoVista estadoVista() {
+    return EstadoVista{ g_tx, g_ty, g_tz, g_rx, g_ry, g_rz, g_scale, g_texEnabled, g_painelPerf, g_width, g_height,
+                        g_temPick ? g_pick.triangulo : UINT32_MAX };
+}
+
+static void aoTimerRedesenho(int) {
+    glutPostRedisplay();
+}
+
+// Agenda um quadro respeitando o limite de FPS; pedidos repetidos antes do quadro sair são absorvidos
+static void solicitarRedesenho() {
+    if (g_redesenhoPendente) { ++g_pedidosAbsorvidos; return; }
+    g_redesenhoPendente = true;
+    if (g_fpsMax > 0.0) {
+        const double intervaloMs = 1000.0 / g_fpsMax;
+        const double decorridoMs = chrono::duration<double, milli>(chrono::steady_clock::now() - g_fimUltimoQuadro).count();
+        if (decorridoMs < intervaloMs) {
+            glutTimerFunc((unsigned int)ceil(intervaloMs - decorridoMs), aoTimerRedesenho, 0);
+            return;
+        }
+    }
+    glutPostRedisplay();
+}
+
+// Pede redesenho só se o evento mudou algo visível
+static void redesenharSeMudou(const EstadoVista& antes) {
+    if (estadoVista() != antes) solicitarRedesenho();
+    else ++g_eventosSemMudanca;
+}
+
+// Liga/desliga a espera pelo retraço vertical no glutSwapBuffers (GLX_SGI_swap_control)
+static void configurarVsync(int intervalo) {
+    typedef int (*PFNSWAPINTERVALSGI)(int);
+    auto swapInterval = (PFNSWAPINTERVALSGI)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+    if (swapInterval) swapInterval(intervalo);
+    else cerr << "glXSwapIntervalSGI indisponivel; vsync fica a cargo do driver\n";
+}
 
 static bool arquivoExiste(const string& path) {
     ifstream f(path);
     return f.good();
 }
 
-static void criarTexturaXadrez(int w = 64, int h = 64, int check = 8) {
-    if (g_texID != 0) {
-        glDeleteTextures(1, &g_texID);
-        g_texID = 0;
-    }
-    vector<unsigned char> img((size_t)w * h * 3u, 0);
+static ImagemRGBA imagemXadrez(int w, int h, int check) {
+    ImagemRGBA img;
+    img.largura = w;
+    img.altura = h;
+    img.niveis.assign(1, vector<uint8_t>((size_t)w * h * 4u, 255));
     for (int y = 0; y < h; ++y) {
         for (int x = 0; x < w; ++x) {
             int cx = (x / check) & 1;
             int cy = (y / check) & 1;
             unsigned char c = (cx ^ cy) ? 230 : 50;
-            size_t i = (size_t)(y * w + x) * 3u;
-            img[i+0] = c;
-            img[i+1] = c;
-            img[i+2] = c;
+            size_t i = (size_t)(y * w + x) * 4u;
+            img.niveis[0][i+0] = c;
+            img.niveis[0][i+1] = c;
+            img.niveis[0][i+2] = c;
+        }
+    }
+    gerarMipmaps(img);
+    return img;
+}
+
+static void criarTexturaXadrez(int w = 64, int h = 64, int check = 8) {
+    if (g_backend == BackendRender::CPU) {
+        g_xadrezCPU = imagemXadrez(w, h, check);
+        return;
+    }
+    if (g_texID != 0) {
+        glDeleteTextures(1, &g_texID);
+        g_texID = 0;
+    }
+    g_texID = criarTexturaRGBA(imagemXadrez(w, h, check));
+    invalidarEstadoGL(g_estadoGL);   // criarTexturaRGBA vincula a textura nova por fora do cache
+}
+
+static const char* nomeBackend() {
+    switch (g_backend) {
+        case BackendRender::VBO: return "vbo";
+        case BackendRender::CPU: return "cpu";
+        default: return "lista";
+    }
+}
+
+
+// Desenha só os clusters da BVH que tocam o frustum atual
+static void desenharClustersVisiveis() {
+    float proj[16], mv[16];
+    for (int i = 0; i < 16; ++i) { proj[i] = (float)g_projecao[i]; mv[i] = (float)g_modelview[i]; }
+    clustersVisiveis(g_bvh, frustumDasMatrizes(proj, mv), g_clustersVisiveis);
+    g_trisVisiveis = 0;
+    for (uint32_t c : g_clustersVisiveis) g_trisVisiveis += g_bvh.clusters[c].numTris;
+
+    if (g_backend == BackendRender::VBO) {
+        // Clusters consecutivos ocupam faixas consecutivas do IBO: junta em faixas maiores
+        vector<GLsizei> primeiros, contagens;
+        for (uint32_t c : g_clustersVisiveis) {
+            const ClusterBVH& cl = g_bvh.clusters[c];
+            if (!primeiros.empty() && (uint32_t)(primeiros.back() + contagens.back()) == cl.primeiroTri)
+                contagens.back() += (GLsizei)cl.numTris;
+            else { primeiros.push_back((GLsizei)cl.primeiroTri); contagens.push_back((GLsizei)cl.numTris); }
         }
+        desenharMalhaVBOFaixas(g_vbo, primeiros, contagens);
+    } else if (!g_clustersVisiveis.empty()) {
+        baseListasGL(g_estadoGL, g_listasClusters);
+        glCallLists((GLsizei)g_clustersVisiveis.size(), GL_UNSIGNED_INT, g_clustersVisiveis.data());
+    }
+}
+
+// Buffers de g_obj para leitura (do cache, direto das páginas mapeadas)
+static VisaoMalhaOBJ visaoObj() {
+    return VisaoMalhaOBJ(g_obj);
+}
+
+// Nível de detalhe para o quadro atual, pelo tamanho do modelo na tela
+static int nivelLODAtual() {
+    const VisaoMalhaIndexada malha = visaoObj().indexada;
+    if (!g_lod || malha.niveisLOD.empty()) return 0;
+    // Centro da esfera envolvente no espaço do olho; a escala do objeto vem da matriz
+    const GLdouble* m = g_modelview;
+    const double z = m[2] * g_centroModelo[0] + m[6] * g_centroModelo[1] + m[10] * g_centroModelo[2] + m[14];
+    const double escala = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+    const double distancia = -z - g_raioModelo * escala;
+    if (distancia <= 0.0) return 0;   // câmera dentro ou encostada no modelo
+    // Pixels ocupados por uma unidade do objeto a essa distância (g_projecao[5] = 1 / tan(fov / 2))
+    const double pixelsPorUnidade = g_viewport[3] * 0.5 * g_projecao[5] * escala / distancia;
+    return escolherNivelLOD(malha, (float)(g_lodErroPixels / pixelsPorUnidade));
+}
+
+// Desenha um nível simplificado inteiro (longe, o modelo todo cabe na tela e o culling não ajuda)
+static void desenharNivelLOD(int nivel) {
+    g_trisVisiveis = visaoObj().indexada.niveisLOD[nivel - 1].numIndices / 3;
+    if (g_backend == BackendRender::VBO) {
+        desenharMalhaVBONivel(g_vbo, nivel);
+    } else {
+        glCallList(g_listasLOD + (GLuint)(nivel - 1));
     }
-    glGenTextures(1, &g_texID);
-    glBindTexture(GL_TEXTURE_2D, g_texID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, w, h, GL_RGB, GL_UNSIGNED_BYTE, img.data());
 }
 
+// Estado do pipeline fixo para o material id (-1 ou sem definição = branco, sem mapa)
+static void aplicarMaterial(int id) {
+    static const MaterialOBJ padrao;
+    const bool valido = id >= 0 && (size_t)id < g_obj.materiais.size();
+    const MaterialOBJ& m = valido ? g_obj.materiais[id] : padrao;
+    corGL(g_estadoGL, m.difusa[0], m.difusa[1], m.difusa[2], m.opacidade);
+    const GLfloat especular[4] = { m.especular[0], m.especular[1], m.especular[2], 1.0f };
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, especular);
+    glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, min(128.0f, m.brilho * 128.0f / 1000.0f));   // Ns vai até 1000
+    habilitarGL(g_estadoGL, GL_BLEND, m.opacidade < 1.0f);
+
+    const GLuint tex = (valido && g_texEnabled && g_temUVs) ? g_texturasMateriais[id] : 0;
+    habilitarGL(g_estadoGL, GL_TEXTURE_2D, tex != 0);
+    if (tex != 0) texturaGL(g_estadoGL, tex);
+}
+
+// Uma chamada por faixa de material (sem culling nem LOD: os dois reordenam os índices)
+static void desenharPorMaterial() {
+    const Fatia<FaixaMaterial> faixas = visaoObj().indexada.faixasMaterial;
+    empilharAtributosGL(g_estadoGL, GL_CURRENT_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    if (g_backend == BackendRender::VBO) {
+        desenharMalhaVBOMateriais(g_vbo, faixas, aplicarMaterial);
+    } else {
+        for (size_t i = 0; i < faixas.size(); ++i) {
+            aplicarMaterial(faixas[i].material);
+            glCallList(g_listasMateriais + (GLuint)i);
+        }
+    }
+    desempilharAtributosGL(g_estadoGL);
+    g_chamadasDesenho = (int)faixas.size();
+}
+
+// Modo --observar: as faixas de cada trecho; sem materiais no arquivo, o estado da cena (branco
+// e a textura xadrez) vale para todos
+static void desenharModeloObservado() {
+    empilharAtributosGL(g_estadoGL, GL_CURRENT_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
+    if (g_modeloObservado.comMateriais) {
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        g_chamadasDesenho = desenharModeloSecoesGPU(g_gpuObservado, g_modeloObservado, aplicarMaterial);
+    } else {
+        g_chamadasDesenho = desenharModeloSecoesGPU(g_gpuObservado, g_modeloObservado, nullptr);
+    }
+    desempilharAtributosGL(g_estadoGL);
+}
+
+static MaterialRaster materialRaster(const MaterialOBJ& m, const ImagemRGBA* textura) {
+    MaterialRaster r;
+    copy(m.difusa, m.difusa + 3, r.cor);
+    r.cor[3] = m.opacidade;
+    copy(m.especular, m.especular + 3, r.especular);
+    r.brilho = min(128.0f, m.brilho * 128.0f / 1000.0f);
+    r.textura = textura;
+    return r;
+}
+
+// O mesmo estado que desenharCena() e aplicarMaterial() põem no GL
+static void montarCenaCPU(CenaRaster& cena) {
+    const float aspect = (g_height > 0) ? (float)g_width / (float)g_height : 1.0f;
+    matrizPerspectiva(60.0f, aspect, 0.1f, 100.0f, cena.projecao);
+    matrizObjeto(g_tx, g_ty, g_tz, g_rx, g_ry, g_rz, g_scale, cena.modelview);
+    const float fundo[4] = { 0.08f, 0.09f, 0.10f, 1.0f };
+    const float luz[4] = { 2.0f, 3.0f, 4.0f, 1.0f };
+    copy(fundo, fundo + 4, cena.fundo);
+    copy(luz, luz + 4, cena.posicaoLuz);
+    const bool texturas = g_texEnabled && g_temUVs;
+    if (visaoObj().indexada.faixasMaterial.empty()) {
+        cena.padrao = MaterialRaster();
+        cena.padrao.textura = (texturas && !g_xadrezCPU.niveis.empty()) ? &g_xadrezCPU : nullptr;
+    } else {
+        cena.padrao = materialRaster(MaterialOBJ(), nullptr);
+    }
+    cena.materiais.resize(g_obj.materiais.size());
+    for (size_t i = 0; i < g_obj.materiais.size(); ++i) {
+        const int img = i < g_imagemMaterialCPU.size() ? g_imagemMaterialCPU[i] : -1;
+        cena.materiais[i] = materialRaster(g_obj.materiais[i], (texturas && img >= 0) ? &g_imagensCPU[(size_t)img] : nullptr);
+    }
+}
+
+// Rasteriza o quadro em g_quadroCPU; imprime a média das fases a cada 120 quadros
+static void rasterizarQuadroCPU() {
+    CenaRaster cena;
+    montarCenaCPU(cena);
+    rasterizarMalha(visaoObj().indexada, cena, g_width, g_height, g_quadroCPU, g_temposCPU, g_threadsCPU);
+    g_trisVisiveis = g_temposCPU.triangulos;
+    g_chamadasDesenho = 1;
+    g_somaTemposCPU.verticesMs += g_temposCPU.verticesMs;
+    g_somaTemposCPU.binningMs += g_temposCPU.binningMs;
+    g_somaTemposCPU.rasterMs += g_temposCPU.rasterMs;
+    g_somaTemposCPU.totalMs += g_temposCPU.totalMs;
+    if (++g_amostrasCPU == 120) {
+        cout << "Rasterizador CPU (" << numThreadsEfetivo(g_threadsCPU) << " threads): vertices "
+             << g_somaTemposCPU.verticesMs / g_amostrasCPU << " ms, binning " << g_somaTemposCPU.binningMs / g_amostrasCPU
+             << " ms, raster " << g_somaTemposCPU.rasterMs / g_amostrasCPU << " ms, total "
+             << g_somaTemposCPU.totalMs / g_amostrasCPU << " ms por quadro\n";
+        g_somaTemposCPU = TemposRaster();
+        g_amostrasCPU = 0;
+    }
+}
+
+// O quadro da CPU cobre a janela inteira (o fundo inclusive); o buffer de profundidade do GL
+// continua limpo para o que vem por cima
+static void desenharModeloCPU() {
+    rasterizarQuadroCPU();
+    empilharAtributosGL(g_estadoGL, GL_ENABLE_BIT);
+    habilitarGL(g_estadoGL, GL_DEPTH_TEST, false);
+    habilitarGL(g_estadoGL, GL_LIGHTING, false);
+    habilitarGL(g_estadoGL, GL_TEXTURE_2D, false);
+    habilitarGL(g_estadoGL, GL_BLEND, false);
+    glWindowPos2i(0, 0);
+    glDrawPixels(g_quadroCPU.largura, g_quadroCPU.altura, GL_RGBA, GL_UNSIGNED_BYTE, g_quadroCPU.cor.data());
+    desempilharAtributosGL(g_estadoGL);
+}
+
+// Estado de material com que o modelo é desenhado (VBO, listas, cenário, prévia): preenchido,
+// sem culling e branco; os materiais trocam a cor por cima
+static void estadoModeloGL() {
+    modoPoligonoGL(g_estadoGL, GL_FILL);
+    habilitarGL(g_estadoGL, GL_CULL_FACE, false);
+    corGL(g_estadoGL, 1.0f, 1.0f, 1.0f);
+}
 
 // Desenha o OBJ carregado ou o cubo colorido como fallback
 static void desenharOBJorFallback() {
-    if (g_objLoaded && g_objList != 0) {
+    estadoModeloGL();
+    g_nivelLOD = g_objLoaded ? nivelLODAtual() : 0;
+    g_trisVisiveis = g_objLoaded ? g_trisModelo : 12;   // os caminhos com culling/LOD corrigem
+    g_chamadasDesenho = 1;
+    g_paginasPendentes = false;
+    if (g_cenarioCarregado) {
+        g_chamadasDesenho = desenharCenario(g_estadoGL, g_cenario);
+    } else if (g_paginas.fd >= 0) {
+        float proj[16], mv[16];
+        for (int i = 0; i < 16; ++i) { proj[i] = (float)g_projecao[i]; mv[i] = (float)g_modelview[i]; }
+        const size_t trocas = g_paginas.carregamentos + g_paginas.descartes;
+        g_paginasPendentes = atualizarMalhaPaginada(g_paginas, proj, mv, BYTES_CARGA_POR_QUADRO);
+        if (g_paginas.carregamentos + g_paginas.descartes != trocas) amostrarMemoriaPaginada();
+        // A vista pede mais blocos do que o orçamento comporta: avisa a cada mudança da falta
+        if (g_paginas.visiveisForaOrcamento != g_visiveisForaAvisados) {
+            g_visiveisForaAvisados = g_paginas.visiveisForaOrcamento;
+            if (g_visiveisForaAvisados > 0)
+                cerr << "Erro: --orcamento-mb=" << g_orcamentoMB << " nao comporta os blocos visiveis; "
+                     << g_visiveisForaAvisados << " de " << g_visiveisForaAvisados + g_paginas.visiveis.size()
+                     << " ficam sem desenhar\n";
+        }
+        g_trisVisiveis = desenharMalhaPaginada(g_paginas);
+        g_chamadasDesenho = (int)g_paginas.visiveis.size();
+    } else if (g_carga.ativa && !g_lotesPrevia.empty()) {
+        // Carga em andamento: o que já foi lido
+        desenharLotesPrevia(g_lotesPrevia);
+    } else if (g_observar && g_objLoaded) {
+        desenharModeloObservado();
+    } else if (g_objLoaded && g_backend == BackendRender::CPU) {
+        desenharModeloCPU();
+    } else if (g_nivelLOD > 0) {
+        desenharNivelLOD(g_nivelLOD);
+    } else if (g_objLoaded && !visaoObj().indexada.faixasMaterial.empty()) {
+        desenharPorMaterial();
+    } else if (g_objLoaded && g_culling && !g_bvh.vazia()) {
+        desenharClustersVisiveis();
+    } else if (g_objLoaded && g_backend == BackendRender::VBO && g_vbo.vao != 0) {
+        desenharMalhaVBO(g_vbo);
+    } else if (g_objLoaded && g_objList != 0) {
         // Chamada para desenhar o OBJ
         glCallList(g_objList);
     } else {
@@ -86,10 +522,36 @@ static void desenharOBJorFallback() {
     }
 }
 
-// Desenha instruções de texto na tela
-static void desenharTextoBitmap2D(float x, float y, const string& text) {
-    glRasterPos2f(x, y);
-    for (unsigned char c : text) glutBitmapCharacter(GLUT_BITMAP_9_BY_15, c);
+// Desenha o modelo medindo o tempo de CPU e GPU; imprime a média a cada 120 quadros
+static void desenharOBJMedindo() {
+    PERF_ESCOPO("quadro.modelo");
+    if (!g_objLoaded || g_consultaTempo[0] == 0) {
+        desenharOBJorFallback();
+        return;
+    }
+    const int atual = g_quadroConsulta & 1;
+    const auto t0 = chrono::steady_clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, g_consultaTempo[atual]);
+    desenharOBJorFallback();
+    glEndQuery(GL_TIME_ELAPSED);
+    const double cpuMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+    // Resultado do quadro anterior (já deve estar pronto)
+    if (g_quadroConsulta > 0) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(g_consultaTempo[atual ^ 1], GL_QUERY_RESULT, &ns);
+        g_ultimoGpuMs = ns / 1.0e6;
+        g_somaGpuMs += g_ultimoGpuMs;
+        g_somaCpuMs += cpuMs;
+        if (++g_amostrasDesenho == 120) {
+            cout << "Desenho (" << nomeBackend() << "): GPU "
+                 << g_somaGpuMs / g_amostrasDesenho << " ms, CPU " << g_somaCpuMs / g_amostrasDesenho
+                 << " ms por quadro\n";
+            g_somaGpuMs = g_somaCpuMs = 0.0;
+            g_amostrasDesenho = 0;
+        }
+    }
+    ++g_quadroConsulta;
 }
 
 // Reseta a transformação do objeto (posição/rotação/escala)
@@ -102,36 +564,36 @@ static void resetTransform() {
 // Desenha um cubo colorido
 static void desenharCuboColorido() {
     const float s = 0.5f;
-    glDisable(GL_LIGHTING);
+    habilitarGL(g_estadoGL, GL_LIGHTING, false);
     glBegin(GL_TRIANGLES);
 
     // +X (vermelho)
-    glColor3f(1,0,0);
+    corGL(g_estadoGL, 1,0,0);
     glVertex3f( s,-s,-s); glVertex3f( s,-s, s); glVertex3f( s, s, s);
     glVertex3f( s,-s,-s); glVertex3f( s, s, s); glVertex3f( s, s,-s);
 
     // -X (amarelo)
-    glColor3f(1,1,0);
+    corGL(g_estadoGL, 1,1,0);
     glVertex3f(-s,-s, s); glVertex3f(-s,-s,-s); glVertex3f(-s, s,-s);
     glVertex3f(-s,-s, s); glVertex3f(-s, s,-s); glVertex3f(-s, s, s);
 
     // +Y (verde)
-    glColor3f(0,1,0);
+    corGL(g_estadoGL, 0,1,0);
     glVertex3f(-s, s,-s); glVertex3f( s, s,-s); glVertex3f( s, s, s);
     glVertex3f(-s, s,-s); glVertex3f( s, s, s); glVertex3f(-s, s, s);
 
     // -Y (ciano)
-    glColor3f(0,1,1);
+    corGL(g_estadoGL, 0,1,1);
     glVertex3f(-s,-s, s); glVertex3f( s,-s, s); glVertex3f( s,-s,-s);
     glVertex3f(-s,-s, s); glVertex3f( s,-s,-s); glVertex3f(-s,-s,-s);
 
     // +Z (azul)
-    glColor3f(0,0,1);
+    corGL(g_estadoGL, 0,0,1);
     glVertex3f(-s,-s, s); glVertex3f(-s, s, s); glVertex3f( s, s, s);
     glVertex3f(-s,-s, s); glVertex3f( s, s, s); glVertex3f( s,-s, s);
 
     // -Z (magenta)
-    glColor3f(1,0,1);
+    corGL(g_estadoGL, 1,0,1);
     glVertex3f( s,-s,-s); glVertex3f( s, s,-s); glVertex3f(-s, s,-s);
     glVertex3f( s,-s,-s); glVertex3f(-s, s,-s); glVertex3f(-s,-s,-s);
 
@@ -142,156 +604,355 @@ static void desenharCuboColorido() {
 static void drawAxesGizmo() {
     const int size = 100;
     const int margin = 10;
-    glViewport(g_width - size - margin, g_height - size - margin, size, size);
+    static float projecao[16];   // gluPerspective(40, 1, 0.1, 10)
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    gluPerspective(40.0, 1.0, 0.1, 10.0);
+    // Eixos e letras não mudam: uma display list, criada no primeiro quadro
+    if (g_listaGizmo == 0) {
+        matrizPerspectiva(40.0f, 1.0f, 0.1f, 10.0f, projecao);
+        g_listaGizmo = glGenLists(1);
+        glNewList(g_listaGizmo, GL_COMPILE);
+        glLineWidth(2.0f);
+        glBegin(GL_LINES);
+          // X - vermelho
+          glColor3f(1,0,0); glVertex3f(0,0,0); glVertex3f(0.8f,0,0);
+          // Y - verde
+          glColor3f(0,1,0); glVertex3f(0,0,0); glVertex3f(0,0.8f,0);
+          // Z - azul
+          glColor3f(0,0,1); glVertex3f(0,0,0); glVertex3f(0,0,0.8f);
+        glEnd();
 
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    glTranslatef(0, 0, -2.0f);
+        // Letras
+        glColor3f(1,0,0); glRasterPos3f(0.9f, 0.0f, 0.0f); glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, 'X');
+        glColor3f(0,1,0); glRasterPos3f(0.0f, 0.9f, 0.0f); glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, 'Y');
+        glColor3f(0,0,1); glRasterPos3f(0.0f, 0.0f, 0.9f); glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, 'Z');
+        glEndList();
+    }
 
     // Rotaciona igual ao objeto para mostrar orientação
-    glRotatef(g_rx, 1,0,0);
-    glRotatef(g_ry, 0,1,0);
-    glRotatef(g_rz, 0,0,1);
-
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
-    glLineWidth(2.0f);
-
-    glBegin(GL_LINES);
-      // X - vermelho
-      glColor3f(1,0,0); glVertex3f(0,0,0); glVertex3f(0.8f,0,0);
-      // Y - verde
-      glColor3f(0,1,0); glVertex3f(0,0,0); glVertex3f(0,0.8f,0);
-      // Z - azul
-      glColor3f(0,0,1); glVertex3f(0,0,0); glVertex3f(0,0,0.8f);
-    glEnd();
-
-    // Letras
-    glColor3f(1,0,0); glRasterPos3f(0.9f, 0.0f, 0.0f); glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, 'X');
-    glColor3f(0,1,0); glRasterPos3f(0.0f, 0.9f, 0.0f); glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, 'Y');
-    glColor3f(0,0,1); glRasterPos3f(0.0f, 0.0f, 0.9f); glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, 'Z');
+    float modelview[16];
+    matrizObjeto(0.0f, 0.0f, -2.0f, g_rx, g_ry, g_rz, 1.0f, modelview);
 
-    // Restaura estado
-    glEnable(GL_DEPTH_TEST);
-    glMatrixMode(GL_MODELVIEW); glPopMatrix();
-    glMatrixMode(GL_PROJECTION); glPopMatrix();
+    viewportGL(g_estadoGL, g_width - size - margin, g_height - size - margin, size, size);
+    empilharMatrizGL(g_estadoGL, GL_PROJECTION, projecao);
+    empilharMatrizGL(g_estadoGL, GL_MODELVIEW, modelview);
+    habilitarGL(g_estadoGL, GL_DEPTH_TEST, false);
+    habilitarGL(g_estadoGL, GL_LIGHTING, false);
+    glCallList(g_listaGizmo);
+    invalidarCorGL(g_estadoGL);   // a lista troca a cor por eixo
+    desempilharMatrizGL(g_estadoGL, GL_MODELVIEW);
+    desempilharMatrizGL(g_estadoGL, GL_PROJECTION);
 
     // Volta viewport padrão
-    glViewport(0, 0, g_width, g_height);
+    viewportGL(g_estadoGL, 0, 0, g_width, g_height);
 }
 
 // Overlay de ajuda com mapeamento de teclas e mouse
 static void drawHelpOverlay() {
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    gluOrtho2D(0, g_width, 0, g_height);
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
-
-    int x = 10;
+    habilitarGL(g_estadoGL, GL_DEPTH_TEST, false);
+    habilitarGL(g_estadoGL, GL_LIGHTING, false);
+
+    // As linhas fixas ficam numa display list só; as que mudam saem uma por glCallLists
+    if (g_listaAjuda == 0) {
+        g_listaAjuda = compilarTextoGL(g_estadoGL, {
+            "Comandos:",
+            "W/S: Transladar +Y/-Y",
+            "A/D: Transladar -X/+X",
+            "Q/E: Aproximar/Afastar (Z)",
+            "Setas: Rotacionar em X/Y",
+            "Z/X: Rotacionar em Z",
+            "+/−: Aumentar/Diminuir escala",
+            "T: Alternar textura ON/OFF",
+            "Mouse Esq: arrastar p/ rotacionar",
+            "Mouse Dir: arrastar p/ transladar",
+            "Mouse Meio: selecionar triangulo",
+            "Scroll: Aproximar/Afastar",
+            "R: Resetar",
+            "P: Painel de desempenho",
+        });
+    }
+    corGL(g_estadoGL, 1.0f, 1.0f, 1.0f);
+    posicaoTextoGL(g_estadoGL, 10, g_height - 10);
+    glCallList(g_listaAjuda);
+    auto line = [](const string& s) { linhaTextoGL(g_estadoGL, s); };
+
+    if (g_carga.ativa) {
+        const double mb = 1024.0 * 1024.0;
+        ostringstream ss;
+        ss.setf(ios::fixed); ss.precision(1);
+        ss << "Carregando: " << g_carga.bytesLidos / mb << "/" << g_carga.bytesTotal / mb << " MB, "
+           << g_carga.triangulos << " triangulos";
+        line(ss.str());
+    }
+    if (g_objLoaded && g_culling && !g_bvh.vazia() && g_nivelLOD == 0) {
+        line("Clusters: " + to_string(g_clustersVisiveis.size()) + "/" + to_string(g_bvh.clusters.size())
+             + " visiveis (" + to_string(g_trisVisiveis) + " de " + to_string(g_bvh.ordem.size()) + " triangulos)");
+    }
+    const Fatia<NivelLOD> niveis = visaoObj().indexada.niveisLOD;
+    if (g_objLoaded && !niveis.empty()) {
+        const size_t trisNivel = g_nivelLOD > 0 ? niveis[g_nivelLOD - 1].numIndices / 3 : g_trisModelo;
+        line("LOD: nivel " + to_string(g_nivelLOD) + "/" + to_string(niveis.size())
+             + " (" + to_string(trisNivel) + " triangulos)");
+    }
+    if (g_cenarioCarregado) {
+        line("Cenario: " + to_string(g_cenario.numInstancias) + " instancias de " + to_string(g_cenario.malhas.size())
+             + " malhas, " + to_string(g_chamadasDesenho) + " chamadas de desenho (" + nomeModoCenario(g_cenario.modo) + ")");
+    }
+    if (g_paginas.fd >= 0) {
+        const double mb = 1024.0 * 1024.0;
+        ostringstream ss;
+        ss.setf(ios::fixed); ss.precision(1);
+        size_t residentes = 0;
+        for (const MalhaVBO& v : g_paginas.vbos) residentes += v.vao != 0;
+        ss << "Paginado: " << residentes << "/" << g_paginas.blocos.size() << " blocos residentes ("
+           << g_paginas.bytesResidentes / mb << "/" << g_paginas.orcamentoBytes / mb << " MB), "
+           << g_paginas.visiveis.size() << " visiveis, " << g_paginas.carregamentos << " carregados, "
+           << g_paginas.descartes << " descartados, RSS " << g_rssPaginadoMB << " MB";
+        if (g_paginas.visiveisForaOrcamento > 0) ss << ", " << g_paginas.visiveisForaOrcamento << " visiveis fora do orcamento";
+        line(ss.str());
+    }
+    if (g_observar && g_objLoaded) {
+        line("Observando: " + to_string(g_modeloObservado.secoes.size()) + " trechos"
+             + (g_recarga.ativa ? ", recarregando..." : g_resumoRecarga.empty() ? string() : ", ultima recarga " + g_resumoRecarga));
+    }
+    if (g_objLoaded && g_backend == BackendRender::CPU) {
+        ostringstream ss;
+        ss.setf(ios::fixed); ss.precision(1);
+        ss << "CPU: " << g_temposCPU.totalMs << " ms (vertices " << g_temposCPU.verticesMs << ", binning "
+           << g_temposCPU.binningMs << ", raster " << g_temposCPU.rasterMs << "), " << g_temposCPU.triangulos
+           << " triangulos, " << numThreadsEfetivo(g_threadsCPU) << " threads";
+        line(ss.str());
+    }
+    if (g_temPick) line("Selecionado: triangulo " + to_string(g_pick.triangulo));
+    line("Quadros: " + to_string(g_quadrosDesenhados) + " desenhados, " + to_string(g_pedidosAbsorvidos + g_eventosSemMudanca)
+         + " pulados (" + to_string(g_pedidosAbsorvidos) + " pedidos absorvidos, " + to_string(g_eventosSemMudanca)
+         + " eventos sem mudanca)");
+}
+
+// Guarda o tempo do quadro (início de display() até depois da troca de buffers) e contadores
+static void registrarQuadroHistorico(chrono::steady_clock::time_point inicio, chrono::steady_clock::time_point fim) {
+    g_historicoQuadroMs[g_posHistorico] = (float)chrono::duration<double, milli>(fim - inicio).count();
+    g_historicoInicio[g_posHistorico] = inicio;
+    g_posHistorico = (g_posHistorico + 1) % QUADROS_HISTORICO;
+    g_amostrasHistorico = min(g_amostrasHistorico + 1, QUADROS_HISTORICO);
+    PERF_CONTADOR("triangulos", g_trisVisiveis);
+    PERF_CONTADOR("chamadas_desenho", g_chamadasDesenho);
+    PERF_CONTADOR("trocas_estado_gl_cache", g_trocasGLQuadro);
+}
+
+// Painel de desempenho no canto superior direito: números do último segundo e o gráfico dos
+// últimos QUADROS_HISTORICO quadros (a linha de referência marca 16,7 ms)
+static void desenharPainelPerf() {
+    const auto agora = chrono::steady_clock::now();
+    int quadrosSegundo = 0;
+    double somaMs = 0.0, maiorMs = 0.0;
+    for (int i = 0; i < g_amostrasHistorico; ++i) {
+        somaMs += g_historicoQuadroMs[i];
+        maiorMs = max(maiorMs, (double)g_historicoQuadroMs[i]);
+        if (agora - g_historicoInicio[i] <= chrono::seconds(1)) ++quadrosSegundo;
+    }
+    const double mediaMs = g_amostrasHistorico > 0 ? somaMs / g_amostrasHistorico : 0.0;
+
+    const int largura = 260, alturaGrafico = 60;
+    const int x0 = g_width - largura - 10;
     int y = g_height - 10;
-    auto line = [&](const string& s){ glColor3f(1,1,1); desenharTextoBitmap2D((float)x, (float)y, s); y -= 18; };
-
-    line("Comandos:");
-    line("W/S: Transladar +Y/-Y");
-    line("A/D: Transladar -X/+X");
-    line("Q/E: Aproximar/Afastar (Z)");
-    line("Setas: Rotacionar em X/Y");
-    line("Z/X: Rotacionar em Z");
-    line("+/−: Aumentar/Diminuir escala");
-    line("T: Alternar textura ON/OFF");
-    line("Mouse Esq: arrastar p/ rotacionar");
-    line("Mouse Dir: arrastar p/ transladar");
-    line("Scroll: Aproximar/Afastar");
-    line("R: Resetar");
-
-    glEnable(GL_DEPTH_TEST);
-    glMatrixMode(GL_MODELVIEW); glPopMatrix();
-    glMatrixMode(GL_PROJECTION); glPopMatrix();
-}
-
-// Desenha a cena: câmera, luz, transformações e objeto
-static void display() {
-    glClearColor(0.08f, 0.09f, 0.10f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Projeção
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    const float aspect = (g_height > 0) ? (float)g_width / (float)g_height : 1.0f;
-    gluPerspective(60.0, aspect, 0.1, 100.0);
+    // gluOrtho2D(0, largura, 0, altura)
+    const float orto[16] = { 2.0f / g_width, 0, 0, 0,  0, 2.0f / g_height, 0, 0,  0, 0, -1, 0,  -1, -1, 0, 1 };
+    const float identidade[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+    empilharMatrizGL(g_estadoGL, GL_PROJECTION, orto);
+    empilharMatrizGL(g_estadoGL, GL_MODELVIEW, identidade);
+    habilitarGL(g_estadoGL, GL_DEPTH_TEST, false);
+    habilitarGL(g_estadoGL, GL_LIGHTING, false);
+    habilitarGL(g_estadoGL, GL_TEXTURE_2D, false);
 
-    // ModelView
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    corGL(g_estadoGL, 1.0f, 1.0f, 0.6f);
+    posicaoTextoGL(g_estadoGL, x0, y);
+    auto line = [&](const string& s) { linhaTextoGL(g_estadoGL, s); y -= ALTURA_LINHA_TEXTO; };
+    ostringstream ss;
+    ss.setf(ios::fixed); ss.precision(1);
+    ss << "FPS: " << quadrosSegundo << " (ultimo segundo)";
+    line(ss.str()); ss.str("");
+    ss << "Quadro: " << mediaMs << " ms media, " << maiorMs << " max";
+    line(ss.str()); ss.str("");
+    ss << "GPU (modelo): " << g_ultimoGpuMs << " ms";
+    line(ss.str()); ss.str("");
+    line("Triangulos: " + to_string(g_trisVisiveis));
+    line("Chamadas de desenho: " + to_string(g_chamadasDesenho));
+    line("Estado GL (cache): " + to_string(g_trocasGLQuadro) + " trocas, " + to_string(g_evitadasGLQuadro) + " evitadas");
+    if (!g_obj.materiais.empty())
+        line("Materiais: " + to_string(g_obj.materiais.size()) + " (" + to_string(g_texturas.porHash.size()) + " texturas)");
 
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
+    // Gráfico: barras do mais antigo (esquerda) ao mais recente, escala até max(33 ms, maior)
+    const float yBase = (float)(y - alturaGrafico);
+    const float escalaMs = (float)max(33.3, maiorMs);
+    const float passo = (float)largura / QUADROS_HISTORICO;
+    corGL(g_estadoGL, 0.2f, 0.2f, 0.2f);
+    glBegin(GL_LINE_LOOP);
+    glVertex2f((float)x0, yBase); glVertex2f((float)(x0 + largura), yBase);
+    glVertex2f((float)(x0 + largura), yBase + alturaGrafico); glVertex2f((float)x0, yBase + alturaGrafico);
+    glEnd();
+    glBegin(GL_LINES);
+    for (int k = 0; k < g_amostrasHistorico; ++k) {
+        const int i = (g_posHistorico - g_amostrasHistorico + k + QUADROS_HISTORICO) % QUADROS_HISTORICO;
+        const float ms = g_historicoQuadroMs[i];
+        if (ms > 33.3f) corGL(g_estadoGL, 1.0f, 0.3f, 0.3f);
+        else if (ms > 16.7f) corGL(g_estadoGL, 1.0f, 0.8f, 0.2f);
+        else corGL(g_estadoGL, 0.3f, 1.0f, 0.4f);
+        const float x = x0 + (k + 0.5f) * passo;
+        glVertex2f(x, yBase);
+        glVertex2f(x, yBase + alturaGrafico * min(1.0f, ms / escalaMs));
+    }
+    const float yRef = yBase + alturaGrafico * 16.7f / escalaMs;
+    corGL(g_estadoGL, 0.6f, 0.6f, 0.6f);
+    glVertex2f((float)x0, yRef); glVertex2f((float)(x0 + largura), yRef);
+    glEnd();
 
-    // Configuração de iluminação no espaço da câmera (antes das transformações do objeto)
-    glEnable(GL_LIGHTING);
+    desempilharMatrizGL(g_estadoGL, GL_MODELVIEW);
+    desempilharMatrizGL(g_estadoGL, GL_PROJECTION);
+}
+
+// Tempo de cada fase da carga ("carga.*" em perf.h), para achar em que etapa algo piorou
+static void imprimirFasesCarga() {
+    if (!perfAtivo()) return;
+    ostringstream ss;
+    for (const TotalFasePerf& f : totaisFasesPerf())
+        if (f.nome.rfind("carga.", 0) == 0) ss << " " << f.nome.substr(6) << " " << f.ms << " ms;";
+    if (!ss.str().empty()) cout << "Fases da carga:" << ss.str() << "\n";
+}
+
+// Contorno do triângulo escolhido com o mouse, por cima do modelo
+static void desenharTrianguloSelecionado() {
+    empilharAtributosGL(g_estadoGL, GL_ENABLE_BIT | GL_LINE_BIT | GL_CURRENT_BIT);
+    habilitarGL(g_estadoGL, GL_LIGHTING, false);
+    habilitarGL(g_estadoGL, GL_TEXTURE_2D, false);
+    habilitarGL(g_estadoGL, GL_DEPTH_TEST, false);
+    glLineWidth(2.0f);
+    corGL(g_estadoGL, 1.0f, 0.2f, 0.2f);
+    const VisaoMalhaOBJ v = visaoObj();
+    glBegin(GL_LINE_LOOP);
+    for (int k = 0; k < 3; ++k) glVertex3fv(&v.vertices[(size_t)v.triangulos[(size_t)g_pick.triangulo * 3u + k].v * 3u]);
+    glEnd();
+    desempilharAtributosGL(g_estadoGL);
+}
+
+// Estado que nenhum quadro muda: luz branca fixa em relação à câmera (a posição é dada com a
+// modelview identidade, no espaço do olho), material de cor, modelo de luz, modo da textura
+static void configurarEstadoFixo() {
+    const float identidade[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+    carregarMatrizGL(g_estadoGL, GL_MODELVIEW, identidade);
+    glClearColor(0.08f, 0.09f, 0.10f, 1.0f);
     glEnable(GL_LIGHT0);
     glEnable(GL_NORMALIZE);
     glEnable(GL_COLOR_MATERIAL);
     glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
     glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
     glShadeModel(GL_SMOOTH);
-
-    // Luz branca direcional/pontual fixa em relação à câmera
     GLfloat lightPos[4] = {2.0f, 3.0f, 4.0f, 1.0f};
     GLfloat lightCol[4] = {1.0f, 1.0f, 1.0f, 1.0f};
     glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
     glLightfv(GL_LIGHT0, GL_DIFFUSE,  lightCol);
     glLightfv(GL_LIGHT0, GL_SPECULAR, lightCol);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    g_estadoFixoPronto = true;
+}
+
+// Projeção da cena, como gluPerspective(60, aspecto, 0.1, 100); só muda com o tamanho da janela
+static void aplicarProjecao() {
+    const float aspect = (g_height > 0) ? (float)g_width / (float)g_height : 1.0f;
+    float projecao[16];
+    matrizPerspectiva(60.0f, aspect, 0.1f, 100.0f, projecao);
+    carregarMatrizGL(g_estadoGL, GL_PROJECTION, projecao);
+    viewportGL(g_estadoGL, 0, 0, g_width, g_height);
+    copy(projecao, projecao + 16, g_projecao);
+    g_viewport[0] = 0; g_viewport[1] = 0; g_viewport[2] = g_width; g_viewport[3] = g_height;
+    g_projecaoValida = true;
+}
+
+// Desenha a cena: câmera, luz, transformações e objeto (sem gizmo/overlay)
+static void desenharCena() {
+    PERF_ESCOPO("quadro.cena");
+    if (!g_estadoFixoPronto) configurarEstadoFixo();
+    if (!g_projecaoValida) aplicarProjecao();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    habilitarGL(g_estadoGL, GL_DEPTH_TEST, true);
+    habilitarGL(g_estadoGL, GL_CULL_FACE, false);
+    habilitarGL(g_estadoGL, GL_LIGHTING, true);
 
     // Textura (ativa somente se há UV carregado)
-    if (g_texEnabled && g_texID != 0 && !g_texcoords.empty()) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, g_texID);
-        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    if (g_texEnabled && g_texID != 0 && g_temUVs) {
+        habilitarGL(g_estadoGL, GL_TEXTURE_2D, true);
+        texturaGL(g_estadoGL, g_texID);
     } else {
-        glDisable(GL_TEXTURE_2D);
+        habilitarGL(g_estadoGL, GL_TEXTURE_2D, false);
     }
 
-    // Aplica transformações
-    glTranslatef(g_tx, g_ty, g_tz);
-    glRotatef(g_rx, 1,0,0);
-    glRotatef(g_ry, 0,1,0);
-    glRotatef(g_rz, 0,0,1);
-    glScalef(g_scale, g_scale, g_scale);
+    // Transformações do objeto, montadas na CPU (as mesmas de glTranslate/glRotate/glScale)
+    float modelview[16];
+    matrizObjeto(g_tx, g_ty, g_tz, g_rx, g_ry, g_rz, g_scale, modelview);
+    carregarMatrizGL(g_estadoGL, GL_MODELVIEW, modelview);
+    copy(modelview, modelview + 16, g_modelview);
 
     // Desenha o arquivo OBJ (ou cubo)
-    desenharOBJorFallback();
+    desenharOBJMedindo();
+
+    if (g_temPick) desenharTrianguloSelecionado();
+}
+
+static void display() {
+    PERF_ESCOPO("quadro");
+    const auto inicio = chrono::steady_clock::now();
+    g_redesenhoPendente = false;
+    ++g_quadrosDesenhados;
+    zerarContagemGL(g_estadoGL);
+
+    desenharCena();
 
-    // Gizmo de eixos (fixo na tela)
-    drawAxesGizmo();
+    {
+        PERF_ESCOPO("quadro.overlay");
+        // Gizmo de eixos (fixo na tela)
+        drawAxesGizmo();
 
-    // Overlay de ajuda
-    drawHelpOverlay();
+        // Overlay de ajuda
+        drawHelpOverlay();
+        if (g_painelPerf) desenharPainelPerf();
+    }
+
+    g_trocasGLQuadro = g_estadoGL.trocas;
+    g_evitadasGLQuadro = g_estadoGL.evitadas;
 
-    glutSwapBuffers();
+    {
+        PERF_ESCOPO("quadro.swap");
+        glutSwapBuffers();
+    }
+    g_fimUltimoQuadro = chrono::steady_clock::now();
+    registrarQuadroHistorico(inicio, g_fimUltimoQuadro);
+
+    if (g_redesenhoContinuo || g_paginasPendentes) solicitarRedesenho();
 }
 
 // Ajusta viewport quando a janela é redimensionada
 static void reshape(int w, int h) {
+    const EstadoVista antes = estadoVista();
     g_width = (w <= 0 ? 1 : w);
     g_height = (h <= 0 ? 1 : h);
-    glViewport(0, 0, g_width, g_height);
+    g_projecaoValida = false;   // viewport e projeção no próximo quadro
+    redesenharSeMudou(antes);
+}
+
+// Sai do programa; com carga em andamento não espera a thread terminar o arquivo
+static void encerrar() {
+    if (!g_caminhoTrace.empty()) gravarTracePerf(g_caminhoTrace);
+    if (g_carga.ativa || g_recarga.ativa) {
+        cout.flush();
+        quick_exit(0);
+    }
+    exit(0);
 }
 
 // Interação via teclado
 static void onKeyboard(unsigned char key, int, int) {
+    const EstadoVista antes = estadoVista();
     switch (key) {
         case 'w': case 'W': g_ty += 0.1f; break;
         case 's': case 'S': g_ty -= 0.1f; break;
@@ -305,14 +966,19 @@ static void onKeyboard(unsigned char key, int, int) {
         case 'x': case 'X': g_rz += 5.0f; break;
         case 'r': case 'R': resetTransform(); break;
         case 't': case 'T': g_texEnabled = !g_texEnabled; break; // textura ON/OFF
-        case 27: /* ESC */ exit(0);
+        case 'p': case 'P': g_painelPerf = !g_painelPerf; break;
+        case 27: /* ESC */
+            cout << "Quadros desenhados: " << g_quadrosDesenhados << " | pulados: " << g_pedidosAbsorvidos + g_eventosSemMudanca
+                 << " (" << g_pedidosAbsorvidos << " pedidos absorvidos, " << g_eventosSemMudanca << " eventos sem mudanca)\n";
+            encerrar();
         default: break;
     }
-    glutPostRedisplay();
+    redesenharSeMudou(antes);
 }
 
 // Interação via teclas especiais (setas, PgUp, PgDn, etc)
 static void onSpecial(int key, int, int) {
+    const EstadoVista antes = estadoVista();
     switch (key) {
         case GLUT_KEY_LEFT:  g_ry -= 5.0f; break;
         case GLUT_KEY_RIGHT: g_ry += 5.0f; break;
@@ -322,23 +988,49 @@ static void onSpecial(int key, int, int) {
         case GLUT_KEY_PAGE_DOWN: g_rz -= 5.0f; break;
         default: break;
     }
-    glutPostRedisplay();
+    redesenharSeMudou(antes);
+}
+
+// Lança um raio pelo pixel (x, y) com as matrizes do último quadro e seleciona o triângulo atingido
+static void selecionarTriangulo(int x, int y) {
+    if (!g_objLoaded || g_bvh.vazia()) return;
+    GLdouble perto[3], longe[3];
+    const GLdouble yGL = g_viewport[3] - 1 - y;
+    if (!gluUnProject(x, yGL, 0.0, g_modelview, g_projecao, g_viewport, &perto[0], &perto[1], &perto[2]) ||
+        !gluUnProject(x, yGL, 1.0, g_modelview, g_projecao, g_viewport, &longe[0], &longe[1], &longe[2])) return;
+    const float origem[3] = { (float)perto[0], (float)perto[1], (float)perto[2] };
+    const float direcao[3] = { (float)(longe[0] - perto[0]), (float)(longe[1] - perto[1]), (float)(longe[2] - perto[2]) };
+
+    const auto t0 = chrono::steady_clock::now();
+    const VisaoMalhaOBJ v = visaoObj();
+    g_temPick = intersectarRaio(g_bvh, v.vertices, v.triangulos, origem, direcao, g_pick);
+    const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    if (g_temPick) {
+        const CantoTri* c = &v.triangulos[(size_t)g_pick.triangulo * 3u];
+        cout << "Pick: triangulo " << g_pick.triangulo << " (vertices " << c[0].v << ", " << c[1].v << ", " << c[2].v
+             << ") em " << ms << " ms\n";
+    } else {
+        cout << "Pick: nenhum triangulo (" << ms << " ms)\n";
+    }
 }
 
 // Interação via mouse
 static void onMouse(int button, int state, int x, int y) {
+    const EstadoVista antes = estadoVista();
     if (button == GLUT_LEFT_BUTTON) g_lmb_down = (state == GLUT_DOWN);
     if (button == GLUT_RIGHT_BUTTON) g_rmb_down = (state == GLUT_DOWN);
     if (state == GLUT_DOWN) {
         if (button == 3) g_tz += 0.1f; // scroll up aproxima
         if (button == 4) g_tz -= 0.1f; // scroll down afasta
     }
+    if (button == GLUT_MIDDLE_BUTTON && state == GLUT_DOWN) selecionarTriangulo(x, y);
     g_last_x = x; g_last_y = y;
-    glutPostRedisplay();
+    redesenharSeMudou(antes);
 }
 
 // Mouse arrastando
 static void onMotion(int x, int y) {
+    const EstadoVista antes = estadoVista();
     const int dx = x - g_last_x;
     const int dy = y - g_last_y;
     if (g_lmb_down) {
@@ -351,48 +1043,659 @@ static void onMotion(int x, int y) {
         g_ty -= dy * sens;
     }
     g_last_x = x; g_last_y = y;
-    glutPostRedisplay();
+    redesenharSeMudou(antes);
 }
 
-static void onIdle() {
-    glutPostRedisplay();
+// Backend CPU: nada vai para a GPU, só os mapas dos materiais são decodificados (com mipmaps)
+static bool prepararModeloCPU() {
+    g_imagensCPU.clear();
+    g_imagemMaterialCPU.assign(g_obj.materiais.size(), -1);
+    vector<string> mapas;
+    vector<size_t> materialDoMapa;
+    for (size_t i = 0; i < g_obj.materiais.size(); ++i) {
+        if (g_obj.materiais[i].mapaDifusa.empty()) continue;
+        mapas.push_back(g_obj.materiais[i].mapaDifusa);
+        materialDoMapa.push_back(i);
+    }
+    if (mapas.empty()) return true;
+    vector<ImagemCarregada> imagens;
+    carregarImagens(mapas, [](uint64_t) { return false; }, imagens, g_threadsCPU);
+    map<uint64_t, int> porHash;
+    for (ImagemCarregada& im : imagens) {
+        if (!im.decodificada) continue;
+        porHash[im.hash] = (int)g_imagensCPU.size();
+        g_imagensCPU.push_back(move(im.imagem));
+    }
+    for (size_t k = 0; k < imagens.size(); ++k) {
+        auto it = imagens[k].lida ? porHash.find(imagens[k].hash) : porHash.end();
+        if (it != porHash.end()) g_imagemMaterialCPU[materialDoMapa[k]] = it->second;
+    }
+    cout << "Texturas (cpu): " << g_imagensCPU.size() << " decodificadas\n";
+    return true;
 }
 
-// Ponto de entrada: inicializa GLUT, registra callbacks, carrega o modelo e textura
-int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitWindowSize(g_width, g_height);
-    glutCreateWindow("Trabalho M1 - Rafael Mota e Kauan Adami");
-
-    // Define preenchimento por padrão
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-    // Declara callbacks
-    glutDisplayFunc(display);
-    glutReshapeFunc(reshape);
-    glutKeyboardFunc(onKeyboard);
-    glutSpecialFunc(onSpecial);
-    glutMouseFunc(onMouse);
-    glutMotionFunc(onMotion);
-    glutIdleFunc(onIdle);
-
-    // Carrega OBJ se existir
-    string caminho = (argc > 1 ? string(argv[1]) : string("data/elepham.obj"));
+// Cria o que o backend desenha a partir dos buffers já carregados: VBO, listas por cluster
+// ou a display list única
+static bool enviarModeloGPU() {
+    PERF_ESCOPO("carga.envio_gpu");
+    const VisaoMalhaOBJ visao = visaoObj();
+    const VisaoMalhaIndexada& malha = visao.indexada;
+    // Esfera envolvente (centro da caixa) para a escolha do nível de detalhe
+    float minimo[3] = { 0, 0, 0 }, maximo[3] = { 0, 0, 0 };
+    for (size_t v = 0; v < malha.numVertices(); ++v)
+        for (int k = 0; k < 3; ++k) {
+            const float x = malha.vertices[v * FLOATS_POR_VERTICE + k];
+            if (v == 0 || x < minimo[k]) minimo[k] = x;
+            if (v == 0 || x > maximo[k]) maximo[k] = x;
+        }
+    g_raioModelo = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        g_centroModelo[k] = 0.5f * (minimo[k] + maximo[k]);
+        g_raioModelo += 0.25f * (maximo[k] - minimo[k]) * (maximo[k] - minimo[k]);
+    }
+    g_raioModelo = sqrt(g_raioModelo);
+    g_temUVs = !visao.uvs.empty();
+    g_trisModelo = malha.numIndices() / 3;
+    if (g_backend == BackendRender::CPU) return prepararModeloCPU();
+    if (!g_obj.materiais.empty()) {
+        vector<string> mapas;
+        for (const MaterialOBJ& m : g_obj.materiais) mapas.push_back(m.mapaDifusa);
+        obterTexturas(g_texturas, mapas, g_texturasMateriais);
+        invalidarEstadoGL(g_estadoGL);
+    }
+
+    if (g_backend == BackendRender::VBO) {
+        const auto t0 = chrono::steady_clock::now();
+        const bool ok = enviarMalhaVBO(malha, g_vbo, g_compacto);
+        glFinish();
+        cout << "Upload VBO" << (g_compacto ? " compacto" : "") << ": "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count()
+             << " ms (" << (g_vbo.bytesVertices + malha.numIndices() * (malha.indices16Bits() ? 2 : 4)) / (1024.0 * 1024.0)
+             << " MB)\n";
+        return ok;
+    }
+    if (!malha.faixasMaterial.empty()) {
+        g_listasMateriais = criarDisplayListsMateriais(malha);
+        return g_listasMateriais != 0;
+    }
+    if (g_lod) g_listasLOD = criarDisplayListsLOD(malha);
+    if (g_culling && !g_bvh.vazia()) {
+        vector<uint32_t> inicioFaixas;
+        inicioFaixas.reserve(g_bvh.clusters.size() + 1);
+        for (const ClusterBVH& c : g_bvh.clusters) inicioFaixas.push_back(c.primeiroTri);
+        inicioFaixas.push_back((uint32_t)g_bvh.ordem.size());
+        g_listasClusters = criarDisplayListsFaixas(visao, g_bvh.ordemDesenho, inicioFaixas);
+        return g_listasClusters != 0;
+    }
+    criarDisplayListOBJ(visao, g_objList);
+    return g_objList != 0;
+}
+
+// Memória residente do processo (VmRSS) e o pico dela (VmHWM), em MB
+static bool lerMemoriaProcesso(double& atualMB, double& picoMB) {
+    ifstream f("/proc/self/status");
+    string linha;
+    int lidos = 0;
+    while (getline(f, linha)) {
+        if (linha.rfind("VmRSS:", 0) == 0) { atualMB = atof(linha.c_str() + 6) / 1024.0; ++lidos; }
+        else if (linha.rfind("VmHWM:", 0) == 0) { picoMB = atof(linha.c_str() + 6) / 1024.0; ++lidos; }
+    }
+    return lidos == 2;
+}
+
+static void imprimirMemoria(const char* momento) {
+    double atual = 0.0, pico = 0.0;
+    if (!lerMemoriaProcesso(atual, pico)) return;
+    cout << "Memoria (" << momento << ", formato " << (g_compacto ? "compacto" : "padrao") << "): RSS "
+         << atual << " MB, pico " << pico << " MB\n";
+}
+
+template <class T>
+static void liberarVetor(vector<T>& v) {
+    vector<T>().swap(v);
+}
+
+// Depois que a GPU tem o modelo, descarta as cópias em CPU que nada mais lê: normais, UVs e a
+// malha indexada (fica só a tabela de níveis de LOD). Posições e triângulos ficam para o pick
+// pela BVH; sem BVH também saem. No backend CPU fica tudo. Vinda do cache, a malha continua
+// mapeada, mas as páginas já lidas voltam ao sistema (o pick e o LOD as releem do arquivo).
+static void liberarCopiasCPU() {
+    if (g_backend == BackendRender::CPU) return;   // o rasterizador lê a malha indexada a cada quadro
+    liberarVetor(g_obj.indicesPos);
+    liberarVetor(g_obj.normaisCalculadas);
+    liberarVetor(g_obj.normaisOBJ);
+    liberarVetor(g_obj.uvs);
+    liberarVetor(g_obj.indexada.vertices);
+    liberarVetor(g_obj.indexada.indices16);
+    liberarVetor(g_obj.indexada.indices32);
+    liberarVetor(g_obj.indexada.indicesLOD);
+    if (g_bvh.vazia()) {
+        liberarVetor(g_obj.vertices);
+        liberarVetor(g_obj.triangulos);
+    }
+    if (g_obj.cache) aliviarCacheMalha(*g_obj.cache);
+    // Devolve ao sistema o que o malloc guardou dos vetores grandes
+    malloc_trim(0);
+}
+
+static bool ehCenario(const string& caminho) {
+    return caminho.size() > 5 && caminho.compare(caminho.size() - 5, 5, ".cena") == 0;
+}
+
+// Lê o .cena e cria os buffers de cada malha (sempre em VBO; culling e LOD não se aplicam)
+static bool carregarCenarioArquivo(const string& caminho, const OpcoesCarregamento& opcoes) {
+    DescricaoCenario desc;
+    if (!lerCenario(caminho, desc) || !carregarCenario(desc, opcoes, g_modoCenario, g_compacto, g_cenario)) return false;
+    g_temUVs = g_cenario.temUVs;
+    g_trisModelo = g_cenario.triangulos;
+    return true;
+}
+
+static bool terminaCom(const string& s, const char* sufixo) {
+    const size_t n = strlen(sufixo);
+    return s.size() >= n && s.compare(s.size() - n, n, sufixo) == 0;
+}
+
+// Orçamento dos blocos residentes: --orcamento-mb menos uma base fixa (o RSS medido ao abrir o
+// arquivo paginado, mais a margem do driver) e o bloco em trânsito. Os blocos contam só os
+// próprios bytes (MalhaPaginada::bytesResidentes), não o RSS, que cresce com cópias do driver
+// e memória que o malloc não devolveu. Sem espaço para um bloco residente e um em trânsito,
+// avisa quanto seria preciso e devolve false.
+static bool definirOrcamentoPaginado() {
+    const double mb = 1024.0 * 1024.0;
+    double pico = 0.0;
+    if (!lerMemoriaProcesso(g_rssPaginadoMB, pico)) g_rssPaginadoMB = 0.0;
+    g_basePaginadoBytes = (size_t)(g_rssPaginadoMB * mb) + MARGEM_DRIVER_PAGINADO;
+    const size_t orcamento = g_orcamentoMB << 20;
+    const size_t minimo = g_basePaginadoBytes + 2 * g_paginas.maiorBloco;
+    if (orcamento < minimo) {
+        cerr << "Erro: --orcamento-mb=" << g_orcamentoMB << " nao comporta o processo (" << g_basePaginadoBytes / mb
+             << " MB com a margem) e dois blocos de " << g_paginas.maiorBloco / mb << " MB; use --orcamento-mb="
+             << (minimo + (1u << 20) - 1) / (1u << 20) << " ou mais\n";
+        return false;
+    }
+    g_paginas.orcamentoBytes = orcamento - g_basePaginadoBytes - g_paginas.maiorBloco;
+    cout << "Orcamento paginado: " << g_paginas.orcamentoBytes / mb << " MB para blocos (base "
+         << g_basePaginadoBytes / mb << " MB)\n";
+    return true;
+}
+
+static void amostrarMemoriaPaginada() {
+    double pico = 0.0;
+    if (!lerMemoriaProcesso(g_rssPaginadoMB, pico) || g_avisouRSSPaginado || g_rssPaginadoMB <= (double)g_orcamentoMB) return;
+    g_avisouRSSPaginado = true;
+    cerr << "Aviso: RSS de " << g_rssPaginadoMB << " MB passou de --orcamento-mb=" << g_orcamentoMB
+         << " (memoria do driver alem da base de " << g_basePaginadoBytes / (1024.0 * 1024.0) << " MB)\n";
+}
+
+// Modo --paginado: converte o OBJ (se o arquivo paginado não existe ou ficou velho) com a
+// memória que sobra do orçamento e abre o resultado; também aceita um .paginas direto
+static bool carregarPaginado(const string& caminho, const OpcoesCarregamento& opcoes) {
+    const bool direto = terminaCom(caminho, ".paginas");
+    const string arquivo = direto ? caminho : caminhoMalhaPaginada(caminho, opcoes.dirCache);
+    const size_t orcamento = g_orcamentoMB << 20;
+    double rss = 0.0, pico = 0.0;
+    if (!abrirMalhaPaginada(arquivo, direto ? string() : caminho, g_paginas)) {
+        if (direto) {
+            cerr << "Arquivo paginado invalido: " << caminho << "\n";
+            return false;
+        }
+        lerMemoriaProcesso(rss, pico);
+        OpcoesPaginacao op;
+        const size_t usado = (size_t)(rss * 1024.0 * 1024.0) + MARGEM_DRIVER_PAGINADO;
+        op.memoriaBytes = orcamento > usado + (32u << 20) ? orcamento - usado : 32u << 20;
+        if (!converterOBJParaPaginado(caminho, arquivo, op) || !abrirMalhaPaginada(arquivo, caminho, g_paginas))
+            return false;
+        malloc_trim(0);
+    }
+    if (!definirOrcamentoPaginado()) {
+        fecharMalhaPaginada(g_paginas);
+        return false;
+    }
+    g_avisouRSSPaginado = false;
+    g_visiveisForaAvisados = 0;
+    g_paginas.compacto = g_compacto;
+    g_temUVs = g_paginas.temUVs;
+    g_trisModelo = g_paginas.triangulos;
+    return true;
+}
+
+// Modo --observar: assume o modelo lido (na carga ou numa recarga) e atualiza só os trechos
+// que mudaram na GPU. Os buffers globais ficam em CPU para a próxima recarga.
+static void assumirModeloObservado(ModeloSecoes& novo, const ResumoRecarga& resumo) {
+    swap(g_modeloObservado, novo);
+    novo = ModeloSecoes();
+    const MalhaOBJ& m = g_modeloObservado.malha;
+    g_obj.materiais = m.materiais;
+    g_temUVs = !m.uvs.empty();
+    g_trisModelo = m.triangulos.size() / 3;
+    if (!m.materiais.empty()) {
+        vector<string> mapas;
+        for (const MaterialOBJ& mat : m.materiais) mapas.push_back(mat.mapaDifusa);
+        obterTexturas(g_texturas, mapas, g_texturasMateriais);
+        invalidarEstadoGL(g_estadoGL);
+    }
+    const auto t0 = chrono::steady_clock::now();
+    const size_t enviados = atualizarModeloSecoesGPU(g_gpuObservado, g_modeloObservado, g_backend == BackendRender::VBO, g_compacto);
+    glFinish();
+    const double envioMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    liberarIndexadasSecoes(g_modeloObservado);
+
+    ostringstream ss;
+    ss << resumo.ms + envioMs << " ms (" << resumo.relidas << " de " << g_modeloObservado.secoes.size()
+       << " trechos relidos, " << resumo.reindexadas << " reindexados, " << enviados << " enviados)";
+    g_resumoRecarga = ss.str();
+}
+
+// Leitura inicial do modo --observar (sem modelo anterior: lê e envia todos os trechos)
+static bool carregarObservado(const string& caminho, const OpcoesCarregamento& opcoes) {
+    ModeloSecoes novo;
+    ResumoRecarga resumo;
+    if (!carregarModeloSecoes(caminho, nullptr, novo, resumo, opcoes.numThreads)) return false;
+    g_caminhoObservado = caminho;
+    assumirModeloObservado(novo, resumo);
+    cout << "OBJ carregado (--observar): " << caminho << " | V: " << g_modeloObservado.malha.vertices.size() / 3
+         << " | Tris: " << g_trisModelo << " | " << g_modeloObservado.secoes.size() << " trechos | "
+         << g_resumoRecarga << "\n";
+    return true;
+}
+
+// Carrega o OBJ ou o cenário (e envia para a GPU no backend VBO); devolve o tempo total em ms
+static double carregarModelo(const string& caminho, OpcoesCarregamento opcoes) {
+    const auto tCarga = chrono::steady_clock::now();
+
+    if (ehCenario(caminho)) {
+        g_cenarioCarregado = g_objLoaded = carregarCenarioArquivo(caminho, opcoes);
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - tCarga).count();
+    }
+    if (g_paginado && arquivoExiste(caminho)) {
+        g_objLoaded = carregarPaginado(caminho, opcoes);
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - tCarga).count();
+    }
+
+    if (g_observar && arquivoExiste(caminho)) {
+        g_objLoaded = carregarObservado(caminho, opcoes);
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - tCarga).count();
+    }
+
     if (arquivoExiste(caminho)) {
-        // Usa o módulo obj_loader para ler v/vt/vn e criar a display list
-        g_objLoaded = carregarOBJParaDisplayList(
-            caminho,
-            g_vertices, g_indices, g_vnormals, g_onormals, g_texcoords, g_triangulos,
-            g_objList
-        );
+        // Usa o módulo obj_loader para ler v/vt/vn; a GPU recebe o modelo em enviarModeloGPU
+        g_objLoaded = carregarMalhaOBJ(caminho, g_obj, opcoes, &g_arenaCarga, &g_bvh);
+        if (g_objLoaded) g_objLoaded = enviarModeloGPU();
+        if (g_objLoaded) liberarCopiasCPU();
     } else {
         cerr << "Arquivo OBJ nao encontrado: " << caminho << " (mostrando cubo de teste)\n";
     }
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - tCarga).count();
+}
+
+// Fim da carga assíncrona: assume os buffers da thread e cria a display list ou o VBO
+static void concluirCargaAssincrona() {
+    g_objLoaded = finalizarCargaAssincrona(g_carga);
+    liberarLotesPrevia(g_lotesPrevia);
+    g_trisPrevia = 0;
+    if (g_objLoaded) {
+        swap(g_obj, g_carga.obj);
+        swap(g_bvh, g_carga.bvh);
+        g_objLoaded = enviarModeloGPU();
+        if (g_objLoaded) liberarCopiasCPU();
+    }
+    if (g_objLoaded) glGenQueries(2, g_consultaTempo);
+    cout << "Carga assincrona: " << chrono::duration<double, milli>(chrono::steady_clock::now() - g_inicioCarga).count()
+         << " ms ate o modelo completo\n";
+    imprimirMemoria("modelo carregado");
+    imprimirFasesCarga();
+}
+
+// Timer da carga: envia os lotes novos para a GPU e, no fim, troca a prévia pelo modelo
+static void aoTimerCarga(int) {
+    vector<vector<float>> lotes;
+    retirarLotesPrevia(g_carga, lotes);
+    for (const vector<float>& l : lotes) {
+        LotePrevia lp;
+        if (enviarLotePrevia(l, lp)) { g_lotesPrevia.push_back(lp); g_trisPrevia += (size_t)lp.numVertices / 3; }
+    }
+    if (g_carga.terminou) concluirCargaAssincrona();
+    else glutTimerFunc(MS_VERIFICAR_CARGA, aoTimerCarga, 0);
+    // Overlay de progresso (e a prévia) mudam a cada verificação
+    solicitarRedesenho();
+}
+
+// Fim de uma recarga do modo --observar: troca o modelo (ou mantém o anterior se a leitura
+// falhou, ex.: arquivo salvo pela metade) e começa outra se o arquivo mudou nesse meio tempo
+static void concluirRecarga(int numThreads) {
+    if (finalizarRecarga(g_recarga)) {
+        assumirModeloObservado(g_recarga.novo, g_recarga.resumo);
+        cout << "Recarga: " << g_resumoRecarga << "\n";
+    } else {
+        g_recarga.novo = ModeloSecoes();
+        cerr << "Recarga falhou; mantendo o modelo anterior\n";
+    }
+    if (g_recargaPendente) {
+        g_recargaPendente = false;
+        iniciarRecarga(g_recarga, g_caminhoObservado, g_modeloObservado, numThreads);
+    }
+    solicitarRedesenho();
+}
+
+// Timer do modo --observar: consulta o inotify e acompanha a recarga em andamento
+static void aoTimerObservar(int numThreads) {
+    if (arquivoMudou(g_observador)) {
+        if (g_recarga.ativa) g_recargaPendente = true;
+        else iniciarRecarga(g_recarga, g_caminhoObservado, g_modeloObservado, numThreads);
+        solicitarRedesenho();   // "recarregando..." no overlay
+    }
+    if (g_recarga.ativa && g_recarga.terminou) concluirRecarga(numThreads);
+    glutTimerFunc(MS_OBSERVAR, aoTimerObservar, numThreads);
+}
+
+// Um quadro dos modos sem janela: a cena no framebuffer offscreen, ou o quadro da CPU
+static void desenharQuadroSemJanela() {
+    zerarContagemGL(g_estadoGL);
+    if (g_backend == BackendRender::CPU) rasterizarQuadroCPU();
+    else desenharCena();
+    g_trocasGLQuadro = g_estadoGL.trocas;
+    g_evitadasGLQuadro = g_estadoGL.evitadas;
+}
+
+// Grava o quadro atual do bench (framebuffer offscreen ou o quadro da CPU)
+static bool gravarQuadroBench(const string& caminho) {
+    if (g_backend == BackendRender::CPU)
+        return gravarImagemRGBA(caminho, g_quadroCPU.largura, g_quadroCPU.altura, g_quadroCPU.cor.data());
+    vector<uint8_t> rgba((size_t)g_width * g_height * 4u);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, g_width, g_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    return gravarImagemRGBA(caminho, g_width, g_height, rgba.data());
+}
+
+// Modo --bench: desenha N quadros num framebuffer offscreen seguindo uma órbita
+// (g_ry de 0 a 360 graus, com a mesma transformação de display()) e imprime as
+// estatísticas em JSON. Gizmo e overlay de texto ficam de fora (dependem do GLUT).
+// No backend CPU não há contexto GL: cada quadro é só o rasterizarQuadroCPU().
+static int executarBench(const string& caminho, const OpcoesCarregamento& opcoes,
+                         int quadros, const string& saidaJson, const string& saidaImagem) {
+    const bool cpu = g_backend == BackendRender::CPU;
+    ContextoOffscreen ctx;
+    if (!cpu && !criarContextoOffscreen(g_width, g_height, ctx)) return 1;
+
+    const double cargaMs = carregarModelo(caminho, opcoes);
+    // Paginado recusado (orçamento pequeno demais, arquivo inválido): medir o cubo enganaria
+    if (g_paginado && !g_objLoaded && arquivoExiste(caminho)) return 1;
+    criarTexturaXadrez();
+    imprimirFasesCarga();
+
+    resetTransform();
+    g_rx = 20.0f;
+
+    // Alguns quadros de aquecimento fora da medição (compilação de shaders do driver etc.);
+    // no modo paginado, até os blocos da vista inicial estarem residentes
+    int aquecimento = 0;
+    for (; aquecimento < 3 || (g_paginasPendentes && aquecimento < 1000); ++aquecimento) {
+        desenharQuadroSemJanela();
+        if (!cpu) glFinish();
+    }
+
+    vector<double> tempos; tempos.reserve((size_t)quadros);
+    double somaTrisVisiveis = 0.0, somaEnvioMs = 0.0, somaChamadas = 0.0, somaTrocasGL = 0.0, somaEvitadasGL = 0.0;
+    for (int i = 0; i < quadros; ++i) {
+        g_ry = 360.0f * (float)i / (float)quadros;
+        const auto t0 = chrono::steady_clock::now();
+        desenharQuadroSemJanela();
+        // Até aqui só a CPU trabalhou (montagem e envio dos comandos); o glFinish espera a GPU
+        somaEnvioMs += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        if (!cpu) glFinish();
+        tempos.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count());
+        if (i == 0 && !saidaImagem.empty() && gravarQuadroBench(saidaImagem)) cout << "Quadro 0: " << saidaImagem << "\n";
+        somaTrisVisiveis += g_trisVisiveis;
+        somaChamadas += g_chamadasDesenho;
+        somaTrocasGL += g_trocasGLQuadro;
+        somaEvitadasGL += g_evitadasGLQuadro;
+    }
+
+    double soma = 0.0;
+    for (double t : tempos) soma += t;
+    vector<double> ordenados = tempos;
+    sort(ordenados.begin(), ordenados.end());
+    const double minimo = ordenados.empty() ? 0.0 : ordenados.front();
+    const double media = tempos.empty() ? 0.0 : soma / tempos.size();
+    const double p99 = ordenados.empty() ? 0.0 : ordenados[min(ordenados.size() - 1, (size_t)(0.99 * ordenados.size()))];
+    const size_t tris = g_objLoaded ? g_trisModelo : 12;
+    double rssMB = 0.0, rssPicoMB = 0.0;
+    lerMemoriaProcesso(rssMB, rssPicoMB);
+    // Fases da carga e média por quadro das fases do desenho
+    ostringstream fases;
+    for (const TotalFasePerf& f : totaisFasesPerf()) {
+        const bool deQuadro = f.nome.rfind("quadro", 0) == 0;
+        fases << (fases.tellp() > 0 ? ", " : "") << "\"" << f.nome << "\": "
+              << (deQuadro ? f.ms / (quadros + aquecimento) : f.ms);
+    }
+
+    ostringstream renderer;
+    if (cpu) renderer << "cpu (" << numThreadsEfetivo(g_threadsCPU) << " threads)";
+    else renderer << glGetString(GL_RENDERER);
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"modelo\": \"" << caminho << "\",\n"
+         << "  \"backend\": \"" << nomeBackend() << "\",\n"
+         << "  \"renderer\": \"" << renderer.str() << "\",\n"
+         << "  \"largura\": " << g_width << ",\n"
+         << "  \"altura\": " << g_height << ",\n"
+         << "  \"quadros\": " << quadros << ",\n"
+         << "  \"triangulos\": " << tris << ",\n"
+         << "  \"culling\": " << (g_culling && !g_bvh.vazia() ? "true" : "false") << ",\n"
+         << "  \"lod\": " << (g_lod && !visaoObj().indexada.niveisLOD.empty() ? "true" : "false") << ",\n"
+         << "  \"triangulos_desenhados_media\": " << somaTrisVisiveis / quadros << ",\n"
+         << "  \"instancias\": " << (g_cenarioCarregado ? g_cenario.numInstancias : (size_t)1) << ",\n"
+         << "  \"chamadas_desenho_media\": " << somaChamadas / quadros << ",\n"
+         << "  \"trocas_estado_gl_cache_media\": " << somaTrocasGL / quadros << ",\n"
+         << "  \"evitadas_estado_gl_cache_media\": " << somaEvitadasGL / quadros << ",\n"
+         << "  \"envio_cpu_ms_media\": " << somaEnvioMs / quadros << ",\n"
+         << "  \"materiais\": " << g_obj.materiais.size() << ",\n"
+         << "  \"texturas\": " << g_texturas.porHash.size() << ",\n"
+         << "  \"compacto\": " << (g_compacto ? "true" : "false") << ",\n"
+         << "  \"paginado\": " << (g_paginas.fd >= 0 ? "true" : "false") << ",\n"
+         << "  \"paginado_visiveis_fora_orcamento\": " << g_paginas.visiveisForaOrcamento << ",\n"
+         << "  \"rss_mb\": " << rssMB << ",\n"
+         << "  \"rss_pico_mb\": " << rssPicoMB << ",\n"
+         << "  \"carga_ms\": " << cargaMs << ",\n"
+         << "  \"fases_ms\": { " << fases.str() << " },\n"
+         << "  \"quadro_ms\": { \"min\": " << minimo << ", \"media\": " << media << ", \"p99\": " << p99 << " },\n"
+         << "  \"triangulos_por_s\": " << (media > 0 ? tris / (media / 1000.0) : 0.0) << "\n"
+         << "}\n";
+
+    if (saidaJson.empty()) {
+        cout << json.str();
+    } else {
+        ofstream f(saidaJson);
+        f << json.str();
+        cout << "Resultado do bench: " << saidaJson << "\n";
+    }
+    if (!g_caminhoTrace.empty()) gravarTracePerf(g_caminhoTrace);
+    if (!cpu) destruirContextoOffscreen(ctx);
+    return 0;
+}
+
+// Modo --turntable: uma volta completa em g_ry (a mesma órbita do bench) em N quadros,
+// gravados como imagens ou vídeo cru. A leitura passa pelo anel de PBOs e a codificação roda
+// em threads de fundo; numPBOs = 0 lê cada quadro com glReadPixels síncrono, para comparação.
+static int executarTurntable(const string& caminho, const OpcoesCarregamento& opcoes,
+                             int quadros, const string& saida, int numPBOs) {
+    const bool cpu = g_backend == BackendRender::CPU;
+    ContextoOffscreen ctx;
+    if (!cpu && !criarContextoOffscreen(g_width, g_height, ctx)) return 1;
+
+    carregarModelo(caminho, opcoes);
+    criarTexturaXadrez();
+    resetTransform();
+    g_rx = 20.0f;
+    for (int i = 0; i < 3 || (g_paginasPendentes && i < 1000); ++i) {
+        desenharQuadroSemJanela();
+        if (!cpu) glFinish();
+    }
+
+    CapturaQuadros captura;
+    if (!iniciarCaptura(captura, saida, g_width, g_height, cpu ? 0 : numPBOs, opcoes.numThreads)) return 1;
+    vector<uint8_t> sincrono;
+    double desenhoMs = 0.0;
+    const auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < quadros; ++i) {
+        g_ry = 360.0f * (float)i / (float)quadros;
+        const auto td = chrono::steady_clock::now();
+        desenharQuadroSemJanela();
+        desenhoMs += chrono::duration<double, milli>(chrono::steady_clock::now() - td).count();
+        if (cpu) {
+            capturarQuadroRGBA(captura, i, g_quadroCPU.cor.data());
+        } else if (numPBOs > 0) {
+            capturarQuadro(captura, i);
+        } else {
+            PERF_ESCOPO("captura.leitura");
+            sincrono.resize((size_t)g_width * g_height * 4u);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, g_width, g_height, GL_RGBA, GL_UNSIGNED_BYTE, sincrono.data());
+            capturarQuadroRGBA(captura, i, sincrono.data());
+        }
+    }
+    const bool ok = encerrarCaptura(captura);
+    const double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    cout << "Turntable: " << captura.gravados << " quadros " << g_width << "x" << g_height << " em " << totalMs
+         << " ms (" << quadros / (totalMs / 1000.0) << " quadros/s; " << desenhoMs / quadros << " ms de desenho por quadro) -> "
+         << saida << "\n"
+         << "  leitura " << (cpu ? "da memoria" : numPBOs > 0 ? "por " + to_string(numPBOs) + " PBOs" : string("sincrona"))
+         << ": espera " << captura.esperaLeituraMs << " ms; fila cheia: " << captura.esperaFilaMs << " ms\n";
+    if (!g_caminhoTrace.empty()) gravarTracePerf(g_caminhoTrace);
+    if (!cpu) destruirContextoOffscreen(ctx);
+    return ok ? 0 : 1;
+}
+
+// Ponto de entrada: inicializa GLUT, registra callbacks, carrega o modelo e textura
+int main(int argc, char** argv) {
+    // Os modos --bench e --turntable rodam sem janela; só inicializa o GLUT fora deles
+    bool bench = false;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg == "--bench" || arg.rfind("--bench=", 0) == 0 || arg == "--turntable" || arg.rfind("--turntable=", 0) == 0)
+            bench = true;
+    }
+
+    if (!bench) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(g_width, g_height);
+        glutCreateWindow("Trabalho M1 - Rafael Mota e Kauan Adami");
+
+        // Define preenchimento por padrão
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        // Declara callbacks
+        glutDisplayFunc(display);
+        glutReshapeFunc(reshape);
+        glutKeyboardFunc(onKeyboard);
+        glutSpecialFunc(onSpecial);
+        glutMouseFunc(onMouse);
+        glutMotionFunc(onMotion);
+        glutCloseFunc(encerrar);
+        // Sem glutIdleFunc: o laço do GLUT dorme até chegar um evento ou timer
+    }
+
+    // Opções de linha de comando (o argumento sem "--" é o caminho do OBJ)
+    string caminho = "data/elepham.obj";
+    OpcoesCarregamento opcoes;
+    int quadrosBench = 300;
+    int vsync = -1;   // -1 = padrão do driver
+    string saidaBench, saidaImagem;
+    int quadrosTurntable = 0;   // 0 = sem --turntable
+    string saidaTurntable = "turntable";
+    int pbosTurntable = 3;
+    bool sincrono = false;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg == "--parser=stream") opcoes.modo = ModoLeituraOBJ::Stream;
+        else if (arg == "--parser=mmap") opcoes.modo = ModoLeituraOBJ::Mmap;
+        else if (arg == "--parser=paralelo") opcoes.modo = ModoLeituraOBJ::Paralelo;
+        else if (arg.rfind("--threads=", 0) == 0) opcoes.numThreads = atoi(arg.c_str() + 10);
+        else if (arg == "--render=lista") g_backend = BackendRender::Lista;
+        else if (arg == "--render=vbo") g_backend = BackendRender::VBO;
+        else if (arg == "--render=cpu") g_backend = BackendRender::CPU;
+        else if (arg == "--sem-cache") opcoes.usarCache = false;
+        else if (arg.rfind("--cache-dir=", 0) == 0) opcoes.dirCache = arg.substr(12);
+        else if (arg == "--sincrono") sincrono = true;
+        else if (arg == "--sem-culling") g_culling = false;
+        else if (arg == "--otimizar") opcoes.otimizarOrdem = true;
+        else if (arg == "--compacto") g_compacto = true;
+        else if (arg == "--perf") g_painelPerf = true;
+        else if (arg.rfind("--trace=", 0) == 0) g_caminhoTrace = arg.substr(8);
+        else if (arg == "--paginado") g_paginado = true;
+        else if (arg == "--observar") g_observar = true;
+        else if (arg.rfind("--orcamento-mb=", 0) == 0) g_orcamentoMB = (size_t)max(1, atoi(arg.c_str() + 15));
+        else if (arg == "--cena-modo=instancias") g_modoCenario = ModoCenario::Instancias;
+        else if (arg == "--cena-modo=lotes") g_modoCenario = ModoCenario::Lotes;
+        else if (arg == "--cena-modo=copias") g_modoCenario = ModoCenario::Copias;
+        else if (arg == "--sem-lod") { g_lod = false; opcoes.gerarLODs = false; }
+        else if (arg.rfind("--lod-erro=", 0) == 0) g_lodErroPixels = (float)atof(arg.c_str() + 11);
+        else if (arg == "--continuo") g_redesenhoContinuo = true;
+        else if (arg.rfind("--fps-max=", 0) == 0) g_fpsMax = atof(arg.c_str() + 10);
+        else if (arg == "--vsync") vsync = 1;
+        else if (arg == "--sem-vsync") vsync = 0;
+        else if (arg == "--bench") {}
+        else if (arg.rfind("--bench=", 0) == 0) quadrosBench = max(1, atoi(arg.c_str() + 8));
+        else if (arg.rfind("--bench-saida=", 0) == 0) saidaBench = arg.substr(14);
+        else if (arg.rfind("--saida-imagem=", 0) == 0) saidaImagem = arg.substr(15);
+        else if (arg == "--turntable") quadrosTurntable = 120;
+        else if (arg.rfind("--turntable=", 0) == 0) quadrosTurntable = max(1, atoi(arg.c_str() + 12));
+        else if (arg.rfind("--turntable-saida=", 0) == 0) saidaTurntable = arg.substr(18);
+        else if (arg.rfind("--turntable-pbos=", 0) == 0) pbosTurntable = max(0, atoi(arg.c_str() + 17));
+        else if (arg.rfind("--resolucao=", 0) == 0) {
+            int l = 0, a = 0;
+            if (sscanf(arg.c_str() + 12, "%dx%d", &l, &a) == 2 && l > 0 && a > 0) { g_width = l; g_height = a; }
+            else cerr << "Resolucao invalida: " << arg.substr(12) << " (use LARGURAxALTURA)\n";
+        }
+        else if (arg.rfind("--", 0) == 0) cerr << "Opcao desconhecida: " << arg << "\n";
+        else caminho = arg;
+    }
+    // A BVH (e a reordenação de triângulos/vértices de --otimizar) sai da carga, e do cache
+    opcoes.montarBVH = g_culling;
+
+    // O rasterizador desenha a malha indexada inteira: sem LOD, paginação, recarga ou cenários
+    if (g_backend == BackendRender::CPU) {
+        if (g_paginado || g_observar || ehCenario(caminho)) {
+            cerr << "--render=cpu nao suporta --paginado, --observar nem cenarios; usando vbo\n";
+            g_backend = BackendRender::VBO;
+        } else {
+            g_lod = false;
+            opcoes.gerarLODs = false;
+            g_threadsCPU = opcoes.numThreads;
+        }
+    }
+
+    // O bench sempre mede as fases (vão para o JSON)
+    configurarPerf(g_painelPerf || bench, !g_caminhoTrace.empty());
+    nomearThreadPerf("principal");
+
+    if (quadrosTurntable > 0) return executarTurntable(caminho, opcoes, quadrosTurntable, saidaTurntable, pbosTurntable);
+    if (bench) return executarBench(caminho, opcoes, quadrosBench, saidaBench, saidaImagem);
+
+    // Carrega OBJ se existir: em segundo plano (a janela já responde) ou antes do laço com --sincrono
+    if (sincrono || !arquivoExiste(caminho) || ehCenario(caminho) || g_paginado || g_observar) {
+        carregarModelo(caminho, opcoes);
+        if (g_objLoaded) glGenQueries(2, g_consultaTempo);
+        imprimirMemoria("modelo carregado");
+        imprimirFasesCarga();
+        if (g_observar && !g_caminhoObservado.empty() && iniciarObservador(g_observador, g_caminhoObservado))
+            glutTimerFunc(MS_OBSERVAR, aoTimerObservar, opcoes.numThreads);
+    } else {
+        g_inicioCarga = chrono::steady_clock::now();
+        g_carga.arena = &g_arenaCarga;
+        iniciarCargaAssincrona(g_carga, caminho, opcoes);
+        glutTimerFunc(MS_VERIFICAR_CARGA, aoTimerCarga, 0);
+    }
 
     // Cria textura de teste
     criarTexturaXadrez();
 
+    if (vsync >= 0) configurarVsync(vsync);
+    solicitarRedesenho();
+
     glutMainLoop();
     return 0;
 }
@@ -0,0 +1,160 @@
+#include "malha_lista.h"
+#include "layout_cantos.h"
+#include "perf.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+// Emite os cantos em modo imediato, especializado no layout: só as chamadas dos atributos que
+// a malha tem. Num canto sem vt (layout misto) a UV do canto anterior continua valendo.
+template <FonteNormal N, FonteUV T>
+static void emitirCantos(const float* vertices, const float* normaisCalculadas, const float* normaisOBJ,
+                         const float* uvs, const CantoTri* cantos, size_t nCantos) {
+    for (size_t i = 0; i < nCantos; ++i) {
+        const CantoTri& c = cantos[i];
+        if (N == FonteNormal::Calculada || (N == FonteNormal::Mista && c.vn < 0)) glNormal3fv(&normaisCalculadas[(size_t)c.v * 3u]);
+        else glNormal3fv(&normaisOBJ[(size_t)c.vn * 3u]);
+        if (T == FonteUV::OBJ || (T == FonteUV::Mista && c.vt >= 0)) glTexCoord2fv(&uvs[(size_t)c.vt * 2u]);
+        glVertex3fv(&vertices[(size_t)c.v * 3u]);
+    }
+}
+
+// Emite os triângulos (dentro de glBegin/glEnd ou de uma lista). Triângulos com algum canto
+// sem posição são descartados, como na malha indexada.
+static void emitirTriangulos(
+    const float* vertices,
+    const float* normaisCalculadas,
+    const float* normaisOBJ, size_t nNormaisOBJ,
+    const float* uvs, size_t nUVs,
+    const CantoTri* triangulos, size_t nTriangulos
+) {
+    nTriangulos -= nTriangulos % 3;
+    const LayoutCantos layout = analisarCantos(triangulos, nTriangulos, nNormaisOBJ, nUVs);
+    vector<CantoTri> validos;
+    if (!layout.posicoesValidas) {
+        for (size_t i = 0; i < nTriangulos; i += 3)
+            if (triangulos[i].v >= 0 && triangulos[i+1].v >= 0 && triangulos[i+2].v >= 0)
+                validos.insert(validos.end(), triangulos + i, triangulos + i + 3);
+        triangulos = validos.data();
+        nTriangulos = validos.size();
+    }
+    comLayout(layout, [&](auto normal, auto uv) {
+        emitirCantos<decltype(normal)::value, decltype(uv)::value>(vertices, normaisCalculadas, normaisOBJ, uvs,
+                                                                     triangulos, nTriangulos);
+    });
+}
+
+// Display list só com a geometria, usando vn/vt quando existem.
+static void construirDisplayList(
+    const float* vertices,
+    const float* normaisCalculadas,
+    const float* normaisOBJ, size_t nNormaisOBJ,
+    const float* uvs, size_t nUVs,
+    const CantoTri* triangulos, size_t nTriangulos,
+    GLuint& displayListOut
+) {
+    if (displayListOut != 0) {
+        glDeleteLists(displayListOut, 1);
+        displayListOut = 0;
+    }
+    displayListOut = glGenLists(1);
+    glNewList(displayListOut, GL_COMPILE);
+    glBegin(GL_TRIANGLES);
+    emitirTriangulos(vertices, normaisCalculadas, normaisOBJ, nNormaisOBJ, uvs, nUVs, triangulos, nTriangulos);
+    glEnd();
+    glEndList();
+}
+
+// Compila a display list e informa o tempo gasto (o glEndList só retorna com a lista pronta)
+static void construirDisplayListMedindo(
+    const float* vertices,
+    const float* normaisCalculadas,
+    const float* normaisOBJ, size_t nNormaisOBJ,
+    const float* uvs, size_t nUVs,
+    const CantoTri* triangulos, size_t nTriangulos,
+    GLuint& displayListOut
+) {
+    PERF_ESCOPO("carga.display_list");
+    const auto t0 = chrono::steady_clock::now();
+    construirDisplayList(vertices, normaisCalculadas, normaisOBJ, nNormaisOBJ, uvs, nUVs,
+                         triangulos, nTriangulos, displayListOut);
+    cout << "Display list: " << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() << " ms\n";
+}
+
+void criarDisplayListOBJ(const VisaoMalhaOBJ& malha, GLuint& displayListOut) {
+    construirDisplayListMedindo(malha.vertices.data(), malha.normaisCalculadas.data(),
+                                malha.normaisOBJ.data(), malha.normaisOBJ.size(), malha.uvs.data(), malha.uvs.size(),
+                                malha.triangulos.data(), malha.triangulos.size(), displayListOut);
+}
+
+GLuint criarDisplayListsFaixas(
+    const VisaoMalhaOBJ& malha,
+    const vector<uint32_t>& ordemTris,
+    const vector<uint32_t>& inicioFaixas
+) {
+    if (inicioFaixas.size() < 2) return 0;
+    PERF_ESCOPO("carga.display_list");
+    const auto t0 = chrono::steady_clock::now();
+    const GLsizei n = (GLsizei)(inicioFaixas.size() - 1);
+    const GLuint base = glGenLists(n);
+    vector<CantoTri> faixa;
+    for (GLsizei f = 0; f < n; ++f) {
+        faixa.clear();
+        for (uint32_t i = inicioFaixas[f]; i < inicioFaixas[f + 1]; ++i) {
+            const CantoTri* c = &malha.triangulos[(size_t)ordemTris[i] * 3u];
+            faixa.insert(faixa.end(), c, c + 3);
+        }
+        glNewList(base + (GLuint)f, GL_COMPILE);
+        glBegin(GL_TRIANGLES);
+        emitirTriangulos(malha.vertices.data(), malha.normaisCalculadas.data(), malha.normaisOBJ.data(),
+                         malha.normaisOBJ.size(), malha.uvs.data(), malha.uvs.size(), faixa.data(), faixa.size());
+        glEnd();
+        glEndList();
+    }
+    cout << "Display lists (" << n << " faixas): " << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() << " ms\n";
+    return base;
+}
+
+GLuint criarDisplayListsLOD(const VisaoMalhaIndexada& malha) {
+    if (malha.niveisLOD.empty()) return 0;
+    PERF_ESCOPO("carga.display_list");
+    const GLsizei n = (GLsizei)malha.niveisLOD.size();
+    const GLuint base = glGenLists(n);
+    for (GLsizei i = 0; i < n; ++i) {
+        const NivelLOD& nivel = malha.niveisLOD[i];
+        glNewList(base + (GLuint)i, GL_COMPILE);
+        glBegin(GL_TRIANGLES);
+        for (uint32_t k = nivel.primeiroIndice; k < nivel.primeiroIndice + nivel.numIndices; ++k) {
+            const float* v = &malha.vertices[(size_t)malha.indicesLOD[k] * FLOATS_POR_VERTICE];
+            glNormal3fv(v + 3);
+            glTexCoord2fv(v + 6);
+            glVertex3fv(v);
+        }
+        glEnd();
+        glEndList();
+    }
+    return base;
+}
+
+GLuint criarDisplayListsMateriais(const VisaoMalhaIndexada& malha) {
+    if (malha.faixasMaterial.empty()) return 0;
+    PERF_ESCOPO("carga.display_list");
+    const GLsizei n = (GLsizei)malha.faixasMaterial.size();
+    const GLuint base = glGenLists(n);
+    for (GLsizei i = 0; i < n; ++i) {
+        const FaixaMaterial& f = malha.faixasMaterial[i];
+        glNewList(base + (GLuint)i, GL_COMPILE);
+        glBegin(GL_TRIANGLES);
+        for (uint32_t k = f.primeiroIndice; k < f.primeiroIndice + f.numIndices; ++k) {
+            const float* v = &malha.vertices[(size_t)malha.indice(k) * FLOATS_POR_VERTICE];
+            glNormal3fv(v + 3);
+            glTexCoord2fv(v + 6);
+            glVertex3fv(v);
+        }
+        glEnd();
+        glEndList();
+    }
+    return base;
+}
@@ -0,0 +1,35 @@
+// Envio de uma MalhaOBJ (obj_loader.h) para display lists do OpenGL em modo imediato, com
+// normal e UV por canto. Separado da carga para que ela rode sem contexto GL; todas as funções
+// aqui precisam de contexto corrente. A malha é lida por VisaoMalhaOBJ, então uma malha vinda
+// do cache é emitida direto das páginas mapeadas. As listas só têm a geometria: o estado de
+// material (preenchimento, sem culling, cor) fica por conta de quem desenha.
+
+#pragma once
+
+#include <GL/freeglut.h>
+#include <cstdint>
+#include <vector>
+
+#include "obj_loader.h"
+
+using namespace std;
+
+// Compila a display list do modelo inteiro (substitui a anterior em displayListOut, se houver)
+void criarDisplayListOBJ(const VisaoMalhaOBJ& malha, GLuint& displayListOut);
+
+// Compila uma display list por faixa de triângulos (ex.: clusters da BVH). A faixa f cobre
+// malha.triangulos[ordemTris[i]] para i em [inicioFaixas[f], inicioFaixas[f + 1]). Devolve a
+// primeira de inicioFaixas.size() - 1 listas consecutivas (0 se não houver faixas).
+GLuint criarDisplayListsFaixas(
+    const VisaoMalhaOBJ& malha,
+    const vector<uint32_t>& ordemTris,
+    const vector<uint32_t>& inicioFaixas
+);
+
+// Compila uma display list por nível de detalhe da malha indexada. Devolve a primeira de
+// niveisLOD.size() listas, ou 0 sem níveis.
+GLuint criarDisplayListsLOD(const VisaoMalhaIndexada& malha);
+
+// Compila uma display list por faixa de material da malha indexada. Devolve
+// a primeira de faixasMaterial.size() listas, ou 0 sem materiais.
+GLuint criarDisplayListsMateriais(const VisaoMalhaIndexada& malha);
@@ -0,0 +1,554 @@
+#include "malha_paginada.h"
+#include "cache_malha.h"
+#include "normais.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Layout do arquivo:
+//   CabecalhoPaginado (preenchido até TAMANHO_PAGINA)
+//   blocos: vértices + índices, cada bloco começando num múltiplo de TAMANHO_PAGINA
+//   tabela de BlocoPaginado (em deslocTabela)
+static const char MAGICA_PAGINADA[8] = { 'O','B','J','P','A','G','I','N' };
+static const size_t TAMANHO_PAGINA = 4096;
+
+struct CabecalhoPaginado {
+    char magica[8];
+    uint32_t versao;
+    uint32_t numBlocos;
+    uint64_t tamanhoOBJ;       // chave: tamanho do OBJ em bytes
+    int64_t mtimeOBJ;          // chave: mtime do OBJ em ns
+    uint64_t triangulos;
+    uint64_t deslocTabela;
+    CaixaAABB caixa;
+    uint32_t temUVs;
+    uint32_t reservado;
+};
+
+static size_t alinharPagina(size_t n) { return (n + TAMANHO_PAGINA - 1) & ~(TAMANHO_PAGINA - 1); }
+
+string caminhoMalhaPaginada(const string& caminhoOBJ, const string& dirCache) {
+    // Mesmo nome do cache binário, com outra extensão
+    const string cache = caminhoCacheMalha(caminhoOBJ, dirCache);
+    return cache.substr(0, cache.rfind('.')) + ".paginas";
+}
+
+// ---------------------------------------------------------------------------
+// Conversão
+// ---------------------------------------------------------------------------
+
+// Temporário gravado em sequência (com buffer próprio) e apagado no destrutor. O nome é
+// único (criarTemporarioAoLado), para duas conversões do mesmo modelo não se misturarem.
+struct ArquivoTemp {
+    string caminho;
+    FILE* f = nullptr;
+    uint64_t bytes = 0;
+    bool falhou = false;
+
+    bool criar(const string& base) {
+        f = criarTemporarioAoLado(base, caminho);
+        if (!f) {
+            cerr << "Falha ao criar temporario: " << base << "\n";
+            caminho.clear();
+            return false;
+        }
+        setvbuf(f, nullptr, _IOFBF, 1u << 20);
+        return true;
+    }
+    void escrever(const void* p, size_t n) {
+        if (fwrite(p, 1, n, f) != n) falhou = true;
+        bytes += n;
+    }
+    bool fechar() {
+        if (f && fclose(f) != 0) falhou = true;
+        f = nullptr;
+        if (falhou) cerr << "Falha ao gravar temporario: " << caminho << "\n";
+        return !falhou;
+    }
+    ~ArquivoTemp() {
+        if (f) fclose(f);
+        if (!caminho.empty()) unlink(caminho.c_str());
+    }
+};
+
+// Temporário mapeado para acesso aleatório. As páginas tocadas contam na memória residente do
+// processo; aliviar() as solta (o conteúdo continua no arquivo), mantendo o uso limitado.
+struct MapaTemp {
+    void* dados = nullptr;
+    size_t tamanho = 0;
+
+    bool mapear(const string& caminho, size_t bytes, bool escrita) {
+        tamanho = bytes;
+        if (bytes == 0) return true;
+        const int fd = open(caminho.c_str(), escrita ? O_RDWR : O_RDONLY);
+        if (fd < 0 || (escrita && ftruncate(fd, (off_t)bytes) != 0)) {
+            if (fd >= 0) close(fd);
+            cerr << "Falha ao mapear temporario: " << caminho << "\n";
+            return false;
+        }
+        void* m = mmap(nullptr, bytes, escrita ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) {
+            cerr << "Falha ao mapear temporario: " << caminho << "\n";
+            return false;
+        }
+        dados = m;
+        return true;
+    }
+    float* floats() const { return static_cast<float*>(dados); }
+    void aliviar() { if (dados) madvise(dados, tamanho, MADV_DONTNEED); }
+    ~MapaTemp() { if (dados) munmap(dados, tamanho); }
+};
+
+// Trecho de uma célula despejado no arquivo de células
+struct TrechoCelula {
+    uint64_t deslocamento;
+    uint32_t cantos;
+};
+
+// Grade uniforme com cerca de "celulas" células sobre a caixa; eixos achatados ficam com 1
+static void dimensionarGrade(const CaixaAABB& caixa, size_t celulas, int dims[3]) {
+    float ext[3], maior = 0.0f;
+    for (int k = 0; k < 3; ++k) { ext[k] = caixa.max[k] - caixa.min[k]; maior = max(maior, ext[k]); }
+    double volume = 1.0;
+    int eixos = 0;
+    for (int k = 0; k < 3; ++k)
+        if (ext[k] > maior * 1e-3f) { volume *= ext[k]; ++eixos; }
+    const double lado = eixos > 0 ? pow(volume / (double)max<size_t>(celulas, 1), 1.0 / eixos) : 1.0;
+    for (int k = 0; k < 3; ++k)
+        dims[k] = (ext[k] > maior * 1e-3f) ? max(1, min(1024, (int)ceil(ext[k] / lado))) : 1;
+}
+
+bool converterOBJParaPaginado(const string& caminhoOBJ, const string& caminhoSaida, const OpcoesPaginacao& opcoes) {
+    PERF_ESCOPO("carga.paginar");
+    const auto t0 = chrono::steady_clock::now();
+    const size_t memoria = max<size_t>(opcoes.memoriaBytes, 16u << 20);
+    const size_t trisPorBloco = max<uint32_t>(opcoes.trisPorBloco, 1024);
+
+    // Chave lida antes da leitura: se o OBJ mudar durante a conversão, o arquivo gravado fica
+    // com a chave antiga e é refeito na próxima abertura
+    ChaveCacheOBJ chave;
+    if (!lerChaveCacheOBJ(caminhoOBJ, chave)) {
+        cerr << "Falha ao abrir OBJ: " << caminhoOBJ << "\n";
+        return false;
+    }
+
+    // 1) Leitura em blocos: v/vn/vt e triângulos vão direto para temporários em disco
+    ArquivoTemp pos, nrm, uv, tri;
+    if (!pos.criar(caminhoSaida + ".v") || !nrm.criar(caminhoSaida + ".vn") || !uv.criar(caminhoSaida + ".vt")
+        || !tri.criar(caminhoSaida + ".f"))
+        return false;
+    CaixaAABB caixa{ { 0, 0, 0 }, { 0, 0, 0 } };
+    uint64_t nPos = 0, nNrm = 0, nUV = 0, nTri = 0;
+    bool algumSemVN = false;
+    LeitorOBJBlocos leitor;
+    leitor.aoVertice = [&](float x, float y, float z) {
+        const float p[3] = { x, y, z };
+        pos.escrever(p, sizeof(p));
+        for (int k = 0; k < 3; ++k) {
+            if (nPos == 0 || p[k] < caixa.min[k]) caixa.min[k] = p[k];
+            if (nPos == 0 || p[k] > caixa.max[k]) caixa.max[k] = p[k];
+        }
+        ++nPos;
+    };
+    leitor.aoNormal = [&](float x, float y, float z) {
+        const float n[3] = { x, y, z };
+        nrm.escrever(n, sizeof(n));
+        ++nNrm;
+    };
+    leitor.aoUV = [&](float u, float v) {
+        const float t[2] = { u, v };
+        uv.escrever(t, sizeof(t));
+        ++nUV;
+    };
+    leitor.aoTriangulo = [&](const CantoTri* t) {
+        // Mesma regra da malha indexada: triângulo com posição inválida é descartado
+        if (t[0].v < 0 || t[1].v < 0 || t[2].v < 0) return;
+        tri.escrever(t, 3 * sizeof(CantoTri));
+        for (int k = 0; k < 3; ++k) algumSemVN = algumSemVN || t[k].vn < 0;
+        ++nTri;
+    };
+    size_t bytesLidos = 0;
+    if (!lerOBJEmBlocos(caminhoOBJ, min<size_t>(memoria / 8, 16u << 20), leitor, bytesLidos)) return false;
+    if (!pos.fechar() || !nrm.fechar() || !uv.fechar() || !tri.fechar()) return false;
+    if (nTri == 0) {
+        cerr << "OBJ vazio ou sem faces: " << caminhoOBJ << "\n";
+        return false;
+    }
+    const double msLeitura = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+    MapaTemp mPos, mNrm, mUV, mNormaisCalc;
+    if (!mPos.mapear(pos.caminho, pos.bytes, false) || !mNrm.mapear(nrm.caminho, nrm.bytes, false) ||
+        !mUV.mapear(uv.caminho, uv.bytes, false)) return false;
+    // Normais calculadas (soma das normais de face por posição), só se algum canto não tem vn
+    ArquivoTemp acumulador;
+    if (algumSemVN) {
+        if (!acumulador.criar(caminhoSaida + ".n")) return false;
+        acumulador.fechar();
+        if (!mNormaisCalc.mapear(acumulador.caminho, (size_t)nPos * 3 * sizeof(float), true)) return false;
+    }
+    // Cada triângulo toca no máximo 3 páginas de cada mapa; a cada trisPorAlivio triângulos as
+    // páginas são soltas, o que limita os mapas a ~1/4 da memória
+    const size_t trisPorAlivio = max<size_t>(1, memoria / 4 / TAMANHO_PAGINA / 12);
+
+    // 2) Distribui os triângulos pela grade (pelo centróide), despejando as células no disco
+    //    sempre que os baldes em memória passam do limite
+    int dims[3];
+    dimensionarGrade(caixa, (size_t)((nTri + trisPorBloco - 1) / trisPorBloco), dims);
+    const size_t numCelulas = (size_t)dims[0] * dims[1] * dims[2];
+    float escalaGrade[3];
+    for (int k = 0; k < 3; ++k) {
+        const float ext = caixa.max[k] - caixa.min[k];
+        escalaGrade[k] = ext > 0.0f ? dims[k] / ext : 0.0f;
+    }
+    vector<vector<CantoTri>> baldes(numCelulas);
+    vector<vector<TrechoCelula>> trechos(numCelulas);
+    size_t cantosNosBaldes = 0;
+    const size_t limiteCantos = max<size_t>(memoria / 8 / sizeof(CantoTri), trisPorBloco * 3);
+    ArquivoTemp celulas;
+    if (!celulas.criar(caminhoSaida + ".cel")) return false;
+    auto despejar = [&]() {
+        for (size_t c = 0; c < numCelulas; ++c) {
+            if (baldes[c].empty()) continue;
+            trechos[c].push_back(TrechoCelula{ celulas.bytes, (uint32_t)baldes[c].size() });
+            celulas.escrever(baldes[c].data(), baldes[c].size() * sizeof(CantoTri));
+            vector<CantoTri>().swap(baldes[c]);
+        }
+        cantosNosBaldes = 0;
+    };
+
+    FILE* ft = fopen(tri.caminho.c_str(), "rb");
+    if (!ft) {
+        cerr << "Falha ao reabrir temporario: " << tri.caminho << "\n";
+        return false;
+    }
+    const float* P = mPos.floats();
+    float* N = mNormaisCalc.floats();
+    vector<CantoTri> lote(3 * 4096);
+    uint64_t processados = 0;
+    size_t lidos;
+    while ((lidos = fread(lote.data(), sizeof(CantoTri) * 3, lote.size() / 3, ft)) > 0) {
+        for (size_t i = 0; i < lidos; ++i) {
+            const CantoTri* t = &lote[i * 3];
+            const float* a = &P[(size_t)t[0].v * 3];
+            const float* b = &P[(size_t)t[1].v * 3];
+            const float* c = &P[(size_t)t[2].v * 3];
+            if (N) {
+                float n[3];
+                calcularNormalFace(a, b, c, n);
+                for (int k = 0; k < 3; ++k) {
+                    float* acc = &N[(size_t)t[k].v * 3];
+                    acc[0] += n[0]; acc[1] += n[1]; acc[2] += n[2];
+                }
+            }
+            size_t celula = 0;
+            for (int k = 2; k >= 0; --k) {
+                const float centro = (a[k] + b[k] + c[k]) / 3.0f;
+                const int ic = min(dims[k] - 1, max(0, (int)((centro - caixa.min[k]) * escalaGrade[k])));
+                celula = celula * (size_t)dims[k] + (size_t)ic;
+            }
+            baldes[celula].insert(baldes[celula].end(), t, t + 3);
+            cantosNosBaldes += 3;
+            if (++processados % trisPorAlivio == 0) { mPos.aliviar(); mNormaisCalc.aliviar(); }
+        }
+        if (cantosNosBaldes >= limiteCantos) despejar();
+    }
+    fclose(ft);
+    despejar();
+    vector<vector<CantoTri>>().swap(baldes);
+    if (!celulas.fechar()) return false;
+    if (N) {
+        const size_t porAlivio = memoria / 4 / (3 * sizeof(float));
+        for (uint64_t v = 0; v < nPos; ++v) {
+            normalizarVertice(&N[v * 3]);
+            if ((v + 1) % porAlivio == 0) mNormaisCalc.aliviar();
+        }
+    }
+    mPos.aliviar();
+    mNormaisCalc.aliviar();
+
+    // 3) Cada célula vira blocos de até trisPorBloco triângulos, indexados e gravados em páginas
+    const int fdCelulas = open(celulas.caminho.c_str(), O_RDONLY);
+    string tmpSaida;
+    FILE* fo = fdCelulas >= 0 ? criarTemporarioAoLado(caminhoSaida, tmpSaida) : nullptr;
+    if (!fo) {
+        if (fdCelulas >= 0) close(fdCelulas);
+        cerr << "Falha ao criar arquivo paginado: " << caminhoSaida << "\n";
+        return false;
+    }
+    bool ok = true;
+    uint64_t fimArquivo = 0;
+    auto gravar = [&](const void* p, size_t n) {
+        if (n && fwrite(p, 1, n, fo) != n) ok = false;
+        fimArquivo += n;
+    };
+    auto preencherAte = [&](uint64_t deslocamento) {
+        static const char zeros[TAMANHO_PAGINA] = {};
+        while (fimArquivo < deslocamento) gravar(zeros, (size_t)min<uint64_t>(deslocamento - fimArquivo, TAMANHO_PAGINA));
+    };
+    CabecalhoPaginado cab{};
+    gravar(&cab, sizeof(cab));
+
+    vector<BlocoPaginado> tabela;
+    vector<CantoTri> cantos;
+    cantos.reserve(trisPorBloco * 3);
+    uint64_t trisGravados = 0;
+    auto emitirBloco = [&]() {
+        if (cantos.empty()) return;
+        MalhaIndexada m;
+        construirMalhaIndexada(P, (size_t)nPos * 3, N, mNrm.floats(), (size_t)nNrm * 3, mUV.floats(), (size_t)nUV * 2,
+                               cantos.data(), cantos.size(), m);
+        BlocoPaginado b;
+        for (int k = 0; k < 3; ++k) { b.caixa.min[k] = m.vertices[k]; b.caixa.max[k] = m.vertices[k]; }
+        for (size_t v = 0; v < m.numVertices(); ++v)
+            for (int k = 0; k < 3; ++k) {
+                b.caixa.min[k] = min(b.caixa.min[k], m.vertices[v * FLOATS_POR_VERTICE + k]);
+                b.caixa.max[k] = max(b.caixa.max[k], m.vertices[v * FLOATS_POR_VERTICE + k]);
+            }
+        b.deslocamento = alinharPagina(fimArquivo);
+        b.numVertices = (uint32_t)m.numVertices();
+        b.numIndices = (uint32_t)m.numIndices();
+        preencherAte(b.deslocamento);
+        gravar(m.vertices.data(), m.vertices.size() * sizeof(float));
+        if (m.indices16Bits()) gravar(m.indices16.data(), m.indices16.size() * sizeof(uint16_t));
+        else gravar(m.indices32.data(), m.indices32.size() * sizeof(uint32_t));
+        tabela.push_back(b);
+        trisGravados += b.numIndices / 3;
+        cantos.clear();
+        mPos.aliviar(); mNrm.aliviar(); mUV.aliviar(); mNormaisCalc.aliviar();
+    };
+    for (size_t c = 0; c < numCelulas && ok; ++c) {
+        for (const TrechoCelula& t : trechos[c]) {
+            uint64_t desloc = t.deslocamento;
+            size_t restantes = t.cantos;
+            while (restantes > 0 && ok) {
+                const size_t n = min(restantes, trisPorBloco * 3 - cantos.size());
+                const size_t antes = cantos.size();
+                cantos.resize(antes + n);
+                if (pread(fdCelulas, cantos.data() + antes, n * sizeof(CantoTri), (off_t)desloc) != (ssize_t)(n * sizeof(CantoTri)))
+                    ok = false;
+                desloc += n * sizeof(CantoTri);
+                restantes -= n;
+                if (cantos.size() == trisPorBloco * 3) emitirBloco();
+            }
+        }
+        emitirBloco();
+    }
+    close(fdCelulas);
+
+    cab.deslocTabela = alinharPagina(fimArquivo);
+    preencherAte(cab.deslocTabela);
+    gravar(tabela.data(), tabela.size() * sizeof(BlocoPaginado));
+    memcpy(cab.magica, MAGICA_PAGINADA, sizeof(cab.magica));
+    cab.versao = VERSAO_MALHA_PAGINADA;
+    cab.numBlocos = (uint32_t)tabela.size();
+    cab.triangulos = trisGravados;
+    cab.caixa = caixa;
+    cab.temUVs = nUV > 0 ? 1u : 0u;
+    cab.tamanhoOBJ = chave.tamanho;
+    cab.mtimeOBJ = chave.mtime;
+    if (ok && (fseek(fo, 0, SEEK_SET) != 0 || fwrite(&cab, sizeof(cab), 1, fo) != 1)) ok = false;
+    if (fclose(fo) != 0) ok = false;
+    if (!ok || rename(tmpSaida.c_str(), caminhoSaida.c_str()) != 0) {
+        unlink(tmpSaida.c_str());
+        cerr << "Falha ao gravar arquivo paginado: " << caminhoSaida << "\n";
+        return false;
+    }
+    cout << "Paginado: " << caminhoSaida << " | " << trisGravados << " triangulos em " << tabela.size()
+         << " blocos (grade " << dims[0] << "x" << dims[1] << "x" << dims[2] << "), "
+         << fimArquivo / (1024.0 * 1024.0) << " MB | leitura " << msLeitura << " ms, total "
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() << " ms\n";
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Visualização
+// ---------------------------------------------------------------------------
+
+bool abrirMalhaPaginada(const string& caminho, const string& caminhoOBJ, MalhaPaginada& out) {
+    fecharMalhaPaginada(out);
+    const int fd = open(caminho.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    CabecalhoPaginado cab;
+    bool valido = pread(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab)
+               && memcmp(cab.magica, MAGICA_PAGINADA, sizeof(cab.magica)) == 0
+               && cab.versao == VERSAO_MALHA_PAGINADA;
+    if (valido && !caminhoOBJ.empty()) {
+        ChaveCacheOBJ chave;
+        valido = lerChaveCacheOBJ(caminhoOBJ, chave) && chave.tamanho == cab.tamanhoOBJ && chave.mtime == cab.mtimeOBJ;
+    }
+    if (valido) {
+        out.blocos.resize(cab.numBlocos);
+        const size_t bytes = out.blocos.size() * sizeof(BlocoPaginado);
+        valido = pread(fd, out.blocos.data(), bytes, (off_t)cab.deslocTabela) == (ssize_t)bytes;
+    }
+    if (!valido) {
+        close(fd);
+        out.blocos.clear();
+        return false;
+    }
+    out.fd = fd;
+    out.caixa = cab.caixa;
+    out.triangulos = cab.triangulos;
+    out.temUVs = cab.temUVs != 0;
+    out.vbos.assign(out.blocos.size(), MalhaVBO());
+    out.ultimoUso.assign(out.blocos.size(), 0);
+    size_t total = 0;
+    out.maiorBloco = 0;
+    for (const BlocoPaginado& b : out.blocos) {
+        total += b.bytes();
+        out.maiorBloco = max(out.maiorBloco, b.bytes());
+    }
+    cout << "Paginado: " << caminho << " | " << out.triangulos << " triangulos em " << out.blocos.size()
+         << " blocos, " << total / (1024.0 * 1024.0) << " MB\n";
+    return true;
+}
+
+// Memória de um bloco residente (VBO + IBO) no formato em uso
+static size_t bytesResidente(const MalhaPaginada& m, const BlocoPaginado& b) {
+    const size_t porVertice = m.compacto ? sizeof(VerticeCompacto) : FLOATS_POR_VERTICE * sizeof(float);
+    return (size_t)b.numVertices * porVertice + b.bytesIndices();
+}
+
+static bool carregarBloco(MalhaPaginada& m, uint32_t i) {
+    PERF_ESCOPO("quadro.carregar_bloco");
+    const BlocoPaginado& b = m.blocos[i];
+    MalhaIndexada tmp;
+    tmp.vertices.resize((size_t)b.numVertices * FLOATS_POR_VERTICE);
+    const size_t bytesVertices = tmp.vertices.size() * sizeof(float);
+    ssize_t lido = pread(m.fd, tmp.vertices.data(), bytesVertices, (off_t)b.deslocamento);
+    void* indices;
+    if (b.numVertices <= 65536u) { tmp.indices16.resize(b.numIndices); indices = tmp.indices16.data(); }
+    else { tmp.indices32.resize(b.numIndices); indices = tmp.indices32.data(); }
+    lido += pread(m.fd, indices, b.bytesIndices(), (off_t)(b.deslocamento + bytesVertices));
+    if (lido != (ssize_t)b.bytes() || !enviarMalhaVBO(tmp, m.vbos[i], m.compacto)) {
+        cerr << "Falha ao carregar o bloco " << i << " do arquivo paginado\n";
+        liberarMalhaVBO(m.vbos[i]);
+        return false;
+    }
+    m.bytesResidentes += bytesResidente(m, b);
+    ++m.carregamentos;
+    return true;
+}
+
+static void descartarBloco(MalhaPaginada& m, uint32_t i) {
+    liberarMalhaVBO(m.vbos[i]);
+    m.bytesResidentes -= bytesResidente(m, m.blocos[i]);
+    ++m.descartes;
+}
+
+// Posição da câmera no espaço do objeto: -A⁻¹·t, com A a parte 3x3 da modelview
+static void posicaoCamera(const float mv[16], float olho[3]) {
+    auto a = [&](int l, int c) { return mv[c * 4 + l]; };
+    const float c00 = a(1,1) * a(2,2) - a(1,2) * a(2,1), c01 = a(1,2) * a(2,0) - a(1,0) * a(2,2), c02 = a(1,0) * a(2,1) - a(1,1) * a(2,0);
+    const float det = a(0,0) * c00 + a(0,1) * c01 + a(0,2) * c02;
+    if (fabs(det) < 1e-20f) { olho[0] = olho[1] = olho[2] = 0.0f; return; }
+    const float inv[3][3] = {
+        { c00 / det, (a(0,2) * a(2,1) - a(0,1) * a(2,2)) / det, (a(0,1) * a(1,2) - a(0,2) * a(1,1)) / det },
+        { c01 / det, (a(0,0) * a(2,2) - a(0,2) * a(2,0)) / det, (a(0,2) * a(1,0) - a(0,0) * a(1,2)) / det },
+        { c02 / det, (a(0,1) * a(2,0) - a(0,0) * a(2,1)) / det, (a(0,0) * a(1,1) - a(0,1) * a(1,0)) / det },
+    };
+    for (int l = 0; l < 3; ++l)
+        olho[l] = -(inv[l][0] * mv[12] + inv[l][1] * mv[13] + inv[l][2] * mv[14]);
+}
+
+static float distanciaCaixa(const CaixaAABB& c, const float p[3]) {
+    float d2 = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        const float d = max(max(c.min[k] - p[k], 0.0f), p[k] - c.max[k]);
+        d2 += d * d;
+    }
+    return sqrt(d2);
+}
+
+bool atualizarMalhaPaginada(MalhaPaginada& m, const float projecao[16], const float modelview[16],
+                            size_t bytesPorQuadro) {
+    ++m.quadro;
+    const Frustum f = frustumDasMatrizes(projecao, modelview);
+    float olho[3];
+    posicaoCamera(modelview, olho);
+
+    // Prioridade: visíveis antes dos demais; em cada grupo, do mais próximo ao mais distante
+    struct Candidato { bool visivel; float distancia; uint32_t bloco; };
+    vector<Candidato> candidatos(m.blocos.size());
+    for (uint32_t i = 0; i < m.blocos.size(); ++i)
+        candidatos[i] = Candidato{ caixaNoFrustum(f, m.blocos[i].caixa), distanciaCaixa(m.blocos[i].caixa, olho), i };
+    sort(candidatos.begin(), candidatos.end(), [](const Candidato& a, const Candidato& b) {
+        if (a.visivel != b.visivel) return a.visivel;
+        return a.distancia < b.distancia;
+    });
+
+    // Conjunto desejado: o maior prefixo que cabe no orçamento
+    vector<char> desejado(m.blocos.size(), 0);
+    size_t desejados = 0, soma = 0;
+    for (; desejados < candidatos.size(); ++desejados) {
+        const size_t b = bytesResidente(m, m.blocos[candidatos[desejados].bloco]);
+        if (soma + b > m.orcamentoBytes) break;
+        soma += b;
+        desejado[candidatos[desejados].bloco] = 1;
+        m.ultimoUso[candidatos[desejados].bloco] = m.quadro;
+    }
+
+    bool pendente = false;
+    size_t carregadoAgora = 0;
+    for (size_t k = 0; k < desejados; ++k) {
+        const uint32_t i = candidatos[k].bloco;
+        if (m.vbos[i].vao != 0) continue;
+        const size_t b = bytesResidente(m, m.blocos[i]);
+        if (carregadoAgora > 0 && carregadoAgora + b > bytesPorQuadro) { pendente = true; break; }
+        // Abre espaço descartando os residentes fora do conjunto desejado, do menos usado
+        while (m.bytesResidentes + b > m.orcamentoBytes) {
+            uint32_t vitima = UINT32_MAX;
+            for (uint32_t j = 0; j < m.blocos.size(); ++j)
+                if (m.vbos[j].vao != 0 && !desejado[j] && (vitima == UINT32_MAX || m.ultimoUso[j] < m.ultimoUso[vitima]))
+                    vitima = j;
+            if (vitima == UINT32_MAX) break;
+            descartarBloco(m, vitima);
+        }
+        if (m.bytesResidentes + b > m.orcamentoBytes || !carregarBloco(m, i)) break;
+        carregadoAgora += b;
+    }
+
+    m.visiveis.clear();
+    m.visiveisForaOrcamento = 0;
+    for (size_t k = 0; k < candidatos.size() && candidatos[k].visivel; ++k) {
+        if (m.vbos[candidatos[k].bloco].vao != 0) m.visiveis.push_back(candidatos[k].bloco);
+        if (k >= desejados) ++m.visiveisForaOrcamento;
+    }
+    return pendente;
+}
+
+size_t desenharMalhaPaginada(const MalhaPaginada& m) {
+    size_t tris = 0;
+    for (uint32_t i : m.visiveis) {
+        desenharMalhaVBO(m.vbos[i]);
+        tris += m.blocos[i].numIndices / 3;
+    }
+    return tris;
+}
+
+void fecharMalhaPaginada(MalhaPaginada& m) {
+    for (MalhaVBO& v : m.vbos) liberarMalhaVBO(v);
+    if (m.fd >= 0) close(m.fd);
+    m.fd = -1;
+    m.blocos.clear();
+    m.vbos.clear();
+    m.ultimoUso.clear();
+    m.visiveis.clear();
+    m.visiveisForaOrcamento = 0;
+    m.bytesResidentes = 0;
+    m.triangulos = 0;
+    m.maiorBloco = 0;
+    m.carregamentos = m.descartes = 0;
+}
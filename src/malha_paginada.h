@@ -0,0 +1,90 @@
+// Modo fora do núcleo (--paginado) para OBJs maiores que a memória.
+// A conversão lê o OBJ em blocos de tamanho fixo e, em passadas com memória limitada
+// (arquivos temporários em disco no lugar dos vetores), divide os triângulos numa grade
+// uniforme sobre a caixa do modelo. Cada célula vira um ou mais blocos de até trisPorBloco
+// triângulos, gravados já indexados (vértices intercalados + índices de 16/32 bits) num
+// arquivo paginado. O visualizador mantém residentes só os blocos que cabem no orçamento de
+// memória, escolhidos por visibilidade (frustum) e distância à câmera, e troca os blocos
+// conforme a vista muda.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+#include "malha_vbo.h"
+#include "vertice_compacto.h"
+
+using namespace std;
+
+// Incrementar sempre que o layout do arquivo ou o resultado do parse mudar
+static const uint32_t VERSAO_MALHA_PAGINADA = 2;
+
+// Bloco espacial do arquivo: numVertices vértices intercalados (FLOATS_POR_VERTICE floats)
+// seguidos de numIndices índices (uint16 quando numVertices <= 65536, senão uint32)
+struct BlocoPaginado {
+    CaixaAABB caixa;
+    uint64_t deslocamento;      // no arquivo, múltiplo do tamanho de página
+    uint32_t numVertices;
+    uint32_t numIndices;
+
+    size_t bytesIndices() const { return (size_t)numIndices * (numVertices <= 65536u ? 2u : 4u); }
+    size_t bytes() const { return (size_t)numVertices * FLOATS_POR_VERTICE * sizeof(float) + bytesIndices(); }
+};
+
+struct OpcoesPaginacao {
+    size_t memoriaBytes = 256u << 20;   // teto dos buffers da conversão
+    uint32_t trisPorBloco = 65536;
+};
+
+// Arquivo paginado de um OBJ: ao lado dele ("modelo.obj.paginas") ou em dirCache
+string caminhoMalhaPaginada(const string& caminhoOBJ, const string& dirCache);
+
+// Converte o OBJ (gravação atômica: temporário + rename). O uso de memória fica limitado por
+// opcoes.memoriaBytes, independente do tamanho do arquivo; os temporários vão para a pasta
+// da saída e são apagados no fim.
+bool converterOBJParaPaginado(const string& caminhoOBJ, const string& caminhoSaida, const OpcoesPaginacao& opcoes);
+
+struct MalhaPaginada {
+    int fd = -1;
+    vector<BlocoPaginado> blocos;
+    CaixaAABB caixa;
+    uint64_t triangulos = 0;
+    bool temUVs = false;
+    size_t maiorBloco = 0;          // bytes do maior bloco no arquivo (calculado ao abrir)
+
+    // Residência: cada bloco residente tem o próprio VBO/IBO
+    vector<MalhaVBO> vbos;          // vao == 0: bloco fora da memória
+    vector<uint64_t> ultimoUso;     // último quadro em que o bloco entrou no conjunto desejado
+    size_t orcamentoBytes = 0;      // limite para os blocos residentes
+    size_t bytesResidentes = 0;
+    bool compacto = false;          // vértices no formato de vertice_compacto.h
+    uint64_t quadro = 0;
+    size_t carregamentos = 0, descartes = 0;
+    vector<uint32_t> visiveis;      // residentes e visíveis no último quadro
+    size_t visiveisForaOrcamento = 0;   // visíveis no último quadro que não couberam no orçamento
+
+    MalhaPaginada() = default;
+    MalhaPaginada(const MalhaPaginada&) = delete;
+    MalhaPaginada& operator=(const MalhaPaginada&) = delete;
+};
+
+// Abre o arquivo paginado. Com caminhoOBJ não vazio, só aceita um arquivo gerado a partir
+// da versão atual do OBJ (mesmo tamanho e mtime).
+bool abrirMalhaPaginada(const string& caminho, const string& caminhoOBJ, MalhaPaginada& out);
+
+// Escolhe os blocos desejados para a vista (visíveis primeiro, depois os demais, cada grupo
+// do mais próximo ao mais distante, até encher o orçamento), descarta os menos usados quando
+// falta espaço e carrega até bytesPorQuadro. Os blocos contam só os próprios bytes
+// (bytesResidentes) contra orcamentoBytes. Devolve true se ainda faltam blocos desejados.
+// Precisa de contexto GL corrente.
+bool atualizarMalhaPaginada(MalhaPaginada& m, const float projecao[16], const float modelview[16],
+                            size_t bytesPorQuadro);
+
+// Desenha os blocos residentes e visíveis; devolve o número de triângulos desenhados
+size_t desenharMalhaPaginada(const MalhaPaginada& m);
+
+void fecharMalhaPaginada(MalhaPaginada& m);
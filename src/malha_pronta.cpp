@@ -0,0 +1,91 @@
+#include "malha_pronta.h"
+#include "cache_malha.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// Layout do arquivo:
+//   CabecalhoMalhaPronta
+//   seções (vertices, indices de 16 ou 32 bits conforme bitsIndice, indicesLOD, niveisLOD,
+//           faixasMaterial, textoMateriais), cada uma alinhada com alinharSecao
+// O checksum (o mesmo do cache) cobre todos os bytes depois do cabeçalho.
+static const char MAGICA_MALHA_PRONTA[8] = { 'O','B','J','P','R','O','N','T' };
+static const int NUM_SECOES_PRONTA = 6;
+
+struct CabecalhoMalhaPronta {
+    char magica[8];
+    uint32_t versao;
+    uint32_t tamCabecalho;
+    uint32_t floatsPorVertice;
+    uint32_t bitsIndice;       // 16 ou 32
+    float caixaMin[3];         // caixa envolvente das posições dos vértices
+    float caixaMax[3];
+    uint64_t tamSecao[NUM_SECOES_PRONTA];   // em bytes
+    uint64_t tamanhoPayload;
+    uint64_t checksum;
+};
+
+bool gravarMalhaPronta(const string& caminho, const MalhaOBJ& malha, uint64_t* checksum) {
+    const MalhaIndexada& m = malha.indexada;
+    const string textoMateriais = textoNomesMateriais(malha.nomesMateriais);
+    CabecalhoMalhaPronta cab;
+    memset(&cab, 0, sizeof(cab));   // sem bytes de preenchimento indefinidos no arquivo
+    memcpy(cab.magica, MAGICA_MALHA_PRONTA, sizeof(MAGICA_MALHA_PRONTA));
+    cab.versao = VERSAO_MALHA_PRONTA;
+    cab.tamCabecalho = sizeof(CabecalhoMalhaPronta);
+    cab.floatsPorVertice = FLOATS_POR_VERTICE;
+    cab.bitsIndice = m.indices16Bits() ? 16 : 32;
+    for (int e = 0; e < 3; ++e) {
+        cab.caixaMin[e] = m.numVertices() ? m.vertices[e] : 0.0f;
+        cab.caixaMax[e] = cab.caixaMin[e];
+    }
+    for (size_t i = 0; i < m.vertices.size(); i += FLOATS_POR_VERTICE)
+        for (int e = 0; e < 3; ++e) {
+            cab.caixaMin[e] = min(cab.caixaMin[e], m.vertices[i + e]);
+            cab.caixaMax[e] = max(cab.caixaMax[e], m.vertices[i + e]);
+        }
+
+    const void* dados[NUM_SECOES_PRONTA] = {
+        m.vertices.data(),
+        m.indices16Bits() ? (const void*)m.indices16.data() : (const void*)m.indices32.data(),
+        m.indicesLOD.data(), m.niveisLOD.data(), m.faixasMaterial.data(), textoMateriais.data()
+    };
+    cab.tamSecao[0] = m.vertices.size() * sizeof(float);
+    cab.tamSecao[1] = m.numIndices() * (m.indices16Bits() ? sizeof(uint16_t) : sizeof(uint32_t));
+    cab.tamSecao[2] = m.indicesLOD.size() * sizeof(uint32_t);
+    cab.tamSecao[3] = m.niveisLOD.size() * sizeof(NivelLOD);
+    cab.tamSecao[4] = m.faixasMaterial.size() * sizeof(FaixaMaterial);
+    cab.tamSecao[5] = textoMateriais.size();
+
+    size_t total = 0;
+    for (int i = 0; i < NUM_SECOES_PRONTA; ++i) total += alinharSecao(cab.tamSecao[i]);
+    cab.tamanhoPayload = total;
+    cab.checksum = checksumInicial(total);
+    for (int i = 0; i < NUM_SECOES_PRONTA; ++i) cab.checksum = checksumSecao(cab.checksum, dados[i], cab.tamSecao[i]);
+    if (checksum) *checksum = cab.checksum;
+
+    string temp;
+    FILE* f = criarTemporarioAoLado(caminho, temp);
+    if (!f) {
+        cerr << "Nao foi possivel gravar: " << caminho << "\n";
+        return false;
+    }
+    static const unsigned char zeros[16] = {};
+    bool ok = fwrite(&cab, sizeof(cab), 1, f) == 1;
+    for (int i = 0; ok && i < NUM_SECOES_PRONTA; ++i) {
+        if (cab.tamSecao[i]) ok = fwrite(dados[i], cab.tamSecao[i], 1, f) == 1;
+        const size_t pad = alinharSecao(cab.tamSecao[i]) - cab.tamSecao[i];
+        if (ok && pad) ok = fwrite(zeros, pad, 1, f) == 1;
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(temp.c_str(), caminho.c_str()) != 0) {
+        remove(temp.c_str());
+        cerr << "Nao foi possivel gravar: " << caminho << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,21 @@
+// Arquivo de malha pronta para desenho, gerado pelo objprep: só a malha indexada (vértices
+// intercalados, índices, níveis de LOD, faixas de material e os nomes dos materiais) e a caixa
+// envolvente, sem os buffers do parse. Ao contrário do cache de cache_malha.h, o cabeçalho não
+// tem caminho nem mtime: o mesmo OBJ gera sempre os mesmos bytes, e o arquivo pode ser
+// identificado pelo hash do conteúdo.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "obj_loader.h"
+
+using namespace std;
+
+// Incrementar sempre que o layout do arquivo mudar
+static const uint32_t VERSAO_MALHA_PRONTA = 1;
+
+// Grava (arquivo temporário + rename) a malha indexada de "malha". checksum, se não for nulo,
+// recebe o checksum do payload gravado no cabeçalho.
+bool gravarMalhaPronta(const string& caminho, const MalhaOBJ& malha, uint64_t* checksum = nullptr);
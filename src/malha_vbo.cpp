@@ -0,0 +1,187 @@
+#include "malha_vbo.h"
+
+#include <cstddef>
+
+using namespace std;
+
+// Deslocamentos dentro de um vértice intercalado (ver FLOATS_POR_VERTICE)
+static const GLsizei STRIDE_VERTICE = FLOATS_POR_VERTICE * sizeof(float);
+static const size_t DESLOC_POSICAO = 0;
+static const size_t DESLOC_NORMAL  = 3 * sizeof(float);
+static const size_t DESLOC_UV      = 6 * sizeof(float);
+
+static const void* deslocamento(size_t bytes) {
+    return reinterpret_cast<const void*>(bytes);
+}
+
+// O estado de material (preenchimento, sem culling, cor) fica com quem desenha; no formato
+// compacto leva as posições quantizadas de volta ao espaço do objeto
+static void iniciarDesenho(const MalhaVBO& m) {
+    if (m.compacta) {
+        glPushMatrix();
+        glTranslatef(m.quant.deslocamento[0], m.quant.deslocamento[1], m.quant.deslocamento[2]);
+        glScalef(m.quant.escala, m.quant.escala, m.quant.escala);
+    }
+    glBindVertexArray(m.vao);
+}
+
+static void terminarDesenho(const MalhaVBO& m) {
+    glBindVertexArray(0);
+    if (m.compacta) glPopMatrix();
+}
+
+// IBO = índices completos seguidos dos níveis de detalhe, todos na largura da malha
+template <class Indice>
+static void enviarIndicesComLOD(const Fatia<Indice>& completos, const VisaoMalhaIndexada& malha) {
+    if (malha.indicesLOD.empty()) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(completos.size() * sizeof(Indice)),
+                     completos.data(), GL_STATIC_DRAW);
+        return;
+    }
+    vector<Indice> todos;
+    todos.reserve(completos.size() + malha.indicesLOD.size());
+    todos.insert(todos.end(), completos.begin(), completos.end());
+    for (uint32_t i : malha.indicesLOD) todos.push_back((Indice)i);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(todos.size() * sizeof(Indice)), todos.data(), GL_STATIC_DRAW);
+}
+
+bool enviarMalhaVBO(const VisaoMalhaIndexada& malha, MalhaVBO& out, bool compacta) {
+    liberarMalhaVBO(out);
+    if (malha.numIndices() == 0) return false;
+
+    glGenVertexArrays(1, &out.vao);
+    glGenBuffers(1, &out.vbo);
+    glGenBuffers(1, &out.ibo);
+    glBindVertexArray(out.vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, out.vbo);
+    out.compacta = compacta;
+    if (compacta) {
+        vector<VerticeCompacto> compactos;
+        compactarVertices(malha, compactos, out.quant);
+        out.bytesVertices = compactos.size() * sizeof(VerticeCompacto);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)out.bytesVertices, compactos.data(), GL_STATIC_DRAW);
+    } else {
+        out.bytesVertices = malha.vertices.size() * sizeof(float);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)out.bytesVertices, malha.vertices.data(), GL_STATIC_DRAW);
+    }
+
+    // O VAO guarda o IBO e os ponteiros/habilitações dos arrays do pipeline fixo
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.ibo);
+    if (malha.indices16Bits()) {
+        enviarIndicesComLOD(malha.indices16, malha);
+        out.tipoIndice = GL_UNSIGNED_SHORT;
+    } else {
+        enviarIndicesComLOD(malha.indices32, malha);
+        out.tipoIndice = GL_UNSIGNED_INT;
+    }
+    for (const NivelLOD& n : malha.niveisLOD) {
+        out.inicioLOD.push_back((GLsizei)(malha.numIndices() + n.primeiroIndice));
+        out.numIndicesLOD.push_back((GLsizei)n.numIndices);
+    }
+    out.numIndices = (GLsizei)malha.numIndices();
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    if (compacta) {
+        const GLsizei stride = sizeof(VerticeCompacto);
+        glVertexPointer(3, GL_SHORT, stride, deslocamento(offsetof(VerticeCompacto, posicao)));
+        glNormalPointer(GL_BYTE, stride, deslocamento(offsetof(VerticeCompacto, normal)));
+        glTexCoordPointer(2, GL_HALF_FLOAT, stride, deslocamento(offsetof(VerticeCompacto, uv)));
+    } else {
+        glVertexPointer(3, GL_FLOAT, STRIDE_VERTICE, deslocamento(DESLOC_POSICAO));
+        glNormalPointer(GL_FLOAT, STRIDE_VERTICE, deslocamento(DESLOC_NORMAL));
+        glTexCoordPointer(2, GL_FLOAT, STRIDE_VERTICE, deslocamento(DESLOC_UV));
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return glGetError() == GL_NO_ERROR;
+}
+
+void desenharMalhaVBO(const MalhaVBO& m) {
+    if (m.vao == 0) return;
+    iniciarDesenho(m);
+    glDrawElements(GL_TRIANGLES, m.numIndices, m.tipoIndice, deslocamento(0));
+    terminarDesenho(m);
+}
+
+void desenharMalhaVBONivel(const MalhaVBO& m, int nivel) {
+    if (nivel <= 0 || (size_t)nivel > m.inicioLOD.size()) { desenharMalhaVBO(m); return; }
+    if (m.vao == 0) return;
+    const size_t bytesIndice = (m.tipoIndice == GL_UNSIGNED_SHORT) ? 2 : 4;
+    iniciarDesenho(m);
+    glDrawElements(GL_TRIANGLES, m.numIndicesLOD[nivel - 1], m.tipoIndice,
+                   deslocamento((size_t)m.inicioLOD[nivel - 1] * bytesIndice));
+    terminarDesenho(m);
+}
+
+void desenharMalhaVBOFaixas(const MalhaVBO& m, const vector<GLsizei>& primeiros, const vector<GLsizei>& contagens) {
+    if (m.vao == 0 || primeiros.empty()) return;
+    const size_t bytesIndice = (m.tipoIndice == GL_UNSIGNED_SHORT) ? 2 : 4;
+    vector<GLsizei> contagensIdx(contagens.size());
+    vector<const void*> deslocs(primeiros.size());
+    for (size_t i = 0; i < primeiros.size(); ++i) {
+        contagensIdx[i] = contagens[i] * 3;
+        deslocs[i] = deslocamento((size_t)primeiros[i] * 3u * bytesIndice);
+    }
+    iniciarDesenho(m);
+    glMultiDrawElements(GL_TRIANGLES, contagensIdx.data(), m.tipoIndice, deslocs.data(), (GLsizei)deslocs.size());
+    terminarDesenho(m);
+}
+
+void desenharMalhaVBOMateriais(const MalhaVBO& m, const Fatia<FaixaMaterial>& faixas,
+                               const function<void(int)>& aplicarMaterial) {
+    if (m.vao == 0) return;
+    const size_t bytesIndice = (m.tipoIndice == GL_UNSIGNED_SHORT) ? 2 : 4;
+    iniciarDesenho(m);
+    for (const FaixaMaterial& f : faixas) {
+        aplicarMaterial(f.material);
+        glDrawElements(GL_TRIANGLES, (GLsizei)f.numIndices, m.tipoIndice,
+                       deslocamento((size_t)f.primeiroIndice * bytesIndice));
+    }
+    terminarDesenho(m);
+}
+
+void liberarMalhaVBO(MalhaVBO& m) {
+    if (m.vao) glDeleteVertexArrays(1, &m.vao);
+    if (m.vbo) glDeleteBuffers(1, &m.vbo);
+    if (m.ibo) glDeleteBuffers(1, &m.ibo);
+    m = MalhaVBO();
+}
+
+bool enviarLotePrevia(const vector<float>& intercalado, LotePrevia& out) {
+    out = LotePrevia();
+    if (intercalado.empty()) return false;
+    glGenBuffers(1, &out.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, out.vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(intercalado.size() * sizeof(float)), intercalado.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    out.numVertices = (GLsizei)(intercalado.size() / FLOATS_POR_VERTICE);
+    return true;
+}
+
+void desenharLotesPrevia(const vector<LotePrevia>& lotes) {
+    if (lotes.empty()) return;
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    for (const LotePrevia& l : lotes) {
+        glBindBuffer(GL_ARRAY_BUFFER, l.vbo);
+        glVertexPointer(3, GL_FLOAT, STRIDE_VERTICE, deslocamento(DESLOC_POSICAO));
+        glNormalPointer(GL_FLOAT, STRIDE_VERTICE, deslocamento(DESLOC_NORMAL));
+        glTexCoordPointer(2, GL_FLOAT, STRIDE_VERTICE, deslocamento(DESLOC_UV));
+        glDrawArrays(GL_TRIANGLES, 0, l.numVertices);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+}
+
+void liberarLotesPrevia(vector<LotePrevia>& lotes) {
+    for (LotePrevia& l : lotes) if (l.vbo) glDeleteBuffers(1, &l.vbo);
+    lotes.clear();
+}
@@ -0,0 +1,62 @@
+// Caminho de renderização com buffers na GPU (VBO/IBO + VAO).
+// Envia a MalhaIndexada uma única vez (vértices intercalados posição/normal/UV e
+// índices de 16 ou 32 bits) e desenha com um só glDrawElements, usando os
+// arrays do pipeline fixo (glVertexPointer/glNormalPointer/glTexCoordPointer).
+// Com compacta = true os vértices vão no formato de 16 bytes de vertice_compacto.h.
+// Os desenhos só ligam o VAO: o estado de material (preenchimento, culling, cor) é de quem
+// desenha, como nas display lists de malha_lista.h.
+
+#pragma once
+
+#include <GL/freeglut.h>
+#include <functional>
+
+#include "obj_loader.h"
+#include "vertice_compacto.h"
+
+struct MalhaVBO {
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ibo = 0;
+    GLsizei numIndices = 0;
+    GLenum tipoIndice = GL_UNSIGNED_INT;
+    // Formato compacto: a dequantização da posição entra na modelview durante o desenho
+    bool compacta = false;
+    QuantizacaoPosicao quant;
+    size_t bytesVertices = 0;
+    // Níveis de detalhe: guardados no mesmo IBO, depois dos índices completos
+    vector<GLsizei> inicioLOD;    // em índices
+    vector<GLsizei> numIndicesLOD;
+};
+
+// Cria (ou recria) os buffers a partir da malha indexada (ou da visão dela sobre o cache mapeado)
+bool enviarMalhaVBO(const VisaoMalhaIndexada& malha, MalhaVBO& out, bool compacta = false);
+
+// Desenha a malha inteira
+void desenharMalhaVBO(const MalhaVBO& m);
+
+// Desenha o nível de detalhe "nivel" (1 = MalhaIndexada::niveisLOD[0]; 0 = malha completa)
+void desenharMalhaVBONivel(const MalhaVBO& m, int nivel);
+
+// Desenha só algumas faixas de triângulos do IBO (pares primeiroTri/numTris, ex.: clusters
+// visíveis da BVH) num único glMultiDrawElements
+void desenharMalhaVBOFaixas(const MalhaVBO& m, const vector<GLsizei>& primeiros, const vector<GLsizei>& contagens);
+
+// Desenha as faixas de material (MalhaIndexada::faixasMaterial) em ordem, chamando
+// aplicarMaterial(id) antes de cada uma
+void desenharMalhaVBOMateriais(const MalhaVBO& m, const Fatia<FaixaMaterial>& faixas,
+                               const function<void(int)>& aplicarMaterial);
+
+// Libera os objetos GL
+void liberarMalhaVBO(MalhaVBO& m);
+
+// Lote de pré-visualização do carregamento assíncrono: triângulos soltos (sem índices)
+// no mesmo formato intercalado da malha indexada
+struct LotePrevia {
+    GLuint vbo = 0;
+    GLsizei numVertices = 0;
+};
+
+bool enviarLotePrevia(const vector<float>& intercalado, LotePrevia& out);
+void desenharLotesPrevia(const vector<LotePrevia>& lotes);
+void liberarLotesPrevia(vector<LotePrevia>& lotes);
@@ -0,0 +1,152 @@
+#include "materiais.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+static bool ehBranco(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+static string aparado(const char* s, const char* e) {
+    while (s < e && ehBranco(*s)) ++s;
+    while (e > s && ehBranco(e[-1])) --e;
+    return string(s, e);
+}
+
+int NomesMateriais::idMaterial(const char* s, const char* e) {
+    const string nome = aparado(s, e);
+    for (size_t i = 0; i < nomes.size(); ++i)
+        if (nomes[i] == nome) return (int)i;
+    nomes.push_back(nome);
+    return (int)nomes.size() - 1;
+}
+
+void NomesMateriais::acrescentarBibliotecas(const char* s, const char* e) {
+    istringstream ls(aparado(s, e));
+    string b;
+    while (ls >> b)
+        if (find(bibliotecas.begin(), bibliotecas.end(), b) == bibliotecas.end()) bibliotecas.push_back(b);
+}
+
+static string diretorioDe(const string& caminho) {
+    const size_t barra = caminho.find_last_of('/');
+    return barra == string::npos ? string() : caminho.substr(0, barra + 1);
+}
+
+// Caminho relativo ao diretório "base" (arquivos exportados no Windows usam '\')
+static string resolverCaminho(const string& base, string relativo) {
+    replace(relativo.begin(), relativo.end(), '\\', '/');
+    if (relativo.empty() || relativo[0] == '/') return relativo;
+    return base + relativo;
+}
+
+static bool ehNumero(const string& s) {
+    char* fim = nullptr;
+    strtod(s.c_str(), &fim);
+    return fim != s.c_str() && *fim == '\0';
+}
+
+// "map_Kd [opções] arquivo": pula as opções (-o/-s/-t têm de 1 a 3 números) e devolve o resto
+static string arquivoDoMapa(const string& resto) {
+    istringstream ls(resto);
+    vector<string> toks;
+    string t;
+    while (ls >> t) toks.push_back(t);
+    size_t i = 0;
+    while (i < toks.size() && toks[i].size() > 1 && toks[i][0] == '-' && !ehNumero(toks[i])) {
+        const string& op = toks[i++];
+        if (op == "-o" || op == "-s" || op == "-t") {
+            for (int k = 0; k < 3 && i < toks.size() && ehNumero(toks[i]); ++k) ++i;
+        } else if (op == "-mm") {
+            i += 2;
+        } else {
+            ++i;   // -blendu, -blendv, -boost, -clamp, -bm, -texres, -imfchan, -type
+        }
+    }
+    string arquivo;
+    for (; i < toks.size(); ++i) arquivo += (arquivo.empty() ? "" : " ") + toks[i];
+    return arquivo;
+}
+
+static void lerTres(istringstream& ls, float v[3]) {
+    ls >> v[0];
+    if (!(ls >> v[1] >> v[2])) v[1] = v[2] = v[0];   // "Kd 0.5" vale para os três canais
+}
+
+static bool lerMTL(const string& caminho, vector<MaterialOBJ>& out) {
+    ifstream in(caminho);
+    if (!in.is_open()) return false;
+    const string base = diretorioDe(caminho);
+    MaterialOBJ* atual = nullptr;
+    string linha, tok;
+    while (getline(in, linha)) {
+        if (!linha.empty() && linha.back() == '\r') linha.pop_back();
+        istringstream ls(linha);
+        if (!(ls >> tok) || tok[0] == '#') continue;
+        if (tok == "newmtl") {
+            string resto; getline(ls, resto);
+            out.emplace_back();
+            atual = &out.back();
+            atual->nome = aparado(resto.data(), resto.data() + resto.size());
+        } else if (!atual) {
+            continue;
+        } else if (tok == "Kd") {
+            lerTres(ls, atual->difusa);
+        } else if (tok == "Ks") {
+            lerTres(ls, atual->especular);
+        } else if (tok == "Ns") {
+            ls >> atual->brilho;
+        } else if (tok == "d") {
+            ls >> atual->opacidade;
+        } else if (tok == "Tr") {
+            float tr = 0.0f;
+            if (ls >> tr) atual->opacidade = 1.0f - tr;
+        } else if (tok == "map_Kd") {
+            string resto; getline(ls, resto);
+            const string arquivo = arquivoDoMapa(resto);
+            if (!arquivo.empty()) atual->mapaDifusa = resolverCaminho(base, arquivo);
+        }
+    }
+    return true;
+}
+
+void resolverMateriais(const string& caminhoOBJ, const NomesMateriais& nomes, vector<MaterialOBJ>& out) {
+    out.clear();
+    vector<MaterialOBJ> lidos;
+    const string base = diretorioDe(caminhoOBJ);
+    for (const string& b : nomes.bibliotecas)
+        if (!lerMTL(resolverCaminho(base, b), lidos)) cerr << "Falha ao abrir MTL: " << resolverCaminho(base, b) << "\n";
+
+    out.resize(nomes.nomes.size());
+    size_t faltando = 0;
+    for (size_t i = 0; i < nomes.nomes.size(); ++i) {
+        // Nome repetido em bibliotecas diferentes: vale a última definição, como nos exportadores
+        auto it = find_if(lidos.rbegin(), lidos.rend(), [&](const MaterialOBJ& m) { return m.nome == nomes.nomes[i]; });
+        if (it != lidos.rend()) out[i] = *it;
+        else { out[i].nome = nomes.nomes[i]; ++faltando; }
+    }
+    if (faltando) cerr << faltando << " material(is) sem definicao nos .mtl (usando branco)\n";
+}
+
+string textoNomesMateriais(const NomesMateriais& nomes) {
+    string s;
+    for (const string& b : nomes.bibliotecas) s += "mtllib " + b + "\n";
+    for (const string& n : nomes.nomes) s += "usemtl " + n + "\n";
+    return s;
+}
+
+void lerTextoNomesMateriais(const char* s, size_t n, NomesMateriais& out) {
+    out = NomesMateriais();
+    const char* fim = s + n;
+    while (s < fim) {
+        const char* nl = static_cast<const char*>(memchr(s, '\n', (size_t)(fim - s)));
+        const char* e = nl ? nl : fim;
+        if (e - s > 7 && memcmp(s, "mtllib ", 7) == 0) out.bibliotecas.push_back(string(s + 7, e));
+        else if (e - s >= 7 && memcmp(s, "usemtl ", 7) == 0) out.nomes.push_back(string(s + 7, e));
+        s = nl ? nl + 1 : fim;
+    }
+}
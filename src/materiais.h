@@ -0,0 +1,45 @@
+// Materiais de arquivos .mtl (mtllib/usemtl do OBJ), só com o que o pipeline fixo usa:
+// cor difusa e especular, brilho, opacidade e o mapa difuso (map_Kd).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct MaterialOBJ {
+    string nome;
+    float difusa[3] = { 1.0f, 1.0f, 1.0f };      // Kd
+    float especular[3] = { 0.0f, 0.0f, 0.0f };   // Ks
+    float brilho = 0.0f;                         // Ns (0 a 1000)
+    float opacidade = 1.0f;                      // d (ou 1 - Tr)
+    string mapaDifusa;                           // map_Kd, já resolvido em relação ao .mtl
+};
+
+// Faixa contígua de índices da malha indexada com o mesmo material (-1 = sem material)
+struct FaixaMaterial {
+    int32_t material;
+    uint32_t primeiroIndice;
+    uint32_t numIndices;
+};
+
+// Nomes vistos no parse, na ordem em que apareceram. O id de um material é a posição dele
+// em nomes.
+struct NomesMateriais {
+    vector<string> bibliotecas;   // mtllib, relativos ao diretório do OBJ
+    vector<string> nomes;         // usemtl
+
+    int idMaterial(const char* s, const char* e);          // busca ou acrescenta
+    void acrescentarBibliotecas(const char* s, const char* e);
+    bool vazio() const { return nomes.empty(); }
+};
+
+// Lê as bibliotecas e devolve um material por nome, na ordem de nomes.nomes. Nomes que não
+// aparecem em nenhum .mtl ficam com o material padrão (branco, sem mapa).
+void resolverMateriais(const string& caminhoOBJ, const NomesMateriais& nomes, vector<MaterialOBJ>& out);
+
+// Texto guardado no cache binário: uma linha "mtllib x" ou "usemtl y" por nome
+string textoNomesMateriais(const NomesMateriais& nomes);
+void lerTextoNomesMateriais(const char* s, size_t n, NomesMateriais& out);
@@ -0,0 +1,242 @@
+#include "normais.h"
+#include "paralelo.h"
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NORMAIS_X86 1
+#endif
+
+using namespace std;
+
+void calcularNormalFace(const float* a, const float* b, const float* c, float n[3]) {
+    const float ux = b[0] - a[0], uy = b[1] - a[1], uz = b[2] - a[2];
+    const float vx = c[0] - a[0], vy = c[1] - a[1], vz = c[2] - a[2];
+    n[0] = uy * vz - uz * vy;
+    n[1] = uz * vx - ux * vz;
+    n[2] = ux * vy - uy * vx;
+    const float len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    if (len > 1e-8f) { n[0]/=len; n[1]/=len; n[2]/=len; }
+}
+
+void normalizarVertice(float* n) {
+    float nx = n[0], ny = n[1], nz = n[2];
+    float len = std::sqrt(nx*nx + ny*ny + nz*nz);
+    if (len > 1e-8f) { n[0] = nx/len; n[1] = ny/len; n[2] = nz/len; }
+    else { n[0] = 0; n[1] = 0; n[2] = 1; }
+}
+
+void calcularNormaisVerticeEscalar(
+    const vector<float>& vertices,
+    const vector<unsigned int>& indicesPos,
+    vector<float>& normais
+) {
+    normais.assign(vertices.size(), 0.0f);
+    for (size_t i = 0; i + 2 < indicesPos.size(); i += 3) {
+        const unsigned int ia = indicesPos[i+0] * 3u;
+        const unsigned int ib = indicesPos[i+1] * 3u;
+        const unsigned int ic = indicesPos[i+2] * 3u;
+        if (ia+2 >= vertices.size() || ib+2 >= vertices.size() || ic+2 >= vertices.size()) continue;
+        float n[3]; calcularNormalFace(&vertices[ia], &vertices[ib], &vertices[ic], n);
+        normais[ia+0] += n[0]; normais[ia+1] += n[1]; normais[ia+2] += n[2];
+        normais[ib+0] += n[0]; normais[ib+1] += n[1]; normais[ib+2] += n[2];
+        normais[ic+0] += n[0]; normais[ic+1] += n[1]; normais[ic+2] += n[2];
+    }
+    for (size_t v = 0; v + 2 < normais.size(); v += 3) normalizarVertice(&normais[v]);
+}
+
+void atualizarNormaisVertice(
+    const vector<float>& vertices,
+    const vector<unsigned int>& indicesPos,
+    const vector<uint8_t>& sujos,
+    vector<float>& normais
+) {
+    const size_t nV = vertices.size() / 3;
+    for (size_t v = 0; v < nV; ++v)
+        if (sujos[v]) normais[3*v] = normais[3*v+1] = normais[3*v+2] = 0.0f;
+    for (size_t i = 0; i + 2 < indicesPos.size(); i += 3) {
+        const unsigned int a = indicesPos[i], b = indicesPos[i+1], c = indicesPos[i+2];
+        if (a >= nV || b >= nV || c >= nV || !(sujos[a] | sujos[b] | sujos[c])) continue;
+        float n[3]; calcularNormalFace(&vertices[3*a], &vertices[3*b], &vertices[3*c], n);
+        for (unsigned int v : { a, b, c }) {
+            if (!sujos[v]) continue;
+            normais[3*v] += n[0]; normais[3*v+1] += n[1]; normais[3*v+2] += n[2];
+        }
+    }
+    for (size_t v = 0; v < nV; ++v)
+        if (sujos[v]) normalizarVertice(&normais[3*v]);
+}
+
+// ---------------------------------------------------------------------------
+// Versão rápida. As faces de uma faixa são processadas em lotes de LOTE: as posições
+// são carregadas em SoA, as normais de face calculadas com SIMD e depois somadas no
+// acumulador da thread. As operações são as mesmas da versão escalar (sem FMA), então
+// as normais de face saem idênticas.
+// ---------------------------------------------------------------------------
+
+static const int LOTE = 8;
+
+// Posições de um lote em SoA e quais faces do lote são válidas
+struct LoteFaces {
+    alignas(32) float ax[LOTE], ay[LOTE], az[LOTE];
+    alignas(32) float bx[LOTE], by[LOTE], bz[LOTE];
+    alignas(32) float cx[LOTE], cy[LOTE], cz[LOTE];
+    alignas(32) float nx[LOTE], ny[LOTE], nz[LOTE];
+    unsigned int ia[LOTE], ib[LOTE], ic[LOTE];
+    bool valida[LOTE];
+};
+
+// Caminho comum: lote cheio e todos os índices da malha já conferidos
+static inline void carregarLoteCheio(const float* V, const unsigned int* idx, size_t f0, LoteFaces& L) {
+    for (int k = 0; k < LOTE; ++k) {
+        const size_t i = 3 * (f0 + k);
+        const unsigned int ia = idx[i] * 3u, ib = idx[i+1] * 3u, ic = idx[i+2] * 3u;
+        L.valida[k] = true;
+        L.ia[k] = ia; L.ib[k] = ib; L.ic[k] = ic;
+        L.ax[k] = V[ia]; L.ay[k] = V[ia+1]; L.az[k] = V[ia+2];
+        L.bx[k] = V[ib]; L.by[k] = V[ib+1]; L.bz[k] = V[ib+2];
+        L.cx[k] = V[ic]; L.cy[k] = V[ic+1]; L.cz[k] = V[ic+2];
+    }
+}
+
+static inline void carregarLote(const vector<float>& V, const unsigned int* idx, size_t f0, int n, LoteFaces& L) {
+    const size_t limite = V.size();
+    for (int k = 0; k < LOTE; ++k) {
+        unsigned int ia = 0, ib = 0, ic = 0;
+        bool ok = false;
+        if (k < n) {
+            const size_t i = 3 * (f0 + k);
+            ia = idx[i] * 3u; ib = idx[i+1] * 3u; ic = idx[i+2] * 3u;
+            ok = !(ia+2 >= limite || ib+2 >= limite || ic+2 >= limite);
+        }
+        L.valida[k] = ok;
+        if (!ok) ia = ib = ic = 0;   // lanes inválidas calculam lixo que não é somado
+        L.ia[k] = ia; L.ib[k] = ib; L.ic[k] = ic;
+        const float* A = &V[0] + ia; const float* B = &V[0] + ib; const float* C = &V[0] + ic;
+        L.ax[k] = A[0]; L.ay[k] = A[1]; L.az[k] = A[2];
+        L.bx[k] = B[0]; L.by[k] = B[1]; L.bz[k] = B[2];
+        L.cx[k] = C[0]; L.cy[k] = C[1]; L.cz[k] = C[2];
+    }
+}
+
+static inline void somarLote(const LoteFaces& L, float* acc) {
+    for (int k = 0; k < LOTE; ++k) {
+        if (!L.valida[k]) continue;
+        const float n0 = L.nx[k], n1 = L.ny[k], n2 = L.nz[k];
+        acc[L.ia[k]+0] += n0; acc[L.ia[k]+1] += n1; acc[L.ia[k]+2] += n2;
+        acc[L.ib[k]+0] += n0; acc[L.ib[k]+1] += n1; acc[L.ib[k]+2] += n2;
+        acc[L.ic[k]+0] += n0; acc[L.ic[k]+1] += n1; acc[L.ic[k]+2] += n2;
+    }
+}
+
+#ifndef NORMAIS_X86
+// Fora do x86 (no x86 o SSE sempre existe e substitui este)
+static void normaisLoteEscalar(LoteFaces& L) {
+    for (int k = 0; k < LOTE; ++k) {
+        const float a[3] = { L.ax[k], L.ay[k], L.az[k] };
+        const float b[3] = { L.bx[k], L.by[k], L.bz[k] };
+        const float c[3] = { L.cx[k], L.cy[k], L.cz[k] };
+        float n[3]; calcularNormalFace(a, b, c, n);
+        L.nx[k] = n[0]; L.ny[k] = n[1]; L.nz[k] = n[2];
+    }
+}
+#else
+// 4 faces por instrução com SSE (disponível em todo x86-64)
+static void normaisLoteSSE(LoteFaces& L) {
+    const __m128 limite = _mm_set1_ps(1e-8f);
+    for (int k = 0; k < LOTE; k += 4) {
+        const __m128 Ax = _mm_load_ps(L.ax + k), Ay = _mm_load_ps(L.ay + k), Az = _mm_load_ps(L.az + k);
+        const __m128 ux = _mm_sub_ps(_mm_load_ps(L.bx + k), Ax), uy = _mm_sub_ps(_mm_load_ps(L.by + k), Ay), uz = _mm_sub_ps(_mm_load_ps(L.bz + k), Az);
+        const __m128 vx = _mm_sub_ps(_mm_load_ps(L.cx + k), Ax), vy = _mm_sub_ps(_mm_load_ps(L.cy + k), Ay), vz = _mm_sub_ps(_mm_load_ps(L.cz + k), Az);
+        __m128 n0 = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy));
+        __m128 n1 = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz));
+        __m128 n2 = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx));
+        const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(n0, n0), _mm_mul_ps(n1, n1)), _mm_mul_ps(n2, n2)));
+        const __m128 usar = _mm_cmpgt_ps(len, limite);
+        n0 = _mm_or_ps(_mm_and_ps(usar, _mm_div_ps(n0, len)), _mm_andnot_ps(usar, n0));
+        n1 = _mm_or_ps(_mm_and_ps(usar, _mm_div_ps(n1, len)), _mm_andnot_ps(usar, n1));
+        n2 = _mm_or_ps(_mm_and_ps(usar, _mm_div_ps(n2, len)), _mm_andnot_ps(usar, n2));
+        _mm_store_ps(L.nx + k, n0); _mm_store_ps(L.ny + k, n1); _mm_store_ps(L.nz + k, n2);
+    }
+}
+
+// 8 faces por instrução com AVX2
+__attribute__((target("avx2")))
+static void normaisLoteAVX2(LoteFaces& L) {
+    const __m256 limite = _mm256_set1_ps(1e-8f);
+    const __m256 Ax = _mm256_load_ps(L.ax), Ay = _mm256_load_ps(L.ay), Az = _mm256_load_ps(L.az);
+    const __m256 ux = _mm256_sub_ps(_mm256_load_ps(L.bx), Ax), uy = _mm256_sub_ps(_mm256_load_ps(L.by), Ay), uz = _mm256_sub_ps(_mm256_load_ps(L.bz), Az);
+    const __m256 vx = _mm256_sub_ps(_mm256_load_ps(L.cx), Ax), vy = _mm256_sub_ps(_mm256_load_ps(L.cy), Ay), vz = _mm256_sub_ps(_mm256_load_ps(L.cz), Az);
+    __m256 n0 = _mm256_sub_ps(_mm256_mul_ps(uy, vz), _mm256_mul_ps(uz, vy));
+    __m256 n1 = _mm256_sub_ps(_mm256_mul_ps(uz, vx), _mm256_mul_ps(ux, vz));
+    __m256 n2 = _mm256_sub_ps(_mm256_mul_ps(ux, vy), _mm256_mul_ps(uy, vx));
+    const __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n0, n0), _mm256_mul_ps(n1, n1)), _mm256_mul_ps(n2, n2)));
+    const __m256 usar = _mm256_cmp_ps(len, limite, _CMP_GT_OQ);
+    n0 = _mm256_blendv_ps(n0, _mm256_div_ps(n0, len), usar);
+    n1 = _mm256_blendv_ps(n1, _mm256_div_ps(n1, len), usar);
+    n2 = _mm256_blendv_ps(n2, _mm256_div_ps(n2, len), usar);
+    _mm256_store_ps(L.nx, n0); _mm256_store_ps(L.ny, n1); _mm256_store_ps(L.nz, n2);
+}
+#endif
+
+typedef void (*KernelLote)(LoteFaces&);
+
+static KernelLote escolherKernel() {
+#ifdef NORMAIS_X86
+    if (__builtin_cpu_supports("avx2")) return normaisLoteAVX2;
+    return normaisLoteSSE;
+#else
+    return normaisLoteEscalar;
+#endif
+}
+
+// Memória extra máxima para acumuladores por thread; acima disso usa menos threads
+static const size_t MAX_BYTES_ACUMULADORES = (size_t)512 << 20;
+
+void calcularNormaisVertice(
+    const vector<float>& vertices,
+    const vector<unsigned int>& indicesPos,
+    vector<float>& normais,
+    int numThreads
+) {
+    normais.assign(vertices.size(), 0.0f);
+    if (vertices.empty()) return;
+    const size_t nF = indicesPos.size() / 3;
+    const size_t bytesAcc = vertices.size() * sizeof(float);
+    size_t threads = numThreadsEfetivo(numThreads);
+    threads = min(threads, 1 + MAX_BYTES_ACUMULADORES / max<size_t>(1, bytesAcc));
+    threads = max<size_t>(1, min(threads, nF / 4096 + 1));
+
+    // Se nenhum índice sai do intervalo, os lotes dispensam a conferência por face
+    unsigned int maiorIndice = 0;
+    for (size_t i = 0; i < nF * 3; ++i) maiorIndice = max(maiorIndice, indicesPos[i]);
+    const bool todosValidos = (size_t)maiorIndice < vertices.size() / 3;
+
+    // Acumulador próprio por thread (a thread 0 usa a própria saída): sem disputa
+    vector<vector<float>> extras(threads - 1);
+    const KernelLote kernel = escolherKernel();
+    paraCadaFaixa(nF, threads, [&](size_t t, size_t ini, size_t fim) {
+        float* acc = normais.data();
+        if (t > 0) { extras[t-1].assign(vertices.size(), 0.0f); acc = extras[t-1].data(); }
+        LoteFaces L;
+        for (size_t f = ini; f < fim; f += LOTE) {
+            const int n = (int)min<size_t>(LOTE, fim - f);
+            if (n == LOTE && todosValidos) carregarLoteCheio(vertices.data(), indicesPos.data(), f, L);
+            else carregarLote(vertices, indicesPos.data(), f, n, L);
+            kernel(L);
+            somarLote(L, acc);
+        }
+    });
+
+    // Redução na ordem das threads e normalização, em paralelo por faixa de vértices
+    const size_t nV = vertices.size() / 3;
+    paraCadaFaixa(nV, threads, [&](size_t, size_t ini, size_t fim) {
+        for (size_t v = ini; v < fim; ++v) {
+            float* n = &normais[3*v];
+            for (const auto& e : extras) { n[0] += e[3*v]; n[1] += e[3*v+1]; n[2] += e[3*v+2]; }
+            normalizarVertice(n);
+        }
+    });
+}
@@ -0,0 +1,45 @@
+// Cálculo de normais por vértice a partir dos triângulos (fallback quando o OBJ não tem vn).
+// Cada vértice recebe a soma das normais unitárias das faces que o usam, normalizada;
+// vértices sem nenhuma face recebem (0, 0, 1). Triângulos com índice fora do intervalo
+// são ignorados.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Versão rápida: normais de face com SIMD (AVX2 ou SSE, escolhido em tempo de execução,
+// com fallback escalar) e acumulação paralela sem disputa, com um acumulador por thread
+// somado no final. Com uma thread o resultado é idêntico ao escalar; com várias, a ordem
+// das somas muda e as normais diferem só no arredondamento.
+void calcularNormaisVertice(
+    const vector<float>& vertices,          // xyz
+    const vector<unsigned int>& indicesPos, // 3 por triângulo
+    vector<float>& normais,                 // saída: xyz por vértice
+    int numThreads = 0                      // 0 = núcleos disponíveis
+);
+
+// Implementação escalar original, mantida como referência para comparação
+void calcularNormaisVerticeEscalar(
+    const vector<float>& vertices,
+    const vector<unsigned int>& indicesPos,
+    vector<float>& normais
+);
+
+// Recalcula só as normais dos vértices marcados em sujos (um byte por vértice), somando as
+// faces que os usam na mesma ordem da versão escalar; as demais ficam como estão. Usado
+// pela recarga incremental (recarga.h), em que uma edição pequena toca poucos vértices.
+void atualizarNormaisVertice(
+    const vector<float>& vertices,
+    const vector<unsigned int>& indicesPos,
+    const vector<uint8_t>& sujos,
+    vector<float>& normais                  // já com vertices.size() floats
+);
+
+// Normal unitária do triângulo abc (não normaliza se a área for quase nula)
+void calcularNormalFace(const float* a, const float* b, const float* c, float n[3]);
+
+// Normaliza a soma acumulada de um vértice (sem faces: aponta para +Z)
+void normalizarVertice(float* n);
@@ -1,9 +1,30 @@
 #include "obj_loader.h"
+#include "arena.h"
+#include "bvh.h"
+#include "cache_malha.h"
+#include "layout_cantos.h"
+#include "lod.h"
+#include "normais.h"
+#include "otimizar_malha.h"
+#include "paralelo.h"
+#include "perf.h"
 
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <charconv>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <algorithm>
+#include <initializer_list>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // Para simplificar leitura do código neste trabalho acadêmico
 using namespace std;
@@ -15,32 +36,22 @@ static int idx0(int idxFromObj, int count) {
     return -1;
 }
 
-// Normal de face
-static void calcularNormalFace(const float* a, const float* b, const float* c, float n[3]) {
-    const float ux = b[0] - a[0], uy = b[1] - a[1], uz = b[2] - a[2];
-    const float vx = c[0] - a[0], vy = c[1] - a[1], vz = c[2] - a[2];
-    n[0] = uy * vz - uz * vy;
-    n[1] = uz * vx - ux * vz;
-    n[2] = ux * vy - uy * vx;
-    const float len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
-    if (len > 1e-8f) { n[0]/=len; n[1]/=len; n[2]/=len; }
-}
-
-// Divide uma string de face "v/vt/vn" em até 3 partes (pode ficar vazia em v//vn)
+// Divide uma string de face "v/vt/vn" em até 3 partes (pode ficar vazia em v//vn).
+// assign reaproveita a capacidade das strings de saída, sem alocar por canto.
 static void dividirPorBarra(const string& s, string& a, string& b, string& c) {
     size_t p1 = s.find('/');
     if (p1 == string::npos) {
-        a = s; b.clear(); c.clear(); return;
+        a.assign(s); b.clear(); c.clear(); return;
     }
-    a = s.substr(0, p1);
+    a.assign(s, 0, p1);
     size_t p2 = s.find('/', p1 + 1);
     if (p2 == string::npos) {
-        b = s.substr(p1 + 1);
+        b.assign(s, p1 + 1, string::npos);
         c.clear();
         return;
     }
-    b = s.substr(p1 + 1, p2 - (p1 + 1));
-    c = s.substr(p2 + 1);
+    b.assign(s, p1 + 1, p2 - (p1 + 1));
+    c.assign(s, p2 + 1, string::npos);
 }
 
 // Converte um token textual para inteiro (retorna false se vazio ou inválido)
@@ -50,9 +61,10 @@ static bool lerInt(const string& s, int& out) {
 }
 
 // Faz o parse de um token de face: "v", "v/vt", "v//vn" ou "v/vt/vn"
-static CantoTri parseCanto(const string& s, int vcount, int vtcount, int vncount) {
+// (partes: três strings de trabalho, reaproveitadas entre chamadas)
+static CantoTri parseCanto(const string& s, int vcount, int vtcount, int vncount, string partes[3]) {
     CantoTri canto{ -1, -1, -1 };
-    string sv, st, sn;
+    string& sv = partes[0]; string& st = partes[1]; string& sn = partes[2];
     dividirPorBarra(s, sv, st, sn);
     int iv = 0, it = 0, in = 0;
     if (lerInt(sv, iv)) canto.v  = idx0(iv, vcount);
@@ -64,146 +76,1116 @@ static CantoTri parseCanto(const string& s, int vcount, int vtcount, int vncount
     return canto;
 }
 
-bool carregarOBJParaDisplayList(
-    const string& caminho,
-    vector<float>& vertices,
-    vector<unsigned int>& indicesPos,
-    vector<float>& normaisCalculadas,
-    vector<float>& normaisOBJ,
-    vector<float>& uvs,
+// Registra uma face já convertida em cantos: triangula em fan e guarda os índices de posição
+static void registrarFace(
+    const VetorArena<CantoTri>& corners,
+    VetorArena<int>& vind,
     vector<CantoTri>& triangulos,
-    GLuint& displayListOut
+    vector<unsigned int>& tempIdx
 ) {
-    // Limpa saídas
-    vertices.clear(); indicesPos.clear(); normaisCalculadas.clear();
-    normaisOBJ.clear(); uvs.clear(); triangulos.clear();
+    // Guardar triângulos (fan)
+    if ((int)corners.size() >= 3) {
+        for (size_t k = 2; k < corners.size(); ++k) {
+            triangulos.push_back(corners[0]);
+            triangulos.push_back(corners[k-1]);
+            triangulos.push_back(corners[k]);
+        }
+    }
+    // Guardar apenas índices de posição para cálculo de normais
+    vind.clear();
+    for (const auto& c : corners) if (c.v >= 0) vind.push_back(c.v);
+    if ((int)vind.size() >= 3) {
+        for (size_t k = 2; k < vind.size(); ++k) {
+            tempIdx.push_back((unsigned int)vind[0]);
+            tempIdx.push_back((unsigned int)vind[k-1]);
+            tempIdx.push_back((unsigned int)vind[k]);
+        }
+    }
+}
+
+// Material corrente numa leitura sequencial. materialTri só começa a ser preenchido no
+// primeiro usemtl; até lá fica vazio, sem custo para OBJs sem materiais.
+struct LeituraMateriais {
+    NomesMateriais& nomes;
+    vector<int32_t>& materialTri;
+    int atual = -1;
+    bool ativo = false;
+
+    void usar(const char* s, const char* e, size_t nTris) {
+        if (!ativo) { materialTri.assign(nTris, -1); ativo = true; }
+        atual = nomes.idMaterial(s, e);
+    }
+    // Depois de cada face: os triângulos novos ficam com o material corrente
+    void completar(size_t nTris) { if (ativo) materialTri.resize(nTris, atual); }
+};
+
+static inline bool lerFloatBuf(const char*& p, const char* fim, float& out);
 
+// Linha v/vn/vt em que o istream falhou (estouro, inf, nan ou número faltando): relê os
+// números com lerFloatBuf, a regra dos outros modos. Nas linhas normais o istream e o
+// from_chars já dão o mesmo float, subnormais inclusive.
+static void relerNumerosLinha(const string& line, const string& tok, initializer_list<float*> saidas) {
+    const char* p = line.data() + line.find(tok) + tok.size();
+    const char* fim = line.data() + line.size();
+    bool ok = true;
+    for (float* f : saidas) {
+        *f = 0.0f;
+        if (ok) ok = lerFloatBuf(p, fim, *f);
+    }
+}
+
+// Leitura original: getline + istringstream por linha. É a referência do benchmark; só as
+// linhas em que o istream falha passam por relerNumerosLinha.
+static bool lerOBJStream(
+    const string& caminho,
+    vector<float>& tempVerts, vector<float>& tempVNs, vector<float>& tempVTs,
+    vector<unsigned int>& tempIdx, vector<CantoTri>& triangulos,
+    NomesMateriais& nomes, vector<int32_t>& materialTri,
+    size_t& bytesLidos, ArenaCarga* arena
+) {
     ifstream in(caminho);
     if (!in.is_open()) {
         cerr << "Falha ao abrir OBJ: " << caminho << "\n";
         return false;
     }
 
-    string line;
-    vector<float> tempVerts; tempVerts.reserve(1000);
-    vector<float> tempVNs;  tempVNs.reserve(1000);
-    vector<float> tempVTs;  tempVTs.reserve(1000);
-    vector<unsigned int> tempIdx; tempIdx.reserve(1000);
-
+    // Temporários de linha e de face criados uma vez só (os vetores vêm da arena)
+    string line, tok;
+    istringstream ls;
+    VetorArena<string> faceTokens{ AlocadorArena<string>(arena) };
+    VetorArena<CantoTri> corners{ AlocadorArena<CantoTri>(arena) };
+    VetorArena<int> vind{ AlocadorArena<int>(arena) };
+    string partes[3];
+    string resto;
+    LeituraMateriais materiais{ nomes, materialTri };
     while (std::getline(in, line)) {
+        bytesLidos += line.size() + 1;
         if (line.empty() || line[0] == '#') continue;
-        istringstream ls(line);
-        string tok; ls >> tok;
+        ls.clear();
+        ls.str(line);
+        if (!(ls >> tok)) continue;   // só espaços (ou o "\r" de uma linha vazia em CRLF)
         if (tok == "v") {
-            float x=0,y=0,z=0; ls >> x >> y >> z; tempVerts.push_back(x); tempVerts.push_back(y); tempVerts.push_back(z);
+            float x=0,y=0,z=0; ls >> x >> y >> z;
+            if (ls.fail()) relerNumerosLinha(line, tok, { &x, &y, &z });
+            tempVerts.push_back(x); tempVerts.push_back(y); tempVerts.push_back(z);
         } else if (tok == "vn") {
-            float x=0,y=0,z=0; ls >> x >> y >> z; tempVNs.push_back(x); tempVNs.push_back(y); tempVNs.push_back(z);
+            float x=0,y=0,z=0; ls >> x >> y >> z;
+            if (ls.fail()) relerNumerosLinha(line, tok, { &x, &y, &z });
+            tempVNs.push_back(x); tempVNs.push_back(y); tempVNs.push_back(z);
         } else if (tok == "vt") {
-            float u=0,v=0; ls >> u >> v; tempVTs.push_back(u); tempVTs.push_back(v);
+            float u=0,v=0; ls >> u >> v;
+            if (ls.fail()) relerNumerosLinha(line, tok, { &u, &v });
+            tempVTs.push_back(u); tempVTs.push_back(v);
         } else if (tok == "f") {
-            vector<string> faceTokens; string fstr; while (ls >> fstr) faceTokens.push_back(fstr);
-            if (faceTokens.size() < 3) continue;
+            // As strings de faceTokens ficam vivas entre faces; nTokens conta as desta face
+            size_t nTokens = 0;
+            for (;;) {
+                if (nTokens == faceTokens.size()) faceTokens.emplace_back();
+                if (!(ls >> faceTokens[nTokens])) break;
+                ++nTokens;
+            }
+            if (nTokens < 3) continue;
             const int vcount  = (int)(tempVerts.size() / 3);
             const int vtcount = (int)(tempVTs.size()  / 2);
             const int vncount = (int)(tempVNs.size()  / 3);
-            vector<CantoTri> corners; corners.reserve(faceTokens.size());
-            for (const auto& s : faceTokens) corners.push_back(parseCanto(s, vcount, vtcount, vncount));
-            // Guardar triângulos (fan)
-            if ((int)corners.size() >= 3) {
-                for (size_t k = 2; k < corners.size(); ++k) {
-                    triangulos.push_back(corners[0]);
-                    triangulos.push_back(corners[k-1]);
-                    triangulos.push_back(corners[k]);
-                }
-            }
-            // Guardar apenas índices de posição para cálculo de normais
-            vector<int> vind; vind.reserve(corners.size());
-            for (const auto& c : corners) if (c.v >= 0) vind.push_back(c.v);
-            if ((int)vind.size() >= 3) {
-                for (size_t k = 2; k < vind.size(); ++k) {
-                    tempIdx.push_back((unsigned int)vind[0]);
-                    tempIdx.push_back((unsigned int)vind[k-1]);
-                    tempIdx.push_back((unsigned int)vind[k]);
-                }
-            }
+            corners.clear();
+            for (size_t k = 0; k < nTokens; ++k) corners.push_back(parseCanto(faceTokens[k], vcount, vtcount, vncount, partes));
+            registrarFace(corners, vind, triangulos, tempIdx);
+            materiais.completar(triangulos.size() / 3);
+        } else if (tok == "usemtl") {
+            getline(ls, resto);
+            materiais.usar(resto.data(), resto.data() + resto.size(), triangulos.size() / 3);
+        } else if (tok == "mtllib") {
+            getline(ls, resto);
+            nomes.acrescentarBibliotecas(resto.data(), resto.data() + resto.size());
         }
     }
     in.close();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Leitura rápida: arquivo mapeado em memória e tokenização no próprio buffer.
+// Nenhuma alocação por linha; os números são lidos com std::from_chars, que não
+// depende de locale e arredonda igual ao strtof usado pelo istream.
+// ---------------------------------------------------------------------------
 
-    if (tempVerts.empty() || tempIdx.empty()) {
-    cerr << "OBJ vazio ou sem faces: " << caminho << "\n";
+// Espaço dentro de uma linha (a quebra '\n' encerra a linha e é tratada à parte)
+static inline bool ehEspaco(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+static inline void pularEspacos(const char*& p, const char* fim) {
+    while (p < fim && ehEspaco(*p)) ++p;
+}
+
+// Próximo token da linha em [s, e); devolve false no fim da linha
+static inline bool proximoToken(const char*& p, const char* fim, const char*& s, const char*& e) {
+    pularEspacos(p, fim);
+    if (p >= fim) return false;
+    s = p;
+    while (p < fim && !ehEspaco(*p)) ++p;
+    e = p;
+    return true;
+}
+
+// Valor de um número fora da faixa do float em [s, e) (como casado pelo from_chars, com o
+// sinal): ±FLT_MAX se estoura, como o istream faz, e zero se é pequeno demais. A ordem de
+// grandeza vem da posição do primeiro dígito não nulo somada ao expoente.
+static float floatForaDaFaixa(const char* s, const char* e) {
+    const bool negativo = s < e && *s == '-';
+    if (negativo) ++s;
+    long long ordem = 0;
+    bool ponto = false, significativo = false;
+    for (; s < e && *s != 'e' && *s != 'E'; ++s) {
+        if (*s == '.') { ponto = true; continue; }
+        if (!significativo && *s == '0') { if (ponto) --ordem; continue; }
+        significativo = true;
+        if (!ponto) ++ordem;
+    }
+    if (s < e) {   // expoente; um expoente enorme demais para long long só precisa do sinal
+        const char* x = s + 1;
+        if (x < e && *x == '+') ++x;
+        long long expoente = 0;
+        if (from_chars(x, e, expoente).ec != errc()) expoente = (*x == '-') ? -(1LL << 40) : (1LL << 40);
+        ordem += expoente;
+    }
+    const float v = (significativo && ordem > 0) ? FLT_MAX : 0.0f;
+    return negativo ? -v : v;
+}
+
+// Lê um float a partir de p (aceita '+' inicial como o istream); avança p se conseguir.
+// Regra única para todos os modos de leitura: fora da faixa vira ±FLT_MAX ou zero e a linha
+// continua; inf e nan não são coordenadas válidas, valem zero e encerram a linha como
+// qualquer outro texto que não é número.
+static inline bool lerFloatBuf(const char*& p, const char* fim, float& out) {
+    pularEspacos(p, fim);
+    const char* q = p;
+    if (q < fim && *q == '+') ++q;
+    auto r = from_chars(q, fim, out);
+    if (r.ec == errc::result_out_of_range) {
+        out = floatForaDaFaixa(q, r.ptr);
+    } else if (r.ec != errc()) {
         return false;
+    } else if (!isfinite(out)) {
+        out = 0.0f;
+        return false;
+    }
+    p = r.ptr;
+    return true;
+}
+
+// Equivalente a lerInt/stoi sobre o intervalo [p, fim): lê o prefixo numérico
+static inline bool lerIntBuf(const char* p, const char* fim, int& out) {
+    if (p < fim && *p == '+') ++p;
+    auto r = from_chars(p, fim, out);
+    return r.ec == errc();
+}
+
+// Separa o token "v/vt/vn" em [s, e) nos índices crus do arquivo (0 quando ausente ou inválido)
+static void lerCantoBruto(const char* s, const char* e, int bruto[3]) {
+    const char* p1 = static_cast<const char*>(memchr(s, '/', (size_t)(e - s)));
+    const char* fimA = p1 ? p1 : e;
+    const char* iniB = e; const char* fimB = e;
+    const char* iniC = e;
+    if (p1) {
+        iniB = p1 + 1;
+        const char* p2 = static_cast<const char*>(memchr(iniB, '/', (size_t)(e - iniB)));
+        fimB = p2 ? p2 : e;
+        iniC = p2 ? p2 + 1 : e;
     }
+    if (!lerIntBuf(s, fimA, bruto[0]))    bruto[0] = 0;
+    if (!lerIntBuf(iniB, fimB, bruto[1])) bruto[1] = 0;
+    if (!lerIntBuf(iniC, e, bruto[2]))    bruto[2] = 0;
+}
+
+// Converte índices crus em CantoTri com as mesmas regras de parseCanto
+static inline CantoTri resolverCanto(const int bruto[3], int vcount, int vtcount, int vncount) {
+    CantoTri canto{ idx0(bruto[0], vcount), idx0(bruto[1], vtcount), idx0(bruto[2], vncount) };
+    if (canto.v  < 0 || canto.v  >= vcount)  canto.v = -1;
+    if (canto.vt < 0 || canto.vt >= vtcount) canto.vt = -1;
+    if (canto.vn < 0 || canto.vn >= vncount) canto.vn = -1;
+    return canto;
+}
 
-    vertices.swap(tempVerts);
-    indicesPos.swap(tempIdx);
-    normaisOBJ.swap(tempVNs);
-    uvs.swap(tempVTs);
+// Percorre as linhas de [p, fimArquivo) e chama o visitante para cada v/vn/vt/f/usemtl/mtllib.
+// Para faces e materiais, o visitante recebe o restante da linha (depois do comando).
+template <class Visitante>
+static void percorrerOBJ(const char* p, const char* fimArquivo, Visitante& vis) {
+    while (p < fimArquivo) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(fimArquivo - p)));
+        const char* fim = nl ? nl : fimArquivo;
+        const char* linha = p;
+        p = nl ? nl + 1 : fimArquivo;
 
-    // Normais por vértice (soma de normais de face, depois normaliza)
-    normaisCalculadas.assign(vertices.size(), 0.0f);
-    for (size_t i = 0; i + 2 < indicesPos.size(); i += 3) {
-        const unsigned int ia = indicesPos[i+0] * 3u;
-        const unsigned int ib = indicesPos[i+1] * 3u;
-        const unsigned int ic = indicesPos[i+2] * 3u;
-        if (ia+2 >= vertices.size() || ib+2 >= vertices.size() || ic+2 >= vertices.size()) continue;
-        const float* A = &vertices[ia];
-        const float* B = &vertices[ib];
-        const float* C = &vertices[ic];
-        float n[3]; calcularNormalFace(A, B, C, n);
-        normaisCalculadas[ia+0] += n[0]; normaisCalculadas[ia+1] += n[1]; normaisCalculadas[ia+2] += n[2];
-        normaisCalculadas[ib+0] += n[0]; normaisCalculadas[ib+1] += n[1]; normaisCalculadas[ib+2] += n[2];
-        normaisCalculadas[ic+0] += n[0]; normaisCalculadas[ic+1] += n[1]; normaisCalculadas[ic+2] += n[2];
-    }
-    for (size_t v = 0; v + 2 < normaisCalculadas.size(); v += 3) {
-        float nx = normaisCalculadas[v+0], ny = normaisCalculadas[v+1], nz = normaisCalculadas[v+2];
-        float len = std::sqrt(nx*nx + ny*ny + nz*nz);
-        if (len > 1e-8f) { normaisCalculadas[v+0] = nx/len; normaisCalculadas[v+1] = ny/len; normaisCalculadas[v+2] = nz/len; }
-        else { normaisCalculadas[v+0] = 0; normaisCalculadas[v+1] = 0; normaisCalculadas[v+2] = 1; }
-    }
-
-    // Display list com preenchimento, usando vn/vt quando existem
-    if (displayListOut != 0) {
-        glDeleteLists(displayListOut, 1);
-        displayListOut = 0;
-    }
-    displayListOut = glGenLists(1);
-    glNewList(displayListOut, GL_COMPILE);
-    glPushMatrix();
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glDisable(GL_CULL_FACE);
-    glColor3f(1.0f, 1.0f, 1.0f);
-
-    glBegin(GL_TRIANGLES);
-    if (!triangulos.empty()) {
-        const bool hasVN = !normaisOBJ.empty();
-        const bool hasVT = !uvs.empty();
-        for (size_t i = 0; i + 2 < triangulos.size(); i += 3) {
-            for (int k = 0; k < 3; ++k) {
-                const CantoTri& c = triangulos[i+k];
-                if (hasVN && c.vn >= 0) {
-                    const float* N = &normaisOBJ[(size_t)c.vn * 3u]; glNormal3fv(N);
-                } else if (c.v >= 0) {
-                    const float* N = &normaisCalculadas[(size_t)c.v * 3u]; glNormal3fv(N);
-                }
-                if (hasVT && c.vt >= 0) {
-                    const float* T = &uvs[(size_t)c.vt * 2u]; glTexCoord2fv(T);
-                }
-                if (c.v >= 0) {
-                    const float* P = &vertices[(size_t)c.v * 3u]; glVertex3fv(P);
+        if (linha == fim || *linha == '#') continue;
+        const char* tok; const char* fimTok;
+        if (!proximoToken(linha, fim, tok, fimTok)) continue;
+        const size_t ntok = (size_t)(fimTok - tok);
+
+        if (ntok == 1 && tok[0] == 'v') {
+            float x=0,y=0,z=0;
+            (void)(lerFloatBuf(linha, fim, x) && lerFloatBuf(linha, fim, y) && lerFloatBuf(linha, fim, z));
+            vis.vertice(x, y, z);
+        } else if (ntok == 2 && tok[0] == 'v' && tok[1] == 'n') {
+            float x=0,y=0,z=0;
+            (void)(lerFloatBuf(linha, fim, x) && lerFloatBuf(linha, fim, y) && lerFloatBuf(linha, fim, z));
+            vis.normal(x, y, z);
+        } else if (ntok == 2 && tok[0] == 'v' && tok[1] == 't') {
+            float u=0,v=0;
+            (void)(lerFloatBuf(linha, fim, u) && lerFloatBuf(linha, fim, v));
+            vis.uv(u, v);
+        } else if (ntok == 1 && tok[0] == 'f') {
+            vis.face(linha, fim);
+        } else if (ntok == 6 && memcmp(tok, "usemtl", 6) == 0) {
+            vis.material(linha, fim);
+        } else if (ntok == 6 && memcmp(tok, "mtllib", 6) == 0) {
+            vis.biblioteca(linha, fim);
+        }
+    }
+}
+
+// Arquivo inteiro mapeado somente leitura (desmapeia no destrutor)
+struct ArquivoMapeado {
+    const char* dados = nullptr;
+    size_t tamanho = 0;
+
+    bool abrir(const string& caminho) {
+        int fd = open(caminho.c_str(), O_RDONLY);
+        if (fd < 0) {
+            cerr << "Falha ao abrir OBJ: " << caminho << "\n";
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            cerr << "Falha ao abrir OBJ: " << caminho << "\n";
+            close(fd);
+            return false;
+        }
+        tamanho = (size_t)st.st_size;
+        if (tamanho == 0) { close(fd); return true; }
+        void* mapa = mmap(nullptr, tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapa == MAP_FAILED) {
+            cerr << "Falha ao mapear OBJ: " << caminho << "\n";
+            tamanho = 0;
+            return false;
+        }
+        dados = static_cast<const char*>(mapa);
+        return true;
+    }
+
+    ~ArquivoMapeado() {
+        if (dados) munmap(const_cast<char*>(dados), tamanho);
+    }
+};
+
+// Triângulos por chamada de progresso na leitura sequencial
+static const size_t TRIS_POR_PROGRESSO = 65536;
+
+// Visitante da leitura sequencial: resolve os índices na hora, contra as contagens correntes
+
+struct LeitorSequencial {
+    vector<float>& verts; vector<float>& vns; vector<float>& vts;
+    vector<unsigned int>& idx; vector<CantoTri>& tris;
+    LeituraMateriais materiais;
+    // Reaproveitados entre faces: depois da primeira face grande não alocam mais
+    VetorArena<CantoTri> corners;
+    VetorArena<int> vind;
+    // Progresso (opcional)
+    const function<void(const ProgressoCarga&)>* aoProgresso = nullptr;
+    const char* inicioArquivo = nullptr;
+    size_t tamanhoArquivo = 0;
+    size_t cantosInformados = 0;
+
+    void informarProgresso(const char* posicao) {
+        ProgressoCarga p;
+        p.bytesLidos = (size_t)(posicao - inicioArquivo);
+        p.bytesTotal = tamanhoArquivo;
+        p.triangulos = tris.size() / 3;
+        p.trisNovos = tris.data() + cantosInformados;
+        p.nCantosNovos = tris.size() - cantosInformados;
+        p.vertices = verts.data();         p.nVertices = verts.size();
+        p.normaisOBJ = vns.data(); p.nNormaisOBJ = vns.size();
+        p.uvs = vts.data();        p.nUVs = vts.size();
+        (*aoProgresso)(p);
+        cantosInformados = tris.size();
+    }
+
+    void vertice(float x, float y, float z) { verts.push_back(x); verts.push_back(y); verts.push_back(z); }
+    void normal(float x, float y, float z)  { vns.push_back(x); vns.push_back(y); vns.push_back(z); }
+    void uv(float u, float v)               { vts.push_back(u); vts.push_back(v); }
+    void material(const char* s, const char* e)   { materiais.usar(s, e, tris.size() / 3); }
+    void biblioteca(const char* s, const char* e) { materiais.nomes.acrescentarBibliotecas(s, e); }
+
+    void face(const char* p, const char* fim) {
+        const int vcount  = (int)(verts.size() / 3);
+        const int vtcount = (int)(vts.size()   / 2);
+        const int vncount = (int)(vns.size()   / 3);
+        corners.clear();
+        const char* s; const char* e;
+        while (proximoToken(p, fim, s, e)) {
+            int bruto[3]; lerCantoBruto(s, e, bruto);
+            corners.push_back(resolverCanto(bruto, vcount, vtcount, vncount));
+        }
+        if (corners.size() < 3) return;
+        registrarFace(corners, vind, tris, idx);
+        materiais.completar(tris.size() / 3);
+        if (aoProgresso && tris.size() - cantosInformados >= TRIS_POR_PROGRESSO * 3) informarProgresso(fim);
+    }
+};
+
+static bool lerOBJMmap(
+    const string& caminho,
+    vector<float>& tempVerts, vector<float>& tempVNs, vector<float>& tempVTs,
+    vector<unsigned int>& tempIdx, vector<CantoTri>& triangulos,
+    NomesMateriais& nomes, vector<int32_t>& materialTri,
+    size_t& bytesLidos,
+    const function<void(const ProgressoCarga&)>& aoProgresso,
+    ArenaCarga* arena
+) {
+    ArquivoMapeado arq;
+    if (!arq.abrir(caminho)) return false;
+    if (arq.tamanho == 0) return true;
+    madvise(const_cast<char*>(arq.dados), arq.tamanho, MADV_SEQUENTIAL);
+
+    LeitorSequencial leitor{ tempVerts, tempVNs, tempVTs, tempIdx, triangulos, LeituraMateriais{ nomes, materialTri },
+                             VetorArena<CantoTri>(AlocadorArena<CantoTri>(arena)), VetorArena<int>(AlocadorArena<int>(arena)) };
+    leitor.corners.reserve(16);
+    leitor.vind.reserve(16);
+    if (aoProgresso) {
+        leitor.aoProgresso = &aoProgresso;
+        leitor.inicioArquivo = arq.dados;
+        leitor.tamanhoArquivo = arq.tamanho;
+    }
+    percorrerOBJ(arq.dados, arq.dados + arq.tamanho, leitor);
+    if (aoProgresso) leitor.informarProgresso(arq.dados + arq.tamanho);
+    bytesLidos = arq.tamanho;
+    return true;
+}
+
+// Visitante da leitura em blocos: guarda só as contagens (para resolver os índices) e a
+// face corrente; o resto vai direto para o LeitorOBJBlocos
+struct VisitanteBlocos {
+    const LeitorOBJBlocos& saida;
+    int vcount = 0, vtcount = 0, vncount = 0;
+    bool estourou = false;
+    vector<CantoTri> corners;
+
+    explicit VisitanteBlocos(const LeitorOBJBlocos& saida) : saida(saida) {}
+
+    void vertice(float x, float y, float z) { contar(vcount); if (saida.aoVertice) saida.aoVertice(x, y, z); }
+    void normal(float x, float y, float z)  { contar(vncount); if (saida.aoNormal) saida.aoNormal(x, y, z); }
+    void uv(float u, float v)               { contar(vtcount); if (saida.aoUV) saida.aoUV(u, v); }
+    // O modo paginado desenha tudo com um material só
+    void material(const char*, const char*) {}
+    void biblioteca(const char*, const char*) {}
+
+    void contar(int& n) {
+        if (n == INT_MAX) estourou = true;
+        else ++n;
+    }
+
+    void face(const char* p, const char* fim) {
+        corners.clear();
+        const char* s; const char* e;
+        while (proximoToken(p, fim, s, e)) {
+            int bruto[3]; lerCantoBruto(s, e, bruto);
+            corners.push_back(resolverCanto(bruto, vcount, vtcount, vncount));
+        }
+        for (size_t k = 2; k < corners.size(); ++k) {
+            const CantoTri tri[3] = { corners[0], corners[k-1], corners[k] };
+            saida.aoTriangulo(tri);
+        }
+    }
+};
+
+bool lerOBJEmBlocos(const string& caminho, size_t bytesBloco, const LeitorOBJBlocos& leitor, size_t& bytesLidos) {
+    bytesLidos = 0;
+    const int fd = open(caminho.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Falha ao abrir OBJ: " << caminho << "\n";
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    VisitanteBlocos vis(leitor);
+    vis.corners.reserve(16);
+    vector<char> buf(max<size_t>(bytesBloco, 4096));
+    size_t cheio = 0;   // bytes válidos em buf (o começo é o resto da linha do bloco anterior)
+    for (;;) {
+        const ssize_t n = read(fd, buf.data() + cheio, buf.size() - cheio);
+        if (n < 0) {
+            cerr << "Falha ao ler OBJ: " << caminho << "\n";
+            close(fd);
+            return false;
+        }
+        cheio += (size_t)n;
+        bytesLidos += (size_t)n;
+        if (n == 0) {
+            percorrerOBJ(buf.data(), buf.data() + cheio, vis);
+            break;
+        }
+        // Processa até a última quebra de linha; o resto passa para o próximo bloco
+        const char* ultimo = static_cast<const char*>(memrchr(buf.data(), '\n', cheio));
+        if (!ultimo) {
+            if (cheio == buf.size()) buf.resize(buf.size() * 2);   // linha maior que o bloco
+            continue;
+        }
+        const size_t usado = (size_t)(ultimo - buf.data()) + 1;
+        percorrerOBJ(buf.data(), buf.data() + usado, vis);
+        memmove(buf.data(), buf.data() + usado, cheio - usado);
+        cheio -= usado;
+    }
+    close(fd);
+    if (vis.estourou) {
+        cerr << "OBJ com elementos demais para índices int: " << caminho << "\n";
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Leitura paralela: o arquivo é dividido em blocos em fronteiras de linha e
+// cada thread lê o seu bloco guardando os índices de face crus. Uma soma de
+// prefixos das contagens de v/vt/vn dá a base de cada bloco; com ela cada
+// bloco resolve os índices (inclusive negativos) exatamente como a leitura
+// sequencial faria, e outra soma de prefixos posiciona os resultados finais.
+// ---------------------------------------------------------------------------
+
+// Resultado local de uma thread
+struct BlocoOBJ {
+    const char* ini = nullptr;
+    const char* fim = nullptr;
+
+    vector<float> verts, vns, vts;
+    vector<int> cantosBrutos;        // 3 ints (v, vt, vn) crus por canto
+    vector<unsigned int> faces;      // por face: nº de cantos e contagens locais de v, vt, vn
+
+    // Materiais: trocas (face local, nome) e bibliotecas vistas no bloco; os ids globais
+    // saem de uma passada sequencial pelos blocos, antes da resolução
+    vector<pair<size_t, string>> trocasMaterial;
+    vector<string> bibliotecas;
+    vector<int> idsTrocas;
+    int materialInicial = -1;    // o último usemtl dos blocos anteriores
+
+    // Depois da resolução
+    vector<CantoTri> tris;
+    vector<unsigned int> idx;
+    vector<int32_t> materialTri;   // só com materiais em algum bloco
+
+    // Bases globais vindas da soma de prefixos
+    size_t baseV = 0, baseVT = 0, baseVN = 0, baseTri = 0, baseIdx = 0;
+
+    void vertice(float x, float y, float z) { verts.push_back(x); verts.push_back(y); verts.push_back(z); }
+    void normal(float x, float y, float z)  { vns.push_back(x); vns.push_back(y); vns.push_back(z); }
+    void uv(float u, float v)               { vts.push_back(u); vts.push_back(v); }
+    void material(const char* s, const char* e)   { trocasMaterial.emplace_back(faces.size() / 4, string(s, e)); }
+    void biblioteca(const char* s, const char* e) { bibliotecas.emplace_back(s, e); }
+
+    void face(const char* p, const char* fim) {
+        const size_t inicio = cantosBrutos.size();
+        const char* s; const char* e;
+        while (proximoToken(p, fim, s, e)) {
+            int bruto[3]; lerCantoBruto(s, e, bruto);
+            cantosBrutos.insert(cantosBrutos.end(), bruto, bruto + 3);
+        }
+        const size_t n = (cantosBrutos.size() - inicio) / 3;
+        if (n < 3) { cantosBrutos.resize(inicio); return; }
+        faces.push_back((unsigned int)n);
+        faces.push_back((unsigned int)(verts.size() / 3));
+        faces.push_back((unsigned int)(vts.size()   / 2));
+        faces.push_back((unsigned int)(vns.size()   / 3));
+    }
+
+    // Resolve os índices crus com as bases globais e triangula
+    void resolver(bool comMateriais) {
+        VetorArena<CantoTri> corners; corners.reserve(16);
+        VetorArena<int> vind; vind.reserve(16);
+        const int* bruto = cantosBrutos.data();
+        int material = materialInicial;
+        size_t proximaTroca = 0;
+        for (size_t f = 0; f + 3 < faces.size(); f += 4) {
+            while (proximaTroca < idsTrocas.size() && trocasMaterial[proximaTroca].first <= f / 4)
+                material = idsTrocas[proximaTroca++];
+            const int vcount  = (int)(baseV  + faces[f+1]);
+            const int vtcount = (int)(baseVT + faces[f+2]);
+            const int vncount = (int)(baseVN + faces[f+3]);
+            corners.clear();
+            for (unsigned int k = 0; k < faces[f]; ++k, bruto += 3)
+                corners.push_back(resolverCanto(bruto, vcount, vtcount, vncount));
+            registrarFace(corners, vind, tris, idx);
+            if (comMateriais) materialTri.resize(tris.size() / 3, material);
+        }
+        vector<int>().swap(cantosBrutos);
+        vector<unsigned int>().swap(faces);
+    }
+};
+
+static bool lerOBJParalelo(
+    const string& caminho,
+    vector<float>& tempVerts, vector<float>& tempVNs, vector<float>& tempVTs,
+    vector<unsigned int>& tempIdx, vector<CantoTri>& triangulos,
+    NomesMateriais& nomes, vector<int32_t>& materialTri,
+    size_t& bytesLidos, int numThreads
+) {
+    ArquivoMapeado arq;
+    if (!arq.abrir(caminho)) return false;
+    if (arq.tamanho == 0) return true;
+
+    // Blocos muito pequenos não compensam o custo das threads
+    const size_t minBloco = 1u << 20;
+    const size_t n = max<size_t>(1, min(numThreadsEfetivo(numThreads), arq.tamanho / minBloco));
+
+    // Divide em fronteiras de linha
+    vector<BlocoOBJ> blocos(n);
+    const char* const fimArquivo = arq.dados + arq.tamanho;
+    const char* p = arq.dados;
+    for (size_t i = 0; i < n; ++i) {
+        blocos[i].ini = p;
+        const char* alvo = (i + 1 == n) ? fimArquivo : arq.dados + arq.tamanho * (i + 1) / n;
+        if (alvo < p) alvo = p;
+        if (alvo < fimArquivo) {
+            const char* nl = static_cast<const char*>(memchr(alvo, '\n', (size_t)(fimArquivo - alvo)));
+            alvo = nl ? nl + 1 : fimArquivo;
+        }
+        blocos[i].fim = alvo;
+        p = alvo;
+    }
+
+    // 1) Leitura local de cada bloco
+    paraCadaBloco(n, [&](size_t i) {
+        percorrerOBJ(blocos[i].ini, blocos[i].fim, blocos[i]);
+    });
+
+    // 2) Soma de prefixos das contagens de v/vt/vn
+    size_t totV = 0, totVT = 0, totVN = 0;
+    for (auto& b : blocos) {
+        b.baseV = totV; b.baseVT = totVT; b.baseVN = totVN;
+        totV += b.verts.size() / 3; totVT += b.vts.size() / 2; totVN += b.vns.size() / 3;
+    }
+    if (totV > (size_t)INT_MAX || totVT > (size_t)INT_MAX || totVN > (size_t)INT_MAX) {
+        cerr << "OBJ com elementos demais para índices int: " << caminho << "\n";
+        return false;
+    }
+
+    // Ids globais dos materiais, na ordem do arquivo (igual à leitura sequencial)
+    bool comMateriais = false;
+    int material = -1;
+    for (auto& b : blocos) {
+        for (const string& lib : b.bibliotecas) nomes.acrescentarBibliotecas(lib.data(), lib.data() + lib.size());
+        b.materialInicial = material;
+        for (const auto& t : b.trocasMaterial) {
+            b.idsTrocas.push_back(material = nomes.idMaterial(t.second.data(), t.second.data() + t.second.size()));
+            comMateriais = true;
+        }
+    }
+
+    // 3) Resolução dos índices com as bases globais
+    paraCadaBloco(n, [&](size_t i) { blocos[i].resolver(comMateriais); });
+
+    // 4) Soma de prefixos das saídas e cópia para os buffers finais
+    size_t totTri = 0, totIdx = 0;
+    for (auto& b : blocos) {
+        b.baseTri = totTri; b.baseIdx = totIdx;
+        totTri += b.tris.size(); totIdx += b.idx.size();
+    }
+    tempVerts.resize(totV * 3); tempVTs.resize(totVT * 2); tempVNs.resize(totVN * 3);
+    triangulos.resize(totTri); tempIdx.resize(totIdx);
+    if (comMateriais) materialTri.resize(totTri / 3);
+    paraCadaBloco(n, [&](size_t i) {
+        BlocoOBJ& b = blocos[i];
+        copy(b.verts.begin(), b.verts.end(), tempVerts.begin() + b.baseV * 3);
+        copy(b.vts.begin(),   b.vts.end(),   tempVTs.begin()   + b.baseVT * 2);
+        copy(b.vns.begin(),   b.vns.end(),   tempVNs.begin()   + b.baseVN * 3);
+        copy(b.tris.begin(),  b.tris.end(),  triangulos.begin() + b.baseTri);
+        copy(b.idx.begin(),   b.idx.end(),   tempIdx.begin()    + b.baseIdx);
+        if (comMateriais) copy(b.materialTri.begin(), b.materialTri.end(), materialTri.begin() + b.baseTri / 3);
+    });
+
+    bytesLidos = arq.tamanho;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Trechos para a recarga incremental. Um trecho novo começa em cada linha o/g e nos cortes
+// escolhidos pelo conteúdo: depois de uma linha cujo hash tem os bits baixos zerados (e
+// respeitando um mínimo e um máximo de linhas). Como o corte depende só do texto das
+// linhas, uma edição local muda o trecho onde ela caiu e os cortes voltam a coincidir logo
+// depois.
+// ---------------------------------------------------------------------------
+
+static const size_t MIN_LINHAS_TRECHO = 4096;
+static const size_t MAX_LINHAS_TRECHO = 262144;
+static const uint64_t MASCARA_CORTE = (1u << 15) - 1;   // ~32 mil linhas por trecho depois do mínimo
+
+static inline uint64_t hashLinha(const char* p, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w; memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    for (; i < n; ++i) h = (h ^ (unsigned char)p[i]) * 0x100000001b3ull;
+    return h ^ (h >> 32);
+}
+
+void dividirTrechosOBJ(const char* dados, size_t tamanho, vector<TrechoOBJ>& out) {
+    out.clear();
+    const char* const fimArquivo = dados + tamanho;
+    const char* p = dados;
+    TrechoOBJ atual;
+    size_t linhas = 0;
+    auto fechar = [&](const char* fim) {
+        atual.fim = (size_t)(fim - dados);
+        out.push_back(atual);
+        atual = TrechoOBJ();
+        atual.inicio = (size_t)(fim - dados);
+        linhas = 0;
+    };
+    while (p < fimArquivo) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(fimArquivo - p)));
+        const char* fim = nl ? nl : fimArquivo;
+        const char* linha = p;
+        const char* proxima = nl ? nl + 1 : fimArquivo;
+
+        const char* cursor = linha;
+        const char* tok = nullptr; const char* fimTok = nullptr;
+        const bool temTok = linha < fim && *linha != '#' && proximoToken(cursor, fim, tok, fimTok);
+        const size_t ntok = temTok ? (size_t)(fimTok - tok) : 0;
+        if (ntok == 1 && (tok[0] == 'o' || tok[0] == 'g') && linhas > 0) fechar(linha);
+
+        const uint64_t h = hashLinha(linha, (size_t)(fim - linha));
+        atual.hash = (atual.hash ^ h) * 0x100000001b3ull;
+        atual.hash ^= atual.hash >> 29;
+        ++linhas;
+        if (ntok == 1 && tok[0] == 'v') ++atual.nV;
+        else if (ntok == 2 && tok[0] == 'v' && tok[1] == 't') ++atual.nVT;
+        else if (ntok == 2 && tok[0] == 'v' && tok[1] == 'n') ++atual.nVN;
+        else if (ntok == 6 && memcmp(tok, "usemtl", 6) == 0) {
+            const char* a = fimTok; const char* b = fim;
+            while (a < b && ehEspaco(*a)) ++a;
+            while (b > a && ehEspaco(b[-1])) --b;
+            atual.ultimoMaterial.assign(a, b);
+        }
+
+        p = proxima;
+        if ((linhas >= MIN_LINHAS_TRECHO && (h & MASCARA_CORTE) == 0) || linhas >= MAX_LINHAS_TRECHO) fechar(p);
+    }
+    if (linhas > 0 || out.empty()) fechar(fimArquivo);
+}
+
+bool lerTrechoOBJ(const char* p, const char* fim, size_t baseV, size_t baseVT, size_t baseVN, TrechoLido& out) {
+    BlocoOBJ b;
+    percorrerOBJ(p, fim, b);
+    if (baseV + b.verts.size() / 3 > (size_t)INT_MAX || baseVT + b.vts.size() / 2 > (size_t)INT_MAX
+        || baseVN + b.vns.size() / 3 > (size_t)INT_MAX) return false;
+    b.baseV = baseV; b.baseVT = baseVT; b.baseVN = baseVN;
+    out.nomes = NomesMateriais();
+    for (const string& lib : b.bibliotecas) out.nomes.acrescentarBibliotecas(lib.data(), lib.data() + lib.size());
+    // Ids locais ao trecho; -1 (materialInicial) é o material herdado dos trechos anteriores
+    for (const auto& t : b.trocasMaterial)
+        b.idsTrocas.push_back(out.nomes.idMaterial(t.second.data(), t.second.data() + t.second.size()));
+    b.resolver(!b.trocasMaterial.empty());
+    out.vertices.swap(b.verts);
+    out.normaisOBJ.swap(b.vns);
+    out.uvs.swap(b.vts);
+    out.triangulos.swap(b.tris);
+    out.indicesPos.swap(b.idx);
+    out.materialTri.swap(b.materialTri);
+    return true;
+}
+
+// Tabela hash com endereçamento aberto para a deduplicação: chave (v, vt, vn) -> vértice
+struct TabelaCantos {
+    struct Entrada { int v, vt, vn; uint32_t id; };
+    VetorArena<Entrada> entradas;
+    size_t mascara = 0;
+    size_t ocupadas = 0;
+    ArenaCarga* arena;
+
+    TabelaCantos(size_t capacidadeEsperada, ArenaCarga* arena)
+        : entradas(AlocadorArena<Entrada>(arena)), arena(arena) {
+        size_t n = 16;
+        while (n < capacidadeEsperada * 2) n <<= 1;
+        entradas.assign(n, Entrada{ 0, 0, 0, UINT32_MAX });
+        mascara = n - 1;
+    }
+
+    static size_t hash(int v, int vt, int vn) {
+        uint64_t h = (uint32_t)v * 0x9e3779b97f4a7c15ull;
+        h ^= (uint32_t)vt * 0xc2b2ae3d27d4eb4full + (h >> 31);
+        h ^= (uint32_t)vn * 0x165667b19e3779f9ull + (h >> 29);
+        return (size_t)(h ^ (h >> 32));
+    }
+
+    // Dobra a tabela e reinsere; os ids não mudam, então o resultado não depende do tamanho
+    void crescer() {
+        VetorArena<Entrada> antigas{ AlocadorArena<Entrada>(arena) };
+        antigas.swap(entradas);
+        entradas.assign(antigas.size() * 2, Entrada{ 0, 0, 0, UINT32_MAX });
+        mascara = entradas.size() - 1;
+        for (const Entrada& a : antigas) {
+            if (a.id == UINT32_MAX) continue;
+            size_t i = hash(a.v, a.vt, a.vn) & mascara;
+            while (entradas[i].id != UINT32_MAX) i = (i + 1) & mascara;
+            entradas[i] = a;
+        }
+    }
+
+    // Devolve o id da chave; se ela não existia, registra com novoId e marca inserido.
+    // A estimativa inicial pode ficar curta (malhas com uma normal por face, faces dos dois
+    // lados): a tabela cresce antes de passar de metade cheia.
+    uint32_t buscarOuInserir(int v, int vt, int vn, uint32_t novoId, bool& inserido) {
+        size_t i = hash(v, vt, vn) & mascara;
+        for (size_t passo = 0; passo <= mascara; ++passo) {
+            Entrada& e = entradas[i];
+            if (e.id == UINT32_MAX) {
+                if ((ocupadas + 1) * 2 > entradas.size()) break;
+                e = Entrada{ v, vt, vn, novoId };
+                ++ocupadas;
+                inserido = true;
+                return novoId;
+            }
+            if (e.v == v && e.vt == vt && e.vn == vn) { inserido = false; return e.id; }
+            i = (i + 1) & mascara;
+        }
+        // Chave nova com a tabela em metade da capacidade (ou, por garantia, sem posição livre)
+        crescer();
+        return buscarOuInserir(v, vt, vn, novoId, inserido);
+    }
+};
+
+// Deduplicação e empacotamento especializados no layout dos cantos. Sem vn nem vt (P) a
+// posição sozinha identifica o vértice: um vetor indexado por posição substitui a tabela hash.
+template <FonteNormal N, FonteUV T>
+static void indexarCantos(
+    const float* vertices, size_t nVertices,
+    const float* normaisCalculadas,
+    const float* normaisOBJ,
+    const float* uvs,
+    const CantoTri* triangulos, size_t nTriangulos,
+    bool verificarPosicoes,
+    MalhaIndexada& out,
+    ArenaCarga* arena,
+    const int32_t* materialTri
+) {
+    const bool porPosicao = N == FonteNormal::Calculada && T == FonteUV::Nenhuma;
+    // Índices sempre montados em 32 bits; compactados para 16 no final se couber
+    vector<uint32_t>& indices = out.indices32;
+    indices.reserve(nTriangulos);
+    TabelaCantos tabela(porPosicao ? 0 : min(nTriangulos, nVertices), arena);
+    VetorArena<uint32_t> idPosicao(porPosicao ? nVertices / 3 : 0, UINT32_MAX, AlocadorArena<uint32_t>(arena));
+    out.vertices.reserve(min(nTriangulos, nVertices / 3) * FLOATS_POR_VERTICE);
+
+    for (size_t i = 0; i + 2 < nTriangulos; i += 3) {
+        if (verificarPosicoes && (triangulos[i].v < 0 || triangulos[i+1].v < 0 || triangulos[i+2].v < 0)) continue;
+        if (materialTri) {
+            // Triângulos já agrupados por material: uma faixa nova a cada troca
+            const int32_t m = materialTri[i / 3];
+            vector<FaixaMaterial>& faixas = out.faixasMaterial;
+            if (faixas.empty() || faixas.back().material != m) faixas.push_back(FaixaMaterial{ m, (uint32_t)indices.size(), 0 });
+            faixas.back().numIndices += 3;
+        }
+        for (int k = 0; k < 3; ++k) {
+            const CantoTri& c = triangulos[i+k];
+            const uint32_t novoId = (uint32_t)out.numVertices();
+            uint32_t id;
+            bool inserido;
+            if (porPosicao) {
+                uint32_t& e = idPosicao[(size_t)c.v];
+                inserido = e == UINT32_MAX;
+                if (inserido) e = novoId;
+                id = e;
+            } else {
+                id = tabela.buscarOuInserir(c.v, T == FonteUV::Nenhuma ? -1 : c.vt, N == FonteNormal::Calculada ? -1 : c.vn,
+                                            novoId, inserido);
+            }
+            if (inserido) {
+                const size_t base = out.vertices.size();
+                out.vertices.resize(base + FLOATS_POR_VERTICE);
+                float* d = &out.vertices[base];
+                const float* P = &vertices[(size_t)c.v * 3u];
+                const bool normalOBJ = N == FonteNormal::OBJ || (N == FonteNormal::Mista && c.vn >= 0);
+                const float* Nrm = normalOBJ ? &normaisOBJ[(size_t)c.vn * 3u] : &normaisCalculadas[(size_t)c.v * 3u];
+                d[0] = P[0]; d[1] = P[1]; d[2] = P[2];
+                d[3] = Nrm[0]; d[4] = Nrm[1]; d[5] = Nrm[2];
+                if (T == FonteUV::OBJ || (T == FonteUV::Mista && c.vt >= 0)) {
+                    d[6] = uvs[(size_t)c.vt * 2u];
+                    d[7] = uvs[(size_t)c.vt * 2u + 1];
                 }
             }
+            indices.push_back(id);
         }
     }
-    glEnd();
-    glPopMatrix();
-    glEndList();
+}
+
+void construirMalhaIndexada(
+    const float* vertices, size_t nVertices,
+    const float* normaisCalculadas,
+    const float* normaisOBJ, size_t nNormaisOBJ,
+    const float* uvs, size_t nUVs,
+    const CantoTri* triangulos, size_t nTriangulos,
+    MalhaIndexada& out,
+    ArenaCarga* arena,
+    const int32_t* materialTri
+) {
+    out.vertices.clear(); out.indices16.clear(); out.indices32.clear(); out.faixasMaterial.clear();
+    const LayoutCantos layout = analisarCantos(triangulos, nTriangulos - nTriangulos % 3, nNormaisOBJ, nUVs);
+    comLayout(layout, [&](auto normal, auto uv) {
+        indexarCantos<decltype(normal)::value, decltype(uv)::value>(
+            vertices, nVertices, normaisCalculadas, normaisOBJ, uvs, triangulos, nTriangulos,
+            !layout.posicoesValidas, out, arena, materialTri);
+    });
+    vector<uint32_t>& indices = out.indices32;
+    // A reserva é uma estimativa; só devolve a sobra quando ela é grande (numa recarga o
+    // vetor reaproveitado já tem o tamanho certo)
+    if (out.vertices.capacity() > out.vertices.size() + out.vertices.size() / 4) out.vertices.shrink_to_fit();
+
+    if (out.numVertices() <= 65536u) {
+        out.indices16.assign(indices.begin(), indices.end());
+        vector<uint32_t>().swap(indices);
+    }
+}
 
+void construirMalhaIndexada(
+    const vector<float>& vertices,
+    const vector<float>& normaisCalculadas,
+    const vector<float>& normaisOBJ,
+    const vector<float>& uvs,
+    const vector<CantoTri>& triangulos,
+    MalhaIndexada& out,
+    ArenaCarga* arena
+) {
+    construirMalhaIndexada(vertices.data(), vertices.size(), normaisCalculadas.data(),
+                           normaisOBJ.data(), normaisOBJ.size(), uvs.data(), uvs.size(),
+                           triangulos.data(), triangulos.size(), out, arena);
+}
+
+static void logCarregado(const string& caminho, size_t nV, size_t nVT, size_t nVN, size_t nTri) {
     cout << "OBJ carregado: " << caminho
-              << " | V: " << (vertices.size()/3)
-              << " VT: " << (uvs.size()/2)
-              << " VN: " << (normaisOBJ.size()/3)
-              << " | Tris: " << (triangulos.size()/3) << "\n";
+              << " | V: " << nV
+              << " VT: " << nVT
+              << " VN: " << nVN
+              << " | Tris: " << nTri << "\n";
+}
+
+// Compara o custo de emitir cada canto (display list) com a malha indexada
+static void logIndexada(const VisaoMalhaIndexada& malha, size_t nCantos) {
+    const double porCanto = (double)nCantos * FLOATS_POR_VERTICE * sizeof(float);
+    const double indexado = (double)malha.vertices.size() * sizeof(float)
+                          + (double)malha.numIndices() * (malha.indices16Bits() ? 2 : 4);
+    const double mb = 1024.0 * 1024.0;
+    cout << "Indexado: " << malha.numVertices() << " vertices unicos de " << nCantos << " cantos"
+         << " | indices " << (malha.indices16Bits() ? 16 : 32) << " bits"
+         << " | " << porCanto / mb << " MB -> " << indexado / mb << " MB"
+         << " (economia " << (porCanto - indexado) / mb << " MB, "
+         << (indexado > 0 ? porCanto / indexado : 0.0) << "x)\n";
+}
+
+static OpcoesLOD opcoesLOD(const OpcoesCarregamento& opcoes) {
+    OpcoesLOD o;
+    o.numThreads = opcoes.numThreads;
+    return o;
+}
+
+void MalhaOBJ::limpar() {
+    vertices.clear(); indicesPos.clear(); normaisCalculadas.clear();
+    normaisOBJ.clear(); uvs.clear(); triangulos.clear();
+    indexada.vertices.clear(); indexada.indices16.clear(); indexada.indices32.clear();
+    indexada.indicesLOD.clear(); indexada.niveisLOD.clear(); indexada.faixasMaterial.clear();
+    nomesMateriais = NomesMateriais(); materiais.clear(); materialTri.clear();
+    cache.reset();
+}
+
+// O vector, ou a seção do cache quando a malha veio dele e o vector não foi preenchido
+template <class T>
+static Fatia<T> vetorOuCache(const vector<T>& v, const MalhaOBJ& m, const T* secao, size_t n) {
+    if (!m.cache || !v.empty()) return Fatia<T>(v);
+    return Fatia<T>(secao, n);
+}
+
+VisaoMalhaOBJ::VisaoMalhaOBJ(const MalhaOBJ& m) {
+    static const CacheMalhaMapeado semCache;
+    const CacheMalhaMapeado& c = m.cache ? *m.cache : semCache;
+    vertices = vetorOuCache(m.vertices, m, c.vertices, c.nVertices);
+    indicesPos = vetorOuCache(m.indicesPos, m, c.indicesPos, c.nIndicesPos);
+    normaisCalculadas = vetorOuCache(m.normaisCalculadas, m, c.normaisCalculadas, c.nNormaisCalculadas);
+    normaisOBJ = vetorOuCache(m.normaisOBJ, m, c.normaisOBJ, c.nNormaisOBJ);
+    uvs = vetorOuCache(m.uvs, m, c.uvs, c.nUVs);
+    triangulos = vetorOuCache(m.triangulos, m, c.triangulos, c.nTriangulos);
+    materialTri = vetorOuCache(m.materialTri, m, c.materialTri, c.nMaterialTri);
+    const MalhaIndexada& mi = m.indexada;
+    indexada.vertices = vetorOuCache(mi.vertices, m, c.verticesIndexados, c.nVerticesIndexados);
+    // Os índices vêm juntos: depois de copiados, o de 16 bits vazio no vector não volta ao cache
+    const bool indicesCopiados = !mi.indices16.empty() || !mi.indices32.empty();
+    indexada.indices16 = indicesCopiados ? Fatia<uint16_t>(mi.indices16) : vetorOuCache(mi.indices16, m, c.indices16, c.nIndices16);
+    indexada.indices32 = indicesCopiados ? Fatia<uint32_t>(mi.indices32) : vetorOuCache(mi.indices32, m, c.indices32, c.nIndices32);
+    indexada.indicesLOD = vetorOuCache(mi.indicesLOD, m, c.indicesLOD, c.nIndicesLOD);
+    indexada.niveisLOD = vetorOuCache(mi.niveisLOD, m, c.niveisLOD, c.nNiveisLOD);
+    indexada.faixasMaterial = vetorOuCache(mi.faixasMaterial, m, c.faixasMaterial, c.nFaixasMaterial);
+}
+
+void copiarIndexadaDoCache(MalhaOBJ& m, bool comVertices) {
+    if (!m.cache) return;
+    const CacheMalhaMapeado& c = *m.cache;
+    MalhaIndexada& mi = m.indexada;
+    if (mi.indices16.empty() && mi.indices32.empty()) {
+        mi.indices16.assign(c.indices16, c.indices16 + c.nIndices16);
+        mi.indices32.assign(c.indices32, c.indices32 + c.nIndices32);
+    }
+    if (!comVertices || !mi.vertices.empty()) return;
+    mi.vertices.assign(c.verticesIndexados, c.verticesIndexados + c.nVerticesIndexados);
+    // Os níveis de LOD apontam para os vértices: renumerados junto com eles
+    mi.indicesLOD.assign(c.indicesLOD, c.indicesLOD + c.nIndicesLOD);
+    mi.niveisLOD.assign(c.niveisLOD, c.niveisLOD + c.nNiveisLOD);
+}
+
+// Ordena os triângulos por material (estável, por contagem), para cada material virar uma
+// faixa contígua de índices. Sem materiais (-1) vêm primeiro.
+static void agruparPorMaterial(MalhaOBJ& m, ArenaCarga* arena) {
+    const size_t nTris = m.triangulos.size() / 3;
+    m.materialTri.resize(nTris, -1);
+    VetorArena<size_t> inicio(m.nomesMateriais.nomes.size() + 2, 0, AlocadorArena<size_t>(arena));
+    for (int32_t id : m.materialTri) ++inicio[(size_t)(id + 2)];
+    for (size_t k = 1; k < inicio.size(); ++k) inicio[k] += inicio[k - 1];
+    VetorArena<CantoTri> tris(m.triangulos.size(), CantoTri{ -1, -1, -1 }, AlocadorArena<CantoTri>(arena));
+    VetorArena<int32_t> ids(nTris, -1, AlocadorArena<int32_t>(arena));
+    for (size_t t = 0; t < nTris; ++t) {
+        const size_t destino = inicio[(size_t)(m.materialTri[t] + 1)]++;
+        ids[destino] = m.materialTri[t];
+        copy(&m.triangulos[t * 3], &m.triangulos[t * 3] + 3, &tris[destino * 3]);
+    }
+    copy(tris.begin(), tris.end(), m.triangulos.begin());
+    copy(ids.begin(), ids.end(), m.materialTri.begin());
+}
+
+// BVH gravada no cache (vazia se ele foi preparado sem ela)
+static void lerBVHDoCache(const CacheMalhaMapeado& c, BVHMalha& bvh) {
+    bvh.nos.assign(c.nosBVH, c.nosBVH + c.nNosBVH);
+    bvh.ordem.assign(c.ordemBVH, c.ordemBVH + c.nOrdemBVH);
+    bvh.ordemDesenho.assign(c.ordemDesenhoBVH, c.ordemDesenhoBVH + c.nOrdemDesenhoBVH);
+    bvh.clusters.assign(c.clustersBVH, c.clustersBVH + c.nClustersBVH);
+}
+
+bool carregarMalhaOBJ(const string& caminho, MalhaOBJ& out, const OpcoesCarregamento& opcoes, ArenaCarga* arena,
+                      BVHMalha* bvh) {
+    // Os vetores de out mantêm a capacidade: recarregar o mesmo modelo não realoca
+    out.limpar();
+    if (bvh) *bvh = BVHMalha();
+    // O passo depois da indexação só existe com onde pôr a BVH; ele faz parte da chave do cache
+    const uint32_t preparo = !bvh ? 0u
+        : (opcoes.montarBVH ? PREPARO_CACHE_BVH : 0u) | (opcoes.otimizarOrdem ? PREPARO_CACHE_OTIMIZADA : 0u);
+    // Os temporários morrem dentro das funções chamadas abaixo; em qualquer saída a arena fica
+    // com um bloco do tamanho usado para a próxima carga
+    const ReinicioArena reinicio(arena);
+
+    // Chave do cache lida antes do parse (ver lerChaveCacheOBJ)
+    ChaveCacheOBJ chave;
+    const bool usarCache = opcoes.usarCache && lerChaveCacheOBJ(caminho, chave);
+
+    // Cache binário válido: a malha fica nas páginas mapeadas, que out.cache mantém vivas; só
+    // os nomes dos materiais são copiados
+    if (usarCache) {
+        PERF_ESCOPO("carga.cache");
+        const auto tc = chrono::steady_clock::now();
+        auto cache = make_shared<CacheMalhaMapeado>();
+        if (abrirCacheMalha(caminho, opcoes.dirCache, preparo, *cache)) {
+            out.cache = cache;
+            lerTextoNomesMateriais(cache->textoMateriais, cache->nTextoMateriais, out.nomesMateriais);
+            // Os .mtl são lidos de novo (pequenos, e podem ter mudado sem o OBJ mudar)
+            if (!out.nomesMateriais.vazio()) resolverMateriais(caminho, out.nomesMateriais, out.materiais);
+            // Cache gravado com gerarLODs = false: o LOD lê a malha indexada dos vetores
+            if (opcoes.gerarLODs && cache->nNiveisLOD == 0 && cache->nFaixasMaterial == 0) {
+                copiarIndexadaDoCache(out, true);
+                gerarNiveisLOD(out.indexada, opcoesLOD(opcoes));
+            }
+            // Os índices no cache já estão na ordem da BVH e da otimização; só a árvore é copiada
+            if (bvh) lerBVHDoCache(*cache, *bvh);
+            const VisaoMalhaOBJ v(out);
+            logCarregado(caminho, v.vertices.size()/3, v.uvs.size()/2, v.normaisOBJ.size()/3, v.triangulos.size()/3);
+            logIndexada(v.indexada, v.triangulos.size());
+            cout << "Cache: " << caminhoCacheMalha(caminho, opcoes.dirCache) << " em "
+                 << chrono::duration<double, milli>(chrono::steady_clock::now() - tc).count() << " ms";
+            if (bvh && !bvh->vazia()) cout << " (BVH: " << bvh->nos.size() << " nos, " << bvh->clusters.size() << " clusters)";
+            cout << "\n";
+            return true;
+        }
+    }
+
+    const auto t0 = chrono::steady_clock::now();
+    size_t bytesLidos = 0;
+    bool ok = false;
+    const ModoLeituraOBJ modo = opcoes.modo;
+    {
+        PERF_ESCOPO("carga.parse");
+        switch (modo) {
+            case ModoLeituraOBJ::Stream:
+                ok = lerOBJStream(caminho, out.vertices, out.normaisOBJ, out.uvs, out.indicesPos, out.triangulos,
+                                  out.nomesMateriais, out.materialTri, bytesLidos, arena);
+                break;
+            case ModoLeituraOBJ::Mmap:
+                ok = lerOBJMmap(caminho, out.vertices, out.normaisOBJ, out.uvs, out.indicesPos, out.triangulos,
+                                out.nomesMateriais, out.materialTri, bytesLidos, opcoes.aoProgresso, arena);
+                break;
+            case ModoLeituraOBJ::Paralelo:
+                ok = lerOBJParalelo(caminho, out.vertices, out.normaisOBJ, out.uvs, out.indicesPos, out.triangulos,
+                                    out.nomesMateriais, out.materialTri, bytesLidos, opcoes.numThreads);
+                break;
+        }
+    }
+    if (!ok) return false;
+    // Nos modos sem progresso incremental, informa ao menos o fim do parse
+    if (opcoes.aoProgresso && modo != ModoLeituraOBJ::Mmap) {
+        ProgressoCarga p;
+        p.bytesLidos = p.bytesTotal = bytesLidos;
+        p.triangulos = out.triangulos.size() / 3;
+        opcoes.aoProgresso(p);
+    }
+    const double msParse = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+    if (out.vertices.empty() || out.indicesPos.empty()) {
+        cerr << "OBJ vazio ou sem faces: " << caminho << "\n";
+        return false;
+    }
+    if (!out.materialTri.empty()) {
+        PERF_ESCOPO("carga.materiais");
+        agruparPorMaterial(out, arena);
+        resolverMateriais(caminho, out.nomesMateriais, out.materiais);
+    }
+
+    // Normais por vértice (soma de normais de face, depois normaliza)
+    const auto tNormais = chrono::steady_clock::now();
+    {
+        PERF_ESCOPO("carga.normais");
+        calcularNormaisVertice(out.vertices, out.indicesPos, out.normaisCalculadas, opcoes.numThreads);
+    }
+    cout << "Normais: " << chrono::duration<double, milli>(chrono::steady_clock::now() - tNormais).count() << " ms\n";
+
+    {
+        PERF_ESCOPO("carga.indexar");
+        construirMalhaIndexada(out.vertices.data(), out.vertices.size(), out.normaisCalculadas.data(),
+                               out.normaisOBJ.data(), out.normaisOBJ.size(), out.uvs.data(), out.uvs.size(),
+                               out.triangulos.data(), out.triangulos.size(), out.indexada, arena,
+                               out.materialTri.empty() ? nullptr : out.materialTri.data());
+    }
+    if (opcoes.gerarLODs && out.indexada.faixasMaterial.empty()) gerarNiveisLOD(out.indexada, opcoesLOD(opcoes));
+    if (!out.materiais.empty())
+        cout << "Materiais: " << out.materiais.size() << " em " << out.indexada.faixasMaterial.size() << " faixas\n";
+
+    logCarregado(caminho, out.vertices.size()/3, out.uvs.size()/2, out.normaisOBJ.size()/3, out.triangulos.size()/3);
+    logIndexada(out.indexada, out.triangulos.size());
+    const double mb = bytesLidos / (1024.0 * 1024.0);
+    const char* nomeModo = modo == ModoLeituraOBJ::Stream ? "stream" : (modo == ModoLeituraOBJ::Mmap ? "mmap" : "paralelo");
+    cout << "Parse (" << nomeModo << "): "
+         << mb << " MB em " << msParse << " ms (" << (msParse > 0 ? mb / (msParse / 1000.0) : 0.0) << " MB/s)\n";
+
+    if (bvh) prepararMalhaCarregada(out, opcoes.montarBVH, opcoes.otimizarOrdem, *bvh, opcoes.numThreads);
+
+    if (usarCache) {
+        PERF_ESCOPO("carga.gravar_cache");
+        gravarCacheMalha(caminho, opcoes.dirCache, chave, out, preparo, bvh);
+    }
 
     return true;
 }
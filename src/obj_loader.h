@@ -1,32 +1,256 @@
 // Carregador de arquivos OBJ com suporte a v, vt, vn e f.
-// Expõe uma função para ler o arquivo, calcular normais por vértice (fallback) e
-// gerar uma display list OpenGL com preenchimento e iluminação por normal.
+// Lê o arquivo, calcula normais por vértice (fallback) e monta a malha indexada e os LODs.
+// Não depende de OpenGL (biblioteca carregador_obj); o envio para a GPU fica em malha_lista.h
+// e malha_vbo.h.
 
 #pragma once
 
-#include <GL/freeglut.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "materiais.h"
+
 // Para simplificar leitura do código neste trabalho acadêmico
 using namespace std;
 
+class ArenaCarga;   // arena.h
+struct CacheMalhaMapeado;   // cache_malha.h
+struct BVHMalha;            // bvh.h
+
+// Visão somente leitura de um array contíguo, sem posse: aponta para um vector ou para as
+// páginas mapeadas do cache, e vale enquanto o dono dos dados existir
+template <class T>
+struct Fatia {
+    const T* dados = nullptr;
+    size_t n = 0;
+
+    Fatia() = default;
+    Fatia(const T* d, size_t tamanho) : dados(d), n(tamanho) {}
+    Fatia(const vector<T>& v) : dados(v.data()), n(v.size()) {}
+
+    const T* data() const { return dados; }
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    const T& operator[](size_t i) const { return dados[i]; }
+    const T* begin() const { return dados; }
+    const T* end() const { return dados + n; }
+};
+
 // Representa um canto de triângulo com índices separados do OBJ
 // v: índice de posição, vt: índice de coordenada de textura, vn: índice de normal
 struct CantoTri {
     int v, vt, vn;
 };
 
-// Lê um arquivo .obj (v, vt, vn, f), triangula faces em fan, calcula normais por vértice (fallback)
-// e constrói uma display list para renderização com iluminação. Também devolve os buffers carregados
-// caso queira inspecionar os dados.
-bool carregarOBJParaDisplayList(
+// Malha indexada: cada trinca (v, vt, vn) distinta vira um único vértice intercalado
+// e os triângulos passam a ser índices para esses vértices.
+static const int FLOATS_POR_VERTICE = 8;   // px py pz  nx ny nz  u v
+
+// Nível de detalhe simplificado (ver lod.h): faixa de MalhaIndexada::indicesLOD
+struct NivelLOD {
+    uint32_t primeiroIndice;
+    uint32_t numIndices;
+    float erro;                   // maior desvio geométrico do nível, em unidades do objeto
+    uint32_t reservado;
+};
+
+struct MalhaIndexada {
+    vector<float> vertices;       // FLOATS_POR_VERTICE floats por vértice
+    vector<uint16_t> indices16;   // usado quando há até 65536 vértices
+    vector<uint32_t> indices32;   // usado nos demais casos (um dos dois fica vazio)
+    // Níveis simplificados, do mais detalhado ao mais simples, sobre os mesmos vértices
+    vector<uint32_t> indicesLOD;
+    vector<NivelLOD> niveisLOD;
+    // Com materiais (usemtl), os índices ficam agrupados por material nessas faixas
+    vector<FaixaMaterial> faixasMaterial;
+
+    size_t numVertices() const { return vertices.size() / FLOATS_POR_VERTICE; }
+    size_t numIndices() const { return indices16.empty() ? indices32.size() : indices16.size(); }
+    bool indices16Bits() const { return !indices16.empty(); }
+    uint32_t indice(size_t i) const { return indices16.empty() ? indices32[i] : indices16[i]; }
+};
+
+// Malha indexada só para leitura (envio à GPU, desenho, rasterizador), com os mesmos campos
+// de MalhaIndexada; os arrays podem estar num vector ou no cache mapeado (VisaoMalhaOBJ)
+struct VisaoMalhaIndexada {
+    Fatia<float> vertices;
+    Fatia<uint16_t> indices16;
+    Fatia<uint32_t> indices32;
+    Fatia<uint32_t> indicesLOD;
+    Fatia<NivelLOD> niveisLOD;
+    Fatia<FaixaMaterial> faixasMaterial;
+
+    VisaoMalhaIndexada() = default;
+    VisaoMalhaIndexada(const MalhaIndexada& m)
+        : vertices(m.vertices), indices16(m.indices16), indices32(m.indices32), indicesLOD(m.indicesLOD),
+          niveisLOD(m.niveisLOD), faixasMaterial(m.faixasMaterial) {}
+
+    size_t numVertices() const { return vertices.size() / FLOATS_POR_VERTICE; }
+    size_t numIndices() const { return indices16.empty() ? indices32.size() : indices16.size(); }
+    bool indices16Bits() const { return !indices16.empty(); }
+    uint32_t indice(size_t i) const { return indices16.empty() ? indices32[i] : indices16[i]; }
+};
+
+// Deduplica os cantos dos triângulos numa MalhaIndexada. A normal de cada canto segue a
+// mesma regra da display list (vn do arquivo quando existe, senão a normal calculada) e a
+// UV fica (0, 0) quando o canto não tem vt. Triângulos com posição inválida são descartados.
+void construirMalhaIndexada(
+    const vector<float>& vertices,
+    const vector<float>& normaisCalculadas,
+    const vector<float>& normaisOBJ,
+    const vector<float>& uvs,
+    const vector<CantoTri>& triangulos,
+    MalhaIndexada& out,
+    ArenaCarga* arena = nullptr   // temporários da deduplicação (nullptr = heap)
+);
+
+// Mesma deduplicação a partir de ponteiros (ex.: arquivos mapeados do modo paginado). Os
+// tamanhos são em floats/cantos; normaisCalculadas só é lida nos cantos sem vn.
+void construirMalhaIndexada(
+    const float* vertices, size_t nVertices,
+    const float* normaisCalculadas,
+    const float* normaisOBJ, size_t nNormaisOBJ,
+    const float* uvs, size_t nUVs,
+    const CantoTri* triangulos, size_t nTriangulos,
+    MalhaIndexada& out,
+    ArenaCarga* arena = nullptr,
+    const int32_t* materialTri = nullptr   // material de cada triângulo, para faixasMaterial
+);
+
+// Forma de ler o texto do OBJ. As duas produzem exatamente os mesmos buffers.
+// Stream: getline + istringstream por linha (implementação original).
+// Mmap: mapeia o arquivo e tokeniza no próprio buffer, sem alocar por linha.
+// Paralelo: como Mmap, mas divide o arquivo em blocos lidos por várias threads.
+enum class ModoLeituraOBJ {
+    Stream,
+    Mmap,
+    Paralelo
+};
+
+// Andamento da leitura, entregue periodicamente a OpcoesCarregamento::aoProgresso.
+// Os ponteiros só valem durante a chamada (os vetores continuam crescendo depois).
+struct ProgressoCarga {
+    size_t bytesLidos = 0;
+    size_t bytesTotal = 0;
+    size_t triangulos = 0;                  // triângulos lidos até agora
+    // Triângulos novos desde a chamada anterior (só na leitura Mmap; nos outros modos fica vazio)
+    const CantoTri* trisNovos = nullptr;    size_t nCantosNovos = 0;
+    const float* vertices = nullptr;        size_t nVertices = 0;   // posições lidas até agora
+    const float* normaisOBJ = nullptr;      size_t nNormaisOBJ = 0;
+    const float* uvs = nullptr;             size_t nUVs = 0;
+};
+
+// Opções de carregamento
+struct OpcoesCarregamento {
+    ModoLeituraOBJ modo = ModoLeituraOBJ::Mmap;
+    int numThreads = 0;           // etapas paralelas (parse Paralelo, normais); 0 = núcleos disponíveis
+    bool usarCache = true;        // lê/grava o cache binário (cache_malha.h)
+    string dirCache;              // vazio = cache ao lado do OBJ
+    bool gerarLODs = true;        // níveis simplificados na malha indexada (guardados no cache)
+    // Passo depois da indexação (prepararMalhaCarregada, otimizar_malha.h), só quando
+    // carregarMalhaOBJ recebe onde pôr a BVH. O cache guarda os índices já reordenados e a BVH;
+    // um cache preparado com outras opções é descartado.
+    bool montarBVH = false;
+    bool otimizarOrdem = false;
+    // Chamado da thread que faz a leitura, a cada lote de triângulos lidos e no fim do parse
+    function<void(const ProgressoCarga&)> aoProgresso;
+};
+
+// Resultado de carregarMalhaOBJ. Reaproveitar a mesma MalhaOBJ em cargas seguidas evita
+// realocar os vetores (limpar() mantém a capacidade).
+// Carregada do cache binário, os buffers ficam nas páginas mapeadas (cache) e os vetores abaixo
+// começam vazios (menos os materiais): a leitura passa por VisaoMalhaOBJ, e quem altera a malha
+// indexada chama antes copiarIndexadaDoCache.
+struct MalhaOBJ {
+    vector<float> vertices;             // xyz
+    vector<unsigned int> indicesPos;    // índices só de posição (para o cálculo de normais)
+    vector<float> normaisCalculadas;    // nx ny nz por vértice (fallback)
+    vector<float> normaisOBJ;           // vn do arquivo
+    vector<float> uvs;                  // vt do arquivo (u v)
+    vector<CantoTri> triangulos;        // 3 cantos por triângulo
+    MalhaIndexada indexada;             // vértices únicos intercalados + índices
+    // Materiais (só quando o OBJ usa usemtl): os triângulos ficam ordenados por material
+    NomesMateriais nomesMateriais;
+    vector<MaterialOBJ> materiais;      // um por id, na ordem de nomesMateriais.nomes
+    vector<int32_t> materialTri;        // id do material de cada triângulo (-1 = nenhum)
+    shared_ptr<const CacheMalhaMapeado> cache;   // mapeamento de onde a malha veio (nullptr = parse)
+
+    void limpar();
+};
+
+// Buffers de uma MalhaOBJ para leitura. Cada um vem do vector correspondente ou, se a malha
+// veio do cache e o vector está vazio, direto das páginas mapeadas (sem cópia). Vale enquanto
+// a MalhaOBJ não for alterada.
+struct VisaoMalhaOBJ {
+    Fatia<float> vertices;
+    Fatia<unsigned int> indicesPos;
+    Fatia<float> normaisCalculadas;
+    Fatia<float> normaisOBJ;
+    Fatia<float> uvs;
+    Fatia<CantoTri> triangulos;
+    Fatia<int32_t> materialTri;
+    VisaoMalhaIndexada indexada;
+
+    VisaoMalhaOBJ(const MalhaOBJ& m);
+};
+
+// Copia do cache para m.indexada os arrays que vão ser alterados: os índices (a BVH os
+// reordena) e, com comVertices, também os vértices e os níveis de LOD (a otimização da ordem
+// renumera os vértices; gerarNiveisLOD escreve os níveis). Sem cache, ou com os arrays já
+// copiados, não faz nada.
+void copiarIndexadaDoCache(MalhaOBJ& m, bool comVertices);
+
+// Lê um arquivo .obj (v, vt, vn, f), triangula faces em fan, calcula normais por vértice
+// (fallback) e monta a malha indexada. Se houver um cache binário válido do arquivo, o parse é
+// pulado. Não faz chamadas GL, então pode rodar em qualquer thread. Com uma arena, os
+// temporários do parse e da indexação saem dela e ela é reiniciada no fim. Com materiais, os
+// triângulos são agrupados por material e os níveis de detalhe não são gerados (a
+// simplificação misturaria triângulos de materiais diferentes). Com bvh, faz também o passo
+// de opcoes.montarBVH/otimizarOrdem, ou lê do cache o resultado dele.
+bool carregarMalhaOBJ(
     const string& caminho,
-    vector<float>& vertices,              // xyz
-    vector<unsigned int>& indicesPos,     // indices somente de posição (para cálculo de normais)
-    vector<float>& normaisCalculadas,     // nx ny nz por vértice (fallback)
-    vector<float>& normaisOBJ,            // vn do arquivo
-    vector<float>& uvs,                   // vt do arquivo (u v)
-    vector<CantoTri>& triangulos,         // lista de triângulos (3 cantos por triângulo)
-    GLuint& displayListOut                // id da display list gerada
+    MalhaOBJ& out,
+    const OpcoesCarregamento& opcoes = OpcoesCarregamento(),
+    ArenaCarga* arena = nullptr,
+    BVHMalha* bvh = nullptr
 );
+
+// Leitura sequencial em blocos de tamanho fixo, sem guardar nada além da face corrente (para
+// arquivos maiores que a memória, ver malha_paginada.h). Cada elemento é entregue assim que
+// lido; as faces chegam trianguladas em fan, com os índices resolvidos como em
+// carregarMalhaOBJ (0-based, -1 quando ausente ou inválido).
+struct LeitorOBJBlocos {
+    function<void(float, float, float)> aoVertice;
+    function<void(float, float, float)> aoNormal;
+    function<void(float, float)> aoUV;
+    function<void(const CantoTri* tri)> aoTriangulo;   // 3 cantos
+};
+
+bool lerOBJEmBlocos(const string& caminho, size_t bytesBloco, const LeitorOBJBlocos& leitor, size_t& bytesLidos);
+
+// Trecho do texto do OBJ para a recarga incremental (recarga.h). Os trechos começam nas
+// linhas o/g e em cortes definidos pelo conteúdo das linhas, de modo que uma edição local
+// só muda o trecho em que caiu.
+struct TrechoOBJ {
+    size_t inicio = 0, fim = 0;          // bytes no arquivo
+    uint64_t hash = 0;                   // do texto do trecho
+    size_t nV = 0, nVT = 0, nVN = 0;     // linhas v, vt e vn
+    string ultimoMaterial;               // último usemtl do trecho (vazio = nenhum)
+};
+
+void dividirTrechosOBJ(const char* dados, size_t tamanho, vector<TrechoOBJ>& out);
+
+// Um trecho lido isoladamente: as contagens de v/vt/vn anteriores a ele (bases) resolvem os
+// índices exatamente como na leitura do arquivo inteiro.
+struct TrechoLido {
+    vector<float> vertices, normaisOBJ, uvs;
+    vector<CantoTri> triangulos;         // índices globais
+    vector<unsigned int> indicesPos;
+    NomesMateriais nomes;                // mtllib/usemtl do trecho, com ids locais
+    vector<int32_t> materialTri;         // id local; -1 = material herdado (vazio sem usemtl no trecho)
+};
+
+bool lerTrechoOBJ(const char* p, const char* fim, size_t baseV, size_t baseVT, size_t baseVN, TrechoLido& out);
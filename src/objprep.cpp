@@ -0,0 +1,275 @@
+// objprep: pré-processamento em lote de OBJs, sem OpenGL. Cada arquivo passa por parse, normais,
+// malha indexada (vértices deduplicados) com LODs, otimização da ordem dos triângulos e é gravado
+// como malha pronta (malha_pronta.h). Vários arquivos são processados ao mesmo tempo, um por
+// thread; cada carga usa uma thread só, o que deixa a saída idêntica byte a byte qualquer que
+// seja o número de threads (as normais somadas em paralelo diferem no arredondamento). As cargas
+// simultâneas respeitam um orçamento de memória estimado pelo tamanho dos arquivos: um arquivo
+// maior que o orçamento inteiro roda sozinho.
+//
+// Uso: objprep [opções] <arquivo.obj | diretório>...
+//   --saida=DIR        diretório dos .malha (padrão "prep"); diretórios de entrada são
+//                      percorridos recursivamente e a estrutura deles é repetida na saída
+//   --lista=ARQ        lê mais caminhos de ARQ, um por linha ("-" = entrada padrão)
+//   --threads=N        arquivos ao mesmo tempo (0 = núcleos disponíveis)
+//   --memoria-mb=N     orçamento das cargas simultâneas (padrão: metade da RAM)
+//   --sem-lod, --sem-otimizar, --verbose (log do carregador)
+
+#include "malha_pronta.h"
+#include "obj_loader.h"
+#include "otimizar_malha.h"
+#include "paralelo.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Pico de memória de uma carga por byte de OBJ (MalhaOBJ completa mais os temporários da
+// indexação e dos LODs): medido até ~5x nos OBJs só com v e f, menos com vt/vn
+static const size_t MEMORIA_POR_BYTE_OBJ = 6;
+
+struct TrabalhoPrep {
+    string entrada;
+    string saida;
+    size_t bytes = 0;
+};
+
+// Reserva de memória das cargas em andamento
+struct OrcamentoMemoria {
+    mutex trava;
+    condition_variable liberou;
+    size_t limite = 0, usado = 0, pico = 0;
+};
+
+static void reservarMemoria(OrcamentoMemoria& o, size_t n) {
+    unique_lock<mutex> l(o.trava);
+    o.liberou.wait(l, [&] { return o.usado == 0 || o.usado + n <= o.limite; });
+    o.usado += n;
+    o.pico = max(o.pico, o.usado);
+}
+
+static void liberarMemoria(OrcamentoMemoria& o, size_t n) {
+    {
+        lock_guard<mutex> l(o.trava);
+        o.usado -= n;
+    }
+    o.liberou.notify_all();
+}
+
+// Como "mkdir -p"
+static bool criarDiretorios(const string& caminho) {
+    for (size_t p = caminho.find('/', 1); ; p = caminho.find('/', p + 1)) {
+        const string parte = caminho.substr(0, p);
+        if (!parte.empty() && mkdir(parte.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (p == string::npos) return true;
+    }
+}
+
+static bool terminaCom(const string& s, const char* fim) {
+    const size_t n = strlen(fim);
+    return s.size() >= n && strcasecmp(s.c_str() + s.size() - n, fim) == 0;
+}
+
+static string semExtensao(const string& s) {
+    const size_t barra = s.rfind('/'), ponto = s.rfind('.');
+    return ponto != string::npos && (barra == string::npos || ponto > barra) ? s.substr(0, ponto) : s;
+}
+
+// Os .obj de um diretório e subdiretórios, em ordem de nome (relativo = caminho dentro da raiz)
+static void listarOBJs(const string& dir, const string& relativo, vector<pair<string, string>>& out) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        cerr << "Nao foi possivel abrir o diretorio " << dir << ": " << strerror(errno) << "\n";
+        return;
+    }
+    vector<string> nomes;
+    while (dirent* e = readdir(d))
+        if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0) nomes.push_back(e->d_name);
+    closedir(d);
+    sort(nomes.begin(), nomes.end());
+    for (const string& nome : nomes) {
+        const string caminho = dir + "/" + nome, rel = relativo.empty() ? nome : relativo + "/" + nome;
+        struct stat st;
+        if (stat(caminho.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) listarOBJs(caminho, rel, out);
+        else if (S_ISREG(st.st_mode) && terminaCom(nome, ".obj")) out.push_back({ caminho, rel });
+    }
+}
+
+// Arquivo vira <saida>/<nome>.malha; diretório, <saida>/<caminho relativo>.malha
+static void adicionarEntrada(const string& caminho, const string& dirSaida, vector<TrabalhoPrep>& trabalhos) {
+    struct stat st;
+    if (stat(caminho.c_str(), &st) != 0) {
+        cerr << "Entrada nao encontrada: " << caminho << "\n";
+        return;
+    }
+    vector<pair<string, string>> objs;
+    if (S_ISDIR(st.st_mode)) {
+        string dir = caminho;
+        while (dir.size() > 1 && dir.back() == '/') dir.pop_back();
+        listarOBJs(dir, "", objs);
+    } else {
+        const size_t barra = caminho.rfind('/');
+        objs.push_back({ caminho, barra == string::npos ? caminho : caminho.substr(barra + 1) });
+    }
+    for (const auto& o : objs) {
+        TrabalhoPrep t;
+        t.entrada = o.first;
+        t.saida = dirSaida + "/" + semExtensao(o.second) + ".malha";
+        if (stat(o.first.c_str(), &st) == 0) t.bytes = (size_t)st.st_size;
+        trabalhos.push_back(t);
+    }
+}
+
+static size_t memoriaFisica() {
+    const long paginas = sysconf(_SC_PHYS_PAGES), tamanho = sysconf(_SC_PAGE_SIZE);
+    return paginas > 0 && tamanho > 0 ? (size_t)paginas * (size_t)tamanho : ((size_t)4 << 30);
+}
+
+static double msDesde(chrono::steady_clock::time_point t) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t).count();
+}
+
+int main(int argc, char** argv) {
+    string dirSaida = "prep";
+    int numThreads = 0;
+    size_t memoriaMB = memoriaFisica() / 2 / (1024 * 1024);
+    bool gerarLODs = true, otimizar = true, verbose = false;
+    vector<string> entradas;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg.rfind("--saida=", 0) == 0) dirSaida = arg.substr(8);
+        else if (arg.rfind("--threads=", 0) == 0) numThreads = atoi(arg.c_str() + 10);
+        else if (arg.rfind("--memoria-mb=", 0) == 0) memoriaMB = (size_t)max(1, atoi(arg.c_str() + 13));
+        else if (arg == "--sem-lod") gerarLODs = false;
+        else if (arg == "--sem-otimizar") otimizar = false;
+        else if (arg == "--verbose") verbose = true;
+        else if (arg.rfind("--lista=", 0) == 0) {
+            const string lista = arg.substr(8);
+            ifstream arquivo;
+            if (lista != "-") arquivo.open(lista);
+            istream& in = lista == "-" ? cin : arquivo;
+            if (!in) {
+                cerr << "Nao foi possivel ler a lista " << lista << "\n";
+                return 1;
+            }
+            for (string linha; getline(in, linha);) {
+                if (!linha.empty() && linha.back() == '\r') linha.pop_back();
+                if (!linha.empty()) entradas.push_back(linha);
+            }
+        }
+        else if (arg.rfind("--", 0) == 0) cerr << "Opcao desconhecida: " << arg << "\n";
+        else entradas.push_back(arg);
+    }
+    if (entradas.empty()) {
+        fprintf(stderr, "Uso: %s [--saida=DIR] [--lista=ARQ] [--threads=N] [--memoria-mb=N] "
+                        "[--sem-lod] [--sem-otimizar] [--verbose] <arquivo.obj | diretorio>...\n", argv[0]);
+        return 1;
+    }
+
+    vector<TrabalhoPrep> trabalhos;
+    for (const string& e : entradas) adicionarEntrada(e, dirSaida, trabalhos);
+    // Duas entradas com o mesmo destino: fica a primeira
+    set<string> destinos;
+    size_t falhas = 0;
+    trabalhos.erase(remove_if(trabalhos.begin(), trabalhos.end(), [&](const TrabalhoPrep& t) {
+        if (destinos.insert(t.saida).second) return false;
+        cerr << "Saida repetida, ignorado: " << t.entrada << " -> " << t.saida << "\n";
+        ++falhas;
+        return true;
+    }), trabalhos.end());
+    // Os maiores primeiro: o último a terminar não é um arquivo grande começado tarde
+    stable_sort(trabalhos.begin(), trabalhos.end(), [](const TrabalhoPrep& a, const TrabalhoPrep& b) { return a.bytes > b.bytes; });
+
+    // O log do carregador (cout) é por carga e se misturaria entre as threads
+    if (!verbose) cout.setstate(ios::badbit);
+
+    OrcamentoMemoria orcamento;
+    orcamento.limite = memoriaMB * 1024 * 1024;
+    mutex travaRelatorio;
+    size_t feitos = 0, bytesLidos = 0, bytesGravados = 0, triangulos = 0;
+    double somaMs = 0.0;
+    atomic<size_t> falhasCarga{ 0 };
+    const size_t threads = min(numThreadsEfetivo(numThreads), max<size_t>(1, trabalhos.size()));
+    const auto t0 = chrono::steady_clock::now();
+
+    paraCadaItem(trabalhos.size(), (int)threads, [&](size_t i) {
+        const TrabalhoPrep& t = trabalhos[i];
+        const size_t reserva = t.bytes * MEMORIA_POR_BYTE_OBJ;
+        reservarMemoria(orcamento, reserva);
+        const auto ti = chrono::steady_clock::now();
+
+        OpcoesCarregamento opcoes;
+        opcoes.modo = ModoLeituraOBJ::Mmap;
+        opcoes.numThreads = 1;
+        opcoes.usarCache = false;
+        opcoes.gerarLODs = gerarLODs;
+        MalhaOBJ malha;
+        bool ok = carregarMalhaOBJ(t.entrada, malha, opcoes);
+        const double msCarga = msDesde(ti);
+
+        // Com materiais, cada faixa de material é otimizada sem sair do lugar
+        const auto tOtim = chrono::steady_clock::now();
+        if (ok && otimizar) {
+            vector<uint32_t> inicioFaixas, permutacao;
+            for (const FaixaMaterial& f : malha.indexada.faixasMaterial) inicioFaixas.push_back(f.primeiroIndice / 3);
+            if (!inicioFaixas.empty()) inicioFaixas.push_back((uint32_t)(malha.indexada.numIndices() / 3));
+            otimizarMalhaIndexada(malha.indexada, inicioFaixas, permutacao, 1);
+        }
+        const double msOtimizar = msDesde(tOtim);
+
+        uint64_t checksum = 0;
+        const size_t barra = t.saida.rfind('/');
+        if (ok) ok = criarDiretorios(t.saida.substr(0, barra)) && gravarMalhaPronta(t.saida, malha, &checksum);
+        struct stat st;
+        const size_t gravado = ok && stat(t.saida.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+        const size_t tris = malha.triangulos.size() / 3, vertices = malha.indexada.numVertices();
+        const double ms = msDesde(ti);
+        malha = MalhaOBJ();   // devolve a memória antes de liberar a reserva
+        liberarMemoria(orcamento, reserva);
+
+        const double mb = t.bytes / (1024.0 * 1024.0);
+        lock_guard<mutex> l(travaRelatorio);
+        ++feitos;
+        if (!ok) {
+            ++falhasCarga;
+            fprintf(stderr, "[%zu/%zu] FALHOU %s\n", feitos, trabalhos.size(), t.entrada.c_str());
+            return;
+        }
+        bytesLidos += t.bytes;
+        bytesGravados += gravado;
+        triangulos += tris;
+        somaMs += ms;
+        printf("[%zu/%zu] %s -> %s: %.1f MB, %zu tris, %zu vertices, %.1f MB gravados | carga %.0f ms, "
+               "otimizacao %.0f ms, total %.0f ms (%.1f MB/s) | %016llx\n",
+               feitos, trabalhos.size(), t.entrada.c_str(), t.saida.c_str(), mb, tris, vertices,
+               gravado / (1024.0 * 1024.0), msCarga, msOtimizar, ms, ms > 0 ? mb / (ms / 1000.0) : 0.0,
+               (unsigned long long)checksum);
+        fflush(stdout);
+    });
+
+    const double s = msDesde(t0) / 1000.0;
+    const double mb = 1024.0 * 1024.0;
+    falhas += falhasCarga;
+    printf("Total: %zu arquivos (%zu falharam) em %.2f s com %zu threads: %.1f MB lidos (%.1f MB/s), "
+           "%.1f MB gravados, %.2f M tris/s, concorrencia media %.2f | memoria reservada: pico %.0f de %zu MB\n",
+           trabalhos.size(), falhas, s, threads, bytesLidos / mb, s > 0 ? bytesLidos / mb / s : 0.0,
+           bytesGravados / mb, s > 0 ? triangulos / 1e6 / s : 0.0, s > 0 ? somaMs / 1000.0 / s : 0.0,
+           orcamento.pico / mb, memoriaMB);
+    return falhas ? 1 : 0;
+}
@@ -0,0 +1,54 @@
+#include "observador_arquivo.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace std;
+
+bool iniciarObservador(ObservadorArquivo& o, const string& caminho) {
+    encerrarObservador(o);
+    const size_t barra = caminho.find_last_of('/');
+    const string dir = barra == string::npos ? string(".") : caminho.substr(0, barra + 1);
+    o.nome = barra == string::npos ? caminho : caminho.substr(barra + 1);
+    o.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (o.fd < 0) {
+        cerr << "inotify indisponivel: " << strerror(errno) << "\n";
+        return false;
+    }
+    // Só eventos de arquivo completo: IN_MODIFY dispararia no meio da gravação, e IN_CREATE
+    // com o arquivo ainda vazio. IN_CLOSE_WRITE cobre quem grava no lugar e IN_MOVED_TO quem
+    // grava num temporário e renomeia.
+    o.observacao = inotify_add_watch(o.fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (o.observacao < 0) {
+        cerr << "Falha ao observar " << dir << ": " << strerror(errno) << "\n";
+        encerrarObservador(o);
+        return false;
+    }
+    return true;
+}
+
+bool arquivoMudou(ObservadorArquivo& o) {
+    if (o.fd < 0) return false;
+    bool mudou = false;
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        const ssize_t n = read(o.fd, buf, sizeof(buf));
+        if (n <= 0) break;   // EAGAIN: nada pendente
+        for (char* p = buf; p < buf + n;) {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+            if (ev->len > 0 && o.nome == ev->name) mudou = true;
+            p += sizeof(inotify_event) + ev->len;
+        }
+    }
+    return mudou;
+}
+
+void encerrarObservador(ObservadorArquivo& o) {
+    if (o.fd >= 0) close(o.fd);
+    o.fd = -1;
+    o.observacao = -1;
+}
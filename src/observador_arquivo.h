@@ -0,0 +1,22 @@
+// Observa um arquivo com inotify, sem bloquear: o laço de eventos consulta de tempos em
+// tempos. O diretório é observado (e não o arquivo), porque editores e exportadores costumam
+// gravar num temporário e renomear por cima, o que troca o inode.
+
+#pragma once
+
+#include <string>
+
+using namespace std;
+
+struct ObservadorArquivo {
+    int fd = -1;
+    int observacao = -1;
+    string nome;   // só o nome do arquivo, comparado com os eventos do diretório
+};
+
+bool iniciarObservador(ObservadorArquivo& o, const string& caminho);
+
+// Consome os eventos pendentes; true se algum deles indica que o arquivo foi regravado
+bool arquivoMudou(ObservadorArquivo& o);
+
+void encerrarObservador(ObservadorArquivo& o);
@@ -0,0 +1,310 @@
+#include "otimizar_malha.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "bvh.h"
+#include "paralelo.h"
+#include "perf.h"
+
+using namespace std;
+
+// Tamanho do cache simulado pela pontuação de Forsyth (maior que o real, como no artigo)
+static const int TAMANHO_CACHE_FORSYTH = 32;
+
+// Tabela de pontuação por posição no cache e por número de triângulos restantes
+struct PontuacaoForsyth {
+    float porPosicao[TAMANHO_CACHE_FORSYTH];
+    float porValencia[64];
+
+    PontuacaoForsyth() {
+        for (int i = 0; i < TAMANHO_CACHE_FORSYTH; ++i) {
+            // Os 3 vértices do último triângulo recebem um valor fixo para não favorecer fitas
+            porPosicao[i] = (i < 3) ? 0.75f
+                : pow(1.0f - (float)(i - 3) / (float)(TAMANHO_CACHE_FORSYTH - 3), 1.5f);
+        }
+        porValencia[0] = 0.0f;
+        for (int i = 1; i < 64; ++i) porValencia[i] = 2.0f / sqrt((float)i);
+    }
+
+    float vertice(int posCache, uint32_t restantes) const {
+        if (restantes == 0) return -1.0f;
+        const float cache = posCache >= 0 ? porPosicao[posCache] : 0.0f;
+        return cache + porValencia[min<uint32_t>(restantes, 63)];
+    }
+};
+
+static const PontuacaoForsyth PONTUACAO;
+
+// Ordena os triângulos idx (vértices locais 0..nV-1) pela pontuação de Forsyth.
+// Devolve em "ordem" os índices dos triângulos na nova sequência.
+static void ordenarForsyth(const vector<uint32_t>& idx, uint32_t nV, vector<uint32_t>& ordem) {
+    const size_t nTris = idx.size() / 3;
+    ordem.clear();
+    ordem.reserve(nTris);
+
+    // Vértice -> triângulos ainda não emitidos (CSR; os emitidos são retirados trocando com o fim)
+    vector<uint32_t> inicio(nV + 1, 0), restantes(nV, 0);
+    for (uint32_t v : idx) ++inicio[v + 1];
+    for (uint32_t v = 0; v < nV; ++v) { inicio[v + 1] += inicio[v]; restantes[v] = inicio[v + 1] - inicio[v]; }
+    vector<uint32_t> adj(idx.size());
+    {
+        vector<uint32_t> pos(inicio.begin(), inicio.end() - 1);
+        for (size_t i = 0; i < idx.size(); ++i) adj[pos[idx[i]]++] = (uint32_t)(i / 3);
+    }
+
+    vector<int> posCache(nV, -1);
+    vector<float> pontoV(nV);
+    for (uint32_t v = 0; v < nV; ++v) pontoV[v] = PONTUACAO.vertice(-1, restantes[v]);
+    vector<float> pontoT(nTris);
+    vector<uint8_t> emitido(nTris, 0);
+    for (size_t t = 0; t < nTris; ++t) pontoT[t] = pontoV[idx[t * 3]] + pontoV[idx[t * 3 + 1]] + pontoV[idx[t * 3 + 2]];
+
+    vector<uint32_t> cache, novoCache;
+    cache.reserve(TAMANHO_CACHE_FORSYTH + 3);
+    novoCache.reserve(TAMANHO_CACHE_FORSYTH + 3);
+
+    size_t melhor = 0;
+    for (size_t t = 1; t < nTris; ++t) if (pontoT[t] > pontoT[melhor]) melhor = t;
+    size_t cursor = 0;   // para quando nenhum triângulo do cache sobrou
+
+    while (ordem.size() < nTris) {
+        if (melhor == SIZE_MAX) {
+            while (emitido[cursor]) ++cursor;
+            melhor = cursor;
+        }
+        const uint32_t* tri = &idx[melhor * 3];
+        ordem.push_back((uint32_t)melhor);
+        emitido[melhor] = 1;
+
+        // Tira o triângulo das listas dos seus vértices
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = tri[k];
+            uint32_t* lista = &adj[inicio[v]];
+            for (uint32_t i = 0; i < restantes[v]; ++i)
+                if (lista[i] == melhor) { swap(lista[i], lista[restantes[v] - 1]); --restantes[v]; break; }
+        }
+
+        // Cache LRU: vértices do triângulo na frente, os demais na ordem em que estavam
+        novoCache.assign(tri, tri + 3);
+        for (uint32_t v : cache) if (v != tri[0] && v != tri[1] && v != tri[2]) novoCache.push_back(v);
+        cache.swap(novoCache);
+        for (size_t i = 0; i < cache.size(); ++i) {
+            const uint32_t v = cache[i];
+            posCache[v] = (i < (size_t)TAMANHO_CACHE_FORSYTH) ? (int)i : -1;
+            pontoV[v] = PONTUACAO.vertice(posCache[v], restantes[v]);
+        }
+
+        // Recalcula os triângulos ligados ao cache e escolhe o melhor entre eles
+        melhor = SIZE_MAX;
+        float pontoMelhor = -1.0f;
+        for (uint32_t v : cache)
+            for (uint32_t i = 0; i < restantes[v]; ++i) {
+                const uint32_t t = adj[inicio[v] + i];
+                const float p = pontoV[idx[t * 3]] + pontoV[idx[t * 3 + 1]] + pontoV[idx[t * 3 + 2]];
+                pontoT[t] = p;
+                if (p > pontoMelhor) { pontoMelhor = p; melhor = t; }
+            }
+        if (cache.size() > (size_t)TAMANHO_CACHE_FORSYTH) cache.resize(TAMANHO_CACHE_FORSYTH);
+    }
+}
+
+// Forsyth sobre os triângulos [triIni, triFim) de "indices" (globais), reescritos no lugar.
+// "origem" recebe a posição original de cada triângulo reordenado.
+static void otimizarFaixaCache(vector<uint32_t>& indices, size_t triIni, size_t triFim, uint32_t* origem) {
+    // Numeração local dos vértices da faixa
+    vector<uint32_t> unicos(indices.begin() + triIni * 3, indices.begin() + triFim * 3);
+    sort(unicos.begin(), unicos.end());
+    unicos.erase(unique(unicos.begin(), unicos.end()), unicos.end());
+    vector<uint32_t> locais((triFim - triIni) * 3);
+    for (size_t i = 0; i < locais.size(); ++i)
+        locais[i] = (uint32_t)(lower_bound(unicos.begin(), unicos.end(), indices[triIni * 3 + i]) - unicos.begin());
+
+    vector<uint32_t> ordem;
+    ordenarForsyth(locais, (uint32_t)unicos.size(), ordem);
+    for (size_t k = 0; k < ordem.size(); ++k) {
+        for (int j = 0; j < 3; ++j) indices[(triIni + k) * 3 + j] = unicos[locais[(size_t)ordem[k] * 3 + j]];
+        origem[k] = (uint32_t)triIni + ordem[k];
+    }
+}
+
+// Corta a faixa (já em ordem de cache) em grupos onde um triângulo erra os 3 vértices num
+// cache FIFO e ordena os grupos pela medida de overdraw: dot(normal do grupo, centróide do
+// grupo - centro da malha), maior primeiro
+static void ordenarFaixaOverdraw(vector<uint32_t>& indices, size_t triIni, size_t triFim, uint32_t* origem,
+                                 const MalhaIndexada& malha, const float centro[3]) {
+    struct Grupo { size_t ini, fim; float medida; };
+    vector<Grupo> grupos;
+    uint32_t fifo[16];
+    size_t nFifo = 0, topo = 0;
+    auto noCache = [&](uint32_t v) { for (size_t i = 0; i < nFifo; ++i) if (fifo[i] == v) return true; return false; };
+
+    size_t inicioGrupo = triIni;
+    for (size_t t = triIni; t < triFim; ++t) {
+        int erros = 0;
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = indices[t * 3 + k];
+            if (noCache(v)) continue;
+            ++erros;
+            fifo[topo] = v; topo = (topo + 1) % 16; nFifo = min<size_t>(nFifo + 1, 16);
+        }
+        if (erros == 3 && t > inicioGrupo) { grupos.push_back(Grupo{ inicioGrupo, t, 0.0f }); inicioGrupo = t; }
+    }
+    grupos.push_back(Grupo{ inicioGrupo, triFim, 0.0f });
+    if (grupos.size() < 2) return;
+
+    for (Grupo& g : grupos) {
+        double n[3] = { 0, 0, 0 }, c[3] = { 0, 0, 0 }, areaTotal = 0.0;
+        for (size_t t = g.ini; t < g.fim; ++t) {
+            const float* p[3];
+            for (int k = 0; k < 3; ++k) p[k] = &malha.vertices[(size_t)indices[t * 3 + k] * FLOATS_POR_VERTICE];
+            const double u[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            const double v[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+            const double nt[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+            const double area = sqrt(nt[0] * nt[0] + nt[1] * nt[1] + nt[2] * nt[2]);
+            for (int k = 0; k < 3; ++k) {
+                n[k] += nt[k];
+                c[k] += area * (p[0][k] + p[1][k] + p[2][k]) / 3.0;
+            }
+            areaTotal += area;
+        }
+        const double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len <= 0.0 || areaTotal <= 0.0) continue;
+        double medida = 0.0;
+        for (int k = 0; k < 3; ++k) medida += (c[k] / areaTotal - centro[k]) * n[k] / len;
+        g.medida = (float)medida;
+    }
+    stable_sort(grupos.begin(), grupos.end(), [](const Grupo& a, const Grupo& b) { return a.medida > b.medida; });
+
+    vector<uint32_t> novosIdx;
+    vector<uint32_t> novaOrigem;
+    novosIdx.reserve((triFim - triIni) * 3);
+    novaOrigem.reserve(triFim - triIni);
+    for (const Grupo& g : grupos) {
+        novosIdx.insert(novosIdx.end(), indices.begin() + g.ini * 3, indices.begin() + g.fim * 3);
+        novaOrigem.insert(novaOrigem.end(), origem + (g.ini - triIni), origem + (g.fim - triIni));
+    }
+    copy(novosIdx.begin(), novosIdx.end(), indices.begin() + triIni * 3);
+    copy(novaOrigem.begin(), novaOrigem.end(), origem);
+}
+
+template <class Indice>
+static void copiarIndices(const vector<uint32_t>& origem, vector<Indice>& destino) {
+    for (size_t i = 0; i < origem.size(); ++i) destino[i] = (Indice)origem[i];
+}
+
+void otimizarMalhaIndexada(
+    MalhaIndexada& malha,
+    const vector<uint32_t>& inicioFaixasEntrada,
+    vector<uint32_t>& permutacao,
+    int numThreads
+) {
+    const size_t nIndices = malha.numIndices();
+    const size_t nTris = nIndices / 3;
+    permutacao.resize(nTris);
+    if (nTris == 0) return;
+
+    vector<uint32_t> faixas = inicioFaixasEntrada;
+    if (faixas.size() < 2) faixas = { 0, (uint32_t)nTris };
+
+    vector<uint32_t> indices(nIndices);
+    for (size_t i = 0; i < nIndices; ++i) indices[i] = malha.indice(i);
+
+    // Centro da malha para a medida de overdraw
+    float centro[3] = { 0, 0, 0 };
+    const size_t nV = malha.numVertices();
+    for (size_t v = 0; v < nV; ++v)
+        for (int k = 0; k < 3; ++k) centro[k] += malha.vertices[v * FLOATS_POR_VERTICE + k] / (float)nV;
+
+    // (1) e (2): cada faixa é independente
+    const size_t nFaixas = faixas.size() - 1;
+    paraCadaFaixa(nFaixas, numThreadsEfetivo(numThreads), [&](size_t, size_t fIni, size_t fFim) {
+        for (size_t f = fIni; f < fFim; ++f) {
+            if (faixas[f + 1] <= faixas[f]) continue;
+            otimizarFaixaCache(indices, faixas[f], faixas[f + 1], &permutacao[faixas[f]]);
+            ordenarFaixaOverdraw(indices, faixas[f], faixas[f + 1], &permutacao[faixas[f]], malha, centro);
+        }
+    });
+
+    // Níveis de LOD: só o cache (são desenhados inteiros, sem faixas)
+    paraCadaFaixa(malha.niveisLOD.size(), numThreadsEfetivo(numThreads), [&](size_t, size_t nIni, size_t nFim) {
+        for (size_t n = nIni; n < nFim; ++n) {
+            const NivelLOD& nivel = malha.niveisLOD[n];
+            vector<uint32_t> lod(malha.indicesLOD.begin() + nivel.primeiroIndice,
+                                 malha.indicesLOD.begin() + nivel.primeiroIndice + nivel.numIndices);
+            vector<uint32_t> origemLOD(lod.size() / 3);
+            otimizarFaixaCache(lod, 0, lod.size() / 3, origemLOD.data());
+            copy(lod.begin(), lod.end(), malha.indicesLOD.begin() + nivel.primeiroIndice);
+        }
+    });
+
+    // (3) Vértices na ordem do primeiro uso (índices completos, depois os níveis)
+    vector<uint32_t> novoId(nV, UINT32_MAX);
+    uint32_t proximo = 0;
+    for (uint32_t& i : indices) { if (novoId[i] == UINT32_MAX) novoId[i] = proximo++; i = novoId[i]; }
+    for (uint32_t& i : malha.indicesLOD) { if (novoId[i] == UINT32_MAX) novoId[i] = proximo++; i = novoId[i]; }
+    for (size_t v = 0; v < nV; ++v) if (novoId[v] == UINT32_MAX) novoId[v] = proximo++;
+    vector<float> vertices(malha.vertices.size());
+    for (size_t v = 0; v < nV; ++v)
+        copy_n(&malha.vertices[v * FLOATS_POR_VERTICE], FLOATS_POR_VERTICE, &vertices[(size_t)novoId[v] * FLOATS_POR_VERTICE]);
+    malha.vertices.swap(vertices);
+
+    if (malha.indices16Bits()) copiarIndices(indices, malha.indices16);
+    else copiarIndices(indices, malha.indices32);
+}
+
+EstatisticasCacheVertices analisarCacheVertices(const MalhaIndexada& malha, uint32_t tamanhoCache) {
+    const size_t nIndices = malha.numIndices();
+    if (nIndices == 0) return EstatisticasCacheVertices{ 0.0, 0.0 };
+    // FIFO: o instante em que cada vértice entrou; está no cache se entrou há menos de tamanhoCache erros
+    vector<uint64_t> entrada(malha.numVertices(), UINT64_MAX);
+    vector<uint8_t> usado(malha.numVertices(), 0);
+    uint64_t erros = 0;
+    size_t unicos = 0;
+    for (size_t i = 0; i < nIndices; ++i) {
+        const uint32_t v = malha.indice(i);
+        if (!usado[v]) { usado[v] = 1; ++unicos; }
+        if (entrada[v] != UINT64_MAX && erros - entrada[v] < tamanhoCache) continue;
+        entrada[v] = erros++;
+    }
+    return EstatisticasCacheVertices{ (double)erros / (nIndices / 3), (double)erros / unicos };
+}
+
+void otimizarMalhaComBVH(MalhaIndexada& malha, BVHMalha& bvh, int numThreads) {
+    PERF_ESCOPO("carga.otimizar");
+    const auto t0 = chrono::steady_clock::now();
+    const EstatisticasCacheVertices antes = analisarCacheVertices(malha);
+
+    vector<uint32_t> faixas;
+    if (!bvh.vazia() && bvh.ordem.size() * 3 == malha.numIndices()) {
+        for (const ClusterBVH& c : bvh.clusters) faixas.push_back(c.primeiroTri);
+        faixas.push_back((uint32_t)bvh.ordem.size());
+    }
+    vector<uint32_t> permutacao;
+    otimizarMalhaIndexada(malha, faixas, permutacao, numThreads);
+    if (!faixas.empty()) {
+        vector<uint32_t> ordemDesenho(permutacao.size());
+        for (size_t k = 0; k < permutacao.size(); ++k) ordemDesenho[k] = bvh.ordemDesenho[permutacao[k]];
+        bvh.ordemDesenho.swap(ordemDesenho);
+    }
+
+    const EstatisticasCacheVertices depois = analisarCacheVertices(malha);
+    cout << "Otimizacao (cache FIFO de 16): ACMR " << antes.acmr << " -> " << depois.acmr
+         << ", ATVR " << antes.atvr << " -> " << depois.atvr << " em "
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count() << " ms\n";
+}
+
+void prepararMalhaCarregada(MalhaOBJ& m, bool montarBVH, bool otimizar, BVHMalha& bvh, int numThreads) {
+    if (!VisaoMalhaOBJ(m).indexada.faixasMaterial.empty()) return;
+    if (montarBVH) {
+        copiarIndexadaDoCache(m, false);
+        const VisaoMalhaOBJ v(m);
+        prepararBVH(v.vertices, v.triangulos, m.indexada, bvh);
+    }
+    if (otimizar) {
+        copiarIndexadaDoCache(m, true);
+        otimizarMalhaComBVH(m.indexada, bvh, numThreads);
+    }
+}
@@ -0,0 +1,46 @@
+// Otimização da ordem dos triângulos e vértices da malha indexada para a GPU.
+// (1) Os triângulos de cada faixa são reordenados para o cache pós-transformação de vértices
+//     (algoritmo de Tom Forsyth, "Linear-Speed Vertex Cache Optimisation").
+// (2) A ordem resultante é cortada em grupos onde o cache recomeça e os grupos são ordenados
+//     por uma medida de overdraw independente da câmera (os que apontam para fora do centro
+//     primeiro), como no Tipsify de Sander et al., ajudando o early-z.
+// (3) Os vértices são renumerados na ordem do primeiro uso, para leituras sequenciais.
+// As faixas (ex.: clusters da BVH) continuam no mesmo lugar do IBO.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bvh.h"
+#include "obj_loader.h"
+
+using namespace std;
+
+// Faz as três etapas. A faixa i cobre os triângulos [inicioFaixas[i], inicioFaixas[i + 1]) do IBO
+// (vazio = uma faixa com a malha inteira). Os níveis de LOD também passam pela etapa (1).
+// "permutacao" recebe, para cada posição nova de triângulo no IBO, a posição antiga.
+void otimizarMalhaIndexada(
+    MalhaIndexada& malha,
+    const vector<uint32_t>& inicioFaixas,
+    vector<uint32_t>& permutacao,
+    int numThreads = 0
+);
+
+// Simulação de um cache FIFO de vértices sobre os índices completos
+struct EstatisticasCacheVertices {
+    double acmr;   // vértices transformados por triângulo (mínimo ~0,5; pior 3)
+    double atvr;   // vértices transformados por vértice único (ideal 1)
+};
+
+EstatisticasCacheVertices analisarCacheVertices(const MalhaIndexada& malha, uint32_t tamanhoCache = 16);
+
+// otimizarMalhaIndexada com os clusters da BVH como faixas (ou a malha inteira se a BVH
+// estiver vazia), atualizando bvh.ordemDesenho; mostra ACMR/ATVR antes e depois no log
+void otimizarMalhaComBVH(MalhaIndexada& malha, BVHMalha& bvh, int numThreads = 0);
+
+// Passo de carregarMalhaOBJ depois da indexação, antes de gravar o cache: monta a BVH
+// (montarBVH) e otimiza a ordem com os clusters dela (otimizar). As duas reordenam os índices,
+// o que desfaria o agrupamento por material, então malhas com materiais ficam como estão.
+// Vindos do cache, os arrays alterados são copiados antes (copiarIndexadaDoCache).
+void prepararMalhaCarregada(MalhaOBJ& m, bool montarBVH, bool otimizar, BVHMalha& bvh, int numThreads = 0);
@@ -0,0 +1,45 @@
+// Utilitários simples de paralelismo usados pelo carregador.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Número de threads a usar: o pedido, ou os núcleos disponíveis quando pedido <= 0
+inline size_t numThreadsEfetivo(int pedido) {
+    if (pedido > 0) return (size_t)pedido;
+    return (size_t)std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Executa tarefa(i) para i em [0, n), cada índice numa thread (a 0 roda na thread atual)
+template <class Tarefa>
+void paraCadaBloco(size_t n, Tarefa tarefa) {
+    std::vector<std::thread> ts;
+    ts.reserve(n > 0 ? n - 1 : 0);
+    for (size_t i = 1; i < n; ++i) ts.emplace_back(tarefa, i);
+    if (n > 0) tarefa(0);
+    for (auto& t : ts) t.join();
+}
+
+// Divide [0, total) em até n faixas contíguas e chama tarefa(faixa, inicio, fim) para cada
+// uma em paralelo
+template <class Tarefa>
+void paraCadaFaixa(size_t total, size_t n, Tarefa tarefa) {
+    n = std::max<size_t>(1, std::min(n, total));
+    paraCadaBloco(n, [&](size_t i) {
+        tarefa(i, total * i / n, total * (i + 1) / n);
+    });
+}
+
+// Executa tarefa(i) para i em [0, n) com até numThreads threads (0 = núcleos disponíveis),
+// distribuindo os índices sob demanda: para itens de custo bem diferente (imagens, trechos)
+template <class Tarefa>
+void paraCadaItem(size_t n, int numThreads, Tarefa tarefa) {
+    std::atomic<size_t> proximo(0);
+    paraCadaBloco(std::min(numThreadsEfetivo(numThreads), n), [&](size_t) {
+        for (size_t i; (i = proximo.fetch_add(1)) < n;) tarefa(i);
+    });
+}
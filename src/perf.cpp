@@ -0,0 +1,125 @@
+#include "perf.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+using namespace std;
+
+atomic<bool> g_perfAtivo{ false };
+
+struct EventoPerf {
+    const char* nome;
+    uint64_t inicioNs;
+    uint64_t duracaoNs;
+    double valor;
+    uint32_t thread;
+    bool contador;
+};
+
+// Teto dos eventos guardados (~32 MB); além dele só os totais continuam
+static const size_t LIMITE_EVENTOS = 1u << 20;
+
+static mutex g_trava;
+static bool g_gravarEventos = false;
+static vector<EventoPerf> g_eventos;
+static size_t g_eventosPerdidos = 0;
+static vector<TotalFasePerf> g_totais;
+static vector<const char*> g_nomesTotais;          // mesmos índices de g_totais
+static vector<pair<uint32_t, string>> g_nomesThreads;
+static atomic<uint32_t> g_proximaThread{ 1 };
+static const uint64_t g_origemNs = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+
+static uint32_t idThread() {
+    thread_local const uint32_t id = g_proximaThread.fetch_add(1);
+    return id;
+}
+
+static void guardarEvento(const EventoPerf& e) {
+    if (!g_gravarEventos) return;
+    if (g_eventos.size() < LIMITE_EVENTOS) g_eventos.push_back(e);
+    else ++g_eventosPerdidos;
+}
+
+void configurarPerf(bool ativo, bool gravarEventos) {
+    lock_guard<mutex> g(g_trava);
+    g_gravarEventos = gravarEventos;
+    g_perfAtivo.store(ativo || gravarEventos, memory_order_relaxed);
+}
+
+uint64_t relogioPerfNs() {
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count()
+         - g_origemNs;
+}
+
+void nomearThreadPerf(const char* nome) {
+    const uint32_t id = idThread();
+    lock_guard<mutex> g(g_trava);
+    g_nomesThreads.emplace_back(id, nome);
+}
+
+void registrarIntervaloPerf(const char* nome, uint64_t inicioNs, uint64_t fimNs) {
+    const uint32_t id = idThread();
+    lock_guard<mutex> g(g_trava);
+    // Poucos nomes distintos: busca linear pelo ponteiro (literais) e, na falta, pelo texto
+    size_t i = 0;
+    while (i < g_nomesTotais.size() && g_nomesTotais[i] != nome) ++i;
+    if (i == g_nomesTotais.size()) {
+        i = 0;
+        while (i < g_totais.size() && g_totais[i].nome != nome) ++i;
+        if (i == g_totais.size()) {
+            g_totais.push_back(TotalFasePerf{ nome, 0.0, 0 });
+            g_nomesTotais.push_back(nome);
+        }
+    }
+    g_totais[i].ms += (fimNs - inicioNs) / 1.0e6;
+    ++g_totais[i].chamadas;
+    guardarEvento(EventoPerf{ nome, inicioNs, fimNs - inicioNs, 0.0, id, false });
+}
+
+void registrarContadorPerf(const char* nome, double valor) {
+    const uint32_t id = idThread();
+    const uint64_t agora = relogioPerfNs();
+    lock_guard<mutex> g(g_trava);
+    guardarEvento(EventoPerf{ nome, agora, 0, valor, id, true });
+}
+
+vector<TotalFasePerf> totaisFasesPerf() {
+    lock_guard<mutex> g(g_trava);
+    return g_totais;
+}
+
+bool gravarTracePerf(const string& caminho) {
+    lock_guard<mutex> g(g_trava);
+    if (g_eventos.empty()) return false;
+    ofstream f(caminho);
+    if (!f) {
+        cerr << "Falha ao gravar o trace: " << caminho << "\n";
+        return false;
+    }
+    // Tempos em microssegundos, como o formato pede; em ponto fixo com resolução de ns, pois a
+    // precisão padrão (6 dígitos) arredonda ts para 100 µs depois de ~10 s de execução
+    f << fixed << setprecision(3);
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool primeiro = true;
+    auto separar = [&]() { if (!primeiro) f << ",\n"; primeiro = false; };
+    for (const auto& t : g_nomesThreads) {
+        separar();
+        f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t.first
+          << ",\"args\":{\"name\":\"" << t.second << "\"}}";
+    }
+    for (const EventoPerf& e : g_eventos) {
+        separar();
+        f << "{\"name\":\"" << e.nome << "\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << e.inicioNs / 1000.0;
+        if (e.contador) f << ",\"ph\":\"C\",\"args\":{\"valor\":" << e.valor << "}}";
+        else f << ",\"ph\":\"X\",\"dur\":" << e.duracaoNs / 1000.0 << "}";
+    }
+    f << "\n]}\n";
+    cout << "Trace: " << caminho << " (" << g_eventos.size() << " eventos";
+    if (g_eventosPerdidos) cout << ", " << g_eventosPerdidos << " descartados pelo limite";
+    cout << ")\n";
+    return (bool)f;
+}
@@ -0,0 +1,64 @@
+// Instrumentação leve: medidores de escopo e contadores.
+// Desligada (padrão), cada PERF_ESCOPO custa a leitura de um atomic<bool>; compilando com
+// -DSEM_PERF os macros somem. Ligada (--perf, --trace=arquivo.json ou --bench), cada intervalo
+// soma no total da fase com o mesmo nome (o log da carga e o JSON do --bench usam esses totais)
+// e, se pedido, vira um evento do trace no formato Chrome trace-event (chrome://tracing,
+// ui.perfetto.dev). Pode ser usada de qualquer thread.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+extern atomic<bool> g_perfAtivo;
+
+inline bool perfAtivo() { return g_perfAtivo.load(memory_order_relaxed); }
+
+// gravarEventos: guarda também os eventos individuais para gravarTracePerf
+void configurarPerf(bool ativo, bool gravarEventos);
+
+// Nanossegundos do relógio monotônico
+uint64_t relogioPerfNs();
+
+// Nome da thread atual no trace (ex.: "carga")
+void nomearThreadPerf(const char* nome);
+
+// nome precisa durar até o fim do programa (literal)
+void registrarIntervaloPerf(const char* nome, uint64_t inicioNs, uint64_t fimNs);
+void registrarContadorPerf(const char* nome, double valor);
+
+struct MedidorPerf {
+    const char* nome;
+    uint64_t inicio;
+
+    explicit MedidorPerf(const char* n) : nome(perfAtivo() ? n : nullptr), inicio(nome ? relogioPerfNs() : 0) {}
+    ~MedidorPerf() { if (nome) registrarIntervaloPerf(nome, inicio, relogioPerfNs()); }
+    MedidorPerf(const MedidorPerf&) = delete;
+    MedidorPerf& operator=(const MedidorPerf&) = delete;
+};
+
+#define PERF_CONCATENAR2(a, b) a##b
+#define PERF_CONCATENAR(a, b) PERF_CONCATENAR2(a, b)
+#ifdef SEM_PERF
+#define PERF_ESCOPO(nome) ((void)0)
+#define PERF_CONTADOR(nome, valor) ((void)0)
+#else
+#define PERF_ESCOPO(nome) MedidorPerf PERF_CONCATENAR(medidorPerf_, __LINE__)(nome)
+#define PERF_CONTADOR(nome, valor) do { if (perfAtivo()) registrarContadorPerf(nome, (double)(valor)); } while (0)
+#endif
+
+struct TotalFasePerf {
+    string nome;
+    double ms = 0.0;
+    uint64_t chamadas = 0;
+};
+
+// Totais por nome, na ordem em que cada fase apareceu pela primeira vez
+vector<TotalFasePerf> totaisFasesPerf();
+
+// Grava os eventos guardados em JSON (Chrome trace-event); falso se não houver o que gravar
+bool gravarTracePerf(const string& caminho);
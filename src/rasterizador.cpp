@@ -0,0 +1,668 @@
+#include "rasterizador.h"
+#include "paralelo.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86 1
+#endif
+
+using namespace std;
+
+static const int LADO_LADRILHO = 64;
+static const int LADO_BLOCO = 8;
+static const int SUBPIXEL = 256;          // 8 bits de subpixel
+static const float GUARDA = 8.0f;         // recorte em x/y só fora de [-8w, 8w]: mantém o ponto fixo em 32 bits
+static const int MAX_VERTICES_RECORTE = 9;
+
+static const double PI = 3.14159265358979323846;
+
+// ----------------------------------------------------------------------------- matrizes
+
+// out = a * b (por colunas)
+static void multiplicar(const float a[16], const float b[16], float out[16]) {
+    float r[16];
+    for (int c = 0; c < 4; ++c)
+        for (int l = 0; l < 4; ++l)
+            r[c * 4 + l] = a[0 * 4 + l] * b[c * 4 + 0] + a[1 * 4 + l] * b[c * 4 + 1]
+                         + a[2 * 4 + l] * b[c * 4 + 2] + a[3 * 4 + l] * b[c * 4 + 3];
+    memcpy(out, r, sizeof(r));
+}
+
+static void identidade(float m[16]) {
+    for (int i = 0; i < 16; ++i) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
+
+// glRotatef(graus, eixo) para um eixo coordenado (0 = X, 1 = Y, 2 = Z)
+static void rotacao(float graus, int eixo, float m[16]) {
+    identidade(m);
+    const float r = (float)(graus * PI / 180.0);
+    const float c = cos(r), s = sin(r);
+    const int a = (eixo + 1) % 3, b = (eixo + 2) % 3;
+    m[a * 4 + a] = c;  m[b * 4 + a] = -s;
+    m[a * 4 + b] = s;  m[b * 4 + b] = c;
+}
+
+void matrizPerspectiva(float fovyGraus, float aspecto, float perto, float longe, float out[16]) {
+    const float f = (float)(1.0 / tan(fovyGraus * PI / 360.0));
+    for (int i = 0; i < 16; ++i) out[i] = 0.0f;
+    out[0] = f / aspecto;
+    out[5] = f;
+    out[10] = (longe + perto) / (perto - longe);
+    out[11] = -1.0f;
+    out[14] = 2.0f * longe * perto / (perto - longe);
+}
+
+void matrizObjeto(float tx, float ty, float tz, float rx, float ry, float rz, float escala, float out[16]) {
+    float t[16], r[16];
+    identidade(out);
+    out[12] = tx; out[13] = ty; out[14] = tz;
+    rotacao(rx, 0, r); multiplicar(out, r, out);
+    rotacao(ry, 1, r); multiplicar(out, r, out);
+    rotacao(rz, 2, r); multiplicar(out, r, out);
+    identidade(t);
+    t[0] = t[5] = t[10] = escala;
+    multiplicar(out, t, out);
+}
+
+// Inversa transposta da parte 3x3 (transformação das normais); n[l * 3 + c]
+static void matrizNormal(const float m[16], float n[9]) {
+    const float a = m[0], b = m[4], c = m[8];
+    const float d = m[1], e = m[5], f = m[9];
+    const float g = m[2], h = m[6], i = m[10];
+    const float A = e * i - f * h, B = -(d * i - f * g), C = d * h - e * g;
+    const float D = -(b * i - c * h), E = a * i - c * g, F = -(a * h - b * g);
+    const float G = b * f - c * e, H = -(a * f - c * d), I = a * e - b * d;
+    const float det = a * A + b * B + c * C;
+    const float k = det != 0.0f ? 1.0f / det : 0.0f;
+    // Inversa = adj / det (adj = transposta dos cofatores); a transposta da inversa são os cofatores
+    n[0] = A * k; n[1] = B * k; n[2] = C * k;
+    n[3] = D * k; n[4] = E * k; n[5] = F * k;
+    n[6] = G * k; n[7] = H * k; n[8] = I * k;
+}
+
+// ----------------------------------------------------------------------------- vértices
+
+// Distância ao plano p (>= 0 dentro): perto, longe e as quatro da banda de guarda
+static float distanciaPlano(const float c[4], int p) {
+    switch (p) {
+        case 0: return c[2] + c[3];
+        case 1: return c[3] - c[2];
+        case 2: return GUARDA * c[3] - c[0];
+        case 3: return GUARDA * c[3] + c[0];
+        case 4: return GUARDA * c[3] - c[1];
+        default: return GUARDA * c[3] + c[1];
+    }
+}
+
+static int codigoFora(const float c[4]) {
+    int codigo = 0;
+    for (int p = 0; p < 6; ++p)
+        if (distanciaPlano(c, p) < 0.0f) codigo |= 1 << p;
+    return codigo;
+}
+
+
+static inline int32_t arredondar(double v) {
+    return (int32_t)(v >= 0.0 ? v + 0.5 : v - 0.5);
+}
+
+// Coordenadas de janela (x, y em ponto fixo) de um ponto dentro da banda de guarda
+static inline void projetar(const float c[4], int largura, int altura, int32_t& x, int32_t& y, float& z, float& invW) {
+    invW = 1.0f / c[3];
+    x = arredondar((c[0] * invW * 0.5 + 0.5) * largura * SUBPIXEL);
+    y = arredondar((c[1] * invW * 0.5 + 0.5) * altura * SUBPIXEL);
+    z = c[2] * invW * 0.5f + 0.5f;
+}
+
+
+static void transformarVertices(const VisaoMalhaIndexada& malha, const CenaRaster& cena, int largura, int altura,
+                                size_t inicio, size_t fim, VerticeRaster* out) {
+    float mvp[16], nm[9];
+    multiplicar(cena.projecao, cena.modelview, mvp);
+    matrizNormal(cena.modelview, nm);
+    const float* mv = cena.modelview;
+    const float* luz = cena.posicaoLuz;
+    for (size_t i = inicio; i < fim; ++i) {
+        const float* p = &malha.vertices[i * FLOATS_POR_VERTICE];
+        VerticeRaster& o = out[i];
+        for (int l = 0; l < 4; ++l) o.clip[l] = mvp[l] * p[0] + mvp[4 + l] * p[1] + mvp[8 + l] * p[2] + mvp[12 + l];
+        o.fora = codigoFora(o.clip);
+        if (!o.fora) projetar(o.clip, largura, altura, o.x, o.y, o.z, o.invW);
+        const float olho[3] = {
+            mv[0] * p[0] + mv[4] * p[1] + mv[8] * p[2] + mv[12],
+            mv[1] * p[0] + mv[5] * p[1] + mv[9] * p[2] + mv[13],
+            mv[2] * p[0] + mv[6] * p[1] + mv[10] * p[2] + mv[14],
+        };
+        // GL_NORMALIZE
+        float n[3];
+        for (int l = 0; l < 3; ++l) n[l] = nm[l * 3] * p[3] + nm[l * 3 + 1] * p[4] + nm[l * 3 + 2] * p[5];
+        float len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len > 0.0f) { n[0] /= len; n[1] /= len; n[2] /= len; }
+        // Luz pontual (w = 1) ou direcional (w = 0); observador no infinito: H = L + (0, 0, 1)
+        float L[3];
+        for (int l = 0; l < 3; ++l) L[l] = luz[3] != 0.0f ? luz[l] - olho[l] : luz[l];
+        len = sqrt(L[0] * L[0] + L[1] * L[1] + L[2] * L[2]);
+        if (len > 0.0f) { L[0] /= len; L[1] /= len; L[2] /= len; }
+        float H[3] = { L[0], L[1], L[2] + 1.0f };
+        len = sqrt(H[0] * H[0] + H[1] * H[1] + H[2] * H[2]);
+        if (len > 0.0f) { H[0] /= len; H[1] /= len; H[2] /= len; }
+        o.nl = n[0] * L[0] + n[1] * L[1] + n[2] * L[2];
+        o.nh = n[0] * H[0] + n[1] * H[1] + n[2] * H[2];
+        o.u = p[6];
+        o.v = p[7];
+    }
+}
+
+// ----------------------------------------------------------------------------- montagem
+
+// Termos da equação de iluminação que só dependem do material
+struct MaterialPreparado {
+    float ambiente[3], difusa[3], especular[3];
+    float alfa, brilho;
+    bool temEspecular, misturar;
+    const ImagemRGBA* textura;
+};
+
+static MaterialPreparado prepararMaterial(const MaterialRaster& m, const CenaRaster& cena) {
+    MaterialPreparado p;
+    for (int k = 0; k < 3; ++k) {
+        p.ambiente[k] = m.cor[k] * (cena.ambienteGlobal[k] + cena.luzAmbiente[k]);
+        p.difusa[k] = m.cor[k] * cena.luzDifusa[k];
+        p.especular[k] = m.especular[k] * cena.luzEspecular[k];
+    }
+    p.alfa = m.cor[3];
+    p.brilho = m.brilho;
+    p.temEspecular = p.especular[0] > 0.0f || p.especular[1] > 0.0f || p.especular[2] > 0.0f;
+    p.misturar = m.cor[3] < 1.0f;   // GL_BLEND só nos materiais translúcidos, como em aplicarMaterial
+    p.textura = (m.textura && !m.textura->niveis.empty()) ? m.textura : nullptr;
+    return p;
+}
+
+// Cor de um vértice numa face (sinal = +1 frente, -1 verso: a normal é invertida)
+static void iluminar(const MaterialPreparado& m, float nl, float nh, float sinal, float out[4]) {
+    nl *= sinal;
+    nh *= sinal;
+    const float dif = max(nl, 0.0f);
+    const float esp = (m.temEspecular && nl > 0.0f) ? pow(max(nh, 0.0f), m.brilho) : 0.0f;
+    for (int k = 0; k < 3; ++k) out[k] = min(1.0f, m.ambiente[k] + dif * m.difusa[k] + esp * m.especular[k]);
+    out[3] = m.alfa;
+}
+
+struct VerticeRecorte {
+    float clip[4];
+    float frente[4], verso[4];
+    float u, v;
+};
+
+static VerticeRecorte interpolar(const VerticeRecorte& a, const VerticeRecorte& b, float t) {
+    VerticeRecorte r;
+    for (int k = 0; k < 4; ++k) {
+        r.clip[k] = a.clip[k] + t * (b.clip[k] - a.clip[k]);
+        r.frente[k] = a.frente[k] + t * (b.frente[k] - a.frente[k]);
+        r.verso[k] = a.verso[k] + t * (b.verso[k] - a.verso[k]);
+    }
+    r.u = a.u + t * (b.u - a.u);
+    r.v = a.v + t * (b.v - a.v);
+    return r;
+}
+
+// Sutherland-Hodgman nos planos marcados em "planos"; devolve o número de vértices
+static int recortar(VerticeRecorte* poli, int n, int planos) {
+    VerticeRecorte tmp[MAX_VERTICES_RECORTE];
+    for (int p = 0; p < 6 && n > 0; ++p) {
+        if (!(planos & (1 << p))) continue;
+        int m = 0;
+        for (int i = 0; i < n; ++i) {
+            const VerticeRecorte& a = poli[i];
+            const VerticeRecorte& b = poli[(i + 1) % n];
+            const float da = distanciaPlano(a.clip, p), db = distanciaPlano(b.clip, p);
+            if (da >= 0.0f) tmp[m++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) tmp[m++] = interpolar(a, b, da / (da - db));
+        }
+        n = m;
+        copy(tmp, tmp + n, poli);
+    }
+    return n;
+}
+
+static inline int64_t divisaoPiso(int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+struct ContextoMontagem {
+    const vector<MaterialPreparado>* materiais;
+    const VerticeRaster* vertices;
+    int largura, altura, ladrilhosX;
+};
+
+// Triângulo em coordenadas de janela (x, y em ponto fixo) para o sentido anti-horário
+// (ordem[k] = vértice de origem). Devolve 1 para a face da frente (anti-horário na janela, o
+// glFrontFace padrão), -1 para o verso e 0 se nenhum centro de pixel pode ser coberto. Cores e
+// UVs ficam para quem chama: só os triângulos que sobram são iluminados.
+static int montarTriangulo(const ContextoMontagem& ctx, const int32_t x[3], const int32_t y[3], const float z[3],
+                           const float invW[3], TrianguloRaster& r, int ordem[3]) {
+    const int32_t minX = min(x[0], min(x[1], x[2])), maxX = max(x[0], max(x[1], x[2]));
+    const int32_t minY = min(y[0], min(y[1], y[2])), maxY = max(y[0], max(y[1], y[2]));
+    // Centros de pixel em p * SUBPIXEL + SUBPIXEL / 2
+    r.minX = (int32_t)max<int64_t>(0, divisaoPiso(minX - SUBPIXEL / 2 + SUBPIXEL - 1, SUBPIXEL));
+    r.maxX = (int32_t)min<int64_t>(ctx.largura - 1, divisaoPiso(maxX - SUBPIXEL / 2, SUBPIXEL));
+    r.minY = (int32_t)max<int64_t>(0, divisaoPiso(minY - SUBPIXEL / 2 + SUBPIXEL - 1, SUBPIXEL));
+    r.maxY = (int32_t)min<int64_t>(ctx.altura - 1, divisaoPiso(maxY - SUBPIXEL / 2, SUBPIXEL));
+    if (r.minX > r.maxX || r.minY > r.maxY) return 0;
+    const int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0) return 0;
+    ordem[0] = 0;
+    ordem[1] = area > 0 ? 1 : 2;
+    ordem[2] = area > 0 ? 2 : 1;
+    for (int k = 0; k < 3; ++k) {
+        const int o = ordem[k];
+        r.x[k] = x[o]; r.y[k] = y[o]; r.z[k] = z[o];
+        r.invW[k] = invW[o];
+    }
+    return area > 0 ? 1 : -1;
+}
+
+static void distribuirTriangulo(const ContextoMontagem& ctx, const TrianguloRaster& r,
+                                vector<TrianguloRaster>& tris, vector<vector<uint32_t>>& ladrilhos) {
+    const uint32_t id = (uint32_t)tris.size();
+    tris.push_back(r);
+    for (int ly = r.minY / LADO_LADRILHO; ly <= r.maxY / LADO_LADRILHO; ++ly)
+        for (int lx = r.minX / LADO_LADRILHO; lx <= r.maxX / LADO_LADRILHO; ++lx)
+            ladrilhos[(size_t)(ly * ctx.ladrilhosX + lx)].push_back(id);
+}
+
+static void montarTriangulos(const ContextoMontagem& ctx, const VisaoMalhaIndexada& malha,
+                             const vector<FaixaMaterial>& faixas, size_t triInicio, size_t triFim,
+                             vector<TrianguloRaster>& tris, vector<vector<uint32_t>>& ladrilhos) {
+    tris.clear();
+    for (vector<uint32_t>& l : ladrilhos) l.clear();
+    size_t f = 0;
+    TrianguloRaster r;
+    int ordem[3];
+    for (size_t t = triInicio; t < triFim; ++t) {
+        while (f + 1 < faixas.size() && (size_t)faixas[f].primeiroIndice + faixas[f].numIndices <= t * 3) ++f;
+        const int idMaterial = faixas[f].material;
+        const int material = (idMaterial >= 0 && (size_t)idMaterial + 1 < ctx.materiais->size()) ? idMaterial + 1 : 0;
+        const MaterialPreparado& m = (*ctx.materiais)[(size_t)material];
+        r.material = material;
+        const VerticeRaster* v[3] = {
+            &ctx.vertices[malha.indice(t * 3)], &ctx.vertices[malha.indice(t * 3 + 1)], &ctx.vertices[malha.indice(t * 3 + 2)],
+        };
+        const int c0 = v[0]->fora, c1 = v[1]->fora, c2 = v[2]->fora;
+        if (c0 & c1 & c2) continue;   // inteiro fora de um dos planos
+
+        if (!(c0 | c1 | c2)) {
+            // Caso comum, sem recorte: os vértices já estão projetados
+            const int32_t x[3] = { v[0]->x, v[1]->x, v[2]->x }, y[3] = { v[0]->y, v[1]->y, v[2]->y };
+            const float z[3] = { v[0]->z, v[1]->z, v[2]->z }, invW[3] = { v[0]->invW, v[1]->invW, v[2]->invW };
+            const int face = montarTriangulo(ctx, x, y, z, invW, r, ordem);
+            if (face == 0) continue;
+            for (int k = 0; k < 3; ++k) {
+                const VerticeRaster& o = *v[ordem[k]];
+                float cor[4];
+                iluminar(m, o.nl, o.nh, (float)face, cor);
+                for (int c = 0; c < 4; ++c) r.corW[k][c] = cor[c] * r.invW[k];
+                r.uW[k] = o.u * r.invW[k];
+                r.vW[k] = o.v * r.invW[k];
+            }
+            distribuirTriangulo(ctx, r, tris, ladrilhos);
+            continue;
+        }
+
+        // Recortado: a face só é conhecida depois da projeção, então as duas cores são interpoladas
+        VerticeRecorte poli[MAX_VERTICES_RECORTE];
+        for (int k = 0; k < 3; ++k) {
+            copy(v[k]->clip, v[k]->clip + 4, poli[k].clip);
+            iluminar(m, v[k]->nl, v[k]->nh, 1.0f, poli[k].frente);
+            iluminar(m, v[k]->nl, v[k]->nh, -1.0f, poli[k].verso);
+            poli[k].u = v[k]->u;
+            poli[k].v = v[k]->v;
+        }
+        const int n = recortar(poli, 3, c0 | c1 | c2);
+        for (int k = 1; k + 1 < n; ++k) {
+            const VerticeRecorte* tri[3] = { &poli[0], &poli[k], &poli[k + 1] };
+            int32_t x[3], y[3];
+            float z[3], invW[3];
+            for (int j = 0; j < 3; ++j) projetar(tri[j]->clip, ctx.largura, ctx.altura, x[j], y[j], z[j], invW[j]);
+            const int face = montarTriangulo(ctx, x, y, z, invW, r, ordem);
+            if (face == 0) continue;
+            for (int j = 0; j < 3; ++j) {
+                const VerticeRecorte& o = *tri[ordem[j]];
+                const float* cor = face > 0 ? o.frente : o.verso;
+                for (int c = 0; c < 4; ++c) r.corW[j][c] = cor[c] * r.invW[j];
+                r.uW[j] = o.u * r.invW[j];
+                r.vW[j] = o.v * r.invW[j];
+            }
+            distribuirTriangulo(ctx, r, tris, ladrilhos);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------- textura
+
+static void texelBilinear(const ImagemRGBA& img, size_t nivel, float u, float v, float out[4]) {
+    const int w = img.larguraNivel(nivel), h = img.alturaNivel(nivel);
+    const uint8_t* d = img.niveis[nivel].data();
+    const float x = u * w - 0.5f, y = v * h - 0.5f;
+    const float fx0 = floor(x), fy0 = floor(y);
+    const float fx = x - fx0, fy = y - fy0;
+    // GL_REPEAT
+    int x0 = (int)fmod((double)fx0, (double)w); if (x0 < 0) x0 += w;
+    int y0 = (int)fmod((double)fy0, (double)h); if (y0 < 0) y0 += h;
+    const int x1 = (x0 + 1) % w, y1 = (y0 + 1) % h;
+    const uint8_t* a = d + ((size_t)y0 * w + x0) * 4u;
+    const uint8_t* b = d + ((size_t)y0 * w + x1) * 4u;
+    const uint8_t* c = d + ((size_t)y1 * w + x0) * 4u;
+    const uint8_t* e = d + ((size_t)y1 * w + x1) * 4u;
+    for (int k = 0; k < 4; ++k) {
+        const float topo = a[k] + fx * (b[k] - a[k]);
+        const float base = c[k] + fx * (e[k] - c[k]);
+        out[k] = (topo + fy * (base - topo)) * (1.0f / 255.0f);
+    }
+}
+
+// GL_LINEAR_MIPMAP_LINEAR (GL_LINEAR na ampliação), nível pelo maior lado da pegada do pixel
+static void amostrarTextura(const ImagemRGBA& img, float u, float v, float dudx, float dvdx, float dudy, float dvdy,
+                            float out[4]) {
+    const float w = (float)img.largura, h = (float)img.altura;
+    const float px = (dudx * w) * (dudx * w) + (dvdx * h) * (dvdx * h);
+    const float py = (dudy * w) * (dudy * w) + (dvdy * h) * (dvdy * h);
+    const float lambda = 0.5f * log2(max(px, py));
+    const float maxNivel = (float)(img.niveis.size() - 1);
+    if (!(lambda > 0.0f) || maxNivel == 0.0f) {
+        texelBilinear(img, 0, u, v, out);
+        return;
+    }
+    const float l = min(lambda, maxNivel);
+    const size_t n0 = (size_t)l;
+    const float f = l - (float)n0;
+    texelBilinear(img, n0, u, v, out);
+    if (f > 0.0f && n0 + 1 < img.niveis.size()) {
+        float o[4];
+        texelBilinear(img, n0 + 1, u, v, o);
+        for (int k = 0; k < 4; ++k) out[k] += f * (o[k] - out[k]);
+    }
+}
+
+// ----------------------------------------------------------------------------- ladrilhos
+
+// Triângulo preparado para o ladrilho: arestas em ponto fixo e as derivadas da interpolação
+struct Arestas {
+    int64_t A[3], B[3], C[3];    // E(p) = A x + B y + C (>= 0 dentro, já com a regra topo-esquerda)
+    float invArea;
+    float dQdx, dQdy, dUdx, dUdy, dVdx, dVdy;   // derivadas de 1/w, u/w e v/w por pixel
+};
+
+static void prepararArestas(const TrianguloRaster& t, Arestas& a) {
+    for (int i = 0; i < 3; ++i) {
+        const int p = (i + 1) % 3, q = (i + 2) % 3;   // aresta oposta ao vértice i
+        a.A[i] = (int64_t)t.y[p] - t.y[q];
+        a.B[i] = (int64_t)t.x[q] - t.x[p];
+        a.C[i] = (int64_t)t.x[p] * t.y[q] - (int64_t)t.x[q] * t.y[p];
+        // Regra topo-esquerda (y para cima, anti-horário): arestas esquerdas descem, a do topo vai para a esquerda
+        const bool topoEsquerda = a.A[i] > 0 || (a.A[i] == 0 && a.B[i] < 0);
+        if (!topoEsquerda) a.C[i] -= 1;
+    }
+    const int64_t area = a.A[0] * t.x[0] + a.B[0] * t.y[0] + a.C[0];
+    a.invArea = 1.0f / (float)max<int64_t>(area, 1);
+    float dbx[3], dby[3];
+    for (int i = 0; i < 3; ++i) {
+        dbx[i] = (float)(a.A[i] * SUBPIXEL) * a.invArea;
+        dby[i] = (float)(a.B[i] * SUBPIXEL) * a.invArea;
+    }
+    a.dQdx = dbx[0] * t.invW[0] + dbx[1] * t.invW[1] + dbx[2] * t.invW[2];
+    a.dQdy = dby[0] * t.invW[0] + dby[1] * t.invW[1] + dby[2] * t.invW[2];
+    a.dUdx = dbx[0] * t.uW[0] + dbx[1] * t.uW[1] + dbx[2] * t.uW[2];
+    a.dUdy = dby[0] * t.uW[0] + dby[1] * t.uW[1] + dby[2] * t.uW[2];
+    a.dVdx = dbx[0] * t.vW[0] + dbx[1] * t.vW[1] + dbx[2] * t.vW[2];
+    a.dVdy = dby[0] * t.vW[0] + dby[1] * t.vW[1] + dby[2] * t.vW[2];
+}
+
+static inline uint8_t paraByte(float c) {
+    return (uint8_t)(min(max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Pixel que passou na cobertura e na profundidade: interpolação com correção de perspectiva,
+// textura em GL_MODULATE e, nos materiais translúcidos, mistura com o que já está no quadro
+static inline void sombrearPixel(QuadroRaster& q, const TrianguloRaster& t, const Arestas& a,
+                                 const MaterialPreparado& m, int x, int y, float e0, float e1, float e2, float z) {
+    const float b0 = e0 * a.invArea, b1 = e1 * a.invArea, b2 = e2 * a.invArea;
+    const float Q = b0 * t.invW[0] + b1 * t.invW[1] + b2 * t.invW[2];
+    const float w = 1.0f / Q;
+    float c[4];
+    for (int k = 0; k < 4; ++k) c[k] = (b0 * t.corW[0][k] + b1 * t.corW[1][k] + b2 * t.corW[2][k]) * w;
+    if (m.textura) {
+        const float u = (b0 * t.uW[0] + b1 * t.uW[1] + b2 * t.uW[2]) * w;
+        const float v = (b0 * t.vW[0] + b1 * t.vW[1] + b2 * t.vW[2]) * w;
+        float texel[4];
+        amostrarTextura(*m.textura, u, v, (a.dUdx - u * a.dQdx) * w, (a.dVdx - v * a.dQdx) * w,
+                        (a.dUdy - u * a.dQdy) * w, (a.dVdy - v * a.dQdy) * w, texel);
+        for (int k = 0; k < 4; ++k) c[k] *= texel[k];
+    }
+    const size_t i = (size_t)y * q.largura + x;
+    uint8_t* px = &q.cor[i * 4];
+    if (m.misturar) {
+        const float alfa = min(max(c[3], 0.0f), 1.0f);
+        for (int k = 0; k < 4; ++k) c[k] = c[k] * alfa + px[k] * (1.0f / 255.0f) * (1.0f - alfa);
+    }
+    for (int k = 0; k < 4; ++k) px[k] = paraByte(c[k]);
+    q.profundidade[i] = z;
+}
+
+// Pixels de um bloco 8x8 com as arestas em int64 (reserva para triângulos enormes)
+static bool rasterizarBlocoEscalar(QuadroRaster& q, const TrianguloRaster& t, const Arestas& a,
+                                   const MaterialPreparado& m, int px0, int py0, int nx, int ny) {
+    bool escreveu = false;
+    for (int dy = 0; dy < ny; ++dy) {
+        const int y = py0 + dy;
+        const int64_t cy = (int64_t)y * SUBPIXEL + SUBPIXEL / 2;
+        for (int dx = 0; dx < nx; ++dx) {
+            const int x = px0 + dx;
+            const int64_t cx = (int64_t)x * SUBPIXEL + SUBPIXEL / 2;
+            const int64_t e0 = a.A[0] * cx + a.B[0] * cy + a.C[0];
+            const int64_t e1 = a.A[1] * cx + a.B[1] * cy + a.C[1];
+            const int64_t e2 = a.A[2] * cx + a.B[2] * cy + a.C[2];
+            if ((e0 | e1 | e2) < 0) continue;
+            const float f0 = (float)e0, f1 = (float)e1, f2 = (float)e2;
+            const float z = (f0 * t.z[0] + f1 * t.z[1] + f2 * t.z[2]) * a.invArea;
+            if (!(z < q.profundidade[(size_t)y * q.largura + x])) continue;
+            sombrearPixel(q, t, a, m, x, y, f0, f1, f2, z);
+            escreveu = true;
+        }
+    }
+    return escreveu;
+}
+
+#ifdef RASTER_X86
+// 4 pixels por instrução: as três arestas avançam em int32 (exatas), a cobertura sai do bit
+// de sinal e a profundidade é comparada em float antes de sombrear
+static bool rasterizarBlocoSSE(QuadroRaster& q, const TrianguloRaster& t, const Arestas& a,
+                               const MaterialPreparado& m, int px0, int py0, int nx, int ny, const int64_t E[3]) {
+    bool escreveu = false;
+    __m128i linha[3][2], passoY[3];
+    for (int i = 0; i < 3; ++i) {
+        const int32_t e = (int32_t)E[i], sx = (int32_t)(a.A[i] * SUBPIXEL);
+        linha[i][0] = _mm_setr_epi32(e, e + sx, e + 2 * sx, e + 3 * sx);
+        linha[i][1] = _mm_add_epi32(linha[i][0], _mm_set1_epi32(4 * sx));
+        passoY[i] = _mm_set1_epi32((int32_t)(a.B[i] * SUBPIXEL));
+    }
+    const __m128 z0 = _mm_set1_ps(t.z[0] * a.invArea), z1 = _mm_set1_ps(t.z[1] * a.invArea), z2 = _mm_set1_ps(t.z[2] * a.invArea);
+    const int mascaraX[2] = { (1 << min(nx, 4)) - 1, nx > 4 ? (1 << (nx - 4)) - 1 : 0 };
+    alignas(16) float ef[3][4], zf[4];
+    for (int dy = 0; dy < ny; ++dy) {
+        const int y = py0 + dy;
+        float* prof = &q.profundidade[(size_t)y * q.largura + px0];
+        for (int h = 0; h < 2; ++h) {
+            if (!mascaraX[h]) continue;
+            const __m128i cobertura = _mm_or_si128(_mm_or_si128(linha[0][h], linha[1][h]), linha[2][h]);
+            int mascara = ~_mm_movemask_ps(_mm_castsi128_ps(cobertura)) & mascaraX[h];
+            if (!mascara) continue;
+            const __m128 f0 = _mm_cvtepi32_ps(linha[0][h]), f1 = _mm_cvtepi32_ps(linha[1][h]), f2 = _mm_cvtepi32_ps(linha[2][h]);
+            const __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f0, z0), _mm_mul_ps(f1, z1)), _mm_mul_ps(f2, z2));
+            mascara &= _mm_movemask_ps(_mm_cmplt_ps(z, _mm_loadu_ps(prof + 4 * h)));
+            if (!mascara) continue;
+            _mm_store_ps(ef[0], f0); _mm_store_ps(ef[1], f1); _mm_store_ps(ef[2], f2); _mm_store_ps(zf, z);
+            for (; mascara; mascara &= mascara - 1) {
+                const int k = __builtin_ctz((unsigned)mascara);
+                sombrearPixel(q, t, a, m, px0 + 4 * h + k, y, ef[0][k], ef[1][k], ef[2][k], zf[k]);
+            }
+            escreveu = true;
+        }
+        for (int i = 0; i < 3; ++i) {
+            linha[i][0] = _mm_add_epi32(linha[i][0], passoY[i]);
+            linha[i][1] = _mm_add_epi32(linha[i][1], passoY[i]);
+        }
+    }
+    return escreveu;
+}
+#endif
+
+static float maximoBloco(const QuadroRaster& q, int px0, int py0, int nx, int ny) {
+    float m = 0.0f;
+    for (int dy = 0; dy < ny; ++dy) {
+        const float* p = &q.profundidade[(size_t)(py0 + dy) * q.largura + px0];
+        for (int dx = 0; dx < nx; ++dx) m = max(m, p[dx]);
+    }
+    return m;
+}
+
+static void rasterizarTriangulo(QuadroRaster& q, const TrianguloRaster& t, const MaterialPreparado& m,
+                                int x0, int y0, int x1, int y1, int blocosX) {
+    const int minX = max(t.minX, x0), maxX = min(t.maxX, x1 - 1);
+    const int minY = max(t.minY, y0), maxY = min(t.maxY, y1 - 1);
+    if (minX > maxX || minY > maxY) return;
+    Arestas a;
+    prepararArestas(t, a);
+    const float zMin = min(t.z[0], min(t.z[1], t.z[2]));
+    const int64_t lado = LADO_BLOCO - 1;
+    for (int by = minY / LADO_BLOCO; by <= maxY / LADO_BLOCO; ++by) {
+        for (int bx = minX / LADO_BLOCO; bx <= maxX / LADO_BLOCO; ++bx) {
+            float& zMax = q.zMaxBloco[(size_t)by * blocosX + bx];
+            if (zMin >= zMax) continue;   // bloco inteiro já tem algo na frente (GL_LESS)
+            const int px0 = bx * LADO_BLOCO, py0 = by * LADO_BLOCO;
+            const int nx = min(LADO_BLOCO, x1 - px0), ny = min(LADO_BLOCO, y1 - py0);
+            const int64_t cx = (int64_t)px0 * SUBPIXEL + SUBPIXEL / 2, cy = (int64_t)py0 * SUBPIXEL + SUBPIXEL / 2;
+            int64_t E[3];
+            bool fora = false, cabe32 = true;
+            for (int i = 0; i < 3 && !fora; ++i) {
+                E[i] = a.A[i] * cx + a.B[i] * cy + a.C[i];
+                const int64_t sx = a.A[i] * SUBPIXEL * lado, sy = a.B[i] * SUBPIXEL * lado;
+                fora = E[i] + max<int64_t>(sx, 0) + max<int64_t>(sy, 0) < 0;
+                cabe32 = cabe32 && llabs(E[i]) + llabs(sx) + llabs(sy) + llabs(a.A[i] * SUBPIXEL) < ((int64_t)1 << 31);
+            }
+            if (fora) continue;
+#ifdef RASTER_X86
+            const bool escreveu = cabe32 ? rasterizarBlocoSSE(q, t, a, m, px0, py0, nx, ny, E)
+                                         : rasterizarBlocoEscalar(q, t, a, m, px0, py0, nx, ny);
+#else
+            const bool escreveu = rasterizarBlocoEscalar(q, t, a, m, px0, py0, nx, ny);
+#endif
+            if (escreveu) zMax = maximoBloco(q, px0, py0, nx, ny);
+        }
+    }
+}
+
+static void rasterizarLadrilho(QuadroRaster& q, const vector<MaterialPreparado>& materiais, size_t ladrilho,
+                               int ladrilhosX, const uint8_t fundo[4]) {
+    const int x0 = (int)(ladrilho % (size_t)ladrilhosX) * LADO_LADRILHO;
+    const int y0 = (int)(ladrilho / (size_t)ladrilhosX) * LADO_LADRILHO;
+    const int x1 = min(x0 + LADO_LADRILHO, q.largura), y1 = min(y0 + LADO_LADRILHO, q.altura);
+    const int blocosX = (q.largura + LADO_BLOCO - 1) / LADO_BLOCO;
+    // glClear do ladrilho
+    for (int y = y0; y < y1; ++y) {
+        uint8_t* c = &q.cor[((size_t)y * q.largura + x0) * 4];
+        for (int x = x0; x < x1; ++x, c += 4) memcpy(c, fundo, 4);
+        fill_n(&q.profundidade[(size_t)y * q.largura + x0], x1 - x0, 1.0f);
+    }
+    for (int by = y0 / LADO_BLOCO; by * LADO_BLOCO < y1; ++by)
+        fill_n(&q.zMaxBloco[(size_t)by * blocosX + x0 / LADO_BLOCO], (x1 - x0 + LADO_BLOCO - 1) / LADO_BLOCO, 1.0f);
+
+    // Threads da montagem em ordem: cada uma tem uma faixa contígua de triângulos da malha
+    for (size_t th = 0; th < q.ladrilhos.size(); ++th) {
+        const vector<TrianguloRaster>& tris = q.triangulos[th];
+        for (uint32_t id : q.ladrilhos[th][ladrilho]) {
+            const TrianguloRaster& t = tris[id];
+            rasterizarTriangulo(q, t, materiais[(size_t)t.material], x0, y0, x1, y1, blocosX);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------- quadro
+
+void rasterizarMalha(const VisaoMalhaIndexada& malha, const CenaRaster& cena, int largura, int altura,
+                     QuadroRaster& q, TemposRaster& tempos, int numThreads) {
+    using relogio = chrono::steady_clock;
+    const auto t0 = relogio::now();
+    tempos = TemposRaster();
+    largura = max(1, largura);
+    altura = max(1, altura);
+    const size_t nPixels = (size_t)largura * altura;
+    q.largura = largura;
+    q.altura = altura;
+    q.cor.resize(nPixels * 4);
+    q.profundidade.resize(nPixels + 8);
+    const int blocosX = (largura + LADO_BLOCO - 1) / LADO_BLOCO, blocosY = (altura + LADO_BLOCO - 1) / LADO_BLOCO;
+    q.zMaxBloco.resize((size_t)blocosX * blocosY);
+    const int ladrilhosX = (largura + LADO_LADRILHO - 1) / LADO_LADRILHO;
+    const int ladrilhosY = (altura + LADO_LADRILHO - 1) / LADO_LADRILHO;
+    const size_t nLadrilhos = (size_t)ladrilhosX * ladrilhosY;
+    const size_t nThreads = numThreadsEfetivo(numThreads);
+
+    // 1) Vértices
+    {
+        PERF_ESCOPO("quadro.cpu.vertices");
+        q.vertices.resize(malha.numVertices());
+        paraCadaFaixa(malha.numVertices(), nThreads, [&](size_t, size_t inicio, size_t fim) {
+            transformarVertices(malha, cena, largura, altura, inicio, fim, q.vertices.data());
+        });
+    }
+    const auto t1 = relogio::now();
+
+    // 2) Montagem, recorte e distribuição nos ladrilhos, em faixas contíguas de triângulos
+    vector<MaterialPreparado> materiais;
+    materiais.push_back(prepararMaterial(cena.padrao, cena));
+    for (const MaterialRaster& m : cena.materiais) materiais.push_back(prepararMaterial(m, cena));
+    vector<FaixaMaterial> faixas(malha.faixasMaterial.begin(), malha.faixasMaterial.end());
+    if (faixas.empty()) faixas.push_back(FaixaMaterial{ -1, 0, (uint32_t)malha.numIndices() });
+    const size_t nTris = malha.numIndices() / 3;
+    const size_t nMontagem = max<size_t>(1, min(nThreads, nTris));
+    q.triangulos.resize(nMontagem);
+    q.ladrilhos.resize(nMontagem);
+    for (vector<vector<uint32_t>>& l : q.ladrilhos) l.resize(nLadrilhos);
+    {
+        PERF_ESCOPO("quadro.cpu.binning");
+        const ContextoMontagem ctx{ &materiais, q.vertices.data(), largura, altura, ladrilhosX };
+        paraCadaFaixa(nTris, nMontagem, [&](size_t th, size_t inicio, size_t fim) {
+            montarTriangulos(ctx, malha, faixas, inicio, fim, q.triangulos[th], q.ladrilhos[th]);
+        });
+    }
+    for (const vector<TrianguloRaster>& t : q.triangulos) tempos.triangulos += t.size();
+    const auto t2 = relogio::now();
+
+    // 3) Ladrilhos, dos mais cheios para os mais vazios, entregues sob demanda às threads
+    {
+        PERF_ESCOPO("quadro.cpu.raster");
+        vector<size_t> carga(nLadrilhos, 0), ordem(nLadrilhos);
+        for (const vector<vector<uint32_t>>& th : q.ladrilhos)
+            for (size_t l = 0; l < nLadrilhos; ++l) carga[l] += th[l].size();
+        iota(ordem.begin(), ordem.end(), 0);
+        stable_sort(ordem.begin(), ordem.end(), [&](size_t a, size_t b) { return carga[a] > carga[b]; });
+        uint8_t fundo[4];
+        for (int k = 0; k < 4; ++k) fundo[k] = paraByte(cena.fundo[k]);
+        paraCadaItem(nLadrilhos, (int)nThreads, [&](size_t i) {
+            rasterizarLadrilho(q, materiais, ordem[i], ladrilhosX, fundo);
+        });
+    }
+    const auto t3 = relogio::now();
+    tempos.verticesMs = chrono::duration<double, milli>(t1 - t0).count();
+    tempos.binningMs = chrono::duration<double, milli>(t2 - t1).count();
+    tempos.rasterMs = chrono::duration<double, milli>(t3 - t2).count();
+    tempos.totalMs = chrono::duration<double, milli>(t3 - t0).count();
+}
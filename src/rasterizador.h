@@ -0,0 +1,85 @@
+// Rasterizador em CPU (backend --render=cpu), sem OpenGL. Reproduz o pipeline fixo de
+// display(): matrizes de gluPerspective/glTranslate/glRotate/glScale, GL_LIGHT0 pontual com
+// difusa e especular, iluminação nas duas faces, GL_COLOR_MATERIAL e textura em GL_MODULATE
+// com mipmaps trilineares e GL_REPEAT. Os triângulos são recortados, montados em ponto fixo e
+// distribuídos em ladrilhos de 64x64 pixels; cada ladrilho é rasterizado inteiro por uma
+// thread (a ordem dos triângulos dentro dele é a da malha), com funções de aresta em SSE e um
+// buffer de profundidade hierárquico (o máximo de cada bloco de 8x8 descarta blocos ocultos).
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "imagem.h"
+#include "obj_loader.h"
+
+using namespace std;
+
+// Estado de material de uma faixa (o que aplicarMaterial põe no GL)
+struct MaterialRaster {
+    float cor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };   // glColor com GL_COLOR_MATERIAL (ambiente e difusa)
+    float especular[3] = { 0.0f, 0.0f, 0.0f };
+    float brilho = 0.0f;                        // GL_SHININESS, 0..128
+    const ImagemRGBA* textura = nullptr;         // com mipmaps (gerarMipmaps); nullptr = sem textura
+};
+
+struct CenaRaster {
+    float projecao[16];                          // por colunas, como glGetFloatv
+    float modelview[16];
+    float fundo[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    float posicaoLuz[4] = { 0.0f, 0.0f, 1.0f, 0.0f };   // no espaço do olho
+    float luzAmbiente[3] = { 0.0f, 0.0f, 0.0f };
+    float luzDifusa[3] = { 1.0f, 1.0f, 1.0f };
+    float luzEspecular[3] = { 1.0f, 1.0f, 1.0f };
+    float ambienteGlobal[3] = { 0.2f, 0.2f, 0.2f };
+    MaterialRaster padrao;                       // sem faixas de material, ou id -1
+    vector<MaterialRaster> materiais;            // por id de MalhaIndexada::faixasMaterial
+};
+
+struct TemposRaster {
+    double verticesMs = 0.0;     // transformação e iluminação por vértice
+    double binningMs = 0.0;      // montagem, recorte e distribuição nos ladrilhos
+    double rasterMs = 0.0;       // ladrilhos
+    double totalMs = 0.0;
+    size_t triangulos = 0;       // que cobrem algum centro de pixel
+};
+
+// Internos, guardados no QuadroRaster para reaproveitar a memória entre quadros
+struct VerticeRaster {
+    float clip[4];
+    int32_t fora;                // planos de recorte violados (bits); 0 = x, y, z e invW valem
+    int32_t x, y;                // na janela, em ponto fixo
+    float z, invW;
+    float nl, nh;                // n·L e n·H da face da frente
+    float u, v;
+};
+
+struct TrianguloRaster {
+    int32_t x[3], y[3];          // pixels em ponto fixo (8 bits de subpixel), sentido anti-horário
+    float z[3], invW[3];
+    float corW[3][4];            // cor já iluminada (face visível), dividida por w
+    float uW[3], vW[3];
+    int32_t minX, minY, maxX, maxY;   // pixels cujo centro pode estar dentro
+    int32_t material;            // índice em materiais preparados (0 = padrão)
+};
+
+struct QuadroRaster {
+    int largura = 0, altura = 0;
+    vector<uint8_t> cor;         // RGBA8, linha 0 embaixo (como glReadPixels / glDrawPixels)
+    vector<float> profundidade;  // com folga no fim para as leituras de 4 em 4
+
+    vector<VerticeRaster> vertices;
+    vector<vector<TrianguloRaster>> triangulos;   // por thread da montagem
+    vector<vector<vector<uint32_t>>> ladrilhos;   // [thread][ladrilho] -> índices em triangulos[thread]
+    vector<float> zMaxBloco;                      // por bloco de 8x8
+};
+
+// Desenha a malha indexada inteira (todas as faixas de material) num quadro largura x altura
+void rasterizarMalha(const VisaoMalhaIndexada& malha, const CenaRaster& cena, int largura, int altura,
+                     QuadroRaster& quadro, TemposRaster& tempos, int numThreads = 0);
+
+// Matrizes por colunas iguais às do GL: gluPerspective e, para o objeto,
+// glTranslatef(tx, ty, tz) glRotatef(rx, X) glRotatef(ry, Y) glRotatef(rz, Z) glScalef(escala)
+void matrizPerspectiva(float fovyGraus, float aspecto, float perto, float longe, float out[16]);
+void matrizObjeto(float tx, float ty, float tz, float rx, float ry, float rz, float escala, float out[16]);
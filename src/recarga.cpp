@@ -0,0 +1,304 @@
+#include "recarga.h"
+#include "normais.h"
+#include "paralelo.h"
+#include "perf.h"
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Arquivo mapeado somente leitura (desmapeia no destrutor)
+struct TextoMapeado {
+    const char* dados = nullptr;
+    size_t tamanho = 0;
+
+    bool abrir(const string& caminho) {
+        int fd = open(caminho.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return false; }
+        void* mapa = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapa == MAP_FAILED) return false;
+        dados = static_cast<const char*>(mapa);
+        tamanho = (size_t)st.st_size;
+        return true;
+    }
+
+    ~TextoMapeado() {
+        if (dados) munmap(const_cast<char*>(dados), tamanho);
+    }
+};
+
+// Agrupa os triângulos do trecho por id local (estável): cada material vira uma faixa
+static void agruparTrecho(TrechoLido& t) {
+    if (t.materialTri.empty()) return;
+    const size_t nTris = t.materialTri.size();
+    vector<size_t> inicio(t.nomes.nomes.size() + 2, 0);
+    for (int32_t id : t.materialTri) ++inicio[(size_t)(id + 2)];
+    for (size_t k = 1; k < inicio.size(); ++k) inicio[k] += inicio[k - 1];
+    vector<CantoTri> tris(t.triangulos.size());
+    vector<int32_t> ids(nTris);
+    for (size_t i = 0; i < nTris; ++i) {
+        const size_t destino = inicio[(size_t)(t.materialTri[i] + 1)]++;
+        ids[destino] = t.materialTri[i];
+        copy(&t.triangulos[i * 3], &t.triangulos[i * 3] + 3, &tris[destino * 3]);
+    }
+    t.triangulos.swap(tris);
+    t.materialTri.swap(ids);
+}
+
+static bool mesmoTrecho(const SecaoModelo& a, const SecaoModelo& b) {
+    return a.trecho.hash == b.trecho.hash && a.trecho.fim - a.trecho.inicio == b.trecho.fim - b.trecho.inicio
+        && a.trecho.nV == b.trecho.nV && a.trecho.nVT == b.trecho.nVT && a.trecho.nVN == b.trecho.nVN
+        && a.baseV == b.baseV && a.baseVT == b.baseVT && a.baseVN == b.baseVN
+        && a.materialInicial == b.materialInicial;
+}
+
+// Marca em "mudou" os elementos (de "largura" floats) do intervalo que diferem do modelo anterior
+static void compararIntervalo(const vector<float>& novo, const vector<float>& antigo, size_t largura,
+                              size_t inicio, size_t n, vector<uint8_t>& mudou) {
+    for (size_t k = inicio; k < inicio + n; ++k)
+        mudou[k] = (k + 1) * largura > antigo.size()
+                   || memcmp(&novo[k * largura], &antigo[k * largura], largura * sizeof(float)) != 0;
+}
+
+bool carregarModeloSecoes(const string& caminho, const ModeloSecoes* anterior, ModeloSecoes& out,
+                          ResumoRecarga& resumo, int numThreads) {
+    PERF_ESCOPO("recarga");
+    const auto t0 = chrono::steady_clock::now();
+    out = ModeloSecoes();
+    resumo = ResumoRecarga();
+    TextoMapeado arq;
+    if (!arq.abrir(caminho)) {
+        cerr << "Falha ao abrir OBJ (ou arquivo vazio): " << caminho << "\n";
+        return false;
+    }
+
+    vector<TrechoOBJ> trechos;
+    dividirTrechosOBJ(arq.dados, arq.tamanho, trechos);
+    const size_t n = trechos.size();
+    out.secoes.resize(n);
+    size_t totV = 0, totVT = 0, totVN = 0;
+    string material;
+    for (size_t i = 0; i < n; ++i) {
+        SecaoModelo& s = out.secoes[i];
+        s.trecho = move(trechos[i]);
+        s.baseV = totV; s.baseVT = totVT; s.baseVN = totVN;
+        s.materialInicial = material;
+        totV += s.trecho.nV; totVT += s.trecho.nVT; totVN += s.trecho.nVN;
+        if (!s.trecho.ultimoMaterial.empty()) material = s.trecho.ultimoMaterial;
+    }
+    if (totV > (size_t)INT_MAX || totVT > (size_t)INT_MAX || totVN > (size_t)INT_MAX) {
+        cerr << "OBJ com elementos demais para índices int: " << caminho << "\n";
+        return false;
+    }
+
+    // 1) Trechos iguais aos do modelo anterior (mesmo texto e mesmas bases)
+    if (anterior) {
+        unordered_multimap<uint64_t, size_t> porHash;
+        for (size_t j = 0; j < anterior->secoes.size(); ++j) porHash.emplace(anterior->secoes[j].trecho.hash, j);
+        vector<uint8_t> usada(anterior->secoes.size(), 0);
+        for (SecaoModelo& s : out.secoes) {
+            auto faixa = porHash.equal_range(s.trecho.hash);
+            for (auto it = faixa.first; it != faixa.second; ++it) {
+                if (usada[it->second] || !mesmoTrecho(s, anterior->secoes[it->second])) continue;
+                s.origem = (int)it->second;
+                usada[it->second] = 1;
+                break;
+            }
+        }
+    }
+
+    // 2) Parse dos demais, em paralelo
+    vector<TrechoLido> lidos(n);
+    vector<uint8_t> ok(n, 1);
+    paraCadaItem(n, numThreads, [&](size_t i) {
+        const SecaoModelo& s = out.secoes[i];
+        if (s.origem >= 0) return;
+        ok[i] = lerTrechoOBJ(arq.dados + s.trecho.inicio, arq.dados + s.trecho.fim, s.baseV, s.baseVT, s.baseVN, lidos[i]);
+        agruparTrecho(lidos[i]);
+    });
+    for (size_t i = 0; i < n; ++i) {
+        const SecaoModelo& s = out.secoes[i];
+        if (s.origem >= 0) continue;
+        ++resumo.relidas;
+        if (!ok[i] || lidos[i].vertices.size() != s.trecho.nV * 3 || lidos[i].uvs.size() != s.trecho.nVT * 2
+            || lidos[i].normaisOBJ.size() != s.trecho.nVN * 3) {
+            cerr << "Trecho inconsistente em " << caminho << " (bytes " << s.trecho.inicio << "-" << s.trecho.fim << ")\n";
+            return false;
+        }
+    }
+
+    // 3) Buffers globais: trechos reaproveitados copiados do modelo anterior, os outros do parse
+    size_t totTris = 0, totIdx = 0;
+    for (size_t i = 0; i < n; ++i) {
+        SecaoModelo& s = out.secoes[i];
+        s.primeiroTri = totTris; s.primeiroIdx = totIdx;
+        if (s.origem >= 0) {
+            const SecaoModelo& a = anterior->secoes[(size_t)s.origem];
+            s.numTris = a.numTris; s.numIdx = a.numIdx;
+            s.nomes = a.nomes; s.materialTri = a.materialTri;
+        } else {
+            s.numTris = lidos[i].triangulos.size() / 3; s.numIdx = lidos[i].indicesPos.size();
+            s.nomes = move(lidos[i].nomes); s.materialTri = move(lidos[i].materialTri);
+        }
+        totTris += s.numTris; totIdx += s.numIdx;
+    }
+    MalhaOBJ& m = out.malha;
+    m.vertices.resize(totV * 3); m.uvs.resize(totVT * 2); m.normaisOBJ.resize(totVN * 3);
+    m.triangulos.resize(totTris * 3); m.indicesPos.resize(totIdx);
+    paraCadaItem(n, numThreads, [&](size_t i) {
+        const SecaoModelo& s = out.secoes[i];
+        if (s.origem >= 0) {
+            const MalhaOBJ& a = anterior->malha;
+            const SecaoModelo& sa = anterior->secoes[(size_t)s.origem];
+            copy_n(a.vertices.data() + s.baseV * 3, s.trecho.nV * 3, m.vertices.data() + s.baseV * 3);
+            copy_n(a.uvs.data() + s.baseVT * 2, s.trecho.nVT * 2, m.uvs.data() + s.baseVT * 2);
+            copy_n(a.normaisOBJ.data() + s.baseVN * 3, s.trecho.nVN * 3, m.normaisOBJ.data() + s.baseVN * 3);
+            copy_n(a.triangulos.data() + sa.primeiroTri * 3, s.numTris * 3, m.triangulos.data() + s.primeiroTri * 3);
+            copy_n(a.indicesPos.data() + sa.primeiroIdx, s.numIdx, m.indicesPos.data() + s.primeiroIdx);
+        } else {
+            TrechoLido& t = lidos[i];
+            copy(t.vertices.begin(), t.vertices.end(), m.vertices.begin() + s.baseV * 3);
+            copy(t.uvs.begin(), t.uvs.end(), m.uvs.begin() + s.baseVT * 2);
+            copy(t.normaisOBJ.begin(), t.normaisOBJ.end(), m.normaisOBJ.begin() + s.baseVN * 3);
+            copy(t.triangulos.begin(), t.triangulos.end(), m.triangulos.begin() + s.primeiroTri * 3);
+            copy(t.indicesPos.begin(), t.indicesPos.end(), m.indicesPos.begin() + s.primeiroIdx);
+            t = TrechoLido();
+        }
+    });
+    if (m.vertices.empty() || m.triangulos.empty()) {
+        cerr << "OBJ vazio ou sem faces: " << caminho << "\n";
+        return false;
+    }
+
+    // 4) Ids globais dos materiais, na ordem em que os nomes aparecem no arquivo (como no parse inteiro)
+    for (SecaoModelo& s : out.secoes) {
+        for (const string& b : s.nomes.bibliotecas) m.nomesMateriais.acrescentarBibliotecas(b.data(), b.data() + b.size());
+        s.idGlobal.assign(1, s.materialInicial.empty() ? -1
+                             : m.nomesMateriais.idMaterial(s.materialInicial.data(), s.materialInicial.data() + s.materialInicial.size()));
+        for (const string& nome : s.nomes.nomes) s.idGlobal.push_back(m.nomesMateriais.idMaterial(nome.data(), nome.data() + nome.size()));
+        if (!s.materialTri.empty() || !s.materialInicial.empty()) out.comMateriais = true;
+    }
+    if (out.comMateriais) resolverMateriais(caminho, m.nomesMateriais, m.materiais);
+
+    // 5) Normais: tudo na leitura completa; na recarga, só os vértices cujas faces mudaram
+    vector<uint8_t> posMudou(totV, 0), vtMudou(totVT, 0), vnMudou(totVN, 0), normalMudou;
+    if (!anterior) {
+        PERF_ESCOPO("recarga.normais");
+        calcularNormaisVertice(m.vertices, m.indicesPos, m.normaisCalculadas, numThreads);
+        resumo.normais = totV;
+    } else {
+        PERF_ESCOPO("recarga.normais");
+        const MalhaOBJ& a = anterior->malha;
+        vector<uint8_t> sujos(totV, 0);
+        for (const SecaoModelo& s : out.secoes) {
+            if (s.origem >= 0) continue;
+            compararIntervalo(m.vertices, a.vertices, 3, s.baseV, s.trecho.nV, posMudou);
+            compararIntervalo(m.uvs, a.uvs, 2, s.baseVT, s.trecho.nVT, vtMudou);
+            compararIntervalo(m.normaisOBJ, a.normaisOBJ, 3, s.baseVN, s.trecho.nVN, vnMudou);
+            // Faces novas
+            for (size_t k = s.primeiroIdx; k < s.primeiroIdx + s.numIdx; ++k) sujos[m.indicesPos[k]] = 1;
+        }
+        // Faces que saíram (dos trechos antigos não reaproveitados)
+        vector<uint8_t> reaproveitada(anterior->secoes.size(), 0);
+        for (const SecaoModelo& s : out.secoes) if (s.origem >= 0) reaproveitada[(size_t)s.origem] = 1;
+        for (size_t j = 0; j < anterior->secoes.size(); ++j) {
+            if (reaproveitada[j]) continue;
+            const SecaoModelo& sa = anterior->secoes[j];
+            for (size_t k = sa.primeiroIdx; k < sa.primeiroIdx + sa.numIdx; ++k)
+                if (a.indicesPos[k] < totV) sujos[a.indicesPos[k]] = 1;
+        }
+        // Faces com algum vértice movido mudam de normal: os três vértices dela também
+        for (size_t k = 0; k + 2 < m.indicesPos.size(); k += 3) {
+            const unsigned int i0 = m.indicesPos[k], i1 = m.indicesPos[k + 1], i2 = m.indicesPos[k + 2];
+            if (i0 < totV && i1 < totV && i2 < totV && (posMudou[i0] | posMudou[i1] | posMudou[i2]))
+                sujos[i0] = sujos[i1] = sujos[i2] = 1;
+        }
+        const size_t nAntigos = min(totV, a.normaisCalculadas.size() / 3);
+        m.normaisCalculadas.assign(totV * 3, 0.0f);
+        copy_n(a.normaisCalculadas.begin(), nAntigos * 3, m.normaisCalculadas.begin());
+        for (size_t v = nAntigos; v < totV; ++v) sujos[v] = 1;
+        atualizarNormaisVertice(m.vertices, m.indicesPos, sujos, m.normaisCalculadas);
+
+        normalMudou.assign(totV, 0);
+        for (size_t v = 0; v < totV; ++v) {
+            if (!sujos[v]) continue;
+            ++resumo.normais;
+            normalMudou[v] = v >= nAntigos || memcmp(&m.normaisCalculadas[3 * v], &a.normaisCalculadas[3 * v], 3 * sizeof(float)) != 0;
+        }
+    }
+
+    // 6) Malha indexada por trecho: os relidos e os reaproveitados que usam algo que mudou
+    const bool temVN = !m.normaisOBJ.empty(), temVT = !m.uvs.empty();
+    vector<uint8_t> reindexada(n, 0);
+    {
+        PERF_ESCOPO("recarga.indexar");
+        paraCadaItem(n, numThreads, [&](size_t i) {
+            SecaoModelo& s = out.secoes[i];
+            const CantoTri* tris = m.triangulos.data() + s.primeiroTri * 3;
+            if (s.origem >= 0) {
+                bool afetada = false;
+                for (size_t k = 0; k < s.numTris * 3 && !afetada; ++k) {
+                    const CantoTri& c = tris[k];
+                    if (c.v < 0) continue;
+                    if ((size_t)c.v >= totV) continue;
+                    const bool comVN = temVN && c.vn >= 0 && (size_t)c.vn < totVN;
+                    afetada = posMudou[(size_t)c.v]
+                              || (comVN ? vnMudou[(size_t)c.vn] : normalMudou[(size_t)c.v])
+                              || (temVT && c.vt >= 0 && (size_t)c.vt < totVT && vtMudou[(size_t)c.vt]);
+                }
+                if (!afetada) {
+                    s.indexada.faixasMaterial = anterior->secoes[(size_t)s.origem].indexada.faixasMaterial;
+                    s.reenviar = false;
+                    return;
+                }
+                reindexada[i] = 1;
+            }
+            construirMalhaIndexada(m.vertices.data(), m.vertices.size(), m.normaisCalculadas.data(),
+                                   m.normaisOBJ.data(), m.normaisOBJ.size(), m.uvs.data(), m.uvs.size(),
+                                   tris, s.numTris * 3, s.indexada, nullptr,
+                                   s.materialTri.empty() ? nullptr : s.materialTri.data());
+            // Sem usemtl no trecho: uma faixa só, com o material herdado
+            if (s.indexada.faixasMaterial.empty() && s.indexada.numIndices() > 0)
+                s.indexada.faixasMaterial.push_back(FaixaMaterial{ -1, 0, (uint32_t)s.indexada.numIndices() });
+        });
+    }
+    for (uint8_t r : reindexada) resumo.reindexadas += r;
+    resumo.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    return true;
+}
+
+void liberarIndexadasSecoes(ModeloSecoes& m) {
+    for (SecaoModelo& s : m.secoes) {
+        vector<float>().swap(s.indexada.vertices);
+        vector<uint16_t>().swap(s.indexada.indices16);
+        vector<uint32_t>().swap(s.indexada.indices32);
+    }
+}
+
+void iniciarRecarga(RecargaAssincrona& r, const string& caminho, const ModeloSecoes& atual, int numThreads) {
+    r.ativa = true;
+    r.terminou = false;
+    r.trabalhador = thread([&r, &atual, caminho, numThreads]() {
+        nomearThreadPerf("recarga");
+        r.sucesso = carregarModeloSecoes(caminho, &atual, r.novo, r.resumo, numThreads);
+        r.terminou = true;
+    });
+}
+
+bool finalizarRecarga(RecargaAssincrona& r) {
+    if (r.trabalhador.joinable()) r.trabalhador.join();
+    r.ativa = false;
+    return r.sucesso;
+}
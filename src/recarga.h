@@ -0,0 +1,71 @@
+// Recarga incremental do OBJ (modo --observar). O modelo fica dividido em trechos do texto
+// (dividirTrechosOBJ em obj_loader.h), cada um com a própria malha indexada e os próprios
+// buffers na GPU (recarga_gpu.h). Quando o arquivo muda, um trecho com o mesmo texto, as
+// mesmas contagens de v/vt/vn antes dele e o mesmo material herdado é reaproveitado sem
+// parse; só os demais são lidos de novo. As normais são recalculadas só nos vértices
+// afetados, e um trecho reaproveitado só é reindexado (e reenviado) quando algum vértice que
+// ele usa mudou.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "obj_loader.h"
+
+using namespace std;
+
+struct SecaoModelo {
+    TrechoOBJ trecho;
+    size_t baseV = 0, baseVT = 0, baseVN = 0;   // contagens antes do trecho
+    size_t primeiroTri = 0, numTris = 0;        // em MalhaOBJ::triangulos (em triângulos)
+    size_t primeiroIdx = 0, numIdx = 0;         // em MalhaOBJ::indicesPos
+    string materialInicial;                     // herdado dos trechos anteriores (vazio = nenhum)
+    NomesMateriais nomes;                       // mtllib/usemtl do trecho, ids locais
+    vector<int32_t> materialTri;                // id local por triângulo, -1 = herdado (vazio = todos herdados)
+    vector<int32_t> idGlobal;                   // id local + 1 -> índice em MalhaOBJ::materiais (-1 = nenhum)
+    MalhaIndexada indexada;                     // faixasMaterial sempre presente, com ids locais
+    int origem = -1;                            // índice no modelo anterior, quando reaproveitada
+    bool reenviar = true;                       // malha indexada nova: a GPU precisa de buffers novos
+};
+
+struct ModeloSecoes {
+    MalhaOBJ malha;              // buffers globais na ordem dos trechos (malha.indexada fica vazia)
+    vector<SecaoModelo> secoes;
+    bool comMateriais = false;   // algum usemtl no arquivo
+};
+
+struct ResumoRecarga {
+    size_t relidas = 0;          // trechos lidos de novo
+    size_t reindexadas = 0;      // reaproveitados, mas com vértices alterados por outros trechos
+    size_t normais = 0;          // vértices com a normal recalculada
+    double ms = 0.0;
+};
+
+// Lê o arquivo aproveitando de "anterior" o que não mudou (nullptr = leitura completa).
+// anterior só é lido, então a thread de desenho pode continuar usando o modelo antigo.
+bool carregarModeloSecoes(const string& caminho, const ModeloSecoes* anterior, ModeloSecoes& out,
+                          ResumoRecarga& resumo, int numThreads = 0);
+
+// Depois do envio à GPU: descarta vértices e índices das malhas indexadas (as faixas ficam).
+// Os buffers globais ficam, porque a próxima recarga compara e copia a partir deles.
+void liberarIndexadasSecoes(ModeloSecoes& m);
+
+// Recarga numa thread de trabalho, como carga_assincrona.h: nenhuma chamada GL
+struct RecargaAssincrona {
+    thread trabalhador;
+    atomic<bool> terminou{ false };
+    bool ativa = false;
+    bool sucesso = false;
+    ModeloSecoes novo;
+    ResumoRecarga resumo;
+};
+
+// "atual" não pode mudar até finalizarRecarga
+void iniciarRecarga(RecargaAssincrona& r, const string& caminho, const ModeloSecoes& atual, int numThreads = 0);
+
+// Espera a thread (chamar depois de r.terminou) e devolve se o modelo novo é válido
+bool finalizarRecarga(RecargaAssincrona& r);
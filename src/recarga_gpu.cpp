@@ -0,0 +1,63 @@
+#include "recarga_gpu.h"
+#include "malha_lista.h"
+#include "perf.h"
+
+using namespace std;
+
+static void liberarSecaoGPU(SecaoGPU& s) {
+    liberarMalhaVBO(s.vbo);
+    if (s.listas) glDeleteLists(s.listas, s.numListas);
+    s = SecaoGPU();
+}
+
+size_t atualizarModeloSecoesGPU(ModeloSecoesGPU& gpu, const ModeloSecoes& novo, bool usarVBO, bool compacta) {
+    PERF_ESCOPO("recarga.envio_gpu");
+    vector<SecaoGPU> secoes(novo.secoes.size());
+    size_t enviadas = 0;
+    for (size_t i = 0; i < novo.secoes.size(); ++i) {
+        const SecaoModelo& s = novo.secoes[i];
+        if (!s.reenviar && s.origem >= 0 && (size_t)s.origem < gpu.secoes.size()) {
+            secoes[i] = gpu.secoes[(size_t)s.origem];
+            gpu.secoes[(size_t)s.origem] = SecaoGPU();
+            continue;
+        }
+        ++enviadas;
+        if (s.indexada.numIndices() == 0) continue;   // trecho só com vértices
+        if (usarVBO) {
+            enviarMalhaVBO(s.indexada, secoes[i].vbo, compacta);
+        } else {
+            secoes[i].listas = criarDisplayListsMateriais(s.indexada);
+            secoes[i].numListas = (GLsizei)s.indexada.faixasMaterial.size();
+        }
+    }
+    liberarModeloSecoesGPU(gpu);
+    gpu.secoes.swap(secoes);
+    return enviadas;
+}
+
+int desenharModeloSecoesGPU(const ModeloSecoesGPU& gpu, const ModeloSecoes& m,
+                            const function<void(int)>& aplicarMaterial) {
+    int chamadas = 0;
+    for (size_t i = 0; i < gpu.secoes.size() && i < m.secoes.size(); ++i) {
+        const SecaoGPU& g = gpu.secoes[i];
+        const SecaoModelo& s = m.secoes[i];
+        // Ids locais do trecho: idGlobal[local + 1]
+        auto aplicar = [&](int local) { if (aplicarMaterial) aplicarMaterial(s.idGlobal[(size_t)(local + 1)]); };
+        if (g.vbo.vao != 0) {
+            desenharMalhaVBOMateriais(g.vbo, s.indexada.faixasMaterial, aplicar);
+            chamadas += (int)s.indexada.faixasMaterial.size();
+        } else {
+            for (GLsizei k = 0; k < g.numListas; ++k) {
+                aplicar(s.indexada.faixasMaterial[(size_t)k].material);
+                glCallList(g.listas + (GLuint)k);
+            }
+            chamadas += (int)g.numListas;
+        }
+    }
+    return chamadas;
+}
+
+void liberarModeloSecoesGPU(ModeloSecoesGPU& gpu) {
+    for (SecaoGPU& s : gpu.secoes) liberarSecaoGPU(s);
+    gpu.secoes.clear();
+}
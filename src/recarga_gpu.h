@@ -0,0 +1,37 @@
+// Objetos GL do modo --observar: um VBO (ou um conjunto de display lists) por trecho do
+// ModeloSecoes (recarga.h). Na recarga só os trechos com malha indexada nova são enviados; os
+// outros continuam com os buffers que já estavam na GPU. Precisa de contexto GL corrente.
+
+#pragma once
+
+#include <GL/freeglut.h>
+#include <functional>
+#include <vector>
+
+#include "malha_vbo.h"
+#include "recarga.h"
+
+using namespace std;
+
+struct SecaoGPU {
+    MalhaVBO vbo;
+    GLuint listas = 0;       // uma por faixa de material (backend de display lists)
+    GLsizei numListas = 0;
+};
+
+struct ModeloSecoesGPU {
+    vector<SecaoGPU> secoes;   // paralelo a ModeloSecoes::secoes
+};
+
+// Monta gpu para o modelo "novo": trechos com !reenviar assumem os objetos da seção de origem
+// no modelo anterior, os demais são enviados, e o que sobrou do anterior é liberado. Devolve
+// quantos trechos foram enviados.
+size_t atualizarModeloSecoesGPU(ModeloSecoesGPU& gpu, const ModeloSecoes& novo, bool usarVBO, bool compacta);
+
+// Desenha todos os trechos; aplicarMaterial recebe o id global (MalhaOBJ::materiais, -1 =
+// nenhum). Sem materiais no arquivo, aplicarMaterial pode ser vazio e o estado fica como está.
+// Devolve o número de chamadas de desenho.
+int desenharModeloSecoesGPU(const ModeloSecoesGPU& gpu, const ModeloSecoes& m,
+                            const function<void(int)>& aplicarMaterial);
+
+void liberarModeloSecoesGPU(ModeloSecoesGPU& gpu);
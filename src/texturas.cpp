@@ -0,0 +1,67 @@
+#include "texturas.h"
+#include "perf.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+GLuint criarTexturaRGBA(const ImagemRGBA& img) {
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    img.niveis.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Níveis prontos da CPU: nada de gluBuild2DMipmaps (reamostragem para potência de 2 e
+    // filtro lento, na thread do GL)
+    for (size_t n = 0; n < img.niveis.size(); ++n)
+        glTexImage2D(GL_TEXTURE_2D, (GLint)n, GL_RGBA, img.larguraNivel(n), img.alturaNivel(n), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, img.niveis[n].data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return id;
+}
+
+void obterTexturas(CacheTexturas& cache, const vector<string>& caminhos, vector<GLuint>& ids, int numThreads) {
+    PERF_ESCOPO("carga.texturas");
+    const auto t0 = chrono::steady_clock::now();
+    vector<string> validos;
+    for (const string& c : caminhos)
+        if (!c.empty()) validos.push_back(c);
+
+    vector<ImagemCarregada> imagens;
+    carregarImagens(validos, [&](uint64_t h) { return cache.porHash.count(h) != 0; }, imagens, numThreads);
+
+    size_t decodificadas = 0, reaproveitadas = 0;
+    for (ImagemCarregada& im : imagens) {
+        if (!im.decodificada) continue;
+        cache.porHash[im.hash] = criarTexturaRGBA(im.imagem);
+        im.imagem = ImagemRGBA();
+        ++decodificadas;
+    }
+    ids.assign(caminhos.size(), 0);
+    for (size_t i = 0, k = 0; i < caminhos.size(); ++i) {
+        if (caminhos[i].empty()) continue;
+        const ImagemCarregada& im = imagens[k++];
+        if (!im.lida) continue;
+        auto it = cache.porHash.find(im.hash);
+        if (it == cache.porHash.end()) continue;   // falha na decodificação
+        ids[i] = it->second;
+        if (!im.decodificada) ++reaproveitadas;
+    }
+    cache.decodificadas += decodificadas;
+    cache.reaproveitadas += reaproveitadas;
+    if (!validos.empty()) {
+        const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        cout << "Texturas: " << decodificadas << " decodificadas, " << reaproveitadas
+             << " reaproveitadas do cache (" << ms << " ms)\n";
+    }
+}
+
+void liberarTexturas(CacheTexturas& cache) {
+    for (auto& p : cache.porHash) glDeleteTextures(1, &p.second);
+    cache.porHash.clear();
+}
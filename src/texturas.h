@@ -0,0 +1,30 @@
+// Texturas dos materiais na GPU, com cache por conteúdo: o mesmo arquivo (ou arquivos
+// diferentes com os mesmos bytes) vira uma única textura, mesmo entre modelos diferentes.
+// A decodificação roda em paralelo (imagem.h); o envio precisa de contexto GL corrente.
+
+#pragma once
+
+#include <GL/freeglut.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "imagem.h"
+
+using namespace std;
+
+struct CacheTexturas {
+    unordered_map<uint64_t, GLuint> porHash;
+    size_t decodificadas = 0;   // total desde a criação do cache
+    size_t reaproveitadas = 0;
+};
+
+// Cria a textura com todos os níveis já gerados em img (filtro trilinear, repetição)
+GLuint criarTexturaRGBA(const ImagemRGBA& img);
+
+// Uma textura por caminho em ids (0 se o arquivo falhou). Caminhos vazios dão 0 sem erro.
+void obterTexturas(CacheTexturas& cache, const vector<string>& caminhos, vector<GLuint>& ids, int numThreads = 0);
+
+// Apaga todas as texturas do cache
+void liberarTexturas(CacheTexturas& cache);
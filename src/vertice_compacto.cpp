@@ -0,0 +1,74 @@
+#include "vertice_compacto.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+static const float MAX_INT16 = 32767.0f;
+
+uint16_t paraMeiaPrecisao(float x) {
+    uint32_t b;
+    memcpy(&b, &x, sizeof(b));
+    const uint16_t sinal = (uint16_t)((b >> 16) & 0x8000u);
+    const uint32_t absoluto = b & 0x7fffffffu;
+    if (absoluto >= 0x7f800000u)                       // inf / NaN
+        return (uint16_t)(sinal | 0x7c00u | (absoluto > 0x7f800000u ? 0x200u : 0u));
+    if (absoluto >= 0x477ff000u) return (uint16_t)(sinal | 0x7c00u);   // estoura: inf
+    if (absoluto < 0x38800000u) {
+        // Subnormal em meia precisão (ou zero)
+        if (absoluto < 0x33000000u) return sinal;
+        const uint32_t expoente = absoluto >> 23;
+        const uint32_t mantissa = (absoluto & 0x7fffffu) | 0x800000u;
+        const uint32_t desloc = 126u - expoente;
+        uint32_t h = mantissa >> desloc;
+        const uint32_t resto = mantissa & ((1u << desloc) - 1u), meio = 1u << (desloc - 1u);
+        if (resto > meio || (resto == meio && (h & 1u))) ++h;
+        return (uint16_t)(sinal | h);
+    }
+    // Normal: reajusta o expoente e arredonda 13 bits de mantissa (empate para par)
+    uint32_t h = ((absoluto - 0x38000000u) >> 13);
+    const uint32_t resto = absoluto & 0x1fffu;
+    if (resto > 0x1000u || (resto == 0x1000u && (h & 1u))) ++h;
+    return (uint16_t)(sinal | h);
+}
+
+int8_t paraInt8Normalizado(float x) {
+    return (int8_t)lround(max(-1.0f, min(1.0f, x)) * 127.0f);
+}
+
+void compactarVertices(const VisaoMalhaIndexada& malha, vector<VerticeCompacto>& out, QuantizacaoPosicao& quant) {
+    const size_t n = malha.numVertices();
+    const float* v = malha.vertices.data();
+    float minimo[3] = { 0, 0, 0 }, maximo[3] = { 0, 0, 0 };
+    for (size_t i = 0; i < n; ++i)
+        for (int k = 0; k < 3; ++k) {
+            const float x = v[i * FLOATS_POR_VERTICE + k];
+            if (i == 0 || x < minimo[k]) minimo[k] = x;
+            if (i == 0 || x > maximo[k]) maximo[k] = x;
+        }
+    // Mesma escala nos três eixos: o maior meio-lado da caixa ocupa toda a faixa do int16
+    float meioLado = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        quant.deslocamento[k] = 0.5f * (minimo[k] + maximo[k]);
+        meioLado = max(meioLado, 0.5f * (maximo[k] - minimo[k]));
+    }
+    quant.escala = meioLado > 0.0f ? meioLado / MAX_INT16 : 1.0f;
+    const float inv = 1.0f / quant.escala;
+
+    out.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const float* f = v + i * FLOATS_POR_VERTICE;
+        VerticeCompacto& c = out[i];
+        for (int k = 0; k < 3; ++k) {
+            const float q = (f[k] - quant.deslocamento[k]) * inv;
+            c.posicao[k] = (int16_t)lround(max(-MAX_INT16, min(MAX_INT16, q)));
+        }
+        c.preenchimento = 0;
+        for (int k = 0; k < 3; ++k) c.normal[k] = paraInt8Normalizado(f[3 + k]);
+        c.preenchimentoNormal = 0;
+        c.uv[0] = paraMeiaPrecisao(f[6]);
+        c.uv[1] = paraMeiaPrecisao(f[7]);
+    }
+}
@@ -0,0 +1,40 @@
+// Formato compacto dos vértices da malha indexada (--compacto): 16 bytes por vértice em vez
+// dos 32 do formato intercalado em float.
+//   posição: 3 x int16 relativos à caixa envolvente (mais 2 bytes de preenchimento)
+//   normal:  3 x int8 normalizados (mais 1 byte de preenchimento)
+//   UV:      2 x meia precisão (GL_HALF_FLOAT)
+// Todos os três são aceitos pelos arrays do pipeline fixo (normais 10:10:10:2 caberiam nos
+// mesmos 4 bytes com mais precisão, mas o Mesa recusa GL_INT_2_10_10_10_REV no glNormalPointer).
+// A escala da posição é a mesma nos três eixos, então a dequantização é só um glTranslate +
+// glScale uniforme na modelview, que não distorce as normais.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "obj_loader.h"
+
+struct VerticeCompacto {
+    int16_t posicao[3];
+    int16_t preenchimento;
+    int8_t normal[3];
+    int8_t preenchimentoNormal;
+    uint16_t uv[2];
+};
+static_assert(sizeof(VerticeCompacto) == 16, "VerticeCompacto deve ter 16 bytes");
+
+// posição original = deslocamento + escala * posição quantizada
+struct QuantizacaoPosicao {
+    float escala = 1.0f;
+    float deslocamento[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// Converte os vértices intercalados da malha; os índices continuam valendo
+void compactarVertices(const VisaoMalhaIndexada& malha, vector<VerticeCompacto>& out, QuantizacaoPosicao& quant);
+
+// Float de 32 bits para meia precisão (arredondamento para o mais próximo)
+uint16_t paraMeiaPrecisao(float x);
+
+// Componente de normal em [-1, 1] para int8 normalizado
+int8_t paraInt8Normalizado(float x);